@@ -0,0 +1,316 @@
+/**
+ * @file ansiparser.cc
+ * @brief Definitions for AnsiParser class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "ansiparser.h"
+#include "textscan.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class AnsiParser
+ *
+ * The parser is a small state machine that works on raw bytes; it never
+ * allocates and keeps no reference to the input between calls. Plain
+ * text is handed to the sink in runs that point inside the input buffer.
+ *
+ * Only the sequences that influence how captured output looks are
+ * interpreted: SGR (colors and attributes), cursor up, erase in line
+ * and moving to the first column. Everything else is consumed silently.
+ */
+
+/**
+ * @class AnsiStyle
+ *
+ * Colors are indexes in the xterm 256 color palette (0-15 are the
+ * classic colors, 16-231 a 6x6x6 cube and 232-255 a gray ramp).
+ * True color requests are mapped to the closest palette entry.
+ */
+
+//! Values used by the 6x6x6 color cube.
+static const int cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+//! The classic 16 colors.
+static const quint32 base_colors[16] = {
+    0x000000, 0xcd0000, 0x00cd00, 0xcdcd00,
+    0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+    0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00,
+    0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff
+};
+
+/* ------------------------------------------------------------------------- */
+static int nearestLevel (int v)
+{
+    int best = 0;
+    for (int i = 1; i < 6; ++i) {
+        if (qAbs (cube_levels[i] - v) < qAbs (cube_levels[best] - v)) {
+            best = i;
+        }
+    }
+    return best;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int AnsiStyle::nearestColor (int r, int g, int b)
+{
+    int ri = nearestLevel (r);
+    int gi = nearestLevel (g);
+    int bi = nearestLevel (b);
+    int cube = 16 + 36 * ri + 6 * gi + bi;
+    int cube_err =
+            qAbs (cube_levels[ri] - r) +
+            qAbs (cube_levels[gi] - g) +
+            qAbs (cube_levels[bi] - b);
+
+    // the gray ramp may be closer for unsaturated colors
+    int avg = (r + g + b) / 3;
+    int gray_idx = qBound (0, (avg - 8 + 5) / 10, 23);
+    int gray = 8 + gray_idx * 10;
+    int gray_err = qAbs (gray - r) + qAbs (gray - g) + qAbs (gray - b);
+
+    return gray_err < cube_err ? 232 + gray_idx : cube;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+quint32 AnsiStyle::paletteColor (int index)
+{
+    if (index < 0 || index > 255)
+        return 0;
+    if (index < 16)
+        return base_colors[index];
+    if (index < 232) {
+        int i = index - 16;
+        return (cube_levels[i / 36] << 16) |
+                (cube_levels[(i / 6) % 6] << 8) |
+                cube_levels[i % 6];
+    }
+    int gray = 8 + (index - 232) * 10;
+    return (gray << 16) | (gray << 8) | gray;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+AnsiParser::AnsiParser ()
+{
+    reset ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void AnsiParser::reset ()
+{
+    state_ = Ground;
+    style_ = AnsiStyle::plain ();
+    param_count_ = 0;
+    b_private_ = false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static inline bool isPassedControl (unsigned char c)
+{
+    return (c == '\n') || (c == '\r') || (c == '\b') || (c == '\t');
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void AnsiParser::feed (const char * data, int size, AnsiSink * sink)
+{
+    const char * end = data + size;
+    const char * p = data;
+    while (p < end) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        switch (state_) {
+        case Ground: {
+            // hand over the longest run of printable bytes
+            const char * run = p;
+            p += TextScan::printableRun (p, static_cast<int>(end - p));
+            if (p != run) {
+                sink->ansiText (run, static_cast<int>(p - run));
+                continue;
+            }
+            if (c == 0x1b) {
+                state_ = Escape;
+            } else if (isPassedControl (c)) {
+                sink->ansiControl (static_cast<char>(c));
+            }
+            break; }
+
+        case Escape:
+            if (c == '[') {
+                state_ = Csi;
+                param_count_ = 1;
+                params_[0] = -1;
+                b_private_ = false;
+            } else if ((c == ']') || (c == 'P') || (c == 'X') ||
+                       (c == '^') || (c == '_')) {
+                state_ = Osc;
+            } else if ((c >= 0x20) && (c <= 0x2f)) {
+                state_ = EscapeIntermediate;
+            } else if (c == 0x1b) {
+                // stay
+            } else {
+                if (c == 'M') {
+                    // reverse index
+                    sink->ansiCursorUp (1);
+                }
+                state_ = Ground;
+            }
+            break;
+
+        case EscapeIntermediate:
+            if ((c >= 0x30) && (c <= 0x7e)) {
+                state_ = Ground;
+            } else if (c == 0x1b) {
+                state_ = Escape;
+            }
+            break;
+
+        case Csi:
+            if ((c >= '0') && (c <= '9')) {
+                int & prm = params_[param_count_ - 1];
+                if (prm < 0)
+                    prm = 0;
+                if (prm < 65535)
+                    prm = prm * 10 + (c - '0');
+            } else if ((c == ';') || (c == ':')) {
+                if (param_count_ < MAX_PARAMS) {
+                    params_[param_count_++] = -1;
+                }
+            } else if ((c >= 0x3c) && (c <= 0x3f)) {
+                b_private_ = true;
+            } else if ((c >= 0x20) && (c <= 0x2f)) {
+                // intermediate bytes; nothing we care about uses them
+            } else if ((c >= 0x40) && (c <= 0x7e)) {
+                state_ = Ground;
+                dispatchCsi (static_cast<char>(c), sink);
+            } else if (c == 0x1b) {
+                state_ = Escape;
+            } else if (isPassedControl (c)) {
+                sink->ansiControl (static_cast<char>(c));
+            }
+            break;
+
+        case Osc:
+            if (c == 0x07) {
+                state_ = Ground;
+            } else if (c == 0x1b) {
+                state_ = OscEscape;
+            }
+            break;
+
+        case OscEscape:
+            state_ = (c == '\\') ? Ground : Osc;
+            break;
+        }
+        ++p;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void AnsiParser::dispatchCsi (char final, AnsiSink * sink)
+{
+    if (b_private_)
+        return;
+
+    switch (final) {
+    case 'm':
+        applySgr ();
+        sink->ansiStyle (style_);
+        break;
+    case 'A':
+        sink->ansiCursorUp (qMax (1, param (0, 1)));
+        break;
+    case 'F':
+        sink->ansiCursorUp (qMax (1, param (0, 1)));
+        sink->ansiControl ('\r');
+        break;
+    case 'G':
+        if (param (0, 1) <= 1) {
+            sink->ansiControl ('\r');
+        }
+        break;
+    case 'K':
+        sink->ansiEraseLine (param (0, 0));
+        break;
+    default:
+        break;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void AnsiParser::applySgr ()
+{
+    for (int i = 0; i < param_count_; ++i) {
+        int v = params_[i] < 0 ? 0 : params_[i];
+        if (v == 0) {
+            style_ = AnsiStyle::plain ();
+        } else if (v == 1) {
+            style_ |= AnsiStyle::BOLD;
+        } else if (v == 2) {
+            style_ |= AnsiStyle::FAINT;
+        } else if (v == 3) {
+            style_ |= AnsiStyle::ITALIC;
+        } else if (v == 4) {
+            style_ |= AnsiStyle::UNDERLINE;
+        } else if (v == 7) {
+            style_ |= AnsiStyle::INVERSE;
+        } else if (v == 9) {
+            style_ |= AnsiStyle::STRIKE;
+        } else if ((v == 21) || (v == 22)) {
+            style_ &= ~(AnsiStyle::BOLD | AnsiStyle::FAINT);
+        } else if (v == 23) {
+            style_ &= ~AnsiStyle::ITALIC;
+        } else if (v == 24) {
+            style_ &= ~AnsiStyle::UNDERLINE;
+        } else if (v == 27) {
+            style_ &= ~AnsiStyle::INVERSE;
+        } else if (v == 29) {
+            style_ &= ~AnsiStyle::STRIKE;
+        } else if ((v >= 30) && (v <= 37)) {
+            style_ = AnsiStyle::withForeground (style_, v - 30);
+        } else if (v == 39) {
+            style_ = AnsiStyle::withForeground (style_, AnsiStyle::COLOR_DEFAULT);
+        } else if ((v >= 40) && (v <= 47)) {
+            style_ = AnsiStyle::withBackground (style_, v - 40);
+        } else if (v == 49) {
+            style_ = AnsiStyle::withBackground (style_, AnsiStyle::COLOR_DEFAULT);
+        } else if ((v >= 90) && (v <= 97)) {
+            style_ = AnsiStyle::withForeground (style_, v - 90 + 8);
+        } else if ((v >= 100) && (v <= 107)) {
+            style_ = AnsiStyle::withBackground (style_, v - 100 + 8);
+        } else if ((v == 38) || (v == 48)) {
+            // extended color: 5;n or 2;r;g;b
+            int color = -1;
+            int kind = param (i + 1, -1);
+            if ((kind == 5) && (i + 2 < param_count_)) {
+                color = qBound (0, param (i + 2, 0), 255);
+                i += 2;
+            } else if ((kind == 2) && (i + 4 < param_count_)) {
+                color = AnsiStyle::nearestColor (
+                            qBound (0, param (i + 2, 0), 255),
+                            qBound (0, param (i + 3, 0), 255),
+                            qBound (0, param (i + 4, 0), 255));
+                i += 4;
+            } else {
+                // malformed; ignore the rest
+                break;
+            }
+            if (v == 38) {
+                style_ = AnsiStyle::withForeground (style_, color);
+            } else {
+                style_ = AnsiStyle::withBackground (style_, color);
+            }
+        }
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,187 @@
+/**
+ * @file ansiparser.h
+ * @brief Declarations for AnsiParser class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_ANSIPARSER_H_INCLUDE
+#define GUARD_ANSIPARSER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QtGlobal>
+
+//! Packed representation of text colors and attributes.
+class PROCRUNGUI_EXPORT AnsiStyle {
+
+public:
+
+    //! Bits in the packed value.
+    enum Bits {
+        COLOR_DEFAULT = 0x100, /**< color value meaning "not set" */
+        FG_MASK = 0x000001FF, /**< foreground (0-255 or COLOR_DEFAULT) */
+        BG_SHIFT = 9, /**< where the background starts */
+        BG_MASK = 0x0003FE00, /**< background (0-255 or COLOR_DEFAULT) */
+        BOLD = 0x00040000,
+        FAINT = 0x00080000,
+        ITALIC = 0x00100000,
+        UNDERLINE = 0x00200000,
+        INVERSE = 0x00400000,
+        STRIKE = 0x00800000
+    };
+
+    //! The style with no colors and no attributes.
+    static quint32
+    plain () {
+        return COLOR_DEFAULT | (COLOR_DEFAULT << BG_SHIFT);
+    }
+
+    //! Foreground color index (0-255) or COLOR_DEFAULT.
+    static int
+    foreground (
+            quint32 style) {
+        return static_cast<int>(style & FG_MASK);
+    }
+
+    //! Background color index (0-255) or COLOR_DEFAULT.
+    static int
+    background (
+            quint32 style) {
+        return static_cast<int>((style & BG_MASK) >> BG_SHIFT);
+    }
+
+    //! Change the foreground color.
+    static quint32
+    withForeground (
+            quint32 style,
+            int color) {
+        return (style & ~FG_MASK) | (static_cast<quint32>(color) & FG_MASK);
+    }
+
+    //! Change the background color.
+    static quint32
+    withBackground (
+            quint32 style,
+            int color) {
+        return (style & ~BG_MASK) |
+                ((static_cast<quint32>(color) << BG_SHIFT) & BG_MASK);
+    }
+
+    //! Color index of the xterm 256 color palette closest to a RGB value.
+    static int
+    nearestColor (
+            int r,
+            int g,
+            int b);
+
+    //! The RGB value (0xRRGGBB) of a color in the xterm 256 color palette.
+    static quint32
+    paletteColor (
+            int index);
+};
+
+//! Receives the pieces produced by AnsiParser.
+class PROCRUNGUI_EXPORT AnsiSink {
+
+public:
+
+    //! Destructor.
+    virtual ~AnsiSink () {}
+
+    //! Printable text (UTF-8 bytes); the pointer is only valid during the call.
+    virtual void
+    ansiText (
+            const char * data,
+            int size) = 0;
+
+    //! Style for the text that follows.
+    virtual void
+    ansiStyle (
+            quint32 style) = 0;
+
+    //! A control character (\\n, \\r, \\b, \\t).
+    virtual void
+    ansiControl (
+            char c) = 0;
+
+    //! Cursor moved up a number of lines (CSI n A, CSI n F).
+    virtual void
+    ansiCursorUp (
+            int) {}
+
+    //! Erase in line (CSI n K): 0 - to end, 1 - to start, 2 - all.
+    virtual void
+    ansiEraseLine (
+            int) {}
+};
+
+//! Streaming parser for ANSI/VT escape sequences.
+class PROCRUNGUI_EXPORT AnsiParser {
+
+public:
+
+    //! Maximum number of numeric parameters kept for a sequence.
+    enum { MAX_PARAMS = 16 };
+
+    //! Default constructor.
+    AnsiParser ();
+
+    //! Go back to initial state.
+    void
+    reset ();
+
+    //! Parse a piece of input; sequences may be split between calls.
+    void
+    feed (
+            const char * data,
+            int size,
+            AnsiSink * sink);
+
+    //! Current style.
+    quint32
+    style () const {
+        return style_;
+    }
+
+private:
+
+    //! Where we are inside a sequence.
+    enum State {
+        Ground, /**< plain text */
+        Escape, /**< after ESC */
+        EscapeIntermediate, /**< after ESC and an intermediate byte */
+        Csi, /**< after ESC [ */
+        Osc, /**< after ESC ] (or P, X, ^, _) */
+        OscEscape /**< ESC seen inside an OSC string */
+    };
+
+    //! A CSI sequence is complete.
+    void
+    dispatchCsi (
+            char final,
+            AnsiSink * sink);
+
+    //! Apply Select Graphic Rendition parameters.
+    void
+    applySgr ();
+
+    //! Parameter at index or a default value if missing.
+    int
+    param (
+            int index,
+            int def) const {
+        return ((index < param_count_) && (params_[index] >= 0)) ?
+                    params_[index] : def;
+    }
+
+    State state_; /**< current state */
+    quint32 style_; /**< current style */
+    int params_[MAX_PARAMS]; /**< parameters of current CSI (-1 if empty) */
+    int param_count_; /**< number of parameters */
+    bool b_private_; /**< CSI has a private marker (?, >, =, <) */
+};
+
+#endif // GUARD_ANSIPARSER_H_INCLUDE
@@ -0,0 +1,174 @@
+/**
+ * @file commandtemplate.cc
+ * @brief Definitions for CommandTemplate class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "commandtemplate.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+#include <QDir>
+#include <QRegularExpression>
+
+/**
+ * @class CommandTemplate
+ *
+ * A saved command becomes a template when a placeholder and its values
+ * are stored for it; {name} may then appear in the program, the
+ * arguments, the working directory and the inputs. Running it with
+ * ProcRunGui::fanOut () starts an instance for each value.
+ *
+ * The values are written in one of three ways:
+ * - a glob like *.csv, matched against the files of a single directory
+ *   that may precede it (relative paths are looked up in the working
+ *   directory of the command and passed on as written);
+ * - an integer range like 0..15 (both ends included);
+ * - a list separated by commas.
+ */
+
+#define STG_TEMPLATE_GROUP "Template"
+#define STG_TEMPLATE_NAME "Placeholder"
+#define STG_TEMPLATE_VALUES "Values"
+#define STG_TEMPLATE_PARALLEL "MaxParallel"
+
+//! Largest number of instances a range may produce.
+#define MAX_RANGE_VALUES 100000
+
+/* ------------------------------------------------------------------------- */
+void CommandTemplate::load (QSettings & stg, const QString & s_key)
+{
+    stg.beginGroup (QLatin1String (STG_TEMPLATE_GROUP));
+    stg.beginGroup (s_key);
+    s_placeholder_ = stg.value (QLatin1String (STG_TEMPLATE_NAME)).toString ();
+    s_values_ = stg.value (QLatin1String (STG_TEMPLATE_VALUES)).toString ();
+    max_parallel_ = stg.value (QLatin1String (STG_TEMPLATE_PARALLEL), 0).toInt ();
+    stg.endGroup ();
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void CommandTemplate::save (QSettings & stg, const QString & s_key) const
+{
+    stg.beginGroup (QLatin1String (STG_TEMPLATE_GROUP));
+    if (isEmpty ()) {
+        stg.remove (s_key);
+    } else {
+        stg.beginGroup (s_key);
+        stg.setValue (QLatin1String (STG_TEMPLATE_NAME), s_placeholder_);
+        stg.setValue (QLatin1String (STG_TEMPLATE_VALUES), s_values_);
+        stg.setValue (QLatin1String (STG_TEMPLATE_PARALLEL), max_parallel_);
+        stg.endGroup ();
+    }
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QStringList CommandTemplate::values (const QString & s_wrk_dir) const
+{
+    QStringList result;
+    QString s_spec = s_values_.trimmed ();
+
+    static const QRegularExpression range (
+                QLatin1String ("^(-?\\d+)\\s*\\.\\.\\s*(-?\\d+)$"));
+    QRegularExpressionMatch m = range.match (s_spec);
+    if (m.hasMatch ()) {
+        qint64 first = m.captured (1).toLongLong ();
+        qint64 last = m.captured (2).toLongLong ();
+        if ((last >= first) && (last - first < MAX_RANGE_VALUES)) {
+            for (qint64 i = first; i <= last; ++i) {
+                result.append (QString::number (i));
+            }
+        } else {
+            PROCRUNGUI_DEBUGM("Ignoring range %s\n", TMP_A(s_spec));
+        }
+        return result;
+    }
+
+    if (isGlob (s_spec))
+        return glob (s_spec, s_wrk_dir);
+
+    foreach(const QString & s_part, s_spec.split (QChar (','))) {
+        QString s_value = s_part.trimmed ();
+        if (!s_value.isEmpty ()) {
+            result.append (s_value);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Globs are resolved in the working directory of the command, unless
+ * that one depends on the placeholder too.
+ */
+QList<ProcRunData> CommandTemplate::instances (const ProcRunData & data) const
+{
+    QList<ProcRunData> result;
+    if (isEmpty ())
+        return result;
+
+    QString s_name = s_placeholder_.trimmed ();
+    QString s_token = QChar ('{') + s_name + QChar ('}');
+    QString s_wrk_dir;
+    if (!data.s_wrk_dir_.contains (s_token)) {
+        s_wrk_dir = data.s_wrk_dir_;
+    }
+    foreach(const QString & s_value, values (s_wrk_dir)) {
+        result.append (expand (data, s_name, s_value));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool CommandTemplate::isGlob (const QString & s_value)
+{
+    return s_value.contains (QChar ('*')) || s_value.contains (QChar ('?')) ||
+            s_value.contains (QChar ('['));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QStringList CommandTemplate::glob (
+        const QString & s_pattern, const QString & s_wrk_dir)
+{
+    QStringList result;
+    QString s_path = QDir::fromNativeSeparators (s_pattern);
+    int slash = s_path.lastIndexOf (QChar ('/'));
+    QString s_prefix = s_path.left (slash + 1);
+    QString s_dir = s_prefix.isEmpty () ? QString (QLatin1String (".")) : s_prefix;
+    if (QDir::isRelativePath (s_dir) && !s_wrk_dir.isEmpty ()) {
+        s_dir = QDir (s_wrk_dir).filePath (s_dir);
+    }
+    QDir dir (s_dir);
+    QStringList sl_names = dir.entryList (
+                QStringList (s_path.mid (slash + 1)),
+                QDir::Files, QDir::Name);
+    foreach(const QString & s_name, sl_names) {
+        result.append (s_prefix + s_name);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunData CommandTemplate::expand (
+        const ProcRunData & data, const QString & s_name, const QString & s_value)
+{
+    QString s_token = QChar ('{') + s_name + QChar ('}');
+    ProcRunData result = data;
+    result.s_program_.replace (s_token, s_value);
+    result.s_wrk_dir_.replace (s_token, s_value);
+    result.sl_arguments_.replaceInStrings (s_token, s_value);
+    result.sl_input_.replaceInStrings (s_token, s_value);
+    return result;
+}
+/* ========================================================================= */
@@ -0,0 +1,86 @@
+/**
+ * @file commandtemplate.h
+ * @brief Declarations for CommandTemplate class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_COMMANDTEMPLATE_H_INCLUDE
+#define GUARD_COMMANDTEMPLATE_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrun/procrundata.h>
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+//! A placeholder in a command and the values it is replaced with.
+struct PROCRUNGUI_EXPORT CommandTemplate {
+
+    //! Default constructor.
+    CommandTemplate () :
+        s_placeholder_ (),
+        s_values_ (),
+        max_parallel_ (0)
+    {}
+
+    //! Tell if the command is not a template.
+    bool
+    isEmpty () const {
+        return s_placeholder_.trimmed ().isEmpty () ||
+                s_values_.trimmed ().isEmpty ();
+    }
+
+    //! Read the template stored for a command.
+    void
+    load (
+            QSettings & stg,
+            const QString & s_key);
+
+    //! Store the template for a command.
+    void
+    save (
+            QSettings & stg,
+            const QString & s_key) const;
+
+    //! The values, with globs resolved in @a s_wrk_dir.
+    QStringList
+    values (
+            const QString & s_wrk_dir) const;
+
+    //! One command for each value.
+    QList<ProcRunData>
+    instances (
+            const ProcRunData & data) const;
+
+    //! Files matching a single-directory glob, as written (sorted by name).
+    static QStringList
+    glob (
+            const QString & s_pattern,
+            const QString & s_wrk_dir);
+
+    //! Tell if a value looks like a glob.
+    static bool
+    isGlob (
+            const QString & s_value);
+
+    //! Replace {name} with @a s_value in all parts of a command.
+    static ProcRunData
+    expand (
+            const ProcRunData & data,
+            const QString & s_name,
+            const QString & s_value);
+
+    QString s_placeholder_; /**< name used between braces, e.g. file */
+    QString s_values_; /**< a list (a, b), a range (0..15) or a glob (*.txt) */
+    int max_parallel_; /**< instances running at the same time (0 for all) */
+};
+
+#endif // GUARD_COMMANDTEMPLATE_H_INCLUDE
@@ -0,0 +1,352 @@
+/**
+ * @file launchprofile.cc
+ * @brief Definitions for LaunchProfile class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "launchprofile.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+#include <QProcessEnvironment>
+#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QFile>
+#include <QDir>
+
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   include <sched.h>
+#   include <sys/resource.h>
+#   include <sys/syscall.h>
+#endif
+
+/**
+ * @class LaunchLimits
+ *
+ * Everything the child needs is computed before fork into a Params
+ * structure; applyInChild () only makes system calls, so it is safe to
+ * run between fork and exec, in our children or in those of the
+ * launcher helper (see ProcLauncher).
+ * Failures in the child cannot be reported back, so a short message is
+ * written to its standard error, where it shows up in the output.
+ *
+ * The memory limit uses a cgroup v2 control group with memory.max when
+ * the parent of our own group is delegated to us (the usual case for a
+ * desktop session under systemd); the child moves itself into it. When
+ * that is not possible the address space of the child is limited with
+ * setrlimit () instead, which is not inherited as a total by its own
+ * children. The group is removed once the process ended and all its
+ * members are gone.
+ *
+ * Only Linux is supported for now.
+ */
+
+#define STG_PROFILE_GROUP "LaunchProfile"
+#define STG_PROFILE_ENV "Environment"
+#define STG_PROFILE_NICE "Nice"
+#define STG_PROFILE_IO_CLASS "IoClass"
+#define STG_PROFILE_IO_LEVEL "IoLevel"
+#define STG_PROFILE_CPUS "Cpus"
+#define STG_PROFILE_MEMORY "MemoryMB"
+
+/* ------------------------------------------------------------------------- */
+void LaunchProfile::load (QSettings & stg, const QString & s_key)
+{
+    stg.beginGroup (QLatin1String (STG_PROFILE_GROUP));
+    stg.beginGroup (s_key);
+    sl_env_ = stg.value (QLatin1String (STG_PROFILE_ENV)).toStringList ();
+    nice_ = stg.value (QLatin1String (STG_PROFILE_NICE), 0).toInt ();
+    io_class_ = stg.value (QLatin1String (STG_PROFILE_IO_CLASS), IoDefault).toInt ();
+    io_level_ = stg.value (QLatin1String (STG_PROFILE_IO_LEVEL), 4).toInt ();
+    s_cpus_ = stg.value (QLatin1String (STG_PROFILE_CPUS)).toString ();
+    memory_mb_ = stg.value (QLatin1String (STG_PROFILE_MEMORY), 0).toLongLong ();
+    stg.endGroup ();
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void LaunchProfile::save (QSettings & stg, const QString & s_key) const
+{
+    stg.beginGroup (QLatin1String (STG_PROFILE_GROUP));
+    if (isEmpty ()) {
+        stg.remove (s_key);
+    } else {
+        stg.beginGroup (s_key);
+        stg.setValue (QLatin1String (STG_PROFILE_ENV), sl_env_);
+        stg.setValue (QLatin1String (STG_PROFILE_NICE), nice_);
+        stg.setValue (QLatin1String (STG_PROFILE_IO_CLASS), io_class_);
+        stg.setValue (QLatin1String (STG_PROFILE_IO_LEVEL), io_level_);
+        stg.setValue (QLatin1String (STG_PROFILE_CPUS), s_cpus_);
+        stg.setValue (QLatin1String (STG_PROFILE_MEMORY), memory_mb_);
+        stg.endGroup ();
+    }
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void LaunchProfile::applyEnvironment (QProcessEnvironment & env) const
+{
+    foreach(const QString & s_entry, sl_env_) {
+        QString s_line = s_entry.trimmed ();
+        if (s_line.isEmpty ())
+            continue;
+        int eq = s_line.indexOf (QChar ('='));
+        if (eq == -1) {
+            env.remove (s_line);
+        } else {
+            env.insert (s_line.left (eq), s_line.mid (eq + 1));
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool LaunchProfile::parseCpus (const QString & s_cpus, QList<int> & cpus)
+{
+    cpus.clear ();
+    foreach(const QString & s_part, s_cpus.split (QChar (','))) {
+        QString s_range = s_part.trimmed ();
+        if (s_range.isEmpty ())
+            continue;
+
+        bool b_ok_first;
+        bool b_ok_last;
+        int first;
+        int last;
+        int dash = s_range.indexOf (QChar ('-'));
+        if (dash == -1) {
+            first = s_range.toInt (&b_ok_first);
+            last = first;
+            b_ok_last = true;
+        } else {
+            first = s_range.left (dash).trimmed ().toInt (&b_ok_first);
+            last = s_range.mid (dash + 1).trimmed ().toInt (&b_ok_last);
+        }
+        if (!b_ok_first || !b_ok_last || (first < 0) || (last < first) ||
+                (last >= LaunchLimits::MAX_CPUS))
+            return false;
+
+        for (int i = first; i <= last; ++i) {
+            if (!cpus.contains (i)) {
+                cpus.append (i);
+            }
+        }
+    }
+    return !cpus.isEmpty ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+LaunchLimits::LaunchLimits (const LaunchProfile & profile) :
+    params_ (),
+    cgroup_dir_ ()
+{
+    memset (&params_, 0, sizeof(params_));
+    params_.nice_ = qBound (-20, profile.nice_, 19);
+
+    if ((profile.io_class_ > LaunchProfile::IoDefault) &&
+            (profile.io_class_ <= LaunchProfile::IoIdle)) {
+        int level = profile.io_class_ == LaunchProfile::IoIdle ?
+                    0 : qBound (0, profile.io_level_, 7);
+        params_.ioprio_ = (profile.io_class_ << 13) | level;
+    }
+
+    if (!profile.s_cpus_.isEmpty ()) {
+        QList<int> cpus;
+        if (LaunchProfile::parseCpus (profile.s_cpus_, cpus)) {
+            foreach(int cpu, cpus) {
+                params_.cpus_[cpu / 64] |= Q_UINT64_C(1) << (cpu % 64);
+            }
+            params_.b_cpus_ = 1;
+        } else {
+            PROCRUNGUI_DEBUGM("Ignoring malformed processor list %s\n",
+                              TMP_A(profile.s_cpus_));
+        }
+    }
+
+    if (profile.memory_mb_ > 0) {
+        qint64 bytes = profile.memory_mb_ * 1024 * 1024;
+        if (!createCgroup (bytes)) {
+            params_.memory_bytes_ = bytes;
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+LaunchLimits::~LaunchLimits()
+{
+    release ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool LaunchLimits::isSupported ()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The group is created next to our own one, as groups that have
+ * processes can't enable controllers for their children.
+ */
+bool LaunchLimits::createCgroup (qint64 bytes)
+{
+#ifdef Q_OS_LINUX
+    static QAtomicInt serial;
+
+    QFile fself (QLatin1String ("/proc/self/cgroup"));
+    if (!fself.open (QIODevice::ReadOnly))
+        return false;
+    QString s_own;
+    foreach(const QByteArray & line, fself.readAll ().split ('\n')) {
+        if (line.startsWith ("0::")) {
+            s_own = QString::fromUtf8 (line.mid (3).trimmed ());
+            break;
+        }
+    }
+    if (s_own.isEmpty ())
+        return false;
+
+    QDir dparent (QLatin1String ("/sys/fs/cgroup") + s_own);
+    if (!dparent.cdUp ())
+        return false;
+
+    QFile fctl (dparent.absoluteFilePath (
+                    QLatin1String ("cgroup.subtree_control")));
+    if (!fctl.open (QIODevice::ReadOnly) ||
+            !fctl.readAll ().trimmed ().split (' ').contains ("memory"))
+        return false;
+
+    QString s_name = QString (QLatin1String ("procrungui-%1-%2"))
+            .arg (QCoreApplication::applicationPid ())
+            .arg (serial.fetchAndAddRelaxed (1));
+    if (!dparent.mkdir (s_name)) {
+        PROCRUNGUI_DEBUGM("Failed to create control group in %s\n",
+                          TMP_A(dparent.absolutePath ()));
+        return false;
+    }
+
+    QString s_dir = dparent.absoluteFilePath (s_name);
+    QFile fmax (s_dir + QLatin1String ("/memory.max"));
+    if (!fmax.open (QIODevice::WriteOnly) ||
+            (fmax.write (QByteArray::number (bytes)) <= 0)) {
+        fmax.close ();
+        dparent.rmdir (s_name);
+        return false;
+    }
+    fmax.close ();
+
+    QByteArray procs = QFile::encodeName (
+                s_dir + QLatin1String ("/cgroup.procs"));
+    if (procs.size () >= MAX_PATH) {
+        dparent.rmdir (s_name);
+        return false;
+    }
+    memcpy (params_.cgroup_procs_, procs.constData (),
+            static_cast<size_t> (procs.size ()) + 1);
+    cgroup_dir_ = QFile::encodeName (s_dir);
+    return true;
+#else
+    Q_UNUSED(bytes);
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+#ifdef Q_OS_LINUX
+/* ------------------------------------------------------------------------- */
+static void childWarn (const char * message)
+{
+    ssize_t res = ::write (2, message, strlen (message));
+    (void)res;
+}
+/* ========================================================================= */
+#endif
+
+/* ------------------------------------------------------------------------- */
+void LaunchLimits::applyInChild (const Params & params)
+{
+#ifdef Q_OS_LINUX
+    if (params.cgroup_procs_[0] != 0) {
+        int fd = ::open (params.cgroup_procs_, O_WRONLY | O_CLOEXEC);
+        if ((fd == -1) || (::write (fd, "0", 1) != 1)) {
+            childWarn ("procrungui: failed to enter the memory control group\n");
+        }
+        if (fd != -1) {
+            ::close (fd);
+        }
+    }
+
+    if (params.memory_bytes_ > 0) {
+        struct rlimit rl;
+        rl.rlim_cur = static_cast<rlim_t> (params.memory_bytes_);
+        rl.rlim_max = static_cast<rlim_t> (params.memory_bytes_);
+        if (::setrlimit (RLIMIT_AS, &rl) != 0) {
+            childWarn ("procrungui: failed to limit memory\n");
+        }
+    }
+
+    if (params.nice_ != 0) {
+        if (::setpriority (PRIO_PROCESS, 0, params.nice_) != 0) {
+            childWarn ("procrungui: failed to change niceness\n");
+        }
+    }
+
+    if (params.ioprio_ != 0) {
+        // IOPRIO_WHO_PROCESS, this process
+        if (::syscall (SYS_ioprio_set, 1, 0, params.ioprio_) != 0) {
+            childWarn ("procrungui: failed to change disk priority\n");
+        }
+    }
+
+    if (params.b_cpus_ != 0) {
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        for (int i = 0; (i < MAX_CPUS) && (i < CPU_SETSIZE); ++i) {
+            if ((params.cpus_[i / 64] & (Q_UINT64_C(1) << (i % 64))) != 0) {
+                CPU_SET (i, &set);
+            }
+        }
+        if (::sched_setaffinity (0, sizeof(set), &set) != 0) {
+            childWarn ("procrungui: failed to set processor affinity\n");
+        }
+    }
+#else
+    Q_UNUSED(params);
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void LaunchLimits::release ()
+{
+#ifdef Q_OS_LINUX
+    if (cgroup_dir_.isEmpty ())
+        return;
+    if (::rmdir (cgroup_dir_.constData ()) == 0) {
+        cgroup_dir_.clear ();
+    } else {
+        PROCRUNGUI_DEBUGM("Control group %s not removed yet (%d)\n",
+                          cgroup_dir_.constData (), errno);
+    }
+#endif
+}
+/* ========================================================================= */
@@ -0,0 +1,155 @@
+/**
+ * @file launchprofile.h
+ * @brief Declarations for LaunchProfile class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_LAUNCHPROFILE_H_INCLUDE
+#define GUARD_LAUNCHPROFILE_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+class QProcessEnvironment;
+QT_END_NAMESPACE
+
+//! Environment and resource limits for a command.
+struct PROCRUNGUI_EXPORT LaunchProfile {
+
+    //! Input/output scheduling classes (see ioprio_set).
+    enum IoClass {
+        IoDefault = 0, /**< inherit ours */
+        IoRealtime = 1, /**< served first (needs privileges) */
+        IoBestEffort = 2, /**< normal, with a priority level */
+        IoIdle = 3 /**< only when nobody else uses the disk */
+    };
+
+    //! Default constructor.
+    LaunchProfile () :
+        sl_env_ (),
+        nice_ (0),
+        io_class_ (IoDefault),
+        io_level_ (4),
+        s_cpus_ (),
+        memory_mb_ (0)
+    {}
+
+    //! Tell if the profile changes nothing.
+    bool
+    isEmpty () const {
+        return sl_env_.isEmpty () && (nice_ == 0) &&
+                (io_class_ == IoDefault) && s_cpus_.isEmpty () &&
+                (memory_mb_ <= 0);
+    }
+
+    //! Read the profile stored for a command.
+    void
+    load (
+            QSettings & stg,
+            const QString & s_key);
+
+    //! Store the profile for a command.
+    void
+    save (
+            QSettings & stg,
+            const QString & s_key) const;
+
+    //! Apply the environment overrides.
+    void
+    applyEnvironment (
+            QProcessEnvironment & env) const;
+
+    //! Parse a list of processors like "0-3,8"; false if malformed.
+    static bool
+    parseCpus (
+            const QString & s_cpus,
+            QList<int> & cpus);
+
+    QStringList sl_env_; /**< NAME=value sets, NAME alone removes */
+    int nice_; /**< scheduling niceness (-20 to 19) */
+    int io_class_; /**< see IoClass */
+    int io_level_; /**< 0 (highest) to 7 for realtime and best effort */
+    QString s_cpus_; /**< processors the command may use (empty for all) */
+    qint64 memory_mb_; /**< memory limit in megabytes (0 for none) */
+};
+
+//! Applies a LaunchProfile to a child process.
+class PROCRUNGUI_EXPORT LaunchLimits {
+
+public:
+
+    //! Limits of the representation.
+    enum {
+        MAX_CPUS = 1024, /**< processors that can be named in a profile */
+        MAX_PATH = 512 /**< longest control group path */
+    };
+
+    //! What the child has to do; plain data, so it may cross processes.
+    struct Params {
+        int nice_; /**< niceness or 0 to leave alone */
+        int ioprio_; /**< value for ioprio_set or 0 to leave alone */
+        int b_cpus_; /**< cpus_ is in use */
+        quint64 cpus_[MAX_CPUS / 64]; /**< affinity mask */
+        qint64 memory_bytes_; /**< address space limit or 0 */
+        char cgroup_procs_[MAX_PATH]; /**< file the child writes itself into */
+    };
+
+    //! Constructor; prepares what the child will need.
+    LaunchLimits (
+            const LaunchProfile & profile);
+
+    //! Destructor; removes the control group.
+    virtual ~LaunchLimits();
+
+    //! Tell if limits are supported on this platform.
+    static bool
+    isSupported ();
+
+    //! What the child has to do.
+    const Params &
+    params () const {
+        return params_;
+    }
+
+    //! Runs in the child after fork; async-signal-safe.
+    void
+    setupChild () const {
+        applyInChild (params_);
+    }
+
+    //! Apply parameters in a child after fork; async-signal-safe.
+    static void
+    applyInChild (
+            const Params & params);
+
+    //! Tell if memory is limited through a control group.
+    bool
+    usesCgroup () const {
+        return !cgroup_dir_.isEmpty ();
+    }
+
+    //! Remove the control group (only succeeds once it is empty).
+    void
+    release ();
+
+private:
+
+    //! Create a control group with memory.max; false if not possible.
+    bool
+    createCgroup (
+            qint64 bytes);
+
+    Params params_; /**< what the child does */
+    QByteArray cgroup_dir_; /**< our control group (empty if none) */
+};
+
+#endif // GUARD_LAUNCHPROFILE_H_INCLUDE
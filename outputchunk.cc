@@ -0,0 +1,97 @@
+/**
+ * @file outputchunk.cc
+ * @brief Definitions for OutputChunk and OutputChunkPool classes.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputchunk.h"
+
+#include "procrungui-private.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+/**
+ * @class OutputChunkPool
+ *
+ * Chunks are reference counted so that the store, the viewers and
+ * background tasks may hold on to the same memory. When the last
+ * reference goes away the chunk goes back to a free list; at most
+ * MAX_FREE chunks are kept there, the rest are returned to the system.
+ */
+
+//! Shared state of the pool.
+struct PoolData {
+    QMutex mutex_; /**< protects the list */
+    QVector<OutputChunk*> free_; /**< chunks waiting to be reused */
+    QAtomicInt used_; /**< chunks handed out */
+};
+
+/* ------------------------------------------------------------------------- */
+static PoolData & poolData ()
+{
+    static PoolData data;
+    return data;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputChunk * OutputChunkPool::acquire ()
+{
+    PoolData & pd = poolData ();
+    OutputChunk * result = NULL;
+    {
+        QMutexLocker lock (&pd.mutex_);
+        if (!pd.free_.isEmpty ()) {
+            result = pd.free_.takeLast ();
+        }
+    }
+    if (result == NULL) {
+        result = new OutputChunk;
+    }
+    result->ref_.store (1);
+    pd.used_.ref ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputChunkPool::release (OutputChunk * chunk)
+{
+    if (chunk == NULL)
+        return;
+    if (chunk->ref_.deref ())
+        return;
+
+    PoolData & pd = poolData ();
+    pd.used_.deref ();
+    {
+        QMutexLocker lock (&pd.mutex_);
+        if (pd.free_.count () < MAX_FREE) {
+            pd.free_.append (chunk);
+            return;
+        }
+    }
+    delete chunk;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int OutputChunkPool::freeCount ()
+{
+    PoolData & pd = poolData ();
+    QMutexLocker lock (&pd.mutex_);
+    return pd.free_.count ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int OutputChunkPool::usedCount ()
+{
+    return poolData ().used_.load ();
+}
+/* ========================================================================= */
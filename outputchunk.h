@@ -0,0 +1,60 @@
+/**
+ * @file outputchunk.h
+ * @brief Declarations for OutputChunk and OutputChunkPool classes
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTCHUNK_H_INCLUDE
+#define GUARD_OUTPUTCHUNK_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QAtomicInt>
+
+//! A fixed-size block of captured output.
+struct PROCRUNGUI_EXPORT OutputChunk {
+
+    //! Number of bytes in each chunk.
+    enum { SIZE = 64 * 1024 };
+
+    QAtomicInt ref_; /**< number of owners */
+    char data_[SIZE]; /**< the bytes */
+};
+
+//! Recycles output chunks so that capturing does not allocate.
+class PROCRUNGUI_EXPORT OutputChunkPool {
+
+public:
+
+    //! Number of unused chunks kept around for reuse.
+    enum { MAX_FREE = 64 };
+
+    //! Get a chunk with a reference count of one.
+    static OutputChunk *
+    acquire ();
+
+    //! Add an owner to a chunk.
+    static void
+    addRef (
+            OutputChunk * chunk) {
+        chunk->ref_.ref ();
+    }
+
+    //! Remove an owner; the last one returns the chunk to the pool.
+    static void
+    release (
+            OutputChunk * chunk);
+
+    //! Number of chunks waiting to be reused.
+    static int
+    freeCount ();
+
+    //! Number of chunks in use right now.
+    static int
+    usedCount ();
+};
+
+#endif // GUARD_OUTPUTCHUNK_H_INCLUDE
@@ -0,0 +1,395 @@
+/**
+ * @file outputexporter.cc
+ * @brief Definitions for OutputExporter class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputexporter.h"
+#include "outputchunk.h"
+#include "textscan.h"
+
+#include "procrungui-private.h"
+
+#include <QThreadPool>
+#include <QSaveFile>
+#include <QFileInfo>
+
+/**
+ * @class OutputExporter
+ *
+ * addRun () is called in the thread of the outputs and only copies
+ * their index - the vectors are shared, so this costs nothing - and
+ * takes a reference to each chunk that is not packed, like OutputPacker
+ * does; packed chunks and mapped logs (see ProcOutput::mapLog ()) are
+ * shared as well. The worker thread then reads the text straight from
+ * that memory, so neither the outputs nor their processes need to stay
+ * around, and the thread of the outputs is never blocked.
+ *
+ * The outputs must not be written to anymore: the runs of processes
+ * that ended. Lines are written as they are stored (the last state of
+ * redrawn lines, repeats folded); text that is not valid UTF-8 is
+ * decoded with replacement characters.
+ *
+ * In the JSON Lines format each run starts with a record of type "run"
+ * holding its metadata, followed by a record of type "line" for each of
+ * its lines. The CSV file has a header and a row for each line, with
+ * the program and exit code repeated.
+ *
+ * The file is written through QSaveFile, so it only replaces an
+ * existing one once it is complete.
+ */
+
+//! The buffer is written once it holds this much.
+#define EXPORT_BUFFER_SIZE (1024 * 1024)
+
+//! progress () is emitted after each this many bytes of text.
+#define EXPORT_PROGRESS_STEP (8 * 1024 * 1024)
+
+/* ------------------------------------------------------------------------- */
+static const char * channelName (int channel)
+{
+    switch (channel) {
+    case ProcOutput::StdOut:
+        return "stdout";
+    case ProcOutput::StdErr:
+        return "stderr";
+    default:
+        return "notice";
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputExporter::OutputExporter (const QString & s_file, Format format) :
+    QObject (),
+    QRunnable (),
+    s_file_ (s_file),
+    format_ (format),
+    runs_ (),
+    total_ (0),
+    b_cancel_ (0),
+    buffer_ (),
+    unpacked_ (),
+    unpacked_run_ (-1),
+    unpacked_index_ (-1)
+{
+    setAutoDelete (false);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputExporter::~OutputExporter()
+{
+    foreach(const Run & run, runs_) {
+        foreach(OutputChunk * chunk, run.chunks_) {
+            if (chunk != NULL) {
+                OutputChunkPool::release (chunk);
+            }
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputExporter::Format OutputExporter::formatForFile (const QString & s_file)
+{
+    if (QFileInfo (s_file).suffix ().compare (
+                QLatin1String ("csv"), Qt::CaseInsensitive) == 0)
+        return Csv;
+    return JsonLines;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputExporter::addRun (const ProcOutput & output, const RunInfo & info)
+{
+    Run run;
+    run.info_ = info;
+    run.lines_ = output.lines_;
+    run.repeats_ = output.repeats_;
+    run.chunks_ = output.chunks_;
+    foreach(OutputChunk * chunk, run.chunks_) {
+        if (chunk != NULL) {
+            OutputChunkPool::addRef (chunk);
+        }
+    }
+    run.packed_ = output.packed_;
+    run.map_file_ = output.map_file_;
+    run.mapped_ = output.mapped_;
+    run.bytes_ = output.byteSize ();
+    total_ += run.bytes_;
+    runs_.append (run);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Connect to done () before calling this; the exporter goes away after
+ * the slots connected so far were called.
+ */
+void OutputExporter::start ()
+{
+    connect (this, SIGNAL(done(bool,QString)),
+             this, SLOT(deleteLater()), Qt::QueuedConnection);
+    QThreadPool::globalInstance ()->start (this);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputExporter::run ()
+{
+    QSaveFile file (s_file_);
+    if (!file.open (QIODevice::WriteOnly)) {
+        emit done (false, file.errorString ());
+        return;
+    }
+
+    buffer_.reserve (EXPORT_BUFFER_SIZE + 64 * 1024);
+    if (format_ == Csv) {
+        buffer_.append ("run,program,exit_code,seq,time_ms,channel,repeats,text\n");
+    }
+
+    qint64 written = 0;
+    for (int i = 0; i < runs_.count (); ++i) {
+        if (!writeRun (file, i, written))
+            break;
+    }
+    unpacked_.clear ();
+
+    if (b_cancel_.loadRelaxed () != 0) {
+        file.cancelWriting ();
+        emit done (false, tr ("Cancelled"));
+    } else if (!drain (file, true) || !file.commit ()) {
+        emit done (false, file.errorString ());
+    } else {
+        emit progress (total_, total_);
+        emit done (true, QString ());
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+const char * OutputExporter::lineData (int run, const ProcOutput::Line & ln)
+{
+    const Run & r = runs_.at (run);
+    if (ln.chunk_ < 0) {
+        if (r.mapped_ == NULL)
+            return NULL;
+        return r.mapped_ + ln.offset_ + (static_cast<qint64>(
+                    ProcOutput::MAPPED_CHUNK - ln.chunk_) <<
+                                         ProcOutput::MAPPED_SHIFT);
+    }
+    if (ln.chunk_ >= r.chunks_.count ())
+        return NULL;
+    const OutputChunk * chunk = r.chunks_.at (ln.chunk_);
+    if (chunk != NULL)
+        return chunk->data_ + ln.offset_;
+
+    // lines come in chunk order, so one unpacked chunk is enough
+    if ((unpacked_run_ != run) || (unpacked_index_ != ln.chunk_)) {
+        unpacked_ = qUncompress (r.packed_.value (ln.chunk_));
+        unpacked_run_ = run;
+        unpacked_index_ = ln.chunk_;
+    }
+    if (ln.offset_ + ln.size_ > unpacked_.size ())
+        return NULL;
+    return unpacked_.constData () + ln.offset_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputExporter::writeRun (QIODevice & dev, int run, qint64 & written)
+{
+    const Run & r = runs_.at (run);
+    const RunInfo & info = r.info_;
+    QByteArray run_id = QByteArray::number (run + 1);
+    QByteArray exit_code = QByteArray::number (info.exit_code_);
+    QByteArray program = info.s_program_.toUtf8 ();
+
+    if (format_ == JsonLines) {
+        buffer_.append ("{\"type\":\"run\",\"run\":");
+        buffer_.append (run_id);
+        buffer_.append (",\"program\":");
+        appendJson (buffer_, program.constData (), program.size (),
+                    TextScan::Utf8);
+        buffer_.append (",\"arguments\":[");
+        for (int i = 0; i < info.sl_arguments_.count (); ++i) {
+            QByteArray arg = info.sl_arguments_.at (i).toUtf8 ();
+            if (i > 0) {
+                buffer_.append (',');
+            }
+            appendJson (buffer_, arg.constData (), arg.size (), TextScan::Utf8);
+        }
+        QByteArray wrk_dir = info.s_wrk_dir_.toUtf8 ();
+        buffer_.append ("],\"directory\":");
+        appendJson (buffer_, wrk_dir.constData (), wrk_dir.size (),
+                    TextScan::Utf8);
+        buffer_.append (",\"start_ms\":");
+        buffer_.append (QByteArray::number (info.start_ms_));
+        buffer_.append (",\"end_ms\":");
+        buffer_.append (QByteArray::number (info.end_ms_));
+        buffer_.append (",\"exit_code\":");
+        buffer_.append (exit_code);
+        buffer_.append (",\"crashed\":");
+        buffer_.append (info.b_crashed_ ? "true" : "false");
+        buffer_.append (",\"lines\":");
+        buffer_.append (QByteArray::number (r.lines_.count ()));
+        buffer_.append (",\"bytes\":");
+        buffer_.append (QByteArray::number (r.bytes_));
+        buffer_.append ("}\n");
+    }
+
+    qint64 next_progress = written + EXPORT_PROGRESS_STEP;
+    for (int i = 0; i < r.lines_.count (); ++i) {
+        const ProcOutput::Line & ln = r.lines_.at (i);
+        const char * data = lineData (run, ln);
+        int size = data == NULL ? 0 : ln.size_;
+        int repeats = r.repeats_.value (i, 0);
+
+        if (format_ == JsonLines) {
+            buffer_.append ("{\"type\":\"line\",\"run\":");
+            buffer_.append (run_id);
+            buffer_.append (",\"seq\":");
+            buffer_.append (QByteArray::number (ln.seq_));
+            buffer_.append (",\"time_ms\":");
+            buffer_.append (QByteArray::number (ln.time_ms_));
+            buffer_.append (",\"channel\":\"");
+            buffer_.append (channelName (ln.channel_));
+            buffer_.append ("\",\"text\":");
+            appendJson (buffer_, data, size, ln.encoding_);
+            if (repeats > 0) {
+                buffer_.append (",\"repeats\":");
+                buffer_.append (QByteArray::number (repeats));
+            }
+            buffer_.append ("}\n");
+        } else {
+            buffer_.append (run_id);
+            buffer_.append (',');
+            appendCsv (buffer_, program.constData (), program.size (),
+                       TextScan::Utf8);
+            buffer_.append (',');
+            buffer_.append (exit_code);
+            buffer_.append (',');
+            buffer_.append (QByteArray::number (ln.seq_));
+            buffer_.append (',');
+            buffer_.append (QByteArray::number (ln.time_ms_));
+            buffer_.append (',');
+            buffer_.append (channelName (ln.channel_));
+            buffer_.append (',');
+            buffer_.append (QByteArray::number (repeats));
+            buffer_.append (',');
+            appendCsv (buffer_, data, size, ln.encoding_);
+            buffer_.append ('\n');
+        }
+
+        written += ln.size_;
+        if (buffer_.size () >= EXPORT_BUFFER_SIZE) {
+            if (b_cancel_.loadRelaxed () != 0)
+                return false;
+            if (!drain (dev, false))
+                return false;
+        }
+        if (written >= next_progress) {
+            emit progress (written, total_);
+            next_progress = written + EXPORT_PROGRESS_STEP;
+        }
+    }
+    return b_cancel_.loadRelaxed () == 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputExporter::drain (QIODevice & dev, bool b_all)
+{
+    if (!b_all && (buffer_.size () < EXPORT_BUFFER_SIZE))
+        return true;
+    if (buffer_.isEmpty ())
+        return true;
+    bool b_ok = dev.write (buffer_) == buffer_.size ();
+    // keep the capacity
+    buffer_.resize (0);
+    return b_ok;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only quotes, backslashes and control characters are escaped; the
+ * rest is copied as it is, in runs.
+ */
+void OutputExporter::appendJson (
+        QByteArray & buf, const char * data, int size, int encoding)
+{
+    static const char hex[] = "0123456789abcdef";
+    QByteArray converted;
+    if ((encoding == TextScan::Invalid) && (size > 0)) {
+        converted = QString::fromUtf8 (data, size).toUtf8 ();
+        data = converted.constData ();
+        size = converted.size ();
+    }
+
+    buf.append ('"');
+    int start = 0;
+    for (int i = 0; i < size; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+        buf.append (data + start, i - start);
+        start = i + 1;
+        switch (c) {
+        case '"':
+            buf.append ("\\\"");
+            break;
+        case '\\':
+            buf.append ("\\\\");
+            break;
+        case '\t':
+            buf.append ("\\t");
+            break;
+        case '\r':
+            buf.append ("\\r");
+            break;
+        case '\n':
+            buf.append ("\\n");
+            break;
+        default:
+            buf.append ("\\u00");
+            buf.append (hex[c >> 4]);
+            buf.append (hex[c & 0x0f]);
+        }
+    }
+    buf.append (data + start, size - start);
+    buf.append ('"');
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Fields are always quoted; quotes inside are doubled.
+ */
+void OutputExporter::appendCsv (
+        QByteArray & buf, const char * data, int size, int encoding)
+{
+    QByteArray converted;
+    if ((encoding == TextScan::Invalid) && (size > 0)) {
+        converted = QString::fromUtf8 (data, size).toUtf8 ();
+        data = converted.constData ();
+        size = converted.size ();
+    }
+
+    buf.append ('"');
+    int start = 0;
+    for (int i = 0; i < size; ++i) {
+        if (data[i] != '"')
+            continue;
+        buf.append (data + start, i + 1 - start);
+        buf.append ('"');
+        start = i + 1;
+    }
+    buf.append (data + start, size - start);
+    buf.append ('"');
+}
+/* ========================================================================= */
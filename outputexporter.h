@@ -0,0 +1,180 @@
+/**
+ * @file outputexporter.h
+ * @brief Declarations for OutputExporter class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTEXPORTER_H_INCLUDE
+#define GUARD_OUTPUTEXPORTER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrungui/procoutput.h>
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QAtomicInt>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+class QIODevice;
+QT_END_NAMESPACE
+
+struct OutputChunk;
+
+//! Writes the output of finished runs to a file in a worker thread.
+class PROCRUNGUI_EXPORT OutputExporter : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+
+    //! What is written.
+    enum Format {
+        JsonLines, /**< a record for each run and each line */
+        Csv /**< a row for each line */
+    };
+
+    //! What is known about a run besides its output.
+    struct RunInfo {
+        QString s_program_; /**< the program */
+        QStringList sl_arguments_; /**< its arguments */
+        QString s_wrk_dir_; /**< working directory */
+        qint64 start_ms_; /**< when it started (ms since epoch) */
+        qint64 end_ms_; /**< when it ended (ms since epoch) */
+        int exit_code_; /**< exit code (or signal) */
+        bool b_crashed_; /**< ended abnormally or could not start */
+    };
+
+    //! Constructor.
+    OutputExporter (
+            const QString & s_file,
+            Format format);
+
+    //! Destructor.
+    virtual ~OutputExporter();
+
+    //! The format that goes with the extension of a file.
+    static Format
+    formatForFile (
+            const QString & s_file);
+
+    //! Add a run; takes a reference to the memory of its output.
+    void
+    addRun (
+            const ProcOutput & output,
+            const RunInfo & info);
+
+    //! Number of runs added.
+    int
+    runCount () const {
+        return runs_.count ();
+    }
+
+    //! Bytes of text in all runs.
+    qint64
+    totalBytes () const {
+        return total_;
+    }
+
+    //! Hand the work to the global thread pool; deletes itself when done.
+    void
+    start ();
+
+    //! Write the file; runs in a worker thread.
+    virtual void
+    run ();
+
+public slots:
+
+    //! Stop as soon as possible; the file is left as it was.
+    void
+    cancel () {
+        b_cancel_.storeRelaxed (1);
+    }
+
+signals:
+
+    //! Some of the text was written.
+    void
+    progress (
+            qint64 done,
+            qint64 total);
+
+    //! The file was written (or not; @a s_error tells why).
+    void
+    done (
+            bool b_ok,
+            const QString & s_error);
+
+private:
+
+    Q_DISABLE_COPY(OutputExporter)
+
+    //! A run and what its output was when it was added.
+    struct Run {
+        RunInfo info_; /**< metadata */
+        QVector<ProcOutput::Line> lines_; /**< the index (shared) */
+        QHash<int, int> repeats_; /**< folded repeats (shared) */
+        QVector<OutputChunk*> chunks_; /**< referenced chunks (NULL once packed) */
+        QHash<int, QByteArray> packed_; /**< compressed chunks (shared) */
+        QSharedPointer<QFile> map_file_; /**< keeps a mapped log mapped */
+        const char * mapped_; /**< start of the mapped log */
+        qint64 bytes_; /**< bytes of text */
+    };
+
+    //! The bytes of a line (NULL if they are not available).
+    const char *
+    lineData (
+            int run,
+            const ProcOutput::Line & ln);
+
+    //! Write the records of a run; false if cancelled or on error.
+    bool
+    writeRun (
+            QIODevice & dev,
+            int run,
+            qint64 & written);
+
+    //! Send the buffer to the device once it is large enough.
+    bool
+    drain (
+            QIODevice & dev,
+            bool b_all);
+
+    //! Append text as a JSON string.
+    static void
+    appendJson (
+            QByteArray & buf,
+            const char * data,
+            int size,
+            int encoding);
+
+    //! Append text as a CSV field.
+    static void
+    appendCsv (
+            QByteArray & buf,
+            const char * data,
+            int size,
+            int encoding);
+
+    QString s_file_; /**< where to write */
+    Format format_; /**< what to write */
+    QList<Run> runs_; /**< what to export */
+    qint64 total_; /**< bytes of text in runs_ */
+    QAtomicInt b_cancel_; /**< set by cancel () */
+    QByteArray buffer_; /**< pending output */
+    QByteArray unpacked_; /**< last packed chunk that was read */
+    int unpacked_run_; /**< run of unpacked_ or -1 */
+    int unpacked_index_; /**< chunk of unpacked_ or -1 */
+};
+
+#endif // GUARD_OUTPUTEXPORTER_H_INCLUDE
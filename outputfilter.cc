@@ -0,0 +1,163 @@
+/**
+ * @file outputfilter.cc
+ * @brief Definitions for OutputFilter class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputfilter.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+
+/**
+ * @class OutputFilter
+ *
+ * The filter is consulted by ProcOutput when a line is complete, before
+ * it becomes part of the store; lines that are dropped give their
+ * space back, so they cost neither memory nor painting.
+ *
+ * Patterns that fail to compile are ignored.
+ */
+
+#define STG_FILTER_GROUP "OutputFilter"
+#define STG_FILTER_INCLUDE "Include"
+#define STG_FILTER_EXCLUDE "Exclude"
+#define STG_FILTER_COLLAPSE "Collapse"
+#define STG_FILTER_PROGRESS "Progress"
+
+/* ------------------------------------------------------------------------- */
+void OutputFilterConfig::load (QSettings & stg, const QString & s_key)
+{
+    stg.beginGroup (QLatin1String (STG_FILTER_GROUP));
+    stg.beginGroup (s_key);
+    s_include_ = stg.value (QLatin1String (STG_FILTER_INCLUDE)).toString ();
+    s_exclude_ = stg.value (QLatin1String (STG_FILTER_EXCLUDE)).toString ();
+    b_collapse_ = stg.value (QLatin1String (STG_FILTER_COLLAPSE), false).toBool ();
+    s_progress_ = stg.value (QLatin1String (STG_FILTER_PROGRESS)).toString ();
+    stg.endGroup ();
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputFilterConfig::save (QSettings & stg, const QString & s_key) const
+{
+    stg.beginGroup (QLatin1String (STG_FILTER_GROUP));
+    if (isEmpty ()) {
+        stg.remove (s_key);
+    } else {
+        stg.beginGroup (s_key);
+        stg.setValue (QLatin1String (STG_FILTER_INCLUDE), s_include_);
+        stg.setValue (QLatin1String (STG_FILTER_EXCLUDE), s_exclude_);
+        stg.setValue (QLatin1String (STG_FILTER_COLLAPSE), b_collapse_);
+        stg.setValue (QLatin1String (STG_FILTER_PROGRESS), s_progress_);
+        stg.endGroup ();
+    }
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static bool compilePattern (const QString & s_pattern, QRegularExpression & re)
+{
+    if (s_pattern.isEmpty ())
+        return false;
+    re.setPattern (s_pattern);
+    if (!re.isValid ()) {
+        PROCRUNGUI_DEBUGM("Ignoring output filter pattern %s: %s\n",
+                          TMP_A(s_pattern), TMP_A(re.errorString ()));
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputFilter::OutputFilter (const OutputFilterConfig & config) :
+    config_ (config),
+    include_ (),
+    exclude_ (),
+    progress_re_ (),
+    b_include_ (false),
+    b_exclude_ (false),
+    b_progress_ (false),
+    progress_ (-1),
+    b_progress_changed_ (false),
+    dropped_ (0)
+{
+    b_include_ = compilePattern (config_.s_include_, include_);
+    b_exclude_ = compilePattern (config_.s_exclude_, exclude_);
+    b_progress_ = compilePattern (config_.s_progress_, progress_re_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputFilter::~OutputFilter()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Progress is extracted from all lines, including the ones that are
+ * dropped afterwards.
+ */
+bool OutputFilter::accept (const QString & s_line)
+{
+    inspect (s_line);
+
+    bool b_keep = true;
+    if (b_include_ && !include_.match (s_line).hasMatch ()) {
+        b_keep = false;
+    } else if (b_exclude_ && exclude_.match (s_line).hasMatch ()) {
+        b_keep = false;
+    }
+    if (!b_keep) {
+        ++dropped_;
+    }
+    return b_keep;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The value is taken from the first capture group, or from the whole
+ * match if the pattern has no groups.
+ */
+void OutputFilter::inspect (const QString & s_line)
+{
+    if (!b_progress_)
+        return;
+
+    QRegularExpressionMatch match = progress_re_.match (s_line);
+    if (!match.hasMatch ())
+        return;
+
+    QString s_value = match.lastCapturedIndex () >= 1 ?
+                match.captured (1) : match.captured (0);
+    s_value.remove (QChar ('%'));
+    bool b_ok;
+    double value = s_value.trimmed ().toDouble (&b_ok);
+    if (!b_ok)
+        return;
+
+    int percent = qBound (0, static_cast<int>(value), 100);
+    if (percent != progress_) {
+        progress_ = percent;
+        b_progress_changed_ = true;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputFilter::takeProgressChanged ()
+{
+    bool b_ret = b_progress_changed_;
+    b_progress_changed_ = false;
+    return b_ret;
+}
+/* ========================================================================= */
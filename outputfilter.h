@@ -0,0 +1,140 @@
+/**
+ * @file outputfilter.h
+ * @brief Declarations for OutputFilter class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTFILTER_H_INCLUDE
+#define GUARD_OUTPUTFILTER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QString>
+#include <QRegularExpression>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+//! What to keep from the output of a command.
+struct PROCRUNGUI_EXPORT OutputFilterConfig {
+
+    //! Default constructor.
+    OutputFilterConfig () :
+        s_include_ (),
+        s_exclude_ (),
+        b_collapse_ (false),
+        s_progress_ ()
+    {}
+
+    //! Tell if the configuration changes nothing.
+    bool
+    isEmpty () const {
+        return s_include_.isEmpty () && s_exclude_.isEmpty () &&
+                !b_collapse_ && s_progress_.isEmpty ();
+    }
+
+    //! Read the configuration stored for a command.
+    void
+    load (
+            QSettings & stg,
+            const QString & s_key);
+
+    //! Store the configuration for a command.
+    void
+    save (
+            QSettings & stg,
+            const QString & s_key) const;
+
+    QString s_include_; /**< keep only lines matching this (empty for all) */
+    QString s_exclude_; /**< drop lines matching this (empty for none) */
+    bool b_collapse_; /**< fold repeated lines into the first one */
+    QString s_progress_; /**< first capture group is a percentage */
+};
+
+//! Decides which lines of the output are kept and extracts progress.
+class PROCRUNGUI_EXPORT OutputFilter {
+
+public:
+
+    //! Constructor.
+    OutputFilter (
+            const OutputFilterConfig & config);
+
+    //! Destructor.
+    virtual ~OutputFilter();
+
+    //! The configuration.
+    const OutputFilterConfig &
+    config () const {
+        return config_;
+    }
+
+    //! Tell if lines need to be decoded for accept ().
+    bool
+    needsText () const {
+        return b_include_ || b_exclude_ || b_progress_;
+    }
+
+    //! Tell if repeated lines are folded.
+    bool
+    collapsesRepeats () const {
+        return config_.b_collapse_;
+    }
+
+    //! Look at a complete line; false if it should be dropped.
+    bool
+    accept (
+            const QString & s_line);
+
+    //! Look at a line for progress only.
+    void
+    inspect (
+            const QString & s_line);
+
+    //! Tell if a progress pattern was configured.
+    bool
+    hasProgress () const {
+        return b_progress_;
+    }
+
+    //! Last percentage seen (-1 if none yet).
+    int
+    progress () const {
+        return progress_;
+    }
+
+    //! Tell if progress changed since last call and reset the flag.
+    bool
+    takeProgressChanged ();
+
+    //! Number of lines that were dropped.
+    qint64
+    droppedLines () const {
+        return dropped_;
+    }
+
+    //! Count a line that was dropped for being a repeat.
+    void
+    countDropped () {
+        ++dropped_;
+    }
+
+private:
+
+    OutputFilterConfig config_; /**< what we were asked to do */
+    QRegularExpression include_; /**< compiled include pattern */
+    QRegularExpression exclude_; /**< compiled exclude pattern */
+    QRegularExpression progress_re_; /**< compiled progress pattern */
+    bool b_include_; /**< include_ is valid and in use */
+    bool b_exclude_; /**< exclude_ is valid and in use */
+    bool b_progress_; /**< progress_re_ is valid and in use */
+    int progress_; /**< last percentage */
+    bool b_progress_changed_; /**< progress_ changed since last check */
+    qint64 dropped_; /**< lines dropped so far */
+};
+
+#endif // GUARD_OUTPUTFILTER_H_INCLUDE
@@ -0,0 +1,145 @@
+/**
+ * @file outputlog.cc
+ * @brief Definitions for OutputLog class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputlog.h"
+#include "procoutput.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class OutputLog
+ *
+ * The log is plain text - each line followed by a new line character -
+ * so it can be read with anything; the index has a fixed-size Entry for
+ * each line, so ProcOutput::mapLog () finds the lines without scanning
+ * the text. Only the text is kept: styles and folded repeats are not.
+ *
+ * Redrawn lines are replaced in the output (see ProcOutput::applyPending ())
+ * so the last KEEP_LINES are held back until the program ends. Should a
+ * redraw reach further, the files are cut back to the last line that is
+ * still in the output. The log is flushed before the index, so the index
+ * of a log that was interrupted never points past its end.
+ */
+
+Q_STATIC_ASSERT(sizeof(OutputLog::Entry) == 24);
+
+/* ------------------------------------------------------------------------- */
+OutputLog::OutputLog () :
+    log_ (),
+    index_ (),
+    written_ (0),
+    last_seq_ (-1)
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputLog::~OutputLog()
+{
+    close ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputLog::open (const QString & s_base)
+{
+    close ();
+    log_.setFileName (logFile (s_base));
+    index_.setFileName (indexFile (s_base));
+    if (!log_.open (QIODevice::ReadWrite | QIODevice::Truncate)) {
+        PROCRUNGUI_DEBUGM("Cannot create %s\n", TMP_A(log_.fileName ()));
+        return false;
+    }
+    if (!index_.open (QIODevice::ReadWrite | QIODevice::Truncate)) {
+        PROCRUNGUI_DEBUGM("Cannot create %s\n", TMP_A(index_.fileName ()));
+        log_.close ();
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputLog::write (const ProcOutput & output, bool b_final)
+{
+    if (!isOpen ())
+        return;
+
+    if ((written_ > 0) && ((written_ > output.lineCount ()) ||
+            (output.line (written_ - 1).seq_ != last_seq_))) {
+        rewind (output, output.findSeq (last_seq_ + 1));
+    }
+
+    int limit = output.lineCount ();
+    if (!b_final) {
+        limit -= KEEP_LINES;
+    }
+    if (limit <= written_)
+        return;
+
+    for (int i = written_; i < limit; ++i) {
+        const ProcOutput::Line & ln = output.line (i);
+        Entry entry;
+        entry.offset_ = log_.pos ();
+        entry.size_ = ln.size_;
+        entry.channel_ = ln.channel_;
+        entry.encoding_ = ln.encoding_;
+        entry.reserved_ = 0;
+        entry.time_ms_ = ln.time_ms_;
+        log_.write (output.lineData (ln), ln.size_);
+        log_.putChar ('\n');
+        index_.write (reinterpret_cast<const char *>(&entry), sizeof(entry));
+    }
+    written_ = limit;
+    last_seq_ = output.line (limit - 1).seq_;
+
+    log_.flush ();
+    index_.flush ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputLog::rewind (const ProcOutput & output, int count)
+{
+    qint64 log_size = 0;
+    if (count > 0) {
+        Entry entry;
+        index_.seek (static_cast<qint64>(count - 1) * sizeof(entry));
+        if (index_.read (reinterpret_cast<char *>(&entry), sizeof(entry)) ==
+                sizeof(entry)) {
+            log_size = entry.offset_ + entry.size_ + 1;
+        }
+    }
+    index_.resize (static_cast<qint64>(count) * sizeof(Entry));
+    log_.resize (log_size);
+    index_.seek (index_.size ());
+    log_.seek (log_.size ());
+
+    written_ = count;
+    last_seq_ = count > 0 ? output.line (count - 1).seq_ : -1;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputLog::close ()
+{
+    log_.close ();
+    index_.close ();
+    written_ = 0;
+    last_seq_ = -1;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputLog::remove (const QString & s_base)
+{
+    QFile::remove (logFile (s_base));
+    QFile::remove (indexFile (s_base));
+}
+/* ========================================================================= */
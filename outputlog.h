@@ -0,0 +1,106 @@
+/**
+ * @file outputlog.h
+ * @brief Declarations for OutputLog class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTLOG_H_INCLUDE
+#define GUARD_OUTPUTLOG_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QString>
+#include <QFile>
+
+class ProcOutput;
+
+//! Copies the lines of an output to a file, with an index, as they come.
+class PROCRUNGUI_EXPORT OutputLog {
+
+public:
+
+    //! A record in the index file.
+    struct Entry {
+        qint64 offset_; /**< where the line starts in the log */
+        qint32 size_; /**< number of bytes (no new line character) */
+        quint8 channel_; /**< see ProcOutput::Channel */
+        quint8 encoding_; /**< see TextScan::Encoding */
+        quint16 reserved_; /**< zero */
+        qint64 time_ms_; /**< when the line was completed */
+    };
+
+    //! Last lines that are not written while the program runs.
+    enum { KEEP_LINES = 8 };
+
+    //! Default constructor.
+    OutputLog ();
+
+    //! Destructor.
+    virtual ~OutputLog();
+
+    //! Create (or truncate) the files for @a s_base.
+    bool
+    open (
+            const QString & s_base);
+
+    //! Tell if the files are open.
+    bool
+    isOpen () const {
+        return log_.isOpen ();
+    }
+
+    //! Write the lines that were not written yet (all of them if @a b_final).
+    void
+    write (
+            const ProcOutput & output,
+            bool b_final);
+
+    //! Close the files.
+    void
+    close ();
+
+    //! Number of lines in the log.
+    int
+    lineCount () const {
+        return written_;
+    }
+
+    //! The file with the text.
+    static QString
+    logFile (
+            const QString & s_base) {
+        return s_base + QLatin1String (".log");
+    }
+
+    //! The file with the index.
+    static QString
+    indexFile (
+            const QString & s_base) {
+        return s_base + QLatin1String (".idx");
+    }
+
+    //! Delete the files for @a s_base.
+    static void
+    remove (
+            const QString & s_base);
+
+private:
+
+    Q_DISABLE_COPY(OutputLog)
+
+    //! Forget the lines after the first @a count ones.
+    void
+    rewind (
+            const ProcOutput & output,
+            int count);
+
+    QFile log_; /**< the text, one line per line */
+    QFile index_; /**< an Entry for each line */
+    int written_; /**< lines in the files */
+    qint64 last_seq_; /**< sequence number of the last line written or -1 */
+};
+
+#endif // GUARD_OUTPUTLOG_H_INCLUDE
@@ -0,0 +1,105 @@
+/**
+ * @file outputpacker.cc
+ * @brief Definitions for OutputPacker class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputpacker.h"
+#include "procoutput.h"
+#include "outputchunk.h"
+
+#include "procrungui-private.h"
+
+#include <QThreadPool>
+
+/**
+ * @class OutputPacker
+ *
+ * The output of a finished process rarely changes again, and text
+ * compresses well, so its chunks are replaced by zlib-compressed copies
+ * (qCompress () at the fastest level; Qt has no other codec built in).
+ * Each 64 KiB chunk is compressed on its own, so showing a line only
+ * unpacks the chunk it lives in.
+ *
+ * The packer takes a reference to each chunk, so it does not matter if
+ * the output goes away in the meantime. Once done () is emitted (from
+ * the worker thread) the owner of the output calls apply () in its own
+ * thread; the packer deletes itself afterwards.
+ */
+
+//! Compression level given to qCompress ().
+#define PACK_LEVEL 1
+
+/* ------------------------------------------------------------------------- */
+OutputPacker::OutputPacker (const ProcOutput & output) :
+    QObject (),
+    QRunnable (),
+    jobs_ ()
+{
+    setAutoDelete (false);
+    QVector<int> sizes = output.usedSizes ();
+    foreach(int index, output.sealedChunks ()) {
+        Job job;
+        job.index_ = index;
+        job.chunk_ = output.chunk (index);
+        job.size_ = sizes.at (index);
+        OutputChunkPool::addRef (job.chunk_);
+        jobs_.append (job);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputPacker::~OutputPacker()
+{
+    for (int i = 0; i < jobs_.count (); ++i) {
+        OutputChunkPool::release (jobs_.at (i).chunk_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Connect to done () before calling this; the packer goes away after
+ * the slots connected so far were called.
+ */
+void OutputPacker::start ()
+{
+    connect (this, SIGNAL(done()),
+             this, SLOT(deleteLater()), Qt::QueuedConnection);
+    QThreadPool::globalInstance ()->start (this);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputPacker::run ()
+{
+    for (int i = 0; i < jobs_.count (); ++i) {
+        Job & job = jobs_[i];
+        job.packed_ = qCompress (
+                    reinterpret_cast<const uchar *> (job.chunk_->data_),
+                    job.size_, PACK_LEVEL);
+        OutputChunkPool::release (job.chunk_);
+        job.chunk_ = NULL;
+    }
+    emit done ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Chunks that were too small to gain anything stay as they are.
+ */
+void OutputPacker::apply (ProcOutput & output) const
+{
+    foreach(const Job & job, jobs_) {
+        if (job.packed_.isEmpty () ||
+                (job.packed_.size () >= OutputChunk::SIZE / 2))
+            continue;
+        output.setPacked (job.index_, job.packed_);
+    }
+}
+/* ========================================================================= */
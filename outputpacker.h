@@ -0,0 +1,74 @@
+/**
+ * @file outputpacker.h
+ * @brief Declarations for OutputPacker class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTPACKER_H_INCLUDE
+#define GUARD_OUTPUTPACKER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QObject>
+#include <QRunnable>
+#include <QList>
+#include <QByteArray>
+
+class ProcOutput;
+struct OutputChunk;
+
+//! Compresses the sealed chunks of an output in a worker thread.
+class PROCRUNGUI_EXPORT OutputPacker : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+
+    //! Constructor; takes a reference to the chunks to compress.
+    OutputPacker (
+            const ProcOutput & output);
+
+    //! Destructor.
+    virtual ~OutputPacker();
+
+    //! Tell if there is anything to compress.
+    bool
+    isEmpty () const {
+        return jobs_.isEmpty ();
+    }
+
+    //! Hand the work to the global thread pool; deletes itself when done.
+    void
+    start ();
+
+    //! Place the results in the output (in the thread of the output).
+    void
+    apply (
+            ProcOutput & output) const;
+
+    //! Compress the chunks; runs in a worker thread.
+    virtual void
+    run ();
+
+signals:
+
+    //! All chunks were compressed.
+    void
+    done ();
+
+private:
+
+    //! A chunk to compress.
+    struct Job {
+        int index_; /**< index of the chunk in the output */
+        OutputChunk * chunk_; /**< the chunk (referenced until compressed) */
+        int size_; /**< bytes to compress */
+        QByteArray packed_; /**< the result */
+    };
+
+    QList<Job> jobs_; /**< the chunks */
+};
+
+#endif // GUARD_OUTPUTPACKER_H_INCLUDE
@@ -0,0 +1,635 @@
+/**
+ * @file outputview.cc
+ * @brief Definitions for OutputView class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputview.h"
+#include "procmetrics.h"
+
+#include "procrungui-private.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QScrollBar>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QApplication>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QAction>
+#include <QStringList>
+
+/**
+ * @class OutputView
+ *
+ * The view reads the lines straight from the ProcOutput it was given;
+ * nothing is copied into a text document. Only the rows that are
+ * visible are decoded (once, while they stay visible) and painted, so
+ * the cost does not depend on the size of the output.
+ *
+ * Lines that are still being received are shown after the complete
+ * ones. Selection works on whole lines.
+ *
+ * The view follows the output - keeps showing its last lines - until the
+ * user scrolls away from the end. It is then paused: new output only
+ * repaints a notice with the number of new lines (found by sequence
+ * number), the scroll bars keep the range they had and nothing else is
+ * looked at. Scrolling back to the end, clicking the notice or pressing
+ * End resumes following and jumps straight to the last lines; the lines
+ * in between are not visited.
+ */
+
+//! Space to the left of the text.
+#define OUTPUT_VIEW_MARGIN 4
+
+//! Columns between tab stops.
+#define OUTPUT_VIEW_TAB 8
+
+/* ------------------------------------------------------------------------- */
+static int textWidth (const QFontMetrics & fm, const QString & s_text)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    return fm.horizontalAdvance (s_text);
+#else
+    return fm.width (s_text);
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputView::OutputView (QWidget * parent) :
+    QAbstractScrollArea (parent),
+    output_ (NULL),
+    decoded_ (),
+    styles_ (),
+    line_height_ (1),
+    char_width_ (1),
+    ascent_ (0),
+    max_columns_ (0),
+    scanned_lines_ (0),
+    sel_anchor_ (-1),
+    sel_end_ (-1),
+    b_follow_ (true),
+    b_adjusting_ (false),
+    paused_rows_ (0),
+    pause_seq_ (0)
+{
+    setFont (QFontDatabase::systemFont (QFontDatabase::FixedFont));
+    setFocusPolicy (Qt::StrongFocus);
+    fontChanged ();
+    connect (verticalScrollBar (), SIGNAL(valueChanged(int)),
+             this, SLOT(scrolled(int)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputView::~OutputView()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::setOutput (const ProcOutput * output)
+{
+    output_ = output;
+    decoded_.clear ();
+    max_columns_ = 0;
+    scanned_lines_ = 0;
+    sel_anchor_ = -1;
+    sel_end_ = -1;
+    bool b_was_following = b_follow_;
+    b_follow_ = true;
+    updateScrollBars ();
+    horizontalScrollBar ()->setValue (0);
+    scrollToEnd ();
+    viewport ()->update ();
+    if (!b_was_following) {
+        emit followChanged (true);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * While paused only the notice is repainted.
+ */
+void OutputView::outputChanged ()
+{
+    if (output_ == NULL)
+        return;
+
+    if (!b_follow_) {
+        viewport ()->update (noticeRect ());
+        return;
+    }
+    updateScrollBars ();
+    scrollToEnd ();
+    viewport ()->update ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Pausing remembers the rows there are and the sequence number of the
+ * next line. Resuming skips the lines that came in the meantime when
+ * looking for the widest one, so the cost does not depend on how many
+ * there were.
+ */
+void OutputView::setFollow (bool value)
+{
+    if (value == b_follow_)
+        return;
+
+    b_follow_ = value;
+    if (value) {
+        if (output_ != NULL) {
+            scanned_lines_ = qMax (scanned_lines_,
+                                   output_->lineCount () - visibleRows ());
+        }
+        updateScrollBars ();
+        scrollToEnd ();
+    } else {
+        paused_rows_ = rowCount ();
+        pause_seq_ = 0;
+        if ((output_ != NULL) && (output_->lineCount () > 0)) {
+            pause_seq_ = output_->line (output_->lineCount () - 1).seq_ + 1;
+        }
+    }
+    viewport ()->update ();
+    emit followChanged (value);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Changes we make ourselves are ignored; the user moving away from the
+ * end pauses and moving back to it resumes.
+ */
+void OutputView::scrolled (int value)
+{
+    if (b_adjusting_)
+        return;
+    bool b_at_end = value == verticalScrollBar ()->maximum ();
+    if (b_at_end != b_follow_) {
+        setFollow (b_at_end);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::scrollToEnd ()
+{
+    b_adjusting_ = true;
+    verticalScrollBar ()->setValue (verticalScrollBar ()->maximum ());
+    b_adjusting_ = false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QRect OutputView::noticeRect () const
+{
+    int height = line_height_ + 4;
+    return QRect (0, viewport ()->height () - height,
+                  viewport ()->width (), height);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString OutputView::selectedText () const
+{
+    if ((output_ == NULL) || (sel_anchor_ == -1))
+        return QString ();
+
+    int first = qMin (sel_anchor_, sel_end_);
+    int last = qMin (qMax (sel_anchor_, sel_end_), rowCount () - 1);
+    QStringList sl_lines;
+    for (int row = first; row <= last; ++row) {
+        ProcOutput::Line ln;
+        const ProcOutput::Span * spans;
+        if (rowLine (row, ln, spans)) {
+            sl_lines.append (output_->decode (ln, 0, ln.size_));
+        }
+    }
+    return sl_lines.join (QChar ('\n'));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::copy ()
+{
+    QString s_text = selectedText ();
+    if (!s_text.isEmpty ()) {
+        QApplication::clipboard ()->setText (s_text);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::selectAll ()
+{
+    int count = rowCount ();
+    if (count == 0)
+        return;
+    sel_anchor_ = 0;
+    sel_end_ = count - 1;
+    viewport ()->update ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int OutputView::rowCount () const
+{
+    if (output_ == NULL)
+        return 0;
+
+    int result = output_->lineCount ();
+    ProcOutput::Line ln;
+    for (int i = 0; i < ProcOutput::Notice; ++i) {
+        if (output_->openLine (i, ln)) {
+            ++result;
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputView::rowLine (
+        int row, ProcOutput::Line & ln,
+        const ProcOutput::Span *& spans) const
+{
+    if ((output_ == NULL) || (row < 0))
+        return false;
+
+    int count = output_->lineCount ();
+    if (row < count) {
+        ln = output_->line (row);
+        spans = output_->spans (ln);
+        return true;
+    }
+
+    row -= count;
+    for (int i = 0; i < ProcOutput::Notice; ++i) {
+        if (output_->openLine (i, ln)) {
+            if (row == 0) {
+                spans = output_->openSpans (i);
+                return true;
+            }
+            --row;
+        }
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::decodeLine (
+        const ProcOutput::Line & ln, const ProcOutput::Span * spans,
+        int repeats, DecodedLine & result) const
+{
+    int column = 0;
+    result.channel_ = ln.channel_;
+    result.repeats_ = repeats;
+    result.seq_ = ln.seq_;
+    result.pieces_.resize (ln.span_count_);
+    for (int s = 0; s < ln.span_count_; ++s) {
+        Piece & pc = result.pieces_[s];
+        pc.style_ = spans[s].style_;
+        pc.text_ = output_->decode (ln, spans[s].start_, spans[s].size_);
+
+        int tab = pc.text_.indexOf (QChar ('\t'));
+        if (tab == -1) {
+            column += pc.text_.length ();
+            continue;
+        }
+
+        QString s_expanded;
+        s_expanded.reserve (pc.text_.length () + OUTPUT_VIEW_TAB);
+        foreach(QChar c, pc.text_) {
+            if (c == QChar ('\t')) {
+                int n = OUTPUT_VIEW_TAB - (column % OUTPUT_VIEW_TAB);
+                s_expanded.append (QString (n, QChar (' ')));
+                column += n;
+            } else {
+                s_expanded.append (c);
+                ++column;
+            }
+        }
+        pc.text_ = s_expanded;
+    }
+
+    if (repeats > 0) {
+        Piece pc;
+        pc.style_ = AnsiStyle::plain () | AnsiStyle::FAINT | AnsiStyle::ITALIC;
+        pc.text_ = tr("  (repeated %n more time(s))", "", repeats);
+        result.pieces_.append (pc);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int OutputView::rowAt (const QPoint & pos) const
+{
+    return verticalScrollBar ()->value () + pos.y () / line_height_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int OutputView::visibleRows () const
+{
+    return qMax (1, viewport ()->height () / line_height_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::updateScrollBars ()
+{
+    int rows = b_follow_ ? rowCount () : paused_rows_;
+    if (output_ != NULL) {
+        int count = qMin (output_->lineCount (), rows);
+        for (int i = scanned_lines_; i < count; ++i) {
+            max_columns_ = qMax (max_columns_, output_->line (i).size_);
+        }
+        scanned_lines_ = count;
+    }
+
+    int page = visibleRows ();
+    QScrollBar * vsb = verticalScrollBar ();
+    b_adjusting_ = true;
+    vsb->setRange (0, qMax (0, rows - page));
+    vsb->setPageStep (page);
+    vsb->setSingleStep (1);
+    b_adjusting_ = false;
+
+    int width = max_columns_ * char_width_ + 2 * OUTPUT_VIEW_MARGIN;
+    QScrollBar * hsb = horizontalScrollBar ();
+    hsb->setRange (0, qMax (0, width - viewport ()->width ()));
+    hsb->setPageStep (viewport ()->width ());
+    hsb->setSingleStep (char_width_ * 4);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::fontChanged ()
+{
+    QFontMetrics fm (font ());
+    line_height_ = qMax (1, fm.lineSpacing ());
+    char_width_ = qMax (1, textWidth (fm, QLatin1String ("m")));
+    ascent_ = fm.ascent ();
+    styles_.clear ();
+    updateScrollBars ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+const OutputView::TextStyle & OutputView::textStyle (
+        quint32 style, int channel)
+{
+    quint32 key = style | (static_cast<quint32>(channel) << 24);
+    QHash<quint32, TextStyle>::iterator iter = styles_.find (key);
+    if (iter != styles_.end ())
+        return iter.value ();
+
+    const QPalette & pal = palette ();
+    TextStyle result;
+    result.font_ = font ();
+    int fg_idx = AnsiStyle::foreground (style);
+    int bg_idx = AnsiStyle::background (style);
+    if (fg_idx != AnsiStyle::COLOR_DEFAULT) {
+        result.fg_ = QColor (AnsiStyle::paletteColor (fg_idx));
+    } else if (channel == ProcOutput::StdErr) {
+        result.fg_ = QColor (AnsiStyle::paletteColor (1));
+    } else if (channel == ProcOutput::Notice) {
+        result.fg_ = pal.color (QPalette::Disabled, QPalette::Text);
+        result.font_.setItalic (true);
+    } else {
+        result.fg_ = pal.color (QPalette::Text);
+    }
+    if (bg_idx != AnsiStyle::COLOR_DEFAULT) {
+        result.bg_ = QColor (AnsiStyle::paletteColor (bg_idx));
+    }
+
+    if (style & AnsiStyle::INVERSE) {
+        QColor tmp = result.fg_;
+        result.fg_ = result.bg_.isValid () ?
+                    result.bg_ : pal.color (QPalette::Base);
+        result.bg_ = tmp;
+    }
+    if (style & AnsiStyle::FAINT) {
+        result.fg_.setAlpha (160);
+    }
+
+    if (style & AnsiStyle::BOLD)
+        result.font_.setBold (true);
+    if (style & AnsiStyle::ITALIC)
+        result.font_.setItalic (true);
+    if (style & AnsiStyle::UNDERLINE)
+        result.font_.setUnderline (true);
+    if (style & AnsiStyle::STRIKE)
+        result.font_.setStrikeOut (true);
+
+    return styles_.insert (key, result).value ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Complete lines that stay visible are decoded only once; the ones
+ * that scrolled out of view are dropped from the cache.
+ */
+void OutputView::paintEvent (QPaintEvent * event)
+{
+    QPainter painter (viewport ());
+    const QPalette & pal = palette ();
+    painter.fillRect (event->rect (), pal.color (QPalette::Base));
+    if (output_ == NULL)
+        return;
+
+    int first = verticalScrollBar ()->value ();
+    int last = first + viewport ()->height () / line_height_ + 1;
+    int complete = output_->lineCount ();
+    int x_start = OUTPUT_VIEW_MARGIN - horizontalScrollBar ()->value ();
+    int sel_first = qMin (sel_anchor_, sel_end_);
+    int sel_last = qMax (sel_anchor_, sel_end_);
+    int width = viewport ()->width ();
+
+    QHash<int, DecodedLine> visible;
+    DecodedLine open_line;
+    for (int row = first; row < last; ++row) {
+        ProcOutput::Line ln;
+        const ProcOutput::Span * spans;
+        if (!rowLine (row, ln, spans))
+            break;
+
+        const DecodedLine * dl;
+        if (row < complete) {
+            int repeats = output_->repeats (row);
+            QHash<int, DecodedLine>::iterator iter = decoded_.find (row);
+            // redrawn lines replace the ones at the end of the store
+            if ((iter != decoded_.end ()) &&
+                    (iter.value ().seq_ == ln.seq_) &&
+                    (iter.value ().repeats_ == repeats)) {
+                dl = &visible.insert (row, iter.value ()).value ();
+            } else {
+                DecodedLine & fresh = visible[row];
+                decodeLine (ln, spans, repeats, fresh);
+                ProcMetrics::global ().addRendered (ln.size_);
+                dl = &fresh;
+            }
+        } else {
+            decodeLine (ln, spans, 0, open_line);
+            ProcMetrics::global ().addRendered (ln.size_);
+            dl = &open_line;
+        }
+
+        int y = (row - first) * line_height_;
+        bool b_selected = (sel_anchor_ != -1) &&
+                (row >= sel_first) && (row <= sel_last);
+        if (b_selected) {
+            painter.fillRect (0, y, width, line_height_,
+                              pal.color (QPalette::Highlight));
+        }
+
+        int x = x_start;
+        foreach(const Piece & pc, dl->pieces_) {
+            if (x > width)
+                break;
+            const TextStyle & ts = textStyle (pc.style_, dl->channel_);
+            QFontMetrics fm (ts.font_);
+            int w = textWidth (fm, pc.text_);
+            if (x + w >= 0) {
+                if (ts.bg_.isValid () && !b_selected) {
+                    painter.fillRect (x, y, w, line_height_, ts.bg_);
+                }
+                painter.setFont (ts.font_);
+                painter.setPen (b_selected ?
+                                    pal.color (QPalette::HighlightedText) :
+                                    ts.fg_);
+                painter.drawText (x, y + ascent_, pc.text_);
+            }
+            x += w;
+        }
+    }
+    decoded_.swap (visible);
+
+    if (!b_follow_) {
+        int fresh = output_->lineCount () - output_->findSeq (pause_seq_);
+        QRect rc = noticeRect ();
+        painter.fillRect (rc, pal.color (QPalette::ToolTipBase));
+        painter.setFont (font ());
+        painter.setPen (pal.color (QPalette::ToolTipText));
+        painter.drawText (rc.adjusted (OUTPUT_VIEW_MARGIN, 0, 0, 0),
+                          Qt::AlignVCenter | Qt::AlignLeft,
+                          tr("Paused; %n new line(s) - press End to follow",
+                             "", fresh));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::resizeEvent (QResizeEvent * event)
+{
+    QAbstractScrollArea::resizeEvent (event);
+    updateScrollBars ();
+    if (b_follow_) {
+        scrollToEnd ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::changeEvent (QEvent * event)
+{
+    QAbstractScrollArea::changeEvent (event);
+    if ((event->type () == QEvent::FontChange) ||
+            (event->type () == QEvent::PaletteChange)) {
+        fontChanged ();
+        viewport ()->update ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::mousePressEvent (QMouseEvent * event)
+{
+    if ((event->button () == Qt::LeftButton) && !b_follow_ &&
+            noticeRect ().contains (event->pos ())) {
+        setFollow (true);
+        return;
+    }
+    if (event->button () == Qt::LeftButton) {
+        int row = rowAt (event->pos ());
+        if ((event->modifiers () & Qt::ShiftModifier) && (sel_anchor_ != -1)) {
+            sel_end_ = row;
+        } else if (row < rowCount ()) {
+            sel_anchor_ = row;
+            sel_end_ = row;
+        } else {
+            sel_anchor_ = -1;
+            sel_end_ = -1;
+        }
+        viewport ()->update ();
+    }
+    QAbstractScrollArea::mousePressEvent (event);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::mouseMoveEvent (QMouseEvent * event)
+{
+    if ((event->buttons () & Qt::LeftButton) && (sel_anchor_ != -1)) {
+        int row = qBound (0, rowAt (event->pos ()), qMax (0, rowCount () - 1));
+        if (row != sel_end_) {
+            sel_end_ = row;
+            viewport ()->update ();
+        }
+    }
+    QAbstractScrollArea::mouseMoveEvent (event);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::keyPressEvent (QKeyEvent * event)
+{
+    if (event->matches (QKeySequence::Copy)) {
+        copy ();
+    } else if (event->matches (QKeySequence::SelectAll)) {
+        selectAll ();
+    } else if (event->matches (QKeySequence::MoveToStartOfDocument)) {
+        verticalScrollBar ()->setValue (0);
+    } else if (event->matches (QKeySequence::MoveToEndOfDocument) ||
+               (event->key () == Qt::Key_End)) {
+        setFollow (true);
+        scrollToEnd ();
+    } else {
+        QAbstractScrollArea::keyPressEvent (event);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputView::contextMenuEvent (QContextMenuEvent * event)
+{
+    QMenu menu (this);
+    QAction * act_copy = menu.addAction (tr("Copy"), this, SLOT(copy()));
+    act_copy->setShortcut (QKeySequence::Copy);
+    act_copy->setEnabled (sel_anchor_ != -1);
+    QAction * act_all = menu.addAction (
+                tr("Select all"), this, SLOT(selectAll()));
+    act_all->setShortcut (QKeySequence::SelectAll);
+    menu.addSeparator ();
+    QAction * act_follow = menu.addAction (tr("Follow output"));
+    act_follow->setCheckable (true);
+    act_follow->setChecked (b_follow_);
+    connect (act_follow, SIGNAL(toggled(bool)),
+             this, SLOT(setFollow(bool)));
+    menu.exec (event->globalPos ());
+}
+/* ========================================================================= */
@@ -0,0 +1,210 @@
+/**
+ * @file outputview.h
+ * @brief Declarations for OutputView class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTVIEW_H_INCLUDE
+#define GUARD_OUTPUTVIEW_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrungui/procoutput.h>
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QColor>
+#include <QFont>
+#include <QRect>
+
+//! Shows the lines of a ProcOutput without copying them.
+class PROCRUNGUI_EXPORT OutputView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+
+    //! Default constructor.
+    explicit OutputView (
+            QWidget * parent = NULL);
+
+    //! Destructor.
+    virtual ~OutputView();
+
+    //! The output being shown (NULL for none).
+    const ProcOutput *
+    output () const {
+        return output_;
+    }
+
+    //! Show another output.
+    void
+    setOutput (
+            const ProcOutput * output);
+
+    //! The output has new content.
+    void
+    outputChanged ();
+
+    //! Text of the selected lines.
+    QString
+    selectedText () const;
+
+    //! Does the view keep showing the last lines as they come?
+    bool
+    follow () const {
+        return b_follow_;
+    }
+
+public slots:
+
+    //! Keep showing the last lines (true) or stay where the view is (false).
+    void
+    setFollow (
+            bool value);
+
+    //! Put selected lines in the clipboard.
+    void
+    copy ();
+
+    //! Select all lines.
+    void
+    selectAll ();
+
+signals:
+
+    //! The view started or stopped following the output.
+    void
+    followChanged (
+            bool value);
+
+protected:
+
+    virtual void
+    paintEvent (
+            QPaintEvent * event);
+
+    virtual void
+    resizeEvent (
+            QResizeEvent * event);
+
+    virtual void
+    changeEvent (
+            QEvent * event);
+
+    virtual void
+    mousePressEvent (
+            QMouseEvent * event);
+
+    virtual void
+    mouseMoveEvent (
+            QMouseEvent * event);
+
+    virtual void
+    keyPressEvent (
+            QKeyEvent * event);
+
+    virtual void
+    contextMenuEvent (
+            QContextMenuEvent * event);
+
+private slots:
+
+    //! The user moved the vertical scroll bar.
+    void
+    scrolled (
+            int value);
+
+private:
+
+    //! How a style is drawn.
+    struct TextStyle {
+        QColor fg_; /**< text color */
+        QColor bg_; /**< background (invalid for none) */
+        QFont font_; /**< font with the attributes applied */
+    };
+
+    //! A span decoded to text.
+    struct Piece {
+        QString text_; /**< the text, tabs expanded */
+        quint32 style_; /**< see AnsiStyle */
+    };
+
+    //! A line decoded to text.
+    struct DecodedLine {
+        QVector<Piece> pieces_; /**< the spans */
+        int channel_; /**< see ProcOutput::Channel */
+        int repeats_; /**< folded repeats shown after the text */
+        qint64 seq_; /**< sequence number of the line that was decoded */
+    };
+
+    //! Complete lines and the lines still being received.
+    int
+    rowCount () const;
+
+    //! The line for a row; false if the row does not exist.
+    bool
+    rowLine (
+            int row,
+            ProcOutput::Line & ln,
+            const ProcOutput::Span *& spans) const;
+
+    //! Turn the bytes of a line into text.
+    void
+    decodeLine (
+            const ProcOutput::Line & ln,
+            const ProcOutput::Span * spans,
+            int repeats,
+            DecodedLine & result) const;
+
+    //! Row under a point in viewport coordinates.
+    int
+    rowAt (
+            const QPoint & pos) const;
+
+    //! Number of rows that fit in the viewport.
+    int
+    visibleRows () const;
+
+    //! Adjust the scroll bars to current content (to the rows of the pause if paused).
+    void
+    updateScrollBars ();
+
+    //! Show the last row.
+    void
+    scrollToEnd ();
+
+    //! Where the notice of a paused view is drawn.
+    QRect
+    noticeRect () const;
+
+    //! Recompute font dependent values and drop cached styles.
+    void
+    fontChanged ();
+
+    //! Colors and font for a style on a channel.
+    const TextStyle &
+    textStyle (
+            quint32 style,
+            int channel);
+
+    const ProcOutput * output_; /**< what we show */
+    QHash<int, DecodedLine> decoded_; /**< complete lines that were visible */
+    QHash<quint32, TextStyle> styles_; /**< cached styles */
+    int line_height_; /**< height of a row in pixels */
+    int char_width_; /**< average character width in pixels */
+    int ascent_; /**< font ascent in pixels */
+    int max_columns_; /**< widest line seen so far, in bytes */
+    int scanned_lines_; /**< lines checked for max_columns_ */
+    int sel_anchor_; /**< row where the selection started (-1 for none) */
+    int sel_end_; /**< row where the selection ends */
+    bool b_follow_; /**< show the last lines as they come */
+    bool b_adjusting_; /**< we are moving the scroll bar, not the user */
+    int paused_rows_; /**< rows the scroll bar covers while paused */
+    qint64 pause_seq_; /**< sequence number of the first line after the pause */
+};
+
+#endif // GUARD_OUTPUTVIEW_H_INCLUDE
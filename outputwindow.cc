@@ -0,0 +1,138 @@
+/**
+ * @file outputwindow.cc
+ * @brief Definitions for OutputWindow class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "outputwindow.h"
+#include "outputview.h"
+
+#include "procrungui-private.h"
+
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QVBoxLayout>
+
+#include <math.h>
+
+/**
+ * @class OutputWindow
+ *
+ * Each pane is an OutputView over the ProcOutput of a process, the same
+ * store that the main view reads; nothing is copied, so a window costs
+ * only the rows it has on screen. The owner forwards changes through
+ * outputChanged () and must call removeOutput () before an output is
+ * destroyed.
+ *
+ * The window deletes itself when closed.
+ */
+
+/* ------------------------------------------------------------------------- */
+OutputWindow::OutputWindow (QWidget * parent) :
+    QWidget (parent, Qt::Window),
+    grid_ (NULL),
+    panes_ ()
+{
+    setAttribute (Qt::WA_DeleteOnClose);
+    grid_ = new QGridLayout (this);
+    grid_->setContentsMargins (4, 4, 4, 4);
+    resize (640, 400);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputWindow::~OutputWindow()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputWindow::addOutput (const ProcOutput * output, const QString & s_title)
+{
+    if (hasOutput (output))
+        return;
+
+    Pane pane;
+    pane.output_ = output;
+    pane.box_ = new QGroupBox (s_title, this);
+    pane.view_ = new OutputView (pane.box_);
+    QVBoxLayout * lay = new QVBoxLayout (pane.box_);
+    lay->setContentsMargins (2, 2, 2, 2);
+    lay->addWidget (pane.view_);
+    pane.view_->setOutput (output);
+    panes_.append (pane);
+    arrange ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputWindow::removeOutput (const ProcOutput * output)
+{
+    int i = 0;
+    for (;;) {
+        if (i == panes_.count ())
+            return;
+        if (panes_.at (i).output_ == output)
+            break;
+        ++i;
+    }
+
+    Pane pane = panes_.takeAt (i);
+    pane.view_->setOutput (NULL);
+    grid_->removeWidget (pane.box_);
+    delete pane.box_;
+
+    if (panes_.isEmpty ()) {
+        close ();
+    } else {
+        arrange ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool OutputWindow::hasOutput (const ProcOutput * output) const
+{
+    foreach(const Pane & pane, panes_) {
+        if (pane.output_ == output)
+            return true;
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputWindow::outputChanged (const ProcOutput * output)
+{
+    foreach(const Pane & pane, panes_) {
+        if (pane.output_ == output) {
+            pane.view_->outputChanged ();
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void OutputWindow::arrange ()
+{
+    foreach(const Pane & pane, panes_) {
+        grid_->removeWidget (pane.box_);
+    }
+
+    int count = panes_.count ();
+    int columns = qMax (1, static_cast<int>(ceil (sqrt (
+                                                static_cast<double>(count)))));
+    for (int i = 0; i < count; ++i) {
+        grid_->addWidget (panes_.at (i).box_, i / columns, i % columns);
+    }
+
+    if (count == 1) {
+        setWindowTitle (panes_.first ().box_->title ());
+    } else {
+        setWindowTitle (tr ("%n output(s)", "", count));
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,84 @@
+/**
+ * @file outputwindow.h
+ * @brief Declarations for OutputWindow class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_OUTPUTWINDOW_H_INCLUDE
+#define GUARD_OUTPUTWINDOW_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QWidget>
+#include <QList>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QGridLayout;
+class QGroupBox;
+QT_END_NAMESPACE
+
+class OutputView;
+class ProcOutput;
+
+//! A separate window showing the output of one or more processes.
+class PROCRUNGUI_EXPORT OutputWindow : public QWidget {
+    Q_OBJECT
+
+public:
+
+    //! Default constructor.
+    explicit OutputWindow (
+            QWidget * parent = NULL);
+
+    //! Destructor.
+    virtual ~OutputWindow();
+
+    //! Show an output in a new pane (nothing happens if already shown).
+    void
+    addOutput (
+            const ProcOutput * output,
+            const QString & s_title);
+
+    //! Stop showing an output; the window closes when it has no panes.
+    void
+    removeOutput (
+            const ProcOutput * output);
+
+    //! Tell if an output is shown in this window.
+    bool
+    hasOutput (
+            const ProcOutput * output) const;
+
+    //! Number of panes.
+    int
+    paneCount () const {
+        return panes_.count ();
+    }
+
+    //! An output has new content.
+    void
+    outputChanged (
+            const ProcOutput * output);
+
+private:
+
+    //! One output in the window.
+    struct Pane {
+        const ProcOutput * output_; /**< what is shown */
+        QGroupBox * box_; /**< frame with the title */
+        OutputView * view_; /**< the view */
+    };
+
+    //! Place the panes in a grid that is about as wide as it is tall.
+    void
+    arrange ();
+
+    QGridLayout * grid_; /**< the layout of the panes */
+    QList<Pane> panes_; /**< the panes */
+};
+
+#endif // GUARD_OUTPUTWINDOW_H_INCLUDE
@@ -0,0 +1,920 @@
+/**
+ * @file prgprocess.cc
+ * @brief Definitions for PrgProcess class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "prgprocess.h"
+#include "proctree.h"
+#include "procpty.h"
+#include "proclauncher.h"
+#include "outputpacker.h"
+#include "outputlog.h"
+
+#include "procrungui-private.h"
+
+#include <QLabel>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QProcessEnvironment>
+
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/wait.h>
+#   include <sys/ioctl.h>
+#endif
+
+/**
+ * @class PrgProcess
+ *
+ * Each instance is owned by a ProcRunGui and is associated with a tab.
+ * The data used to start the process is kept around so that
+ * the process may be identified (and restarted) later.
+ *
+ * When asked to, the program is started by the ProcLauncher helper
+ * instead of QProcess. The QProcess part then stays NotRunning; we read
+ * the pipes (or the terminal) ourselves and learn about the end from
+ * the helper, so isRunning (), exit_code_ and b_crashed_ are what callers
+ * should look at rather than state (), exitCode () and exitStatus ().
+ * The ended () signal is emitted either way.
+ *
+ * A program that can't be started and a replayed run end from the event
+ * loop, never inside perform () or replay (): their callers still use
+ * the instance, and ending may remove it. Until then isRunning () is true.
+ */
+
+/* ------------------------------------------------------------------------- */
+PrgProcess::PrgProcess (
+        ProcRunGui * prg, const ProcRunData & data,
+        ProcRunGui::Kb kb, void * user_data) :
+    QProcess (static_cast<QObject*>(prg)),
+    prg_ (prg),
+    data_ (data),
+    start_time_(),
+    end_time_(),
+    output_(),
+    b_started_(false),
+    errors_(),
+    states_(),
+    kb_(kb),
+    user_data_(user_data),
+    widget_(NULL),
+    close_on_exit_(false),
+    peak_rss_(-1),
+    output_size_(0),
+    pid_(0),
+    b_signaled_(false),
+    b_killed_(false),
+    kill_timer_(),
+    tree_(),
+    survivors_(),
+    pty_(NULL),
+    pty_notifier_(NULL),
+    filter_(NULL),
+    progress_bar_(NULL),
+    limits_(NULL),
+    exit_code_(0),
+    b_crashed_(false),
+    b_via_launcher_(false),
+    b_launched_(false),
+    out_fd_(-1),
+    err_fd_(-1),
+    out_notifier_(NULL),
+    err_notifier_(NULL),
+    policy_(),
+    attempt_(1),
+    s_settings_key_(),
+    b_timed_out_(false),
+    deadline_id_(0),
+    idle_id_(0),
+    last_output_ms_(0),
+    rss_(-1),
+    cpu_ms_(-1),
+    pipe_stage_(-1),
+    counters_(),
+    s_cache_key_(),
+    b_from_cache_(false),
+    b_end_queued_(false),
+    session_id_(-1),
+    log_(NULL)
+{
+    output_.setCounters (&counters_);
+    ProcMetrics::global ().processes_started_.fetchAndAddRelaxed (1);
+    kill_timer_.setSingleShot (true);
+    connect (&kill_timer_, SIGNAL(timeout()),
+             this, SLOT(killTree()));
+#if defined(Q_OS_UNIX) && (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    setChildProcessModifier ([this] () { childSetup (); });
+#endif
+
+    connect (this, &QProcess::errorOccurred,
+             this, &PrgProcess::errorSlot);
+    connect (this,
+             SIGNAL(finished(int,QProcess::ExitStatus)),
+             SLOT(finishedSlot(int,QProcess::ExitStatus)));
+    connect (this,
+             SIGNAL(readyReadStandardError()),
+             SLOT(readyReadStandardErrorSlot()));
+    connect (this,
+             SIGNAL(readyReadStandardOutput()),
+             SLOT(readyReadStandardOutputSlot()));
+    connect (this,
+             SIGNAL(started()),
+             SLOT(startedSlot()));
+    connect (this,
+             SIGNAL(stateChanged (QProcess::ProcessState)),
+             SLOT(stateChangedSlot (QProcess::ProcessState)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+PrgProcess::~PrgProcess()
+{
+    // QProcess kills its own child; ours would be left behind
+    if (b_launched_ && (pid_ > 0)) {
+        ProcTree::sendSignal (pid_, QList<qint64>(), ProcTree::Kill);
+    }
+    closeLaunchedFds ();
+    closePty ();
+    counters_.setBacklog (0);
+    output_.setCounters (NULL);
+    ProcMetrics::global ().processes_destroyed_.fetchAndAddRelaxed (1);
+    output_.setFilter (NULL);
+    delete filter_;
+    delete limits_;
+    delete log_;
+    if (widget_ != NULL) {
+        delete widget_;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * An empty configuration removes the filter.
+ */
+void PrgProcess::setFilter (const OutputFilterConfig & config)
+{
+    output_.setFilter (NULL);
+    delete filter_;
+    filter_ = NULL;
+    if (!config.isEmpty ()) {
+        filter_ = new OutputFilter (config);
+        output_.setFilter (filter_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Must be called before perform (). The environment starts from the one
+ * already set for the process, or ours if none was.
+ */
+void PrgProcess::setLaunchProfile (const LaunchProfile & profile)
+{
+    if (!profile.sl_env_.isEmpty ()) {
+        QProcessEnvironment env = processEnvironment ();
+        if (env.isEmpty ()) {
+            env = QProcessEnvironment::systemEnvironment ();
+        }
+        profile.applyEnvironment (env);
+        setProcessEnvironment (env);
+    }
+
+    delete limits_;
+    limits_ = NULL;
+    LaunchProfile limits = profile;
+    limits.sl_env_.clear ();
+    if (!limits.isEmpty () && LaunchLimits::isSupported ()) {
+        limits_ = new LaunchLimits (limits);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::perform (
+        const QStringList & input, bool b_use_pty, bool b_use_launcher)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+
+    // the terminal must exist before fork so that the child inherits it
+    if (b_use_pty && ProcPty::isSupported ()) {
+        pty_ = new ProcPty ();
+        if (!pty_->open ()) {
+            PROCRUNGUI_DEBUGM("Falling back to pipes for %s\n",
+                              TMP_A(data_.s_program_));
+            closePty ();
+        }
+    }
+
+    QByteArray input_data;
+    foreach (const QString & s, input) {
+        input_data.append (s.toLatin1 ());
+    }
+
+    if (b_use_launcher && (pipe_stage_ == -1) && performLaunched (input_data)) {
+        PROCRUNGUI_TRACE_EXIT;
+        return;
+    }
+
+    // start the program
+    this->start (QIODevice::ReadWrite);
+    if (!this->waitForStarted()) {
+        closePty ();
+        return;
+    }
+
+    if (pty_ != NULL) {
+        pty_->closeSlave ();
+        watchPty ();
+    }
+
+    // provide the input; later stages of a pipeline read the previous one
+    if (pipe_stage_ <= 0) {
+        this->write (input_data);
+        this->closeWriteChannel();
+    }
+
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The input is written in one go once the program started, so it has
+ * to fit in the pipe; larger inputs, requests the helper can't take and
+ * a helper that went away all fall back to QProcess.
+ *
+ * @return true if the launcher took care of the program (including
+ * reporting that it could not be started).
+ */
+bool PrgProcess::performLaunched (const QByteArray & input)
+{
+#ifdef Q_OS_LINUX
+    ProcLauncher * launcher = ProcLauncher::instance ();
+    if ((launcher == NULL) || (input.size () > MAX_LAUNCHED_INPUT))
+        return false;
+
+    int in_pipe[2] = { -1, -1 };
+    int out_pipe[2] = { -1, -1 };
+    int err_pipe[2] = { -1, -1 };
+    bool b_ok = ::pipe2 (in_pipe, O_CLOEXEC) == 0;
+    if (b_ok && (pty_ == NULL)) {
+        b_ok = (::pipe2 (out_pipe, O_CLOEXEC) == 0) &&
+                (::pipe2 (err_pipe, O_CLOEXEC) == 0);
+    }
+
+    ProcLauncher::Request req;
+    // as set by ProcRunData::setupProcess ()
+    req.s_program_ = program ();
+    req.sl_args_ = arguments ();
+    req.s_wrk_dir_ = workingDirectory ();
+    req.sl_env_ = processEnvironment ().toStringList ();
+    req.fd_in_ = in_pipe[0];
+    if (pty_ != NULL) {
+        req.fd_out_ = pty_->slaveFd ();
+        req.fd_err_ = pty_->slaveFd ();
+        req.b_ctty_ = true;
+    } else {
+        req.fd_out_ = out_pipe[1];
+        req.fd_err_ = err_pipe[1];
+    }
+    if (limits_ != NULL) {
+        req.limits_ = &limits_->params ();
+    }
+
+    qint64 pid = -1;
+    int error = 0;
+    if (b_ok) {
+        b_ok = launcher->spawn (this, req, pid, error);
+    }
+
+    // the child has its own copies by now
+    int child_ends[3] = { in_pipe[0], out_pipe[1], err_pipe[1] };
+    for (int i = 0; i < 3; ++i) {
+        if (child_ends[i] != -1) {
+            ::close (child_ends[i]);
+        }
+    }
+    if (!b_ok) {
+        int parent_ends[3] = { in_pipe[1], out_pipe[0], err_pipe[0] };
+        for (int i = 0; i < 3; ++i) {
+            if (parent_ends[i] != -1) {
+                ::close (parent_ends[i]);
+            }
+        }
+        return false;
+    }
+
+    b_via_launcher_ = true;
+    if (pty_ != NULL) {
+        pty_->closeSlave ();
+    }
+
+    if (pid <= 0) {
+        ::close (in_pipe[1]);
+        closeLaunchedFds ();
+        closePty ();
+        PROCRUNGUI_DEBUGM("Failed to start %s: %s\n",
+                          TMP_A(data_.s_program_), strerror (error));
+        setErrorString (QString::fromLocal8Bit (strerror (error)));
+        errorSlot (QProcess::FailedToStart);
+        return true;
+    }
+
+    b_launched_ = true;
+    b_started_ = true;
+    start_time_ = QDateTime::currentDateTime ();
+    pid_ = pid;
+
+    if (pty_ != NULL) {
+        watchPty ();
+    } else {
+        out_fd_ = out_pipe[0];
+        err_fd_ = err_pipe[0];
+        ::fcntl (out_fd_, F_SETFL, ::fcntl (out_fd_, F_GETFL) | O_NONBLOCK);
+        ::fcntl (err_fd_, F_SETFL, ::fcntl (err_fd_, F_GETFL) | O_NONBLOCK);
+        out_notifier_ = new QSocketNotifier (out_fd_, QSocketNotifier::Read, this);
+        connect (out_notifier_, SIGNAL(activated(int)),
+                 this, SLOT(readyReadFdSlot(int)));
+        err_notifier_ = new QSocketNotifier (err_fd_, QSocketNotifier::Read, this);
+        connect (err_notifier_, SIGNAL(activated(int)),
+                 this, SLOT(readyReadFdSlot(int)));
+    }
+
+    // fits in the pipe, so this does not block
+    const char * p = input.constData ();
+    qint64 left = input.size ();
+    while (left > 0) {
+        ssize_t n = ::write (in_pipe[1], p, static_cast<size_t> (left));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        p += n;
+        left -= n;
+    }
+    ::close (in_pipe[1]);
+    return true;
+#else
+    Q_UNUSED(input);
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The output goes through the store like the one of a real run (filter
+ * included); the end is reported the usual way from the event loop, so
+ * the process is still around when this returns.
+ */
+void PrgProcess::replay (const ResultCache::Entry & entry)
+{
+    b_from_cache_ = true;
+    b_started_ = true;
+    start_time_ = QDateTime::currentDateTime ();
+    foreach(const ResultCache::Record & rec, entry.records_) {
+        ProcOutput::Channel channel = rec.channel_ == ProcOutput::StdErr ?
+                    ProcOutput::StdErr : ProcOutput::StdOut;
+        int done = 0;
+        while (done < rec.data_.size ()) {
+            int capacity;
+            char * buffer = output_.writeBuffer (channel, capacity);
+            int n = qMin (capacity, rec.data_.size () - done);
+            memcpy (buffer, rec.data_.constData () + done, static_cast<size_t>(n));
+            output_.commitWrite (channel, n);
+            done += n;
+        }
+        output_size_ += rec.data_.size ();
+    }
+    exit_code_ = entry.exit_code_;
+    b_end_queued_ = true;
+    QMetaObject::invokeMethod (this, "replayFinishedSlot", Qt::QueuedConnection);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::replayFinishedSlot ()
+{
+    b_end_queued_ = false;
+    finishedSlot (exit_code_, QProcess::NormalExit);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Nothing is started and ended () is not emitted. A process that was
+ * still running when the session ended is shown as crashed.
+ */
+void PrgProcess::restore (
+        const ProcSession::Item & item, const QString & s_log_base)
+{
+    b_started_ = true;
+    start_time_ = QDateTime::fromMSecsSinceEpoch (item.start_ms_);
+    end_time_ = item.b_running_ ?
+                start_time_ : QDateTime::fromMSecsSinceEpoch (item.end_ms_);
+    exit_code_ = item.exit_code_;
+    b_crashed_ = item.b_crashed_ || item.b_running_;
+    if (!output_.mapLog (s_log_base)) {
+        output_.appendNotice (tr ("The output was lost"));
+    }
+    output_size_ = output_.byteSize ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @a status is what waitpid () returned for the program or -1 if the
+ * helper went away and the end can't be known.
+ */
+void PrgProcess::launchedExited (int status)
+{
+    if (!b_launched_)
+        return;
+
+    int code;
+    QProcess::ExitStatus exit_status;
+#ifdef Q_OS_LINUX
+    if (status == -1) {
+        code = -1;
+        exit_status = QProcess::CrashExit;
+        prg_->appendNotice (this, tr ("Lost track of the process"));
+    } else if (WIFEXITED(status)) {
+        code = WEXITSTATUS(status);
+        exit_status = QProcess::NormalExit;
+    } else {
+        code = WIFSIGNALED(status) ? WTERMSIG(status) : -1;
+        exit_status = QProcess::CrashExit;
+    }
+#else
+    Q_UNUSED(status);
+    code = -1;
+    exit_status = QProcess::CrashExit;
+#endif
+
+    // what the program wrote before it ended
+    readFd (out_fd_, out_notifier_, ProcOutput::StdOut);
+    readFd (err_fd_, err_notifier_, ProcOutput::StdErr);
+    closeLaunchedFds ();
+    b_launched_ = false;
+    finishedSlot (code, exit_status);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * On Linux the kernel keeps the high water mark of the resident set
+ * (VmHWM) so sampling from time to time is enough to learn the peak.
+ * The current resident set and the processor time of the program
+ * (not of its children) are sampled at the same time.
+ * Other platforms leave peak_rss_, rss_ and cpu_ms_ at -1.
+ */
+void PrgProcess::sampleResources ()
+{
+#ifdef Q_OS_LINUX
+    if (!isRunning ())
+        return;
+    QFile f (QString (QLatin1String ("/proc/%1/status")).arg (pid_));
+    if (!f.open (QIODevice::ReadOnly))
+        return;
+    int found = 0;
+    while (found < 2) {
+        QByteArray line = f.readLine ();
+        if (line.isEmpty ())
+            break;
+        bool b_hwm = line.startsWith ("VmHWM:");
+        if (b_hwm || line.startsWith ("VmRSS:")) {
+            ++found;
+            bool b_ok;
+            qint64 kb = line.mid (6).trimmed ().split (' ').at (0).toLongLong (&b_ok);
+            if (!b_ok)
+                continue;
+            if (b_hwm) {
+                peak_rss_ = qMax (peak_rss_, kb);
+            } else {
+                rss_ = kb;
+            }
+        }
+    }
+    f.close ();
+
+    // utime and stime follow the state, after the name in parentheses
+    QFile fstat (QString (QLatin1String ("/proc/%1/stat")).arg (pid_));
+    if (!fstat.open (QIODevice::ReadOnly))
+        return;
+    QByteArray stat = fstat.readAll ();
+    int close_paren = stat.lastIndexOf (')');
+    if (close_paren == -1)
+        return;
+    QList<QByteArray> fields = stat.mid (close_paren + 2).split (' ');
+    if (fields.count () > 12) {
+        static const long ticks = ::sysconf (_SC_CLK_TCK);
+        qint64 total = fields.at (11).toLongLong () + fields.at (12).toLongLong ();
+        if (ticks > 0) {
+            cpu_ms_ = total * 1000 / ticks;
+        }
+    }
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+#if defined(Q_OS_UNIX) && (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+void PrgProcess::setupChildProcess ()
+{
+    childSetup ();
+}
+#endif
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::childSetup ()
+{
+    ProcTree::becomeGroupLeader ();
+    if (pty_ != NULL) {
+        pty_->setupChild ();
+    }
+    // after the terminal, so that complaints reach the output
+    if (limits_ != NULL) {
+        limits_->setupChild ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::closePty ()
+{
+    if (pty_notifier_ != NULL) {
+        delete pty_notifier_;
+        pty_notifier_ = NULL;
+    }
+    if (pty_ != NULL) {
+        delete pty_;
+        pty_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::watchPty ()
+{
+    pty_notifier_ = new QSocketNotifier (
+                pty_->masterFd (), QSocketNotifier::Read, this);
+    connect (pty_notifier_, SIGNAL(activated(int)),
+             this, SLOT(readyReadPtySlot()));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Descendants of the program may keep the pipe open after it ended;
+ * whatever they write later is not collected.
+ */
+void PrgProcess::readFd (
+        int & fd, QSocketNotifier *& notifier, ProcOutput::Channel channel)
+{
+#ifdef Q_OS_LINUX
+    if (fd == -1)
+        return;
+
+    counters_.setBacklog (pendingBytes (fd));
+    bool b_any = false;
+    bool b_end = false;
+    for (;;) {
+        int capacity;
+        char * buffer = output_.writeBuffer (channel, capacity);
+        ssize_t n = ::read (fd, buffer, static_cast<size_t> (capacity));
+        if (n > 0) {
+            output_size_ += n;
+            counters_.addRead (channel, n);
+            output_.commitWrite (channel, static_cast<int>(n));
+            b_any = true;
+        } else if ((n == -1) && (errno == EINTR)) {
+            continue;
+        } else {
+            b_end = (n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK));
+            break;
+        }
+    }
+
+    if (b_end) {
+        if (notifier != NULL) {
+            notifier->setEnabled (false);
+            notifier->deleteLater ();
+            notifier = NULL;
+        }
+        ::close (fd);
+        fd = -1;
+    }
+    if (b_any) {
+        prg_->processGeneratedText (this, channel);
+    }
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(notifier);
+    Q_UNUSED(channel);
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Tells how far behind the program we are when we get to read.
+ */
+qint64 PrgProcess::pendingBytes (int fd)
+{
+#ifdef Q_OS_LINUX
+    int pending = 0;
+    if ((fd != -1) && (::ioctl (fd, FIONREAD, &pending) == 0))
+        return pending;
+#else
+    Q_UNUSED(fd);
+#endif
+    return 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::readyReadFdSlot (int fd)
+{
+    if (fd == out_fd_) {
+        readFd (out_fd_, out_notifier_, ProcOutput::StdOut);
+    } else if (fd == err_fd_) {
+        readFd (err_fd_, err_notifier_, ProcOutput::StdErr);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::closeLaunchedFds ()
+{
+#ifdef Q_OS_LINUX
+    delete out_notifier_;
+    out_notifier_ = NULL;
+    delete err_notifier_;
+    err_notifier_ = NULL;
+    if (out_fd_ != -1) {
+        ::close (out_fd_);
+        out_fd_ = -1;
+    }
+    if (err_fd_ != -1) {
+        ::close (err_fd_);
+        err_fd_ = -1;
+    }
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::readyReadPtySlot ()
+{
+    if (pty_ == NULL)
+        return;
+
+    counters_.setBacklog (pendingBytes (pty_->masterFd ()));
+    bool b_any = false;
+    for (;;) {
+        int capacity;
+        char * buffer = output_.writeBuffer (ProcOutput::StdOut, capacity);
+        qint64 n = pty_->read (buffer, capacity);
+        if (n > 0) {
+            output_size_ += n;
+            counters_.addRead (ProcOutput::StdOut, n);
+            output_.commitWrite (ProcOutput::StdOut, static_cast<int>(n));
+            b_any = true;
+        } else {
+            // nothing for now or never again
+            if ((n < 0) && (pty_notifier_ != NULL)) {
+                pty_notifier_->setEnabled (false);
+            }
+            break;
+        }
+    }
+    if (b_any) {
+        prg_->processGeneratedText (this, ProcOutput::StdOut);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::packOutput ()
+{
+    OutputPacker * packer = new OutputPacker (output_);
+    if (packer->isEmpty ()) {
+        delete packer;
+        return;
+    }
+    connect (packer, SIGNAL(done()),
+             this, SLOT(outputPacked()), Qt::QueuedConnection);
+    packer->start ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::outputPacked ()
+{
+    OutputPacker * packer = qobject_cast<OutputPacker*> (sender ());
+    if (packer == NULL)
+        return;
+    packer->apply (output_);
+    PROCRUNGUI_DEBUGM("Output of %s packed to %lld bytes\n",
+                      TMP_A(data_.s_program_), output_.packedSize ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::collectTree ()
+{
+    tree_ = ProcTree::collect (pid_, pid_, tree_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The whole process group receives SIGTERM. If the process is still
+ * around after @a kill_timeout_ms milliseconds the group is killed.
+ * A negative timeout disables the escalation.
+ */
+void PrgProcess::terminateTree (int kill_timeout_ms)
+{
+    if (!isRunning ())
+        return;
+
+    if (!ProcTree::hasProcessGroups () || (pid_ <= 0)) {
+        terminate ();
+    } else {
+        b_signaled_ = true;
+        collectTree ();
+        ProcTree::sendSignal (
+                    pid_, ProcTree::pids (tree_), ProcTree::Terminate);
+    }
+
+    if (kill_timeout_ms >= 0) {
+        kill_timer_.start (kill_timeout_ms);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::killTree ()
+{
+    kill_timer_.stop ();
+    if (!ProcTree::hasProcessGroups () || (pid_ <= 0)) {
+        if (isRunning ()) {
+            kill ();
+        }
+        return;
+    }
+
+    b_signaled_ = true;
+    b_killed_ = true;
+    // the ids seen at terminate time may have been reused since
+    collectTree ();
+    ProcTree::sendSignal (pid_, ProcTree::pids (tree_), ProcTree::Kill);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * QProcess already buffered the data; it is copied once, straight into
+ * the output chunks, from the channel selected with setReadChannel ().
+ */
+void PrgProcess::readInto (ProcOutput::Channel channel)
+{
+    counters_.setBacklog (bytesAvailable ());
+    bool b_any = false;
+    for (;;) {
+        int capacity;
+        char * buffer = output_.writeBuffer (channel, capacity);
+        qint64 n = read (buffer, capacity);
+        if (n <= 0)
+            break;
+        output_size_ += n;
+        counters_.addRead (channel, n);
+        output_.commitWrite (channel, static_cast<int>(n));
+        b_any = true;
+    }
+    if (b_any) {
+        prg_->processGeneratedText (this, channel);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::readyReadStandardErrorSlot ()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    setReadChannel (QProcess::StandardError);
+    readInto (ProcOutput::StdErr);
+    setReadChannel (QProcess::StandardOutput);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::readyReadStandardOutputSlot ()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    readInto (ProcOutput::StdOut);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::startedSlot ()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    b_started_ = true;
+    start_time_ = QDateTime::currentDateTime ();
+    pid_ = processId ();
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::finishedSlot (
+        int exitCode, QProcess::ExitStatus exitStatus)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    // kept here, as QProcess knows nothing about launched programs
+    exit_code_ = exitCode;
+    b_crashed_ = exitStatus != QProcess::NormalExit;
+    end_time_ = QDateTime::currentDateTime ();
+    kill_timer_.stop ();
+
+    // whatever is still buffered in the terminal belongs to this run
+    if (pty_ != NULL) {
+        readyReadPtySlot ();
+        closePty ();
+    }
+    output_.flush ();
+
+    // whatever we asked to go away and is still around is killed
+    // and reported; the group outlives its leader
+    if (b_signaled_ && (pid_ > 0)) {
+        // the id of the leader is free now; only its group and the
+        // processes seen before still count
+        QList<qint64> remaining = ProcTree::pids (
+                    ProcTree::collect (-1, pid_, tree_));
+        if (!remaining.isEmpty ()) {
+            survivors_ = remaining;
+            ProcTree::sendSignal (pid_, remaining, ProcTree::Kill);
+        }
+    }
+    if (limits_ != NULL) {
+        limits_->release ();
+    }
+    // before finishProcess (), which may delete us
+    emit ended ();
+    // a run that is tried again hands the callback to the next attempt
+    if (!prg_->scheduleRetry (this) && (kb_ != NULL)) {
+        kb_(prg_, this, user_data_);
+    }
+    prg_->finishProcess (this);
+
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::stateChangedSlot (QProcess::ProcessState newState)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    states_.append (newState);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::errorSlot (QProcess::ProcessError error)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    errors_.append (error);
+
+    // finished() is never emitted for a program that could not be started;
+    // the end is reported later, as the caller of perform () still uses us
+    if ((error == QProcess::FailedToStart) && !b_started_ && !b_end_queued_) {
+        start_time_ = QDateTime::currentDateTime ();
+        b_end_queued_ = true;
+        QMetaObject::invokeMethod (this, "startFailedSlot", Qt::QueuedConnection);
+    }
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void PrgProcess::startFailedSlot ()
+{
+    b_end_queued_ = false;
+    finishedSlot (-1, QProcess::CrashExit);
+}
+/* ========================================================================= */
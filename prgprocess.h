@@ -0,0 +1,313 @@
+/**
+ * @file prgprocess.h
+ * @brief Declarations for PrgProcess class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PRGPROCESS_H_INCLUDE
+#define GUARD_PRGPROCESS_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrungui/procrungui.h>
+#include <procrungui/procoutput.h>
+#include <procrungui/launchprofile.h>
+#include <procrungui/runpolicy.h>
+#include <procrungui/procmetrics.h>
+#include <procrungui/resultcache.h>
+#include <procrungui/procsession.h>
+#include <procrungui/proctree.h>
+#include <procrun/procrundata.h>
+
+#include <QProcess>
+#include <QDateTime>
+#include <QList>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QProgressBar;
+class QSocketNotifier;
+QT_END_NAMESPACE
+
+class ProcPty;
+class LaunchLimits;
+class OutputLog;
+
+//! A process managed by the ProcRunGui class.
+class PROCRUNGUI_EXPORT PrgProcess : public QProcess {
+    Q_OBJECT
+
+public:
+
+    //! Limits.
+    enum {
+        MAX_LAUNCHED_INPUT = 32 * 1024 /**< largest input for launcher mode */
+    };
+
+    //! Constructor.
+    PrgProcess (
+            ProcRunGui * prg,
+            const ProcRunData & data,
+            ProcRunGui::Kb kb,
+            void * user_data);
+
+    //! Destructor.
+    virtual ~PrgProcess();
+
+    //! Get the duration in seconds.
+    qint64
+    runDuration() const {
+        return start_time_.secsTo (end_time_);
+    }
+
+    //! Get the duration in seconds.
+    int durationInSeconds () {
+        return static_cast<int>(start_time_.secsTo (end_time_));
+    }
+
+    //! Get the duration in milliseconds.
+    int durationInMiliSeconds () {
+        return static_cast<int>(start_time_.msecsTo (end_time_));
+    }
+
+    //! Start the program (optionally with a pseudo-terminal or the launcher).
+    void
+    perform (
+            const QStringList & input,
+            bool b_use_pty = false,
+            bool b_use_launcher = false);
+
+    //! Filter the output before it is stored.
+    void
+    setFilter (
+            const OutputFilterConfig & config);
+
+    //! Environment and limits to apply when the program starts.
+    void
+    setLaunchProfile (
+            const LaunchProfile & profile);
+
+    //! Is the output of this process a pseudo-terminal?
+    bool
+    usesPty () const {
+        return pty_ != NULL;
+    }
+
+    //! Tell if this process is running or not.
+    bool
+    isRunning () const {
+        return b_launched_ || b_end_queued_ || (state () != NotRunning);
+    }
+
+    //! Was the program started by the launcher helper?
+    bool
+    usesLauncher () const {
+        return b_via_launcher_;
+    }
+
+    //! End as a stored run did, without starting the program.
+    void
+    replay (
+            const ResultCache::Entry & entry);
+
+    //! Show a process of an earlier session, with its log mapped.
+    void
+    restore (
+            const ProcSession::Item & item,
+            const QString & s_log_base);
+
+    //! The launcher tells that the program ended (waitpid status, -1 if unknown).
+    void
+    launchedExited (
+            int status);
+
+    //! Compress the output that will not change anymore, in the background.
+    void
+    packOutput ();
+
+    //! Ask the process and all its descendants to terminate.
+    void
+    terminateTree (
+            int kill_timeout_ms);
+
+    //! Update resource usage figures (peak memory).
+    void
+    sampleResources ();
+
+    //! Tell if the process ended normally with a zero exit code.
+    bool
+    isSuccess () const {
+        return b_started_ && !isRunning () && !b_crashed_ &&
+                (exit_code_ == 0);
+    }
+
+public slots:
+
+    //! Some output coming out of error channel.
+    void
+    readyReadStandardErrorSlot ();
+
+    //! Some output coming out of output channel.
+    void
+    readyReadStandardOutputSlot ();
+
+    //! Connected to keep the started/not started state.
+    void
+    startedSlot ();
+
+    //! Connected to keep the started/not started state.
+    void
+    finishedSlot (
+            int exitCode,
+            QProcess::ExitStatus exitStatus);
+
+    //! Track this slot to accumulate the list of states.
+    void
+    stateChangedSlot (
+            QProcess::ProcessState newState);
+
+    //! Accumulate errors here.
+    void
+    errorSlot (
+            QProcess::ProcessError error);
+
+    //! Kill the process and all its descendants.
+    void
+    killTree ();
+
+    //! Some output coming out of the pseudo-terminal.
+    void
+    readyReadPtySlot ();
+
+    //! The output was compressed.
+    void
+    outputPacked ();
+
+    //! Some output coming out of a pipe of a launched program.
+    void
+    readyReadFdSlot (
+            int fd);
+
+    //! Report a program that could not be started as finished.
+    void
+    startFailedSlot ();
+
+    //! Report the end of a replayed run.
+    void
+    replayFinishedSlot ();
+
+signals:
+
+    //! The process ended and finishing touches were applied.
+    void
+    ended ();
+
+protected:
+
+#if defined(Q_OS_UNIX) && (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+    //! Runs in the child; places it in its own process group.
+    virtual void
+    setupChildProcess ();
+#endif
+
+private:
+
+    //! Prepare the child after fork; async-signal-safe.
+    void
+    childSetup ();
+
+    //! Release the pseudo-terminal.
+    void
+    closePty ();
+
+    //! Read the terminal when it has data.
+    void
+    watchPty ();
+
+    //! Start the program through the launcher; false to use QProcess.
+    bool
+    performLaunched (
+            const QByteArray & input);
+
+    //! Move what is available in a pipe to the output; closes it at end.
+    void
+    readFd (
+            int & fd,
+            QSocketNotifier *& notifier,
+            ProcOutput::Channel channel);
+
+    //! Bytes waiting to be read from a descriptor (0 if unknown).
+    static qint64
+    pendingBytes (
+            int fd);
+
+    //! Release the pipes of a launched program.
+    void
+    closeLaunchedFds ();
+
+    //! Move what QProcess has for current read channel to the output.
+    void
+    readInto (
+            ProcOutput::Channel channel);
+
+    //! Remember the processes that are part of our tree right now
+    //! and forget the ones that are gone.
+    void
+    collectTree ();
+
+public:
+    ProcRunGui * prg_;
+    ProcRunData data_; /**< what was requested to run */
+    QDateTime start_time_; /**< the time when the process was started */
+    QDateTime end_time_; /**< the time when the process ended */
+    ProcOutput output_; /**< the output through output and error channel */
+    bool b_started_; /**< is the process already running? */
+    QList<QProcess::ProcessError> errors_; /**< list of errors */
+    QList<QProcess::ProcessState> states_; /**< list of states*/
+    ProcRunGui::Kb kb_; /**< function to be called when the process ends */
+    void * user_data_; /**< opaque user data */
+    QLabel * widget_; /**< associated widget */
+    bool close_on_exit_; /**< should this process close its tab on exit? */
+    qint64 peak_rss_; /**< largest resident set size seen (kB) or -1 */
+    qint64 output_size_; /**< bytes read from output and error channels */
+    qint64 pid_; /**< process id (also the process group) while it runs */
+    bool b_signaled_; /**< termination of the tree was requested */
+    bool b_killed_; /**< the tree was sent SIGKILL */
+    QTimer kill_timer_; /**< escalates from terminate to kill */
+    QList<ProcTree::Member> tree_; /**< descendants seen when signaled */
+    QList<qint64> survivors_; /**< descendants alive after the process ended */
+    ProcPty * pty_; /**< the pseudo-terminal in pty mode or NULL */
+    QSocketNotifier * pty_notifier_; /**< tells when the terminal has data */
+    OutputFilter * filter_; /**< what is kept from the output or NULL */
+    QProgressBar * progress_bar_; /**< progress in the tab (owned by the tab bar) */
+    LaunchLimits * limits_; /**< applied in the child or NULL */
+    int exit_code_; /**< exit code (or signal) once ended */
+    bool b_crashed_; /**< ended abnormally or could not start */
+    bool b_via_launcher_; /**< started by the launcher helper */
+    bool b_launched_; /**< started by the launcher and still running */
+    int out_fd_; /**< standard output of a launched program or -1 */
+    int err_fd_; /**< standard error of a launched program or -1 */
+    QSocketNotifier * out_notifier_; /**< tells when out_fd_ has data */
+    QSocketNotifier * err_notifier_; /**< tells when err_fd_ has data */
+    RunPolicy policy_; /**< timeouts and retries for this run */
+    int attempt_; /**< 1 for the first run of a command, 2 for its retry... */
+    QString s_settings_key_; /**< the settings and history of the command */
+    bool b_timed_out_; /**< terminated by the policy */
+    quint64 deadline_id_; /**< wall-clock deadline in the timer wheel or 0 */
+    quint64 idle_id_; /**< silence check in the timer wheel or 0 */
+    qint64 last_output_ms_; /**< when output last came (timer wheel time) */
+    qint64 rss_; /**< resident set size at last sample (kB) or -1 */
+    qint64 cpu_ms_; /**< processor time used at last sample or -1 */
+    int pipe_stage_; /**< index in a pipeline or -1 */
+    ProcCounters counters_; /**< reads, dropped bytes, backlog */
+    QString s_cache_key_; /**< the result is stored under this key (empty for no) */
+    bool b_from_cache_; /**< the output was replayed, the program did not run */
+    bool b_end_queued_; /**< the end will be reported from the event loop */
+    int session_id_; /**< id in the session or -1 */
+    OutputLog * log_; /**< where the output is spilled or NULL */
+};
+
+#endif // GUARD_PRGPROCESS_H_INCLUDE
@@ -0,0 +1,323 @@
+/**
+ * @file procdashboardmodel.cc
+ * @brief Definitions for ProcDashboardModel class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procdashboardmodel.h"
+#include "prgprocess.h"
+
+#include "procrungui-private.h"
+
+#include <QDateTime>
+
+/**
+ * @class ProcDashboardModel
+ *
+ * Each row keeps a snapshot of what it shows, so data () never looks
+ * at the processes and a view with a thousand rows costs only what
+ * it paints. refresh () is called once a second (right after the
+ * resources were sampled); it compares new figures with the snapshot
+ * and reports the rows that changed as a few contiguous ranges,
+ * with a single dataChanged () for each.
+ *
+ * Processes are always appended by ProcRunGui, so new ones become
+ * new rows at the end; removed ones are dropped as ProcRunGui
+ * announces them through processRemoved ().
+ */
+
+//! States shown in the State column.
+enum DashState {
+    DashNotStarted = 0,
+    DashRunning,
+    DashSucceeded,
+    DashFailed,
+    DashTimedOut
+};
+
+/* ------------------------------------------------------------------------- */
+ProcDashboardModel::ProcDashboardModel (ProcRunGui * gui, QObject *parent) :
+    QAbstractTableModel (parent),
+    gui_(gui),
+    rows_(),
+    clock_()
+{
+    clock_.start ();
+    connect (gui_, &ProcRunGui::processRemoved,
+             this, &ProcDashboardModel::processRemoved);
+    refresh ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcDashboardModel::~ProcDashboardModel()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+PrgProcess * ProcDashboardModel::process (int row) const
+{
+    if ((row < 0) || (row >= rows_.count ()))
+        return NULL;
+    return rows_.at (row).proc_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcDashboardModel::row (PrgProcess * proc) const
+{
+    for (int i = 0; i < rows_.count (); ++i) {
+        if (rows_.at (i).proc_ == proc)
+            return i;
+    }
+    return -1;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcDashboardModel::rowCount (const QModelIndex &parent) const
+{
+    if (parent.isValid ())
+        return 0;
+    return rows_.count ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcDashboardModel::columnCount (const QModelIndex &parent) const
+{
+    if (parent.isValid ())
+        return 0;
+    return COLUMN_COUNT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QVariant ProcDashboardModel::data (const QModelIndex &index, int role) const
+{
+    if (!index.isValid () || (index.row () >= rows_.count ()))
+        return QVariant ();
+
+    const Row & row = rows_.at (index.row ());
+    if (role == Qt::TextAlignmentRole) {
+        switch (index.column ()) {
+        case ColRuntime:
+        case ColCpu:
+        case ColRss:
+        case ColRate:
+            return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+        default:
+            return QVariant ();
+        }
+    }
+    if (role != Qt::DisplayRole)
+        return QVariant ();
+
+    switch (index.column ()) {
+    case ColProgram:
+        return row.s_program_;
+    case ColState:
+        return stateText (row.state_);
+    case ColRuntime:
+        return QString (QLatin1String ("%1:%2:%3"))
+                .arg (row.runtime_s_ / 3600)
+                .arg ((row.runtime_s_ / 60) % 60, 2, 10, QChar ('0'))
+                .arg (row.runtime_s_ % 60, 2, 10, QChar ('0'));
+    case ColCpu:
+        if (row.cpu_pct_ < 0)
+            return QVariant ();
+        return tr ("%1%").arg (row.cpu_pct_);
+    case ColRss:
+        if (row.rss_kb_ < 0)
+            return QVariant ();
+        return tr ("%1 MB").arg (row.rss_kb_ / 1024.0, 0, 'f', 1);
+    case ColRate:
+        if (row.rate_ < 0)
+            return QVariant ();
+        if (row.rate_ < 1024)
+            return tr ("%1 B/s").arg (row.rate_);
+        return tr ("%1 kB/s").arg (row.rate_ / 1024.0, 0, 'f', 1);
+    case ColLastLine:
+        return row.s_last_line_;
+    default:
+        return QVariant ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QVariant ProcDashboardModel::headerData (
+        int section, Qt::Orientation orientation, int role) const
+{
+    if ((orientation != Qt::Horizontal) || (role != Qt::DisplayRole))
+        return QAbstractTableModel::headerData (section, orientation, role);
+
+    switch (section) {
+    case ColProgram: return tr ("Program");
+    case ColState: return tr ("State");
+    case ColRuntime: return tr ("Runtime");
+    case ColCpu: return tr ("CPU");
+    case ColRss: return tr ("Memory");
+    case ColRate: return tr ("Output");
+    case ColLastLine: return tr ("Last line");
+    default: return QVariant ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDashboardModel::refresh ()
+{
+    qint64 now_ms = clock_.elapsed ();
+
+    // new processes are always at the end
+    int known = rows_.count ();
+    int total = gui_->programCount ();
+    if (total > known) {
+        beginInsertRows (QModelIndex (), known, total - 1);
+        for (int i = known; i < total; ++i) {
+            PrgProcess * proc = gui_->program (i);
+            Row row;
+            row.proc_ = proc;
+            row.s_program_ = ProcRunGui::commandTitle (proc->data_);
+            row.state_ = -1;
+            row.runtime_s_ = 0;
+            row.cpu_pct_ = -1;
+            row.rss_kb_ = -1;
+            row.rate_ = -1;
+            row.sampled_ms_ = now_ms;
+            row.cpu_ms_ = proc->cpu_ms_;
+            row.output_size_ = proc->output_size_;
+            row.line_count_ = -1;
+            update (row, now_ms);
+            rows_.append (row);
+        }
+        endInsertRows ();
+    }
+
+    int first_changed = -1;
+    for (int i = 0; i < known; ++i) {
+        if (update (rows_[i], now_ms)) {
+            if (first_changed == -1)
+                first_changed = i;
+        } else if (first_changed != -1) {
+            emit dataChanged (index (first_changed, 0),
+                              index (i - 1, COLUMN_COUNT - 1));
+            first_changed = -1;
+        }
+    }
+    if (first_changed != -1) {
+        emit dataChanged (index (first_changed, 0),
+                          index (known - 1, COLUMN_COUNT - 1));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDashboardModel::processRemoved (PrgProcess * proc)
+{
+    for (int i = 0; i < rows_.count (); ++i) {
+        if (rows_.at (i).proc_ == proc) {
+            beginRemoveRows (QModelIndex (), i, i);
+            rows_.remove (i);
+            endRemoveRows ();
+            break;
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Rates are computed over the time since the previous refresh; rows
+ * of processes that ended keep their final figures and stop changing.
+ */
+bool ProcDashboardModel::update (Row & row, qint64 now_ms)
+{
+    PrgProcess * proc = row.proc_;
+    bool b_running = proc->isRunning ();
+
+    int state;
+    if (b_running) {
+        state = DashRunning;
+    } else if (!proc->b_started_ && !proc->b_crashed_) {
+        state = DashNotStarted;
+    } else if (proc->b_timed_out_) {
+        state = DashTimedOut;
+    } else if (proc->isSuccess ()) {
+        state = DashSucceeded;
+    } else {
+        state = DashFailed;
+    }
+
+    bool b_changed = (state != row.state_);
+    if (!b_running && !b_changed)
+        return false;
+    row.state_ = state;
+
+    qint64 runtime_s = 0;
+    if (proc->start_time_.isValid ()) {
+        runtime_s = b_running ?
+                    proc->start_time_.secsTo (QDateTime::currentDateTime ()) :
+                    proc->runDuration ();
+    }
+    if (runtime_s != row.runtime_s_) {
+        row.runtime_s_ = runtime_s;
+        b_changed = true;
+    }
+
+    qint64 elapsed = now_ms - row.sampled_ms_;
+    if (elapsed > 0) {
+        int cpu_pct = -1;
+        qint64 rate = 0;
+        if (b_running) {
+            if ((proc->cpu_ms_ >= 0) && (row.cpu_ms_ >= 0)) {
+                cpu_pct = static_cast<int>(
+                            (proc->cpu_ms_ - row.cpu_ms_) * 100 / elapsed);
+            }
+            rate = (proc->output_size_ - row.output_size_) * 1000 / elapsed;
+        }
+        if ((cpu_pct != row.cpu_pct_) || (rate != row.rate_)) {
+            row.cpu_pct_ = cpu_pct;
+            row.rate_ = rate;
+            b_changed = true;
+        }
+        row.sampled_ms_ = now_ms;
+        row.cpu_ms_ = proc->cpu_ms_;
+        row.output_size_ = proc->output_size_;
+    }
+
+    qint64 rss_kb = b_running ? proc->rss_ : -1;
+    if (rss_kb != row.rss_kb_) {
+        row.rss_kb_ = rss_kb;
+        b_changed = true;
+    }
+
+    int line_count = proc->output_.lineCount ();
+    if (line_count != row.line_count_) {
+        row.line_count_ = line_count;
+        row.s_last_line_ = line_count > 0 ?
+                    proc->output_.lineText (line_count - 1) : QString ();
+        b_changed = true;
+    }
+    return b_changed;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcDashboardModel::stateText (int state)
+{
+    switch (state) {
+    case DashNotStarted: return tr ("Not started");
+    case DashRunning: return tr ("Running");
+    case DashSucceeded: return tr ("Succeeded");
+    case DashFailed: return tr ("Failed");
+    case DashTimedOut: return tr ("Timed out");
+    default: return QString ();
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,125 @@
+/**
+ * @file procdashboardmodel.h
+ * @brief Declarations for ProcDashboardModel class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCDASHBOARDMODEL_H_INCLUDE
+#define GUARD_PROCDASHBOARDMODEL_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QString>
+#include <QElapsedTimer>
+
+class ProcRunGui;
+class PrgProcess;
+
+//! A table with a row for each process of a ProcRunGui.
+class PROCRUNGUI_EXPORT ProcDashboardModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+
+    //! The columns.
+    enum Column {
+        ColProgram = 0, /**< program and arguments */
+        ColState, /**< running, succeeded, failed... */
+        ColRuntime, /**< time since start (or duration) */
+        ColCpu, /**< processor use over the last interval */
+        ColRss, /**< resident memory */
+        ColRate, /**< output bytes per second over the last interval */
+        ColLastLine, /**< last line of output */
+        COLUMN_COUNT
+    };
+
+    //! Constructor.
+    ProcDashboardModel (
+            ProcRunGui * gui,
+            QObject *parent = NULL);
+
+    //! Destructor.
+    virtual ~ProcDashboardModel();
+
+    //! The process shown in a row (NULL if out of range).
+    PrgProcess *
+    process (
+            int row) const;
+
+    //! The row of a process (-1 if not shown).
+    int
+    row (
+            PrgProcess * proc) const;
+
+    virtual int
+    rowCount (
+            const QModelIndex &parent = QModelIndex()) const;
+
+    virtual int
+    columnCount (
+            const QModelIndex &parent = QModelIndex()) const;
+
+    virtual QVariant
+    data (
+            const QModelIndex &index,
+            int role = Qt::DisplayRole) const;
+
+    virtual QVariant
+    headerData (
+            int section,
+            Qt::Orientation orientation,
+            int role = Qt::DisplayRole) const;
+
+public slots:
+
+    //! Take a new snapshot of all processes and report what changed.
+    void
+    refresh ();
+
+private slots:
+
+    //! A process is about to be deleted.
+    void
+    processRemoved (
+            PrgProcess * proc);
+
+private:
+
+    //! What a row shows.
+    struct Row {
+        PrgProcess * proc_; /**< the process */
+        QString s_program_; /**< program and arguments */
+        int state_; /**< see stateText () */
+        qint64 runtime_s_; /**< seconds since start or duration */
+        int cpu_pct_; /**< processor use in percents or -1 */
+        qint64 rss_kb_; /**< resident memory or -1 */
+        qint64 rate_; /**< output bytes per second or -1 */
+        QString s_last_line_; /**< last line of output */
+        qint64 sampled_ms_; /**< when the counters below were taken */
+        qint64 cpu_ms_; /**< processor time at last refresh */
+        qint64 output_size_; /**< output bytes at last refresh */
+        int line_count_; /**< lines at last refresh */
+    };
+
+    //! Fill a row from its process; true if anything shown changed.
+    static bool
+    update (
+            Row & row,
+            qint64 now_ms);
+
+    //! Text for a state.
+    static QString
+    stateText (
+            int state);
+
+    ProcRunGui * gui_; /**< where the processes are */
+    QVector<Row> rows_; /**< one for each process, in tab order */
+    QElapsedTimer clock_; /**< time base for the rates */
+};
+
+#endif // GUARD_PROCDASHBOARDMODEL_H_INCLUDE
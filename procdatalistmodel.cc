@@ -0,0 +1,190 @@
+/**
+ * @file procdatalistmodel.cc
+ * @brief Definitions for ProcDataListModel class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procdatalistmodel.h"
+
+#include "procrungui-private.h"
+
+#include <QStyle>
+#include <QApplication>
+
+/**
+ * @class ProcDataListModel
+ *
+ * The model backs the arguments and inputs lists in ProcDataWdg.
+ * Replacing the content is a single assignment of an implicitly shared
+ * QStringList followed by a model reset, so the view only creates
+ * what it needs to paint, no matter how many entries there are.
+ *
+ * The last row is a placeholder; editing it appends a new entry
+ * and the placeholder remains in place.
+ */
+
+/* ------------------------------------------------------------------------- */
+ProcDataListModel::ProcDataListModel (
+        const QString & s_placeholder, QObject *parent) :
+    QAbstractListModel (parent),
+    values_(),
+    s_placeholder_(s_placeholder),
+    placeholder_icon_(qApp->style()->standardIcon (QStyle::SP_ArrowRight))
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcDataListModel::~ProcDataListModel()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataListModel::setStringList (const QStringList & values)
+{
+    beginResetModel ();
+    values_ = values;
+    endResetModel ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataListModel::clear ()
+{
+    setStringList (QStringList ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcDataListModel::rowCount (const QModelIndex &parent) const
+{
+    if (parent.isValid ())
+        return 0;
+    return values_.count () + 1;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QVariant ProcDataListModel::data (const QModelIndex &index, int role) const
+{
+    if (!index.isValid ())
+        return QVariant ();
+
+    int row = index.row ();
+    if (row == values_.count ()) {
+        switch (role) {
+        case Qt::DisplayRole:
+        case Qt::EditRole:
+            return s_placeholder_;
+        case Qt::DecorationRole:
+            return placeholder_icon_;
+        default:
+            return QVariant ();
+        }
+    } else if ((row < 0) || (row > values_.count ())) {
+        return QVariant ();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return values_.at (row);
+    default:
+        return QVariant ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcDataListModel::setData (
+        const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid () || (role != Qt::EditRole && role != Qt::DisplayRole))
+        return false;
+
+    int row = index.row ();
+    QString s_value = value.toString ();
+    if (row == values_.count ()) {
+        // editing the placeholder creates a new entry
+        if (s_value.isEmpty () || (s_value == s_placeholder_))
+            return false;
+        beginInsertRows (QModelIndex (), row, row);
+        values_.append (s_value);
+        endInsertRows ();
+        return true;
+    } else if ((row < 0) || (row > values_.count ())) {
+        return false;
+    }
+
+    values_[row] = s_value;
+    emit dataChanged (index, index);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+Qt::ItemFlags ProcDataListModel::flags (const QModelIndex &index) const
+{
+    if (!index.isValid ())
+        return Qt::ItemIsDropEnabled;
+
+    Qt::ItemFlags result =
+            Qt::ItemIsEditable |
+            Qt::ItemIsEnabled |
+            Qt::ItemIsSelectable |
+            Qt::ItemNeverHasChildren;
+    if (!isPlaceholder (index)) {
+        result |= Qt::ItemIsDragEnabled;
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcDataListModel::insertRows (
+        int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid () || (count < 1) || (row < 0))
+        return false;
+
+    // nothing may be inserted after the placeholder
+    if (row > values_.count ())
+        row = values_.count ();
+
+    beginInsertRows (QModelIndex (), row, row + count - 1);
+    for (int i = 0; i < count; ++i) {
+        values_.insert (row, QString ());
+    }
+    endInsertRows ();
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcDataListModel::removeRows (
+        int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid () || (count < 1) || (row < 0))
+        return false;
+
+    // the placeholder can't be removed
+    if (row + count > values_.count ())
+        return false;
+
+    beginRemoveRows (QModelIndex (), row, row + count - 1);
+    values_.erase (values_.begin () + row, values_.begin () + row + count);
+    endRemoveRows ();
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+Qt::DropActions ProcDataListModel::supportedDropActions () const
+{
+    return Qt::MoveAction;
+}
+/* ========================================================================= */
@@ -0,0 +1,95 @@
+/**
+ * @file procdatalistmodel.h
+ * @brief Declarations for ProcDataListModel class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCDATALISTMODEL_H_INCLUDE
+#define GUARD_PROCDATALISTMODEL_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QIcon>
+
+//! A list of strings (arguments, inputs) followed by an "Add new" entry.
+class PROCRUNGUI_EXPORT ProcDataListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+
+    //! Default constructor.
+    ProcDataListModel (
+            const QString & s_placeholder,
+            QObject *parent = NULL);
+
+    //! Destructor.
+    virtual ~ProcDataListModel();
+
+    //! Replace the content of the model (the list is shared, not copied).
+    void
+    setStringList (
+            const QStringList & values);
+
+    //! The content of the model (without the placeholder).
+    const QStringList &
+    stringList () const {
+        return values_;
+    }
+
+    //! Remove all entries except the placeholder.
+    void
+    clear ();
+
+    //! Tell if the index is the trailing "Add new" entry.
+    bool
+    isPlaceholder (
+            const QModelIndex & index) const {
+        return index.isValid () && (index.row () == values_.count ());
+    }
+
+    virtual int
+    rowCount (
+            const QModelIndex &parent = QModelIndex()) const;
+
+    virtual QVariant
+    data (
+            const QModelIndex &index,
+            int role = Qt::DisplayRole) const;
+
+    virtual bool
+    setData (
+            const QModelIndex &index,
+            const QVariant &value,
+            int role = Qt::EditRole);
+
+    virtual Qt::ItemFlags
+    flags (
+            const QModelIndex &index) const;
+
+    virtual bool
+    insertRows (
+            int row,
+            int count,
+            const QModelIndex &parent = QModelIndex());
+
+    virtual bool
+    removeRows (
+            int row,
+            int count,
+            const QModelIndex &parent = QModelIndex());
+
+    virtual Qt::DropActions
+    supportedDropActions () const;
+
+private:
+    QStringList values_; /**< the actual entries */
+    QString s_placeholder_; /**< text for the last entry */
+    QIcon placeholder_icon_; /**< icon for the last entry */
+};
+
+#endif // GUARD_PROCDATALISTMODEL_H_INCLUDE
@@ -9,6 +9,7 @@
 
 #include "procdatawdg.h"
 #include "ui_procdatawdg.h"
+#include "procdatalistmodel.h"
 
 #include "procrungui-private.h"
 
@@ -35,6 +36,15 @@
 /**
  * @class ProcDataWdg
  *
+ * Arguments and inputs are presented by list views backed by
+ * ProcDataListModel instances, so loading an entry with thousands of
+ * input lines only swaps the lists held by the models.
+ *
+ * The output filter, the launch profile, the run policy, the template
+ * and the cache settings are not part of ProcRunData; the owner of the
+ * widget stores them separately (see ProcRunGui::setOutputFilter (),
+ * ProcRunGui::setLaunchProfile (), ProcRunGui::setRunPolicy (),
+ * ProcRunGui::setCommandTemplate () and ProcRunGui::setCacheConfig ()).
  */
 
 /* ------------------------------------------------------------------------- */
@@ -42,7 +52,8 @@ ProcDataWdg::ProcDataWdg(QWidget * parent) :
     QWidget(parent),
     ui(new Ui::ProcDataWdg ()),
     item_in_form_(),
-    b_list_lock_(false)
+    args_model_(NULL),
+    input_model_(NULL)
 {
     PROCRUNGUI_TRACE_ENTRY;
     commonCtor ();
@@ -55,7 +66,8 @@ ProcDataWdg::ProcDataWdg (const ProcRunData & data, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::ProcDataWdg ()),
     item_in_form_(data),
-    b_list_lock_(false)
+    args_model_(NULL),
+    input_model_(NULL)
 {
     PROCRUNGUI_TRACE_ENTRY;
     commonCtor ();
@@ -79,17 +91,14 @@ ProcDataWdg::~ProcDataWdg()
 void ProcDataWdg::clearProgForm ()
 {
     ui->programLineEdit->clear ();
-    while (ui->argumentsListWidget->count() > 1) {
-        if (ui->argumentsListWidget->item (0)->icon().isNull()) {
-            delete ui->argumentsListWidget->takeItem (0);
-        }
-    }
-    while (ui->inputListWidget->count() > 1) {
-        if (ui->inputListWidget->item (0)->icon().isNull()) {
-            delete ui->inputListWidget->takeItem (0);
-        }
-    }
+    args_model_->clear ();
+    input_model_->clear ();
     ui->wrkDirLineEdit->clear ();
+    setOutputFilter (OutputFilterConfig ());
+    setLaunchProfile (LaunchProfile ());
+    setRunPolicy (RunPolicy ());
+    setCommandTemplate (CommandTemplate ());
+    setCacheConfig (CacheConfig ());
 }
 /* ========================================================================= */
 
@@ -104,29 +113,8 @@ void ProcDataWdg::reloadFromCache ()
 void ProcDataWdg::loadData (const ProcRunData &data)
 {
     ui->programLineEdit->setText (data.s_program_);
-
-    foreach(const QString & s_iter, data.sl_arguments_) {
-        QListWidgetItem * li = new QListWidgetItem (s_iter);
-        li->setFlags (li->flags() |
-                      Qt::ItemIsEditable |
-                      Qt::ItemIsEnabled |
-                      Qt::ItemIsSelectable);
-        ui->argumentsListWidget->addItem (li);
-    }
-    // ui->argumentsListWidget->addItems (data.sl_arguments_);
-    ui->argumentsListWidget->addItem (ui->argumentsListWidget->takeItem(0));
-
-    //ui->inputListWidget->addItems (data.sl_input_);
-    foreach(const QString & s_iter, data.sl_input_) {
-        QListWidgetItem * li = new QListWidgetItem (s_iter);
-        li->setFlags (li->flags() |
-                      Qt::ItemIsEditable |
-                      Qt::ItemIsEnabled |
-                      Qt::ItemIsSelectable);
-        ui->inputListWidget->addItem (li);
-    }
-    ui->inputListWidget->addItem (ui->inputListWidget->takeItem(0));
-
+    args_model_->setStringList (data.sl_arguments_);
+    input_model_->setStringList (data.sl_input_);
     ui->wrkDirLineEdit->setText (data.s_wrk_dir_);
 }
 /* ========================================================================= */
@@ -142,25 +130,8 @@ void ProcDataWdg::saveToCache ()
 void ProcDataWdg::getData (ProcRunData &data)
 {
     data.s_program_ = ui->programLineEdit->text ();
-
-    data.sl_arguments_.clear ();
-    int i_max = ui->argumentsListWidget->count ();
-    for (int i = 0; i < i_max; ++i) {
-        QListWidgetItem * item = ui->argumentsListWidget->item (i);
-        if (item->icon().isNull()) {
-            data.sl_arguments_.append (item->text ());
-        }
-    }
-
-    data.sl_input_.clear ();
-    i_max = ui->inputListWidget->count ();
-    for (int i = 0; i < i_max; ++i) {
-        QListWidgetItem * item = ui->inputListWidget->item (i);
-        if (item->icon().isNull()) {
-            data.sl_input_.append (item->text ());
-        }
-    }
-
+    data.sl_arguments_ = args_model_->stringList ();
+    data.sl_input_ = input_model_->stringList ();
     data.s_wrk_dir_= ui->wrkDirLineEdit->text ();
 }
 /* ========================================================================= */
@@ -175,15 +146,7 @@ QString ProcDataWdg::program () const
 /* ------------------------------------------------------------------------- */
 QStringList ProcDataWdg::arguments () const
 {
-    QStringList result;
-    int i_max = ui->argumentsListWidget->count ();
-    for (int i = 0; i < i_max; ++i) {
-        QListWidgetItem * item = ui->argumentsListWidget->item (i);
-        if (item->icon().isNull()) {
-            result.append (item->text ());
-        }
-    }
-    return result;
+    return args_model_->stringList ();
 }
 /* ========================================================================= */
 
@@ -197,55 +160,124 @@ QString ProcDataWdg::workingDirectory () const
 /* ------------------------------------------------------------------------- */
 QStringList ProcDataWdg::inputs () const
 {
-    QStringList result;
-    int i_max = ui->inputListWidget->count ();
-    for (int i = 0; i < i_max; ++i) {
-        QListWidgetItem * item = ui->inputListWidget->item (i);
-        if (item->icon().isNull()) {
-            result.append (item->text ());
+    return input_model_->stringList ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+OutputFilterConfig ProcDataWdg::outputFilter () const
+{
+    OutputFilterConfig result;
+    result.s_include_ = ui->includeLineEdit->text ();
+    result.s_exclude_ = ui->excludeLineEdit->text ();
+    result.b_collapse_ = ui->collapseCheckBox->isChecked ();
+    result.s_progress_ = ui->progressLineEdit->text ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataWdg::setOutputFilter (const OutputFilterConfig & config)
+{
+    ui->includeLineEdit->setText (config.s_include_);
+    ui->excludeLineEdit->setText (config.s_exclude_);
+    ui->collapseCheckBox->setChecked (config.b_collapse_);
+    ui->progressLineEdit->setText (config.s_progress_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+LaunchProfile ProcDataWdg::launchProfile () const
+{
+    LaunchProfile result;
+    foreach(const QString & s_line,
+            ui->envTextEdit->toPlainText ().split (QChar ('\n'))) {
+        if (!s_line.trimmed ().isEmpty ()) {
+            result.sl_env_.append (s_line.trimmed ());
         }
     }
+    result.nice_ = ui->niceSpinBox->value ();
+    result.io_class_ = ui->ioClassComboBox->currentIndex ();
+    result.io_level_ = ui->ioLevelSpinBox->value ();
+    result.s_cpus_ = ui->cpusLineEdit->text ().trimmed ();
+    result.memory_mb_ = ui->memorySpinBox->value ();
     return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcDataWdg::on_argumentsListWidget_itemChanged (QListWidgetItem *item)
+void ProcDataWdg::setLaunchProfile (const LaunchProfile & profile)
 {
-    if (b_list_lock_)
-        return;
-    b_list_lock_ = true;
-    if (!item->icon().isNull()) {
-        QListWidgetItem * li = new QListWidgetItem (item->text ());
-        li->setFlags (li->flags() |
-                      Qt::ItemIsEditable |
-                      Qt::ItemIsEnabled |
-                      Qt::ItemIsSelectable);
-        int inspos = ui->argumentsListWidget->row (item);
-        ui->argumentsListWidget->insertItem (inspos, li);
-        item->setText (item->data (Qt::UserRole).toString ());
-    }
-    b_list_lock_ = false;
+    ui->envTextEdit->setPlainText (profile.sl_env_.join (QChar ('\n')));
+    ui->niceSpinBox->setValue (profile.nice_);
+    ui->ioClassComboBox->setCurrentIndex (
+                qBound (0, profile.io_class_,
+                        static_cast<int>(LaunchProfile::IoIdle)));
+    ui->ioLevelSpinBox->setValue (profile.io_level_);
+    ui->cpusLineEdit->setText (profile.s_cpus_);
+    ui->memorySpinBox->setValue (static_cast<int>(profile.memory_mb_));
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcDataWdg::on_inputListWidget_itemChanged (QListWidgetItem *item)
+RunPolicy ProcDataWdg::runPolicy () const
 {
-    if (b_list_lock_)
-        return;
-    b_list_lock_ = true;
-    if (!item->icon().isNull()) {
-        QListWidgetItem * li = new QListWidgetItem (item->text ());
-        li->setFlags (li->flags() |
-                      Qt::ItemIsEditable |
-                      Qt::ItemIsEnabled |
-                      Qt::ItemIsSelectable);
-        ui->inputListWidget->insertItem (
-                    ui->inputListWidget->count() - 2, li);
-        item->setText (item->data (Qt::UserRole).toString ());
-    }
-    b_list_lock_ = false;
+    RunPolicy result;
+    result.timeout_s_ = ui->timeoutSpinBox->value ();
+    result.idle_s_ = ui->idleSpinBox->value ();
+    result.retries_ = ui->retriesSpinBox->value ();
+    result.s_retry_codes_ = ui->retryCodesLineEdit->text ().trimmed ();
+    result.retry_delay_s_ = ui->retryDelaySpinBox->value ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataWdg::setRunPolicy (const RunPolicy & policy)
+{
+    ui->timeoutSpinBox->setValue (policy.timeout_s_);
+    ui->idleSpinBox->setValue (policy.idle_s_);
+    ui->retriesSpinBox->setValue (policy.retries_);
+    ui->retryCodesLineEdit->setText (policy.s_retry_codes_);
+    ui->retryDelaySpinBox->setValue (policy.retry_delay_s_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+CommandTemplate ProcDataWdg::commandTemplate () const
+{
+    CommandTemplate result;
+    result.s_placeholder_ = ui->placeholderLineEdit->text ().trimmed ();
+    result.s_values_ = ui->valuesLineEdit->text ().trimmed ();
+    result.max_parallel_ = ui->maxParallelSpinBox->value ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataWdg::setCommandTemplate (const CommandTemplate & tpl)
+{
+    ui->placeholderLineEdit->setText (tpl.s_placeholder_);
+    ui->valuesLineEdit->setText (tpl.s_values_);
+    ui->maxParallelSpinBox->setValue (tpl.max_parallel_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+CacheConfig ProcDataWdg::cacheConfig () const
+{
+    CacheConfig result;
+    result.b_enabled_ = ui->cacheCheckBox->isChecked ();
+    result.s_inputs_ = ui->cacheInputsLineEdit->text ().trimmed ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcDataWdg::setCacheConfig (const CacheConfig & config)
+{
+    ui->cacheCheckBox->setChecked (config.b_enabled_);
+    ui->cacheInputsLineEdit->setText (config.s_inputs_);
 }
 /* ========================================================================= */
 
@@ -301,28 +333,11 @@ void ProcDataWdg::commonCtor ()
     PROCRUNGUI_TRACE_ENTRY;
     ui->setupUi (this);
 
-    QListWidgetItem * it;
-    it = new QListWidgetItem (
-        qApp->style()->standardIcon (
-                    QStyle::SP_ArrowRight),
-                tr ("Add new argument"));
-    it->setData (Qt::UserRole, it->text());
-    it->setFlags (it->flags() |
-                  Qt::ItemIsEditable |
-                  Qt::ItemIsEnabled |
-                  Qt::ItemIsSelectable);
-    ui->argumentsListWidget->addItem (it);
-
-    it = new QListWidgetItem (
-        qApp->style()->standardIcon (
-                    QStyle::SP_ArrowRight),
-                tr ("Add new input"));
-    it->setData (Qt::UserRole, it->text());
-    it->setFlags (it->flags() |
-                  Qt::ItemIsEditable |
-                  Qt::ItemIsEnabled |
-                  Qt::ItemIsSelectable);
-    ui->inputListWidget->addItem (it);
+    args_model_ = new ProcDataListModel (tr ("Add new argument"), this);
+    ui->argumentsListView->setModel (args_model_);
+
+    input_model_ = new ProcDataListModel (tr ("Add new input"), this);
+    ui->inputListView->setModel (input_model_);
     PROCRUNGUI_TRACE_EXIT;
 }
 /* ========================================================================= */
@@ -7,11 +7,16 @@
  * [MIT License](http://opensource.org/licenses/mit-license.html)
  */
 
-#ifndef GUARD_PROCRUNGUI_H_INCLUDE
-#define GUARD_PROCRUNGUI_H_INCLUDE
+#ifndef GUARD_PROCDATAWDG_H_INCLUDE
+#define GUARD_PROCDATAWDG_H_INCLUDE
 
 #include <procrungui/procrungui-config.h>
 #include <procrun/procrundata.h>
+#include <procrungui/outputfilter.h>
+#include <procrungui/launchprofile.h>
+#include <procrungui/runpolicy.h>
+#include <procrungui/commandtemplate.h>
+#include <procrungui/resultcache.h>
 
 #include <QStringList>
 #include <QWidget>
@@ -21,7 +26,6 @@
 QT_BEGIN_NAMESPACE
 class QSettings;
 class QAbstractButton;
-class QListWidgetItem;
 QT_END_NAMESPACE
 
 namespace Ui {
@@ -32,6 +36,7 @@ class PrgProcess;
 class ProcRunModel;
 class ProcRunItem;
 class ProcRunItemBase;
+class ProcDataListModel;
 struct ProcRunData;
 
 //! A widget that shows and manages processes.
@@ -106,18 +111,55 @@ public:
     QStringList
     inputs () const;
 
+    //! Get the output filter from the gui.
+    OutputFilterConfig
+    outputFilter () const;
 
+    //! Show an output filter in the gui.
+    void
+    setOutputFilter (
+            const OutputFilterConfig & config);
 
+    //! Get the environment and limits from the gui.
+    LaunchProfile
+    launchProfile () const;
 
-private slots:
+    //! Show environment and limits in the gui.
+    void
+    setLaunchProfile (
+            const LaunchProfile & profile);
+
+    //! Get the timeouts and retries from the gui.
+    RunPolicy
+    runPolicy () const;
 
+    //! Show timeouts and retries in the gui.
     void
-    on_argumentsListWidget_itemChanged (
-            QListWidgetItem *item);
+    setRunPolicy (
+            const RunPolicy & policy);
 
+    //! Get the placeholder and its values from the gui.
+    CommandTemplate
+    commandTemplate () const;
+
+    //! Show a placeholder and its values in the gui.
     void
-    on_inputListWidget_itemChanged (
-            QListWidgetItem *item);
+    setCommandTemplate (
+            const CommandTemplate & tpl);
+
+    //! Get the result cache settings from the gui.
+    CacheConfig
+    cacheConfig () const;
+
+    //! Show result cache settings in the gui.
+    void
+    setCacheConfig (
+            const CacheConfig & config);
+
+
+
+
+private slots:
 
     void
     on_programButton_clicked();
@@ -132,7 +174,8 @@ private:
 
     Ui::ProcDataWdg *ui; /**< ui components */
     ProcRunData item_in_form_; /**< the item that is presented in the form */
-    bool b_list_lock_; /**< prevent multiple events in list widgets */
+    ProcDataListModel * args_model_; /**< model for the list of arguments */
+    ProcDataListModel * input_model_; /**< model for the list of inputs */
 };
 
-#endif // GUARD_PROCRUNGUI_H_INCLUDE
+#endif // GUARD_PROCDATAWDG_H_INCLUDE
@@ -0,0 +1,632 @@
+/**
+ * @file proclauncher.cc
+ * @brief Definitions for ProcLauncher class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "proclauncher.h"
+#include "prgprocess.h"
+
+#include "procrungui-private.h"
+
+#include <QSocketNotifier>
+#include <QFile>
+#include <QVector>
+#include <QMetaObject>
+
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <signal.h>
+#   include <unistd.h>
+#   include <sys/ioctl.h>
+#   include <sys/signalfd.h>
+#   include <sys/socket.h>
+#   include <sys/types.h>
+#   include <sys/uio.h>
+#   include <sys/wait.h>
+#endif
+
+/**
+ * @class ProcLauncher
+ *
+ * fork () copies the page tables of the caller, so starting a program
+ * costs more the more memory the GUI uses. The helper is forked once,
+ * early in main () while we are still small and have a single thread,
+ * and then forks the programs on our behalf. The cost of a start stays
+ * the same however large the GUI grows.
+ *
+ * The two talk over a sequenced-packet Unix socket. A request carries
+ * the program, arguments, working directory, optional environment and
+ * LaunchLimits::Params, and the descriptors that become the standard
+ * input, output and error of the child are passed with SCM_RIGHTS. The
+ * helper answers with the process id, or with the errno if the program
+ * could not be started (a close-on-exec pipe tells a failed exec from a
+ * successful one). The children are the helper's, so the helper also
+ * reaps them and reports their wait status.
+ *
+ * If the helper goes away, processes still running are reported as
+ * crashed and new ones are started with QProcess again.
+ *
+ * Only Linux is supported for now.
+ */
+
+//! First field of every request.
+#define LAUNCHER_MAGIC 0x50524c31
+
+//! Kinds of messages from the helper.
+enum LauncherMessageType {
+    LAUNCHER_SPAWNED = 1, /**< answer to a request */
+    LAUNCHER_EXITED = 2 /**< a child ended */
+};
+
+//! Request flags.
+enum LauncherFlags {
+    LAUNCHER_CTTY = 0x01, /**< make standard output the controlling terminal */
+    LAUNCHER_ENV = 0x02, /**< environment follows the arguments */
+    LAUNCHER_LIMITS = 0x04 /**< limits_ is in use */
+};
+
+//! Fixed part of a request; NUL-terminated strings follow.
+struct LauncherRequest {
+    quint32 magic_; /**< LAUNCHER_MAGIC */
+    quint32 id_; /**< echoed in the answer */
+    qint32 flags_; /**< see LauncherFlags */
+    qint32 arg_count_; /**< number of arguments */
+    qint32 env_count_; /**< number of environment entries */
+    LaunchLimits::Params limits_; /**< applied in the child */
+};
+
+//! A message from the helper.
+struct LauncherMessage {
+    quint32 type_; /**< see LauncherMessageType */
+    quint32 id_; /**< request being answered */
+    qint64 pid_; /**< the child (-1 if it could not be started) */
+    qint32 value_; /**< errno or wait status */
+};
+
+static int launcher_fd = -1;
+static qint64 launcher_pid = -1;
+static ProcLauncher * launcher_instance = NULL;
+
+#ifdef Q_OS_LINUX
+
+/* ------------------------------------------------------------------------- */
+static void helperSend (
+        int fd, quint32 type, quint32 id, qint64 pid, int value)
+{
+    LauncherMessage msg;
+    memset (&msg, 0, sizeof(msg));
+    msg.type_ = type;
+    msg.id_ = id;
+    msg.pid_ = pid;
+    msg.value_ = value;
+    while ((::send (fd, &msg, sizeof(msg), MSG_NOSIGNAL) == -1) &&
+           (errno == EINTR)) {}
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static void helperReap (int fd)
+{
+    for (;;) {
+        int status;
+        pid_t pid = ::waitpid (-1, &status, WNOHANG);
+        if (pid <= 0)
+            break;
+        helperSend (fd, LAUNCHER_EXITED, 0, pid, status);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static const char * helperString (const char *& p, const char * end)
+{
+    const char * nul = static_cast<const char *> (
+                memchr (p, 0, static_cast<size_t> (end - p)));
+    if (nul == NULL)
+        return NULL;
+    const char * result = p;
+    p = nul + 1;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The helper has a single thread, so allocating here is fine; the
+ * child only makes system calls before exec.
+ */
+static void helperSpawn (
+        int fd, const char * buffer, ssize_t size,
+        const int * fds, int fd_count, const sigset_t & child_mask)
+{
+    LauncherRequest req;
+    if ((size < static_cast<ssize_t> (sizeof(req))) || (fd_count != 3)) {
+        helperSend (fd, LAUNCHER_SPAWNED, 0, -1, EINVAL);
+        return;
+    }
+    memcpy (&req, buffer, sizeof(req));
+    if ((req.magic_ != LAUNCHER_MAGIC) ||
+            (req.arg_count_ < 0) || (req.env_count_ < 0)) {
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, -1, EINVAL);
+        return;
+    }
+
+    const char * p = buffer + sizeof(req);
+    const char * end = buffer + size;
+    const char * program = helperString (p, end);
+    const char * wrk_dir = helperString (p, end);
+    QVector<char*> argv;
+    argv.append (const_cast<char*> (program));
+    QVector<char*> envp;
+    bool b_ok = (program != NULL) && (wrk_dir != NULL);
+    for (int i = 0; b_ok && (i < req.arg_count_); ++i) {
+        const char * arg = helperString (p, end);
+        b_ok = arg != NULL;
+        argv.append (const_cast<char*> (arg));
+    }
+    for (int i = 0; b_ok && (i < req.env_count_); ++i) {
+        const char * entry = helperString (p, end);
+        b_ok = entry != NULL;
+        envp.append (const_cast<char*> (entry));
+    }
+    if (!b_ok) {
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, -1, EINVAL);
+        return;
+    }
+    argv.append (NULL);
+    envp.append (NULL);
+
+    int err_pipe[2];
+    if (::pipe2 (err_pipe, O_CLOEXEC) != 0) {
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, -1, errno);
+        return;
+    }
+
+    pid_t pid = ::fork ();
+    if (pid == 0) {
+        ::close (err_pipe[0]);
+        ::sigprocmask (SIG_SETMASK, &child_mask, NULL);
+        ::setsid ();
+        if ((req.flags_ & LAUNCHER_CTTY) != 0) {
+            ::ioctl (fds[1], TIOCSCTTY, 0);
+        }
+        // the copies lose close-on-exec
+        ::dup2 (fds[0], STDIN_FILENO);
+        ::dup2 (fds[1], STDOUT_FILENO);
+        ::dup2 (fds[2], STDERR_FILENO);
+        if ((req.flags_ & LAUNCHER_LIMITS) != 0) {
+            LaunchLimits::applyInChild (req.limits_);
+        }
+
+        int error = 0;
+        if ((wrk_dir[0] != 0) && (::chdir (wrk_dir) != 0)) {
+            error = errno;
+        } else {
+            if ((req.flags_ & LAUNCHER_ENV) != 0) {
+                ::execvpe (program, argv.data (), envp.data ());
+            } else {
+                ::execvp (program, argv.data ());
+            }
+            error = errno;
+        }
+        ssize_t res = ::write (err_pipe[1], &error, sizeof(error));
+        (void)res;
+        ::_exit (127);
+    }
+
+    ::close (err_pipe[1]);
+    if (pid == -1) {
+        int error = errno;
+        ::close (err_pipe[0]);
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, -1, error);
+        return;
+    }
+
+    // closed without data when exec succeeds
+    int child_error = 0;
+    ssize_t n;
+    do {
+        n = ::read (err_pipe[0], &child_error, sizeof(child_error));
+    } while ((n == -1) && (errno == EINTR));
+    ::close (err_pipe[0]);
+
+    if (n == static_cast<ssize_t> (sizeof(child_error))) {
+        ::waitpid (pid, NULL, 0);
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, -1, child_error);
+    } else {
+        helperSend (fd, LAUNCHER_SPAWNED, req.id_, pid, 0);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs in the helper until the other end of the socket is closed.
+ */
+static void helperMain (int fd)
+{
+    // nothing we inherited is meant for the programs we start
+    for (int i = 3; i < 1024; ++i) {
+        if (i != fd) {
+            ::close (i);
+        }
+    }
+
+    sigset_t mask;
+    sigset_t child_mask;
+    sigemptyset (&mask);
+    sigaddset (&mask, SIGCHLD);
+    ::sigprocmask (SIG_BLOCK, &mask, &child_mask);
+    int sfd = ::signalfd (-1, &mask, SFD_CLOEXEC);
+
+    static char buffer[ProcLauncher::MAX_REQUEST];
+    for (;;) {
+        struct pollfd pfd[2];
+        pfd[0].fd = fd;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = sfd;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        if (::poll (pfd, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if ((pfd[1].revents & POLLIN) != 0) {
+            struct signalfd_siginfo si;
+            ssize_t res = ::read (sfd, &si, sizeof(si));
+            (void)res;
+            helperReap (fd);
+        }
+
+        if ((pfd[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+            struct iovec iov;
+            iov.iov_base = buffer;
+            iov.iov_len = sizeof(buffer);
+            union {
+                char buf[CMSG_SPACE(3 * sizeof(int))];
+                struct cmsghdr align;
+            } control;
+            struct msghdr msg;
+            memset (&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.buf;
+            msg.msg_controllen = sizeof(control.buf);
+
+            ssize_t n = ::recvmsg (fd, &msg, MSG_CMSG_CLOEXEC);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            // the GUI went away
+            if (n == 0)
+                break;
+
+            int fds[3];
+            int fd_count = 0;
+            for (struct cmsghdr * cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+                 cm = CMSG_NXTHDR(&msg, cm)) {
+                if ((cm->cmsg_level != SOL_SOCKET) ||
+                        (cm->cmsg_type != SCM_RIGHTS))
+                    continue;
+                int count = static_cast<int> (
+                            (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                const int * received = reinterpret_cast<const int *> (
+                            CMSG_DATA(cm));
+                for (int i = 0; i < count; ++i) {
+                    if (fd_count < 3) {
+                        fds[fd_count++] = received[i];
+                    } else {
+                        ::close (received[i]);
+                    }
+                }
+            }
+
+            helperSpawn (fd, buffer, n, fds, fd_count, child_mask);
+            for (int i = 0; i < fd_count; ++i) {
+                ::close (fds[i]);
+            }
+        }
+    }
+    ::_exit (0);
+}
+/* ========================================================================= */
+
+#endif // Q_OS_LINUX
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Once our process has threads, a forked copy may find a lock held by a
+ * thread that does not exist in it; hence the call must come first in
+ * main (), before QApplication is created.
+ */
+bool ProcLauncher::start ()
+{
+#ifdef Q_OS_LINUX
+    if (launcher_fd != -1)
+        return true;
+
+    int sv[2];
+    if (::socketpair (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        PROCRUNGUI_DEBUGM("Failed to create launcher socket: %d\n", errno);
+        return false;
+    }
+
+    pid_t pid = ::fork ();
+    if (pid == -1) {
+        PROCRUNGUI_DEBUGM("Failed to start launcher: %d\n", errno);
+        ::close (sv[0]);
+        ::close (sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        ::close (sv[0]);
+        helperMain (sv[1]);
+    }
+
+    ::close (sv[1]);
+    launcher_fd = sv[0];
+    launcher_pid = pid;
+    return true;
+#else
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcLauncher::isRunning ()
+{
+    return launcher_fd != -1;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcLauncher * ProcLauncher::instance ()
+{
+    if (launcher_fd == -1)
+        return NULL;
+    if (launcher_instance == NULL) {
+        launcher_instance = new ProcLauncher (launcher_fd);
+    }
+    return launcher_instance;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcLauncher::ProcLauncher (int fd) :
+    QObject (),
+    fd_ (fd),
+    notifier_ (NULL),
+    running_ (),
+    exits_ (),
+    next_id_ (1),
+    reply_id_ (0),
+    reply_pid_ (-1),
+    reply_error_ (0)
+{
+    notifier_ = new QSocketNotifier (fd_, QSocketNotifier::Read, this);
+    connect (notifier_, SIGNAL(activated(int)),
+             this, SLOT(readyRead()));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcLauncher::~ProcLauncher()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The descriptors in @a req are only borrowed; the caller closes its
+ * copies of the child ends afterwards. The call waits for the helper
+ * to answer, which it does as soon as exec () succeeded or failed.
+ *
+ * @return false if the request could not be delivered (the caller
+ * should start the program some other way); otherwise @a pid is the
+ * process id or -1, with the errno in @a error.
+ */
+bool ProcLauncher::spawn (
+        PrgProcess * proc, const Request & req, qint64 & pid, int & error)
+{
+    pid = -1;
+    error = 0;
+#ifdef Q_OS_LINUX
+    if (fd_ == -1)
+        return false;
+
+    LauncherRequest hdr;
+    memset (&hdr, 0, sizeof(hdr));
+    hdr.magic_ = LAUNCHER_MAGIC;
+    hdr.id_ = next_id_++;
+    hdr.arg_count_ = req.sl_args_.count ();
+    hdr.env_count_ = req.sl_env_.count ();
+    if (req.b_ctty_) {
+        hdr.flags_ |= LAUNCHER_CTTY;
+    }
+    if (!req.sl_env_.isEmpty ()) {
+        hdr.flags_ |= LAUNCHER_ENV;
+    }
+    if (req.limits_ != NULL) {
+        hdr.flags_ |= LAUNCHER_LIMITS;
+        hdr.limits_ = *req.limits_;
+    }
+
+    QByteArray buffer (reinterpret_cast<const char *> (&hdr), sizeof(hdr));
+    buffer.append (QFile::encodeName (req.s_program_)).append ('\0');
+    buffer.append (QFile::encodeName (req.s_wrk_dir_)).append ('\0');
+    foreach(const QString & s_arg, req.sl_args_) {
+        buffer.append (s_arg.toLocal8Bit ()).append ('\0');
+    }
+    foreach(const QString & s_entry, req.sl_env_) {
+        buffer.append (s_entry.toLocal8Bit ()).append ('\0');
+    }
+    if (buffer.size () > MAX_REQUEST) {
+        PROCRUNGUI_DEBUGM("Request too large for the launcher\n");
+        return false;
+    }
+
+    struct iovec iov;
+    iov.iov_base = buffer.data ();
+    iov.iov_len = static_cast<size_t> (buffer.size ());
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset (&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset (&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr * cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    int fds[3] = { req.fd_in_, req.fd_out_, req.fd_err_ };
+    memcpy (CMSG_DATA(cm), fds, sizeof(fds));
+
+    ssize_t n;
+    do {
+        n = ::sendmsg (fd_, &msg, MSG_NOSIGNAL);
+    } while ((n == -1) && (errno == EINTR));
+    if (n != static_cast<ssize_t> (buffer.size ())) {
+        helperLost ();
+        return false;
+    }
+
+    // processes that end in the meantime are dealt with later
+    for (;;) {
+        int type = receive (true);
+        if (type == -1) {
+            helperLost ();
+            return false;
+        }
+        if ((type == LAUNCHER_SPAWNED) && (reply_id_ == hdr.id_))
+            break;
+    }
+
+    pid = reply_pid_;
+    error = reply_error_;
+    if (pid > 0) {
+        running_.insert (pid, QPointer<PrgProcess> (proc));
+    }
+    if (!exits_.isEmpty ()) {
+        QMetaObject::invokeMethod (this, "readyRead", Qt::QueuedConnection);
+    }
+    return true;
+#else
+    Q_UNUSED(proc);
+    Q_UNUSED(req);
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcLauncher::receive (bool b_wait)
+{
+#ifdef Q_OS_LINUX
+    if (fd_ == -1)
+        return -1;
+
+    LauncherMessage msg;
+    ssize_t n;
+    do {
+        n = ::recv (fd_, &msg, sizeof(msg), b_wait ? 0 : MSG_DONTWAIT);
+    } while ((n == -1) && (errno == EINTR));
+    if (n == -1) {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    }
+    if (n != static_cast<ssize_t> (sizeof(msg)))
+        return -1;
+
+    if (msg.type_ == LAUNCHER_SPAWNED) {
+        reply_id_ = msg.id_;
+        reply_pid_ = msg.pid_;
+        reply_error_ = msg.value_;
+    } else if (msg.type_ == LAUNCHER_EXITED) {
+        Exit ex;
+        ex.pid_ = msg.pid_;
+        ex.status_ = msg.value_;
+        exits_.append (ex);
+    }
+    return static_cast<int> (msg.type_);
+#else
+    Q_UNUSED(b_wait);
+    return -1;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcLauncher::readyRead ()
+{
+    for (;;) {
+        int type = receive (false);
+        if (type == 0)
+            break;
+        if (type == -1) {
+            helperLost ();
+            break;
+        }
+    }
+    dispatchExits ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcLauncher::dispatchExits ()
+{
+    while (!exits_.isEmpty ()) {
+        Exit ex = exits_.takeFirst ();
+        QPointer<PrgProcess> proc = running_.take (ex.pid_);
+        if (!proc.isNull ()) {
+            proc->launchedExited (ex.status_);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcLauncher::helperLost ()
+{
+#ifdef Q_OS_LINUX
+    if (fd_ == -1)
+        return;
+    PROCRUNGUI_DEBUGM("The launcher went away; using QProcess from now on\n");
+
+    notifier_->setEnabled (false);
+    ::close (fd_);
+    fd_ = -1;
+    launcher_fd = -1;
+    if (launcher_pid > 0) {
+        ::waitpid (static_cast<pid_t> (launcher_pid), NULL, WNOHANG);
+        launcher_pid = -1;
+    }
+
+    dispatchExits ();
+    QList<QPointer<PrgProcess> > orphans = running_.values ();
+    running_.clear ();
+    foreach(const QPointer<PrgProcess> & proc, orphans) {
+        if (!proc.isNull ()) {
+            proc->launchedExited (-1);
+        }
+    }
+#endif
+}
+/* ========================================================================= */
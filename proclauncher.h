@@ -0,0 +1,131 @@
+/**
+ * @file proclauncher.h
+ * @brief Declarations for ProcLauncher class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCLAUNCHER_H_INCLUDE
+#define GUARD_PROCLAUNCHER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrungui/launchprofile.h>
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QSocketNotifier;
+QT_END_NAMESPACE
+
+class PrgProcess;
+
+//! A small helper process that starts programs on our behalf.
+class PROCRUNGUI_EXPORT ProcLauncher : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! A program to start.
+    struct Request {
+
+        //! Default constructor.
+        Request () :
+            s_program_ (),
+            sl_args_ (),
+            s_wrk_dir_ (),
+            sl_env_ (),
+            fd_in_ (-1),
+            fd_out_ (-1),
+            fd_err_ (-1),
+            b_ctty_ (false),
+            limits_ (NULL)
+        {}
+
+        QString s_program_; /**< program (searched in PATH if no slash) */
+        QStringList sl_args_; /**< arguments */
+        QString s_wrk_dir_; /**< working directory (empty for ours) */
+        QStringList sl_env_; /**< NAME=value entries (empty for ours) */
+        int fd_in_; /**< becomes standard input */
+        int fd_out_; /**< becomes standard output */
+        int fd_err_; /**< becomes standard error */
+        bool b_ctty_; /**< fd_out_ is a terminal to be the controlling one */
+        const LaunchLimits::Params * limits_; /**< applied in the child or NULL */
+    };
+
+    //! Limits.
+    enum {
+        MAX_REQUEST = 256 * 1024 /**< largest encoded request */
+    };
+
+    //! Start the helper; call early in main (), before any thread exists.
+    static bool
+    start ();
+
+    //! Tell if the helper is available.
+    static bool
+    isRunning ();
+
+    //! The instance that talks to the helper (NULL if not running).
+    static ProcLauncher *
+    instance ();
+
+    //! Start a program for a process; false if the helper could not be asked.
+    bool
+    spawn (
+            PrgProcess * proc,
+            const Request & req,
+            qint64 & pid,
+            int & error);
+
+private slots:
+
+    //! The helper has something to say.
+    void
+    readyRead ();
+
+private:
+
+    //! Constructor.
+    ProcLauncher (
+            int fd);
+
+    //! Destructor.
+    virtual ~ProcLauncher();
+
+    //! Read one message; its type, 0 if none is waiting or -1 on error.
+    int
+    receive (
+            bool b_wait);
+
+    //! Tell the processes that ended about it.
+    void
+    dispatchExits ();
+
+    //! The helper went away; processes it started can't be followed.
+    void
+    helperLost ();
+
+    //! A process the helper reported as ended.
+    struct Exit {
+        qint64 pid_; /**< process id */
+        int status_; /**< as returned by waitpid () */
+    };
+
+    int fd_; /**< our end of the socket */
+    QSocketNotifier * notifier_; /**< tells when the helper wrote */
+    QHash<qint64, QPointer<PrgProcess> > running_; /**< started processes */
+    QList<Exit> exits_; /**< exits not yet dispatched */
+    quint32 next_id_; /**< identifies requests */
+    quint32 reply_id_; /**< request of the last spawn reply */
+    qint64 reply_pid_; /**< process id in the last spawn reply */
+    int reply_error_; /**< errno in the last spawn reply */
+};
+
+#endif // GUARD_PROCLAUNCHER_H_INCLUDE
@@ -0,0 +1,134 @@
+/**
+ * @file procmetrics.cc
+ * @brief Definitions for ProcMetrics class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procmetrics.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class ProcMetrics
+ *
+ * All counters are atomics updated with relaxed ordering: they are
+ * incremented on the hot paths (every read, every painted line) and
+ * may be looked at from any thread, but no decision depends on them.
+ *
+ * The text format is the one understood by Prometheus (and by the
+ * textfile collector of its node exporter); ProcRunGui::metricsText ()
+ * puts together the families, with a sample for each process.
+ */
+
+/* ------------------------------------------------------------------------- */
+void ProcCounters::addRead (int channel, qint64 bytes)
+{
+    ProcCounters & totals = ProcMetrics::global ().totals_;
+    if ((channel >= 0) && (channel < CHANNELS)) {
+        read_bytes_[channel].fetchAndAddRelaxed (bytes);
+        totals.read_bytes_[channel].fetchAndAddRelaxed (bytes);
+    }
+    read_calls_.fetchAndAddRelaxed (1);
+    totals.read_calls_.fetchAndAddRelaxed (1);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcCounters::addDropped (qint64 bytes)
+{
+    if (bytes <= 0)
+        return;
+    dropped_bytes_.fetchAndAddRelaxed (bytes);
+    ProcMetrics::global ().totals_.dropped_bytes_.fetchAndAddRelaxed (bytes);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The global figure is the sum of the changes of all processes, so it
+ * stays the total of what is waiting everywhere.
+ */
+void ProcCounters::setBacklog (qint64 bytes)
+{
+    qint64 prev = backlog_bytes_.fetchAndStoreRelaxed (bytes);
+    if (prev != bytes) {
+        ProcMetrics::global ().totals_.backlog_bytes_.fetchAndAddRelaxed (
+                    bytes - prev);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcMetrics::ProcMetrics () :
+    totals_ (),
+    rendered_bytes_ (0),
+    loop_lag_ms_ (0),
+    max_loop_lag_ms_ (0),
+    processes_started_ (0),
+    processes_ended_ (0),
+    processes_destroyed_ (0)
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcMetrics & ProcMetrics::global ()
+{
+    static ProcMetrics instance;
+    return instance;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcMetrics::setLoopLag (qint64 lag_ms)
+{
+    lag_ms = qMax (Q_INT64_C(0), lag_ms);
+    loop_lag_ms_.storeRelaxed (lag_ms);
+    qint64 prev = max_loop_lag_ms_.loadRelaxed ();
+    while ((lag_ms > prev) &&
+           !max_loop_lag_ms_.testAndSetRelaxed (prev, lag_ms, prev)) {
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcMetrics::appendFamily (
+        QString & s_text, const char * name, const char * type, const char * help)
+{
+    s_text.append (QString (QLatin1String ("# HELP %1 %2\n# TYPE %1 %3\n"))
+                   .arg (QLatin1String (name))
+                   .arg (QLatin1String (help))
+                   .arg (QLatin1String (type)));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcMetrics::appendSample (
+        QString & s_text, const char * name,
+        const QString & s_labels, qint64 value)
+{
+    s_text.append (QLatin1String (name));
+    if (!s_labels.isEmpty ()) {
+        s_text.append (QChar ('{'));
+        s_text.append (s_labels);
+        s_text.append (QChar ('}'));
+    }
+    s_text.append (QChar (' '));
+    s_text.append (QString::number (value));
+    s_text.append (QChar ('\n'));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcMetrics::labelValue (const QString & s_value)
+{
+    QString result = s_value;
+    result.replace (QChar ('\\'), QLatin1String ("\\\\"));
+    result.replace (QChar ('"'), QLatin1String ("\\\""));
+    result.replace (QChar ('\n'), QLatin1String ("\\n"));
+    return QChar ('"') + result + QChar ('"');
+}
+/* ========================================================================= */
@@ -0,0 +1,113 @@
+/**
+ * @file procmetrics.h
+ * @brief Declarations for ProcMetrics class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCMETRICS_H_INCLUDE
+#define GUARD_PROCMETRICS_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QAtomicInteger>
+#include <QString>
+
+//! Counters kept for each process (and, summed, for all of them).
+struct PROCRUNGUI_EXPORT ProcCounters {
+
+    //! Channels that are counted separately.
+    enum { CHANNELS = 2 };
+
+    //! Constructor.
+    ProcCounters () :
+        read_calls_ (0),
+        dropped_bytes_ (0),
+        backlog_bytes_ (0)
+    {
+        for (int i = 0; i < CHANNELS; ++i) {
+            read_bytes_[i].storeRelaxed (0);
+        }
+    }
+
+    //! A read brought @a bytes from a channel (ProcOutput::Channel).
+    void
+    addRead (
+            int channel,
+            qint64 bytes);
+
+    //! Bytes that were received but not kept (filtered, redrawn, erased).
+    void
+    addDropped (
+            qint64 bytes);
+
+    //! Bytes that were waiting when we got to read them.
+    void
+    setBacklog (
+            qint64 bytes);
+
+    QAtomicInteger<qint64> read_bytes_[CHANNELS]; /**< bytes read from each channel */
+    QAtomicInteger<qint64> read_calls_; /**< reads that returned data */
+    QAtomicInteger<qint64> dropped_bytes_; /**< bytes received but not stored */
+    QAtomicInteger<qint64> backlog_bytes_; /**< waiting at the last read (a gauge) */
+};
+
+//! Counters for the whole program.
+class PROCRUNGUI_EXPORT ProcMetrics {
+
+public:
+
+    //! The single instance.
+    static ProcMetrics &
+    global ();
+
+    //! Bytes of output that were decoded for painting.
+    void
+    addRendered (
+            qint64 bytes) {
+        rendered_bytes_.fetchAndAddRelaxed (bytes);
+    }
+
+    //! How late a periodic timer fired, in milliseconds.
+    void
+    setLoopLag (
+            qint64 lag_ms);
+
+    //! Add the header of a metric family to a Prometheus text.
+    static void
+    appendFamily (
+            QString & s_text,
+            const char * name,
+            const char * type,
+            const char * help);
+
+    //! Add a sample to a Prometheus text (@a s_labels without braces).
+    static void
+    appendSample (
+            QString & s_text,
+            const char * name,
+            const QString & s_labels,
+            qint64 value);
+
+    //! Quote a label value for a Prometheus text.
+    static QString
+    labelValue (
+            const QString & s_value);
+
+    ProcCounters totals_; /**< sums over all processes that ever ran */
+    QAtomicInteger<qint64> rendered_bytes_; /**< decoded for painting */
+    QAtomicInteger<qint64> loop_lag_ms_; /**< last measured event loop lag */
+    QAtomicInteger<qint64> max_loop_lag_ms_; /**< largest event loop lag */
+    QAtomicInteger<qint64> processes_started_; /**< processes created */
+    QAtomicInteger<qint64> processes_ended_; /**< processes that went through finishProcess () */
+    QAtomicInteger<qint64> processes_destroyed_; /**< processes deleted */
+
+private:
+
+    //! Constructor.
+    ProcMetrics ();
+};
+
+#endif // GUARD_PROCMETRICS_H_INCLUDE
@@ -0,0 +1,695 @@
+/**
+ * @file procoutput.cc
+ * @brief Definitions for ProcOutput class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procoutput.h"
+#include "outputlog.h"
+
+#include "procrungui-private.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+
+#include <string.h>
+
+/**
+ * @class ProcOutput
+ *
+ * The text lives in fixed-size chunks taken from OutputChunkPool. Each
+ * channel writes in a chunk of its own: the reader asks for
+ * writeBuffer (), reads straight into it and calls commitWrite ().
+ * The new bytes go through an AnsiParser and escape sequences are
+ * squeezed out in place - the text only moves towards the start of the
+ * chunk, so nothing is copied when there are no sequences.
+ *
+ * Complete lines are never moved again; the index records the chunk
+ * and offset of each line, its style spans, channel and time of
+ * arrival. Lines are checked once when they are complete (see TextScan)
+ * so that 7-bit ones can skip the UTF-8 decoder; the text is only
+ * decoded when it is shown. When a chunk
+ * fills up the partial line at its end is carried over to a new one;
+ * lines that do not fit in a chunk are split.
+ *
+ * An OutputFilter may be installed; it sees each complete line before
+ * it is stored and lines it rejects are discarded right away.
+ *
+ * Carriage returns, backspaces, erase-line and cursor-up sequences are
+ * interpreted (see applyPending ()) so that redrawn lines are stored
+ * once, in their last state.
+ *
+ * Only the chunks the channels write to ever change. The others may be
+ * replaced by a compressed copy (see OutputPacker); lineData () then
+ * unpacks the chunk into a small cache, so reading a packed output
+ * costs one chunk of memory per recently read chunk.
+ *
+ * The lines of a log written by OutputLog may be added with mapLog ();
+ * the log is mapped in memory and its lines point in it (a negative
+ * chunk_ holds the high part of the offset), so a large output is shown
+ * without being read. Such lines have a single plain span.
+ */
+
+/* ------------------------------------------------------------------------- */
+ProcOutput::ProcOutput () :
+    chunks_ (),
+    packed_ (),
+    packed_size_ (0),
+    cache_next_ (0),
+    lines_ (),
+    spans_ (),
+    repeats_ (),
+    filter_ (NULL),
+    counters_ (NULL),
+    crt_channel_ (StdOut),
+    byte_size_ (0),
+    next_seq_ (0),
+    map_file_ (),
+    mapped_ (NULL)
+{
+    for (int i = 0; i < CHANNEL_COUNT; ++i) {
+        last_line_[i] = -1;
+        Writer & w = writer_[i];
+        w.chunk_ = -1;
+        w.line_start_ = 0;
+        w.pos_ = 0;
+        w.style_ = AnsiStyle::plain ();
+        w.b_cr_ = false;
+        w.up_ = 0;
+    }
+    for (int i = 0; i < UNPACKED_CACHE; ++i) {
+        cache_index_[i] = -1;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcOutput::~ProcOutput()
+{
+    foreach(OutputChunk * chunk, chunks_) {
+        OutputChunkPool::release (chunk);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The buffer is at least MIN_READ bytes long and is only valid until
+ * next call that changes the output.
+ */
+char * ProcOutput::writeBuffer (Channel channel, int & capacity)
+{
+    Writer & w = writer_[channel];
+    if ((w.chunk_ == -1) || (OutputChunk::SIZE - w.pos_ < MIN_READ)) {
+        if ((w.chunk_ != -1) &&
+                (w.pos_ - w.line_start_ > OutputChunk::SIZE - MIN_READ)) {
+            // the line would not fit in next chunk either
+            commitLine (channel);
+        }
+        newChunk (channel);
+    }
+    capacity = OutputChunk::SIZE - w.pos_;
+    return chunks_.at (w.chunk_)->data_ + w.pos_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::commitWrite (Channel channel, int size)
+{
+    Writer & w = writer_[channel];
+    const char * data = chunks_.at (w.chunk_)->data_ + w.pos_;
+    if (channel == Notice) {
+        addText (channel, data, size);
+        return;
+    }
+    crt_channel_ = channel;
+    parser_[channel].feed (data, size, this);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::append (const char * data, int size, Channel channel)
+{
+    if (channel == Notice) {
+        appendNotice (QString::fromUtf8 (data, size));
+        return;
+    }
+    while (size > 0) {
+        int capacity;
+        char * buffer = writeBuffer (channel, capacity);
+        int n = qMin (capacity, size);
+        memcpy (buffer, data, static_cast<size_t>(n));
+        commitWrite (channel, n);
+        data += n;
+        size -= n;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::appendNotice (const QString & s_text)
+{
+    QByteArray text = s_text.toUtf8 ();
+    if (text.endsWith ('\n'))
+        text.chop (1);
+    // notices are short; writeBuffer () guarantees this much
+    if (text.size () > MIN_READ)
+        text.truncate (MIN_READ);
+
+    int capacity;
+    writeBuffer (Notice, capacity);
+    writer_[Notice].style_ = AnsiStyle::plain ();
+    addText (Notice, text.constData (), text.size ());
+    commitLine (Notice);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::flush ()
+{
+    for (int i = 0; i < CHANNEL_COUNT; ++i) {
+        Writer & w = writer_[i];
+        // a pending redraw that never came leaves things as they are
+        w.b_cr_ = false;
+        w.up_ = 0;
+        if ((w.chunk_ != -1) && (w.pos_ > w.line_start_)) {
+            commitLine (i);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Meant for an output that is otherwise empty; a single log may be
+ * mapped. Reading stops at the first index entry that does not fit the
+ * log (the end of an interrupted one).
+ */
+bool ProcOutput::mapLog (const QString & s_base)
+{
+    if (!map_file_.isNull ())
+        return false;
+
+    QFile index (OutputLog::indexFile (s_base));
+    if (!index.open (QIODevice::ReadOnly)) {
+        PROCRUNGUI_DEBUGM("Cannot read %s\n", TMP_A(index.fileName ()));
+        return false;
+    }
+    QByteArray records = index.readAll ();
+    index.close ();
+
+    QFile * log = new QFile (OutputLog::logFile (s_base));
+    if (!log->open (QIODevice::ReadOnly)) {
+        PROCRUNGUI_DEBUGM("Cannot read %s\n", TMP_A(log->fileName ()));
+        delete log;
+        return false;
+    }
+    qint64 log_size = log->size ();
+    uchar * data = NULL;
+    if (log_size > 0) {
+        data = log->map (0, log_size);
+        if (data == NULL) {
+            PROCRUNGUI_DEBUGM("Cannot map %s\n", TMP_A(log->fileName ()));
+            delete log;
+            return false;
+        }
+    }
+    map_file_ = QSharedPointer<QFile> (log);
+    mapped_ = reinterpret_cast<const char *>(data);
+
+    int count = records.size () / static_cast<int>(sizeof(OutputLog::Entry));
+    lines_.reserve (lines_.count () + count);
+    spans_.reserve (spans_.count () + count);
+    for (int i = 0; i < count; ++i) {
+        OutputLog::Entry entry;
+        memcpy (&entry, records.constData () + i * sizeof(entry), sizeof(entry));
+        if ((entry.offset_ < 0) || (entry.size_ < 0) ||
+                (entry.offset_ + entry.size_ > log_size) ||
+                (entry.channel_ >= CHANNEL_COUNT)) {
+            PROCRUNGUI_DEBUGM("%s ends after %d of %d lines\n",
+                              TMP_A(log->fileName ()), i, count);
+            break;
+        }
+
+        Line ln;
+        ln.chunk_ = MAPPED_CHUNK - static_cast<int>(entry.offset_ >> MAPPED_SHIFT);
+        ln.offset_ = static_cast<int>(
+                    entry.offset_ & ((Q_INT64_C(1) << MAPPED_SHIFT) - 1));
+        ln.size_ = entry.size_;
+        ln.first_span_ = spans_.count ();
+        ln.span_count_ = 0;
+        ln.time_ms_ = entry.time_ms_;
+        ln.channel_ = entry.channel_;
+        ln.encoding_ = entry.encoding_;
+        ln.seq_ = next_seq_++;
+        if (ln.size_ > 0) {
+            Span span;
+            span.start_ = 0;
+            span.size_ = ln.size_;
+            span.style_ = AnsiStyle::plain ();
+            spans_.append (span);
+            ln.span_count_ = 1;
+        }
+        lines_.append (ln);
+        byte_size_ += ln.size_;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Sequence numbers grow with the index (lines that are replaced get new
+ * numbers), so a binary search is enough. Returns lineCount () if all
+ * lines are older.
+ */
+int ProcOutput::findSeq (qint64 seq) const
+{
+    int lo = 0;
+    int hi = lines_.count ();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (lines_.at (mid).seq_ < seq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcOutput::lineText (int index) const
+{
+    const Line & ln = lines_.at (index);
+    return decode (ln, 0, ln.size_);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * 7-bit lines skip the UTF-8 decoder; invalid sequences are replaced.
+ */
+QString ProcOutput::decode (const Line & ln, int start, int size) const
+{
+    const char * text = lineData (ln) + start;
+    if (ln.encoding_ == TextScan::Ascii)
+        return QString::fromLatin1 (text, size);
+    return QString::fromUtf8 (text, size);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The spans of the line are in openSpans (); first_span_ is zero and
+ * time_ms_ is not set.
+ */
+bool ProcOutput::openLine (int channel, Line & ln) const
+{
+    const Writer & w = writer_[channel];
+    if ((w.chunk_ == -1) || (w.pos_ == w.line_start_))
+        return false;
+
+    ln.chunk_ = w.chunk_;
+    ln.offset_ = w.line_start_;
+    ln.size_ = w.pos_ - w.line_start_;
+    ln.first_span_ = 0;
+    ln.span_count_ = w.spans_.count ();
+    ln.time_ms_ = 0;
+    ln.channel_ = static_cast<quint8>(channel);
+    ln.encoding_ = static_cast<quint8>(
+                TextScan::classify (lineData (ln), ln.size_));
+    ln.seq_ = -1;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::ansiText (const char * data, int size)
+{
+    addText (crt_channel_, data, size);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::ansiStyle (quint32 style)
+{
+    writer_[crt_channel_].style_ = style;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::ansiControl (char c)
+{
+    Writer & w = writer_[crt_channel_];
+    switch (c) {
+    case '\n':
+        w.b_cr_ = false;
+        if (w.up_ > 0) {
+            // moving down over a line that is already there
+            --w.up_;
+        } else {
+            commitLine (crt_channel_);
+        }
+        break;
+    case '\r':
+        w.b_cr_ = true;
+        break;
+    case '\b':
+        backspace (crt_channel_);
+        break;
+    case '\t':
+        addText (crt_channel_, "\t", 1);
+        break;
+    default:
+        break;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Applied lazily, when the replacement text arrives, so that a cursor
+ * movement at the very end of the output changes nothing.
+ */
+void ProcOutput::ansiCursorUp (int count)
+{
+    if (count > 0) {
+        writer_[crt_channel_].up_ += count;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only erasing the whole line or, after a carriage return, the part
+ * after the cursor is understood; both empty the open line.
+ */
+void ProcOutput::ansiEraseLine (int mode)
+{
+    Writer & w = writer_[crt_channel_];
+    if ((mode == 2) || ((mode == 0) && w.b_cr_)) {
+        applyPending (crt_channel_);
+        discardLine (crt_channel_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Progress bars redraw a line many times. A carriage return followed by
+ * text replaces the open line instead of adding to it, and moving the
+ * cursor up takes back the lines it moved over - as long as they are
+ * the last lines in the store and came from this channel - so the next
+ * text replaces them. Only the last state of a redrawn line is kept and
+ * its space in the chunk is reused.
+ *
+ * The text that gets replaced is shown to the filter for progress.
+ */
+void ProcOutput::applyPending (int channel)
+{
+    Writer & w = writer_[channel];
+    if (w.b_cr_ || (w.up_ > 0)) {
+        Line ln;
+        if ((filter_ != NULL) && filter_->hasProgress () &&
+                openLine (channel, ln)) {
+            filter_->inspect (decode (ln, 0, ln.size_));
+        }
+        discardLine (channel);
+        w.b_cr_ = false;
+    }
+
+    while ((w.up_ > 0) && !lines_.isEmpty ()) {
+        const Line & last = lines_.last ();
+        if ((last.channel_ != channel) || (last.chunk_ != w.chunk_) ||
+                (last.offset_ + last.size_ != w.line_start_)) {
+            break;
+        }
+        w.line_start_ = last.offset_;
+        w.pos_ = w.line_start_;
+        byte_size_ -= last.size_;
+        if (counters_ != NULL) {
+            counters_->addDropped (last.size_);
+        }
+        spans_.resize (last.first_span_);
+        repeats_.remove (lines_.count () - 1);
+        lines_.removeLast ();
+        last_line_[channel] = -1;
+        --w.up_;
+    }
+    w.up_ = 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The character is removed rather than overwritten later; for spinners
+ * and counters the result is the same.
+ */
+void ProcOutput::backspace (int channel)
+{
+    applyPending (channel);
+    Writer & w = writer_[channel];
+    if (w.pos_ <= w.line_start_)
+        return;
+
+    // step over UTF-8 continuation bytes
+    const char * data = chunks_.at (w.chunk_)->data_;
+    int pos = w.pos_ - 1;
+    while ((pos > w.line_start_) &&
+           ((static_cast<unsigned char>(data[pos]) & 0xc0) == 0x80)) {
+        --pos;
+    }
+    int removed = w.pos_ - pos;
+    w.pos_ = pos;
+
+    while ((removed > 0) && !w.spans_.isEmpty ()) {
+        Span & last = w.spans_.last ();
+        int n = qMin (removed, last.size_);
+        last.size_ -= n;
+        removed -= n;
+        if (last.size_ == 0) {
+            w.spans_.removeLast ();
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * When called from the parser @a data points inside the chunk, at or
+ * after the write position, so the text can only move backwards over
+ * bytes that were already parsed.
+ */
+void ProcOutput::addText (int channel, const char * data, int size)
+{
+    Writer & w = writer_[channel];
+    if (w.b_cr_ || (w.up_ > 0)) {
+        applyPending (channel);
+    }
+    char * dest = chunks_.at (w.chunk_)->data_ + w.pos_;
+    if (dest != data) {
+        memmove (dest, data, static_cast<size_t>(size));
+    }
+    int start = w.pos_ - w.line_start_;
+    w.pos_ += size;
+
+    // extend last span if it has the same style
+    if (!w.spans_.isEmpty ()) {
+        Span & last = w.spans_.last ();
+        if ((last.style_ == w.style_) && (last.start_ + last.size_ == start)) {
+            last.size_ += size;
+            return;
+        }
+    }
+
+    Span sp;
+    sp.start_ = start;
+    sp.size_ = size;
+    sp.style_ = w.style_;
+    w.spans_.append (sp);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::commitLine (int channel)
+{
+    Writer & w = writer_[channel];
+    if (w.chunk_ == -1) {
+        // an empty line before anything else
+        newChunk (channel);
+    }
+
+    Line ln;
+    ln.chunk_ = w.chunk_;
+    ln.offset_ = w.line_start_;
+    ln.size_ = w.pos_ - w.line_start_;
+    ln.first_span_ = spans_.count ();
+    ln.span_count_ = w.spans_.count ();
+    ln.time_ms_ = QDateTime::currentMSecsSinceEpoch ();
+    ln.channel_ = static_cast<quint8>(channel);
+    ln.encoding_ = static_cast<quint8>(
+                TextScan::classify (lineData (ln), ln.size_));
+    ln.seq_ = next_seq_;
+
+    if ((filter_ != NULL) && (channel != Notice) && !filterLine (channel, ln)) {
+        discardLine (channel);
+        return;
+    }
+
+    ++next_seq_;
+    last_line_[channel] = lines_.count ();
+    spans_ += w.spans_;
+    lines_.append (ln);
+    byte_size_ += ln.size_;
+
+    // keep the capacity for next line
+    w.line_start_ = w.pos_;
+    w.spans_.resize (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The open line is the last thing in the chunk of the channel, so
+ * moving the write position back makes its space available again.
+ */
+void ProcOutput::discardLine (int channel)
+{
+    Writer & w = writer_[channel];
+    if (counters_ != NULL) {
+        counters_->addDropped (w.pos_ - w.line_start_);
+    }
+    w.pos_ = w.line_start_;
+    w.spans_.resize (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A line identical to the previous one from the same channel is only
+ * counted when the filter folds repeats.
+ */
+bool ProcOutput::filterLine (int channel, const Line & ln)
+{
+    if (filter_->needsText ()) {
+        if (!filter_->accept (decode (ln, 0, ln.size_)))
+            return false;
+    }
+
+    int prev = last_line_[channel];
+    if (filter_->collapsesRepeats () && (prev != -1)) {
+        const Line & pl = lines_.at (prev);
+        if ((pl.size_ == ln.size_) &&
+                (memcmp (lineData (pl), lineData (ln),
+                         static_cast<size_t>(ln.size_)) == 0)) {
+            repeats_[prev] += 1;
+            filter_->countDropped ();
+            return false;
+        }
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<int> ProcOutput::sealedChunks () const
+{
+    QList<int> result;
+    for (int i = 0; i < chunks_.count (); ++i) {
+        if (chunks_.at (i) == NULL)
+            continue;
+        bool b_writing = false;
+        for (int c = 0; c < CHANNEL_COUNT; ++c) {
+            if (writer_[c].chunk_ == i) {
+                b_writing = true;
+                break;
+            }
+        }
+        if (!b_writing) {
+            result.append (i);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Space freed by redrawn lines at the end of a chunk is not counted.
+ * All chunks are measured in a single pass over the lines.
+ */
+QVector<int> ProcOutput::usedSizes () const
+{
+    QVector<int> result (chunks_.count (), 0);
+    foreach(const Line & ln, lines_) {
+        // lines of a mapped log have no chunk
+        if (ln.chunk_ < 0)
+            continue;
+        int & used = result[ln.chunk_];
+        used = qMax (used, ln.offset_ + ln.size_);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Ignored for chunks that are still written to or already packed.
+ */
+void ProcOutput::setPacked (int index, const QByteArray & packed)
+{
+    if ((index < 0) || (index >= chunks_.count ()) ||
+            (chunks_.at (index) == NULL) || !sealedChunks ().contains (index))
+        return;
+
+    OutputChunkPool::release (chunks_.at (index));
+    chunks_[index] = NULL;
+    packed_.insert (index, packed);
+    packed_size_ += packed.size ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+const char * ProcOutput::unpacked (int index) const
+{
+    for (int i = 0; i < UNPACKED_CACHE; ++i) {
+        if (cache_index_[i] == index)
+            return cache_[i].constData ();
+    }
+
+    int slot = cache_next_;
+    cache_next_ = (cache_next_ + 1) % UNPACKED_CACHE;
+    cache_[slot] = qUncompress (packed_.value (index));
+    if (cache_[slot].size () < OutputChunk::SIZE) {
+        // what follows the used part is never read
+        cache_[slot].resize (OutputChunk::SIZE);
+    }
+    cache_index_[slot] = index;
+    return cache_[slot].constData ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcOutput::newChunk (int channel)
+{
+    Writer & w = writer_[channel];
+    OutputChunk * chunk = OutputChunkPool::acquire ();
+    int open = 0;
+    if (w.chunk_ != -1) {
+        open = w.pos_ - w.line_start_;
+        memcpy (chunk->data_,
+                chunks_.at (w.chunk_)->data_ + w.line_start_,
+                static_cast<size_t>(open));
+    }
+    w.chunk_ = chunks_.count ();
+    chunks_.append (chunk);
+    w.line_start_ = 0;
+    w.pos_ = open;
+}
+/* ========================================================================= */
@@ -0,0 +1,360 @@
+/**
+ * @file procoutput.h
+ * @brief Declarations for ProcOutput class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCOUTPUT_H_INCLUDE
+#define GUARD_PROCOUTPUT_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrungui/ansiparser.h>
+#include <procrungui/outputchunk.h>
+#include <procrungui/textscan.h>
+#include <procrungui/outputfilter.h>
+#include <procrungui/procmetrics.h>
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+QT_END_NAMESPACE
+
+//! The output of a process, stored as lines with style spans.
+class PROCRUNGUI_EXPORT ProcOutput : private AnsiSink {
+
+    friend class OutputExporter;
+
+public:
+
+    //! Where a line came from.
+    enum Channel {
+        StdOut = 0, /**< standard output (or the terminal in pty mode) */
+        StdErr = 1, /**< standard error */
+        Notice = 2, /**< a message from us, not from the process */
+        CHANNEL_COUNT
+    };
+
+    //! Reads smaller than this start a new chunk.
+    enum { MIN_READ = 4096 };
+
+    //! Packed chunks kept unpacked at the same time for reading.
+    enum { UNPACKED_CACHE = 4 };
+
+    //! Lines of a mapped log are marked by chunk_ at most MAPPED_CHUNK.
+    enum {
+        MAPPED_CHUNK = -2, /**< chunk_ of lines in the first 2^MAPPED_SHIFT bytes */
+        MAPPED_SHIFT = 30 /**< the log offset is split at this bit */
+    };
+
+    //! A run of text with the same style inside a line.
+    struct Span {
+        int start_; /**< offset in bytes from the start of the line */
+        int size_; /**< number of bytes */
+        quint32 style_; /**< see AnsiStyle */
+    };
+
+    //! A line.
+    struct Line {
+        int chunk_; /**< index of the chunk holding the text */
+        int offset_; /**< where the text starts inside the chunk */
+        int size_; /**< number of bytes (no new line character) */
+        int first_span_; /**< index of the first span */
+        int span_count_; /**< number of spans */
+        qint64 time_ms_; /**< when the line was completed */
+        quint8 channel_; /**< see Channel */
+        quint8 encoding_; /**< see TextScan::Encoding */
+        qint64 seq_; /**< sequence number (-1 for open lines) */
+    };
+
+    //! Default constructor.
+    ProcOutput ();
+
+    //! Destructor.
+    virtual ~ProcOutput();
+
+    //! Free space where the next read for a channel should go.
+    char *
+    writeBuffer (
+            Channel channel,
+            int & capacity);
+
+    //! Process @a size bytes that were placed in the buffer from writeBuffer ().
+    void
+    commitWrite (
+            Channel channel,
+            int size);
+
+    //! Add raw output from the process (copies it).
+    void
+    append (
+            const char * data,
+            int size,
+            Channel channel);
+
+    //! Add a line of our own.
+    void
+    appendNotice (
+            const QString & s_text);
+
+    //! Complete the lines that did not end in a new line character.
+    void
+    flush ();
+
+    //! Add the lines of a log written by OutputLog, without reading the text.
+    bool
+    mapLog (
+            const QString & s_base);
+
+    //! Tell if a log is mapped.
+    bool
+    isMapped () const {
+        return !map_file_.isNull ();
+    }
+
+    //! Filter applied to lines before they are stored (not owned).
+    void
+    setFilter (
+            OutputFilter * filter) {
+        filter_ = filter;
+    }
+
+    //! The filter in use (NULL for none).
+    OutputFilter *
+    filter () const {
+        return filter_;
+    }
+
+    //! Where to count the bytes that are not kept (not owned, NULL for none).
+    void
+    setCounters (
+            ProcCounters * counters) {
+        counters_ = counters;
+    }
+
+    //! How many times a line was repeated right after itself (folded).
+    int
+    repeats (
+            int index) const {
+        return repeats_.value (index, 0);
+    }
+
+    //! Number of complete lines.
+    int
+    lineCount () const {
+        return lines_.count ();
+    }
+
+    //! Information about a line.
+    const Line &
+    line (
+            int index) const {
+        return lines_.at (index);
+    }
+
+    //! Index of the first line with a sequence number of at least @a seq.
+    int
+    findSeq (
+            qint64 seq) const;
+
+    //! The spans of a complete line.
+    const Span *
+    spans (
+            const Line & ln) const {
+        return spans_.constData () + ln.first_span_;
+    }
+
+    //! The raw bytes of a line (valid until a few other packed chunks are read).
+    const char *
+    lineData (
+            const Line & ln) const {
+        if (ln.chunk_ < 0) {
+            return mapped_ + ln.offset_ + (static_cast<qint64>(
+                        MAPPED_CHUNK - ln.chunk_) << MAPPED_SHIFT);
+        }
+        const OutputChunk * chunk = chunks_.at (ln.chunk_);
+        if (chunk != NULL)
+            return chunk->data_ + ln.offset_;
+        return unpacked (ln.chunk_) + ln.offset_;
+    }
+
+    //! The text of a line.
+    QString
+    lineText (
+            int index) const;
+
+    //! Decode a part of a line.
+    QString
+    decode (
+            const Line & ln,
+            int start,
+            int size) const;
+
+    //! The line still being received on a channel (false if empty).
+    bool
+    openLine (
+            int channel,
+            Line & ln) const;
+
+    //! The spans of the line still being received on a channel.
+    const Span *
+    openSpans (
+            int channel) const {
+        return writer_[channel].spans_.constData ();
+    }
+
+    //! Total number of bytes in complete lines.
+    qint64
+    byteSize () const {
+        return byte_size_;
+    }
+
+    //! Number of chunks holding the text.
+    int
+    chunkCount () const {
+        return chunks_.count ();
+    }
+
+    //! Chunks that will not change anymore and are not packed yet.
+    QList<int>
+    sealedChunks () const;
+
+    //! A chunk that is not packed (NULL if it is).
+    OutputChunk *
+    chunk (
+            int index) const {
+        return chunks_.at (index);
+    }
+
+    //! Number of bytes used by lines in each chunk, by chunk index.
+    QVector<int>
+    usedSizes () const;
+
+    //! Replace a sealed chunk with its compressed form (see qCompress ()).
+    void
+    setPacked (
+            int index,
+            const QByteArray & packed);
+
+    //! Tell if a chunk was replaced by its compressed form.
+    bool
+    isPacked (
+            int index) const {
+        return chunks_.at (index) == NULL;
+    }
+
+    //! Bytes held by packed chunks.
+    qint64
+    packedSize () const {
+        return packed_size_;
+    }
+
+private:
+
+    Q_DISABLE_COPY(ProcOutput)
+
+    virtual void
+    ansiText (
+            const char * data,
+            int size);
+
+    virtual void
+    ansiStyle (
+            quint32 style);
+
+    virtual void
+    ansiControl (
+            char c);
+
+    virtual void
+    ansiCursorUp (
+            int count);
+
+    virtual void
+    ansiEraseLine (
+            int mode);
+
+    //! Apply a carriage return or cursor movement before new text.
+    void
+    applyPending (
+            int channel);
+
+    //! Remove the last character of the open line.
+    void
+    backspace (
+            int channel);
+
+    //! Place text at the write position of a channel.
+    void
+    addText (
+            int channel,
+            const char * data,
+            int size);
+
+    //! Move the open line of a channel to the store.
+    void
+    commitLine (
+            int channel);
+
+    //! Drop the open line of a channel, reclaiming its space.
+    void
+    discardLine (
+            int channel);
+
+    //! Ask the filter about a line; false if it should be dropped.
+    bool
+    filterLine (
+            int channel,
+            const Line & ln);
+
+    //! Give a channel a fresh chunk, carrying over its open line.
+    void
+    newChunk (
+            int channel);
+
+    //! The bytes of a packed chunk, unpacked in the cache.
+    const char *
+    unpacked (
+            int index) const;
+
+    //! Where a channel writes.
+    struct Writer {
+        int chunk_; /**< index of the chunk (-1 before first write) */
+        int line_start_; /**< start of the open line in the chunk */
+        int pos_; /**< end of the text in the chunk */
+        QVector<Span> spans_; /**< spans of the open line */
+        quint32 style_; /**< style for next text */
+        bool b_cr_; /**< carriage return seen; next text replaces the line */
+        int up_; /**< lines the cursor moved up; next text replaces them */
+    };
+
+    QVector<OutputChunk*> chunks_; /**< the memory, shared with the pool (NULL once packed) */
+    QHash<int, QByteArray> packed_; /**< compressed chunks by index */
+    qint64 packed_size_; /**< bytes in packed_ */
+    mutable QByteArray cache_[UNPACKED_CACHE]; /**< recently unpacked chunks */
+    mutable int cache_index_[UNPACKED_CACHE]; /**< chunk in each cache slot or -1 */
+    mutable int cache_next_; /**< cache slot to reuse next */
+    QVector<Line> lines_; /**< complete lines */
+    QVector<Span> spans_; /**< spans of all complete lines */
+    Writer writer_[CHANNEL_COUNT]; /**< write state for each channel */
+    int last_line_[CHANNEL_COUNT]; /**< last line stored for each channel */
+    QHash<int, int> repeats_; /**< folded repeats of some lines */
+    OutputFilter * filter_; /**< what to keep (NULL to keep all) */
+    ProcCounters * counters_; /**< counts dropped bytes (NULL for none) */
+    AnsiParser parser_[2]; /**< escape sequence parser for each channel */
+    int crt_channel_; /**< channel being parsed */
+    qint64 byte_size_; /**< bytes in complete lines */
+    qint64 next_seq_; /**< sequence number for next complete line */
+    QSharedPointer<QFile> map_file_; /**< the mapped log (shared with exports) */
+    const char * mapped_; /**< start of the mapped log */
+};
+
+#endif // GUARD_PROCOUTPUT_H_INCLUDE
@@ -0,0 +1,194 @@
+/**
+ * @file procpty.cc
+ * @brief Definitions for ProcPty class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procpty.h"
+
+#include "procrungui-private.h"
+
+#ifdef Q_OS_LINUX
+#   include <stdlib.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   include <termios.h>
+#   include <sys/ioctl.h>
+#endif
+
+/**
+ * @class ProcPty
+ *
+ * Programs check if their output is a terminal to decide on line
+ * buffering and colors. In pty mode the child gets the slave end as
+ * standard output and error (standard input stays a pipe so that the
+ * saved input can still be fed and closed) while we read the master end.
+ *
+ * Output post-processing is disabled so that new lines are not turned
+ * into carriage return / new line pairs.
+ *
+ * Only Linux is supported for now.
+ */
+
+/* ------------------------------------------------------------------------- */
+ProcPty::ProcPty () :
+    master_ (-1),
+    slave_ (-1)
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcPty::~ProcPty()
+{
+    close ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcPty::isSupported ()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcPty::open (int columns, int rows)
+{
+#ifdef Q_OS_LINUX
+    close ();
+    bool b_ret = false;
+    for (;;) {
+        master_ = ::posix_openpt (O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (master_ == -1) {
+            PROCRUNGUI_DEBUGM("posix_openpt failed with %d\n", errno);
+            break;
+        }
+        if ((::grantpt (master_) != 0) || (::unlockpt (master_) != 0)) {
+            PROCRUNGUI_DEBUGM("Failed to unlock pty with %d\n", errno);
+            break;
+        }
+
+        char name[64];
+        if (::ptsname_r (master_, name, sizeof(name)) != 0) {
+            break;
+        }
+        slave_ = ::open (name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (slave_ == -1) {
+            PROCRUNGUI_DEBUGM("Failed to open %s with %d\n", name, errno);
+            break;
+        }
+
+        struct termios tio;
+        if (::tcgetattr (slave_, &tio) == 0) {
+            tio.c_oflag &= ~(OPOST | ONLCR);
+            tio.c_lflag &= ~ECHO;
+            ::tcsetattr (slave_, TCSANOW, &tio);
+        }
+
+        struct winsize ws;
+        ws.ws_col = static_cast<unsigned short>(columns);
+        ws.ws_row = static_cast<unsigned short>(rows);
+        ws.ws_xpixel = 0;
+        ws.ws_ypixel = 0;
+        ::ioctl (master_, TIOCSWINSZ, &ws);
+
+        int flags = ::fcntl (master_, F_GETFL);
+        ::fcntl (master_, F_SETFL, flags | O_NONBLOCK);
+
+        b_ret = true;
+        break;
+    }
+    if (!b_ret) {
+        close ();
+    }
+    return b_ret;
+#else
+    Q_UNUSED(columns);
+    Q_UNUSED(rows);
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs between fork () and exec (), after the child became a session
+ * leader; only async-signal-safe calls are allowed. The descriptors
+ * were opened with close-on-exec, dup2 () clears the flag on the copies.
+ */
+void ProcPty::setupChild () const
+{
+#ifdef Q_OS_LINUX
+    if (slave_ == -1)
+        return;
+    ::ioctl (slave_, TIOCSCTTY, 0);
+    ::dup2 (slave_, STDOUT_FILENO);
+    ::dup2 (slave_, STDERR_FILENO);
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcPty::closeSlave ()
+{
+#ifdef Q_OS_LINUX
+    if (slave_ != -1) {
+        ::close (slave_);
+        slave_ = -1;
+    }
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcPty::close ()
+{
+#ifdef Q_OS_LINUX
+    closeSlave ();
+    if (master_ != -1) {
+        ::close (master_);
+        master_ = -1;
+    }
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the number of bytes read, 0 if nothing is available right now
+ * or -1 if the other end was closed (all processes using it are gone).
+ */
+qint64 ProcPty::read (char * buffer, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    if (master_ == -1)
+        return -1;
+    for (;;) {
+        ssize_t n = ::read (master_, buffer, static_cast<size_t>(size));
+        if (n > 0)
+            return n;
+        if (n == 0)
+            return -1;
+        if (errno == EINTR)
+            continue;
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return 0;
+        // EIO once the last slave descriptor is closed
+        return -1;
+    }
+#else
+    Q_UNUSED(buffer);
+    Q_UNUSED(size);
+    return -1;
+#endif
+}
+/* ========================================================================= */
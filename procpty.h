@@ -0,0 +1,73 @@
+/**
+ * @file procpty.h
+ * @brief Declarations for ProcPty class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCPTY_H_INCLUDE
+#define GUARD_PROCPTY_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QtGlobal>
+
+//! A pseudo-terminal used as standard output and error of a child.
+class PROCRUNGUI_EXPORT ProcPty {
+
+public:
+
+    //! Default constructor.
+    ProcPty ();
+
+    //! Destructor.
+    virtual ~ProcPty();
+
+    //! Tell if pseudo-terminals are available on this platform.
+    static bool
+    isSupported ();
+
+    //! Create the master/slave pair.
+    bool
+    open (
+            int columns = 160,
+            int rows = 48);
+
+    //! Runs in the child: make the slave the controlling terminal and output.
+    void
+    setupChild () const;
+
+    //! The parent has no use for the slave once the child started.
+    void
+    closeSlave ();
+
+    //! Release both ends.
+    void
+    close ();
+
+    //! The master end (-1 if not open).
+    int
+    masterFd () const {
+        return master_;
+    }
+
+    //! The end given to the child (-1 if not open or already closed).
+    int
+    slaveFd () const {
+        return slave_;
+    }
+
+    //! Read what is available without blocking.
+    qint64
+    read (
+            char * buffer,
+            qint64 size);
+
+private:
+    int master_; /**< our end */
+    int slave_; /**< the end given to the child */
+};
+
+#endif // GUARD_PROCPTY_H_INCLUDE
@@ -0,0 +1,333 @@
+/**
+ * @file procrunbatch.cc
+ * @brief Definitions for ProcRunBatch class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procrunbatch.h"
+#include "procrungui.h"
+#include "prgprocess.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class ProcRunBatch
+ *
+ * The batch hands its commands to ProcRunGui::runProgram () and uses the
+ * completion callback to learn when each of them ends. In sequential
+ * mode the next command is only started once the previous one is done;
+ * in parallel mode the same happens once maxParallel () commands run.
+ * In pipeline mode ProcRunGui::runPipeline () starts all of them at
+ * once and the stage index of each process identifies its job.
+ *
+ * A command that is tried again by its run policy only calls back once
+ * its last attempt ends; retryScheduled () and retryStarted () move the
+ * job over to the process of the next attempt in between.
+ *
+ * Estimates are based on the durations of previous runs of the same
+ * command, as provided by ProcRunGui::estimatedDuration (). Commands
+ * that were never run are assumed to last as long as the average
+ * known command in the batch.
+ */
+
+/* ------------------------------------------------------------------------- */
+ProcRunBatch::ProcRunBatch (
+        ProcRunGui * gui, const QList<ProcRunData> & jobs, Mode mode) :
+    QObject (gui),
+    gui_ (gui),
+    jobs_ (),
+    mode_ (mode),
+    max_parallel_ (0),
+    s_title_ (),
+    s_settings_key_ (),
+    next_ (0),
+    finished_ (0),
+    failed_ (0),
+    b_stopped_ (false),
+    timer_ ()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    foreach(const ProcRunData & data, jobs) {
+        Job job;
+        job.data_ = data;
+        job.estimate_ = gui_->estimatedDuration (data);
+        job.started_at_ = -1;
+        job.duration_ = -1;
+        job.proc_ = NULL;
+        job.retry_ = 0;
+        job.b_failed_ = false;
+        jobs_.append (job);
+    }
+    // a job keeps its slot while its command is tried again
+    connect (gui_, &ProcRunGui::retryScheduled,
+             this, &ProcRunBatch::retryScheduled);
+    connect (gui_, &ProcRunGui::retryStarted,
+             this, &ProcRunBatch::retryStarted);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunBatch::~ProcRunBatch()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    // processes that are still running must not call back into us
+    for (int i = 0; i < jobs_.count (); ++i) {
+        PrgProcess * proc = jobs_.at (i).proc_;
+        if ((proc != NULL) && (proc->user_data_ == this)) {
+            proc->kb_ = NULL;
+            proc->user_data_ = NULL;
+        }
+    }
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The instances of a template are the same command for this purpose,
+ * so they are all expected to last as long as the template did.
+ */
+void ProcRunBatch::setSettingsKey (const QString & s_key)
+{
+    s_settings_key_ = s_key;
+    if (s_key.isEmpty ())
+        return;
+    qint64 estimate = gui_->history ().stats (s_key).p50_;
+    for (int i = 0; i < jobs_.count (); ++i) {
+        jobs_[i].estimate_ = estimate;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunBatch::start ()
+{
+    timer_.start ();
+    if (jobs_.isEmpty ()) {
+        emit done ();
+        return;
+    }
+
+    if (mode_ == Parallel) {
+        while ((next_ < jobs_.count ()) &&
+               ((max_parallel_ == 0) || (next_ - finished_ < max_parallel_))) {
+            startNext ();
+        }
+    } else if (mode_ == Pipeline) {
+        startPipeline ();
+    } else {
+        startNext ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunBatch::startNext ()
+{
+    if (b_stopped_ || (next_ >= jobs_.count ()))
+        return;
+
+    int index = next_++;
+    Job & job = jobs_[index];
+    job.started_at_ = timer_.elapsed ();
+
+    // a program that fails to start ends later, from the event loop
+    job.proc_ = gui_->runProgram (
+                job.data_, &ProcRunBatch::jobFinished, this,
+                1, s_settings_key_);
+    emit progress ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunBatch::startPipeline ()
+{
+    QList<ProcRunData> stages;
+    for (int i = 0; i < jobs_.count (); ++i) {
+        jobs_[i].started_at_ = timer_.elapsed ();
+        stages.append (jobs_.at (i).data_);
+    }
+    next_ = jobs_.count ();
+
+    QList<PrgProcess*> procs = gui_->runPipeline (
+                stages, &ProcRunBatch::jobFinished, this);
+
+    for (int i = 0; i < procs.count (); ++i) {
+        jobs_[i].proc_ = procs.at (i);
+    }
+    emit progress ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunBatch::jobFinished (
+        ProcRunGui *, PrgProcess * proc, void * user_data)
+{
+    ProcRunBatch * batch = static_cast<ProcRunBatch*>(user_data);
+
+    int index = -1;
+    if (batch->mode_ == Pipeline) {
+        index = proc->pipe_stage_;
+    } else {
+        for (int i = 0; i < batch->jobs_.count (); ++i) {
+            if (batch->jobs_.at (i).proc_ == proc) {
+                index = i;
+                break;
+            }
+        }
+    }
+    if ((index < 0) || (index >= batch->jobs_.count ()))
+        return;
+
+    Job & job = batch->jobs_[index];
+    job.proc_ = NULL;
+    job.duration_ = batch->timer_.elapsed () - job.started_at_;
+    ++batch->finished_;
+    if (!proc->isSuccess ()) {
+        ++batch->failed_;
+        job.b_failed_ = true;
+    }
+
+    // no more callbacks for this process
+    proc->kb_ = NULL;
+    proc->user_data_ = NULL;
+
+    emit batch->progress ();
+    if ((batch->mode_ == Sequential) ||
+            ((batch->mode_ == Parallel) && (batch->max_parallel_ > 0))) {
+        batch->startNext ();
+    }
+    if (batch->isDone ()) {
+        emit batch->done ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The job is not finished; it keeps its place among the running ones
+ * until the last attempt calls jobFinished ().
+ */
+void ProcRunBatch::retryScheduled (PrgProcess * proc, quint64 retry)
+{
+    for (int i = 0; i < jobs_.count (); ++i) {
+        Job & job = jobs_[i];
+        if (job.proc_ == proc) {
+            job.proc_ = NULL;
+            job.retry_ = retry;
+            break;
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunBatch::retryStarted (quint64 retry, PrgProcess * proc)
+{
+    for (int i = 0; i < jobs_.count (); ++i) {
+        Job & job = jobs_[i];
+        if (job.retry_ == retry) {
+            job.proc_ = proc;
+            job.retry_ = 0;
+            break;
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<ProcRunData> ProcRunBatch::failedJobs () const
+{
+    QList<ProcRunData> result;
+    foreach(const Job & job, jobs_) {
+        if (job.b_failed_) {
+            result.append (job.data_);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+qint64 ProcRunBatch::elapsed () const
+{
+    if (!timer_.isValid ())
+        return 0;
+    return timer_.elapsed ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+qint64 ProcRunBatch::jobEstimate (int index) const
+{
+    const Job & job = jobs_.at (index);
+    if (job.estimate_ >= 0)
+        return job.estimate_;
+
+    // average of what we know about the others
+    qint64 sum = 0;
+    int known = 0;
+    foreach(const Job & other, jobs_) {
+        if (other.estimate_ >= 0) {
+            sum += other.estimate_;
+            ++known;
+        } else if (other.duration_ >= 0) {
+            sum += other.duration_;
+            ++known;
+        }
+    }
+    if (known == 0)
+        return -1;
+    return sum / known;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+qint64 ProcRunBatch::remainingEstimate () const
+{
+    qint64 now = elapsed ();
+    qint64 result = 0;
+    qint64 sum = 0;
+    for (int i = 0; i < jobs_.count (); ++i) {
+        const Job & job = jobs_.at (i);
+        if (job.duration_ >= 0)
+            continue;
+
+        qint64 estimate = jobEstimate (i);
+        if (estimate < 0)
+            return -1;
+
+        // time already spent running counts towards the estimate
+        qint64 left = estimate;
+        if (job.started_at_ >= 0) {
+            left = qMax (Q_INT64_C(0), estimate - (now - job.started_at_));
+        }
+
+        if (mode_ == Parallel) {
+            result = qMax (result, left);
+            sum += left;
+        } else {
+            result += left;
+        }
+    }
+    // with a limit the commands are spread over that many slots
+    if ((mode_ == Parallel) && (max_parallel_ > 0)) {
+        result = qMax (result, sum / max_parallel_);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+qreal ProcRunBatch::throughput () const
+{
+    qint64 ms = elapsed ();
+    if (ms <= 0)
+        return 0.0;
+    return (finished_ * 1000.0) / ms;
+}
+/* ========================================================================= */
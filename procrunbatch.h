@@ -0,0 +1,215 @@
+/**
+ * @file procrunbatch.h
+ * @brief Declarations for ProcRunBatch class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCRUNBATCH_H_INCLUDE
+#define GUARD_PROCRUNBATCH_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrun/procrundata.h>
+
+#include <QObject>
+#include <QList>
+#include <QElapsedTimer>
+#include <QString>
+
+class ProcRunGui;
+class PrgProcess;
+
+//! A set of commands that are started together and tracked as a whole.
+class PROCRUNGUI_EXPORT ProcRunBatch : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! How the commands are started.
+    enum Mode {
+        Parallel, /**< all commands are started at once */
+        Sequential, /**< a command starts when previous one ended */
+        Pipeline /**< all at once, each one feeding the next one */
+    };
+
+    //! Default constructor.
+    ProcRunBatch (
+            ProcRunGui * gui,
+            const QList<ProcRunData> & jobs,
+            Mode mode);
+
+    //! Destructor.
+    virtual ~ProcRunBatch();
+
+    //! Start the batch.
+    void
+    start ();
+
+    //! Start no more commands; the ones that run still report their end.
+    void
+    stop () {
+        b_stopped_ = true;
+    }
+
+    //! The way commands are started.
+    Mode
+    mode () const {
+        return mode_;
+    }
+
+    //! Commands running at the same time in parallel mode (0 for all).
+    int
+    maxParallel () const {
+        return max_parallel_;
+    }
+
+    //! Limit the commands running at the same time (call before start ()).
+    void
+    setMaxParallel (
+            int value) {
+        max_parallel_ = qMax (0, value);
+    }
+
+    //! A name for the batch (empty for none).
+    const QString &
+    title () const {
+        return s_title_;
+    }
+
+    //! Name the batch; named batches get a summary when done.
+    void
+    setTitle (
+            const QString & s_title) {
+        s_title_ = s_title;
+    }
+
+    //! Key of the settings and history of all commands (empty if their own).
+    const QString &
+    settingsKey () const {
+        return s_settings_key_;
+    }
+
+    //! Use the settings and history stored under @a s_key for all commands.
+    void
+    setSettingsKey (
+            const QString & s_key);
+
+    //! Number of commands in this batch.
+    int
+    count () const {
+        return jobs_.count ();
+    }
+
+    //! Number of commands that were started.
+    int
+    startedCount () const {
+        return next_;
+    }
+
+    //! Number of commands that have ended.
+    int
+    finishedCount () const {
+        return finished_;
+    }
+
+    //! Number of commands that have ended with an error.
+    int
+    failedCount () const {
+        return failed_;
+    }
+
+    //! The commands that have ended with an error.
+    QList<ProcRunData>
+    failedJobs () const;
+
+    //! Are all commands done?
+    bool
+    isDone () const {
+        return finished_ == jobs_.count ();
+    }
+
+    //! Milliseconds since the batch was started.
+    qint64
+    elapsed () const;
+
+    //! Estimated number of milliseconds until the batch is done (-1 if unknown).
+    qint64
+    remainingEstimate () const;
+
+    //! Number of commands completed per second.
+    qreal
+    throughput () const;
+
+signals:
+
+    //! A command was started or has ended.
+    void
+    progress ();
+
+    //! All commands have ended.
+    void
+    done ();
+
+private slots:
+
+    //! The command of a job ended and will be tried again.
+    void
+    retryScheduled (
+            PrgProcess * proc,
+            quint64 retry);
+
+    //! The next attempt of a job was started.
+    void
+    retryStarted (
+            quint64 retry,
+            PrgProcess * proc);
+
+private:
+
+    //! Callback used with ProcRunGui::runProgram ().
+    static void
+    jobFinished (
+            ProcRunGui * gui,
+            PrgProcess * proc,
+            void * user_data);
+
+    //! Start the command at index next_.
+    void
+    startNext ();
+
+    //! Start all commands as the stages of a pipeline.
+    void
+    startPipeline ();
+
+    //! Estimated duration of a job (-1 if unknown).
+    qint64
+    jobEstimate (
+            int index) const;
+
+    //! A single command in the batch.
+    struct Job {
+        ProcRunData data_; /**< what to run */
+        qint64 estimate_; /**< expected duration in milliseconds or -1 */
+        qint64 started_at_; /**< milliseconds since batch start or -1 */
+        qint64 duration_; /**< actual duration or -1 if not finished */
+        PrgProcess * proc_; /**< the process while running */
+        quint64 retry_; /**< the attempt waiting to start (0 for none) */
+        bool b_failed_; /**< ended with an error */
+    };
+
+    ProcRunGui * gui_; /**< the widget that runs the processes */
+    QList<Job> jobs_; /**< the commands */
+    Mode mode_; /**< parallel or sequential */
+    int max_parallel_; /**< limit for parallel mode (0 for none) */
+    QString s_title_; /**< name of the batch or empty */
+    QString s_settings_key_; /**< settings of all commands or empty */
+    int next_; /**< index of the next command to start */
+    int finished_; /**< number of commands that ended */
+    int failed_; /**< number of commands that ended in error */
+    bool b_stopped_; /**< no more commands are started */
+    QElapsedTimer timer_; /**< measures the duration of the batch */
+};
+
+#endif // GUARD_PROCRUNBATCH_H_INCLUDE
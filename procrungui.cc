@@ -9,13 +9,22 @@
 
 #include "procrungui.h"
 #include "ui_procrungui.h"
+#include "prgprocess.h"
+#include "procrunstatsdlg.h"
+#include "procshutdown.h"
+#include "procrunserver.h"
+#include "outputwindow.h"
+#include "timerwheel.h"
+#include "procdashboardmodel.h"
+#include "procmetrics.h"
+#include "outputlog.h"
+#include "outputexporter.h"
 
 #include "procrungui-private.h"
 
 #include <procrun/procrunmodel.h>
 
 #include <QProcess>
-#include <QThread>
 #include <QDateTime>
 #include <QLabel>
 #include <QMessageBox>
@@ -30,181 +39,19 @@
 #include <QApplication>
 #include <QFileDialog>
 #include <QListWidgetItem>
+#include <QCryptographicHash>
+#include <QProgressDialog>
+#include <QProgressBar>
+#include <QTabBar>
+#include <QTableView>
+#include <QHeaderView>
+#include <QPlainTextEdit>
+#include <QSaveFile>
+#include <QScrollBar>
+#include <QTime>
 
 #include <assert.h>
 
-//! A process managed by the ProcRunGui class.
-class PrgProcess : public QProcess {
-    Q_OBJECT
-
-public:
-
-    //! Constructor.
-    PrgProcess (ProcRunGui * prg, ProcRunGui::Kb kb, void * user_data) :
-        QProcess (static_cast<QObject*>(prg)),
-        prg_ (prg),
-        start_time_(),
-        end_time_(),
-        all_output_(),
-        b_started_(false),
-        errors_(),
-        states_(),
-        kb_(kb),
-        user_data_(user_data),
-        widget_(NULL),
-        close_on_exit_(false)
-    {
-
-        connect (this,
-                 SIGNAL(error(QProcess::ProcessError)),
-                 SLOT(errorSlot(QProcess::ProcessError)));
-        connect (this,
-                 SIGNAL(finished(int,QProcess::ExitStatus)),
-                 SLOT(finishedSlot(int,QProcess::ExitStatus)));
-        connect (this,
-                 SIGNAL(readyReadStandardError()),
-                 SLOT(readyReadStandardErrorSlot()));
-        connect (this,
-                 SIGNAL(readyReadStandardOutput()),
-                 SLOT(readyReadStandardOutputSlot()));
-        connect (this,
-                 SIGNAL(started()),
-                 SLOT(startedSlot()));
-        connect (this,
-                 SIGNAL(stateChanged (QProcess::ProcessState)),
-                 SLOT(stateChangedSlot (QProcess::ProcessState)));
-    }
-
-    ~PrgProcess() {
-        if (widget_ != NULL) {
-            delete widget_;
-        }
-    }
-
-    //! Get the duration in seconds.
-    qint64
-    runDuration() const {
-        return end_time_.secsTo (start_time_);
-    }
-
-    //! Get the duration in seconds.
-    int durationInSeconds () {
-        return static_cast<int>(end_time_.secsTo (start_time_));
-    }
-
-    //! Get the duration in milliseconds.
-    int durationInMiliSeconds () {
-        return static_cast<int>(end_time_.msecsTo (start_time_));
-    }
-
-    //! Start the program.
-    void
-    perform (const QStringList & input) {
-        PROCRUNGUI_TRACE_ENTRY;
-
-        // start the program
-        this->start (QIODevice::ReadWrite);
-        if (!this->waitForStarted()) {
-            return;
-        }
-
-        // provide the input
-        foreach (const QString & s, input) {
-            this->write (s.toLatin1 ().constData ());
-            // delay?
-        }
-        this->closeWriteChannel();
-
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Tell if this process is running or not.
-    bool
-    isRunning () const {
-        return state () != NotRunning;
-    }
-
-public slots:
-
-    //! Some output coming out of error channel.
-    void
-    readyReadStandardErrorSlot () {
-        PROCRUNGUI_TRACE_ENTRY;
-        all_output_.append (
-                    prg_->processGeneratedText (
-                        this, readAllStandardError (), true));
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Some output coming out of output channel.
-    void
-    readyReadStandardOutputSlot () {
-        PROCRUNGUI_TRACE_ENTRY;
-        all_output_.append (
-                    prg_->processGeneratedText (
-                        this, readAllStandardError (), false));
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Connected to keep the started/not started state.
-    void
-    startedSlot () {
-        PROCRUNGUI_TRACE_ENTRY;
-        b_started_ = true;
-        start_time_ = QDateTime::currentDateTime ();
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Connected to keep the started/not started state.
-    void
-    finishedSlot (
-            int /*exitCode*/,
-            QProcess::ExitStatus /*exitStatus*/) {
-        PROCRUNGUI_TRACE_ENTRY;
-        // no need to cache them as they are available from QProcess
-        end_time_ = QDateTime::currentDateTime ();
-        if (kb_ != NULL) {
-            kb_(prg_, this, user_data_);
-        }
-        prg_->finishProcess (this);
-
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Track this slot to accumulate the list of states.
-    void
-    stateChangedSlot (
-            QProcess::ProcessState newState) {
-        PROCRUNGUI_TRACE_ENTRY;
-        states_.append (newState);
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-    //! Accumulate errors here.
-    void
-    errorSlot (QProcess::ProcessError error) {
-        PROCRUNGUI_TRACE_ENTRY;
-        errors_.append (error);
-        PROCRUNGUI_TRACE_EXIT;
-    }
-
-public:
-    ProcRunGui * prg_;
-    QDateTime start_time_; /**< the time when the process was started */
-    QDateTime end_time_; /**< the time when the process ended */
-    QString all_output_; /**< the output through output and error channel */
-    bool b_started_; /**< is the process already running? */
-    QList<QProcess::ProcessError> errors_; /**< list of errors */
-    QList<QProcess::ProcessState> states_; /**< list of states*/
-    ProcRunGui::Kb kb_; /**< function to be called when the process ends */
-    void * user_data_; /**< opaque user data */
-    QLabel * widget_; /**< associated widget */
-    bool close_on_exit_; /**< should this process close its tab on exit? */
-};
-
-#include "procrungui.moc"
-
-
 /**
  * @class ProcRunGui
  *
@@ -218,8 +65,104 @@ public:
  * The child process may be closed mid-way.
  *
  * The output coming out of the error channel is colored differently
- * than the one coming out of standard output channel.
+ * than the one coming out of standard output channel. Colors and
+ * attributes selected by the program through ANSI escape sequences
+ * are preserved; with setUsePty () the programs see a terminal and
+ * are more likely to use them (and to flush their output by line).
+ *
+ * The output of any tab may also be followed in separate windows
+ * (detachTab (), tileTab ()); all of them read the same store.
+ *
+ * With listen () other programs may start commands, follow their
+ * output, query and end them through a local socket; see ProcRunServer.
+ *
+ * Starting a program from a large GUI is slow, as fork () copies our
+ * page tables. With setUseLauncher () programs are started by a small
+ * helper instead; ProcLauncher::start () must then be called first in
+ * main (). Without the helper QProcess is used as before.
+ *
+ * A RunPolicy stored for a command limits the time a run may take and
+ * the time it may stay silent, and retries failed runs after a delay.
+ * All these deadlines live in a single TimerWheel; the silence check
+ * only looks at when output last came, so output itself costs no timer
+ * operations.
+ *
+ * A group of saved commands may be marked as a pipeline; running it
+ * then connects its commands as the stages of runPipeline ().
+ *
+ * A saved command with a CommandTemplate is run by fanOut () as a batch
+ * with an instance for each value, optionally with a limited number of
+ * them running at once; a summary is shown when all are done.
+ *
+ * The output of a process that ended and stays around is compressed in
+ * the background (see OutputPacker), so many finished tabs may be kept
+ * open for a fraction of the memory.
+ *
+ * With many processes the tabs are hard to follow; showDashboard ()
+ * lists all of them in a table (ProcDashboardModel) with their state,
+ * resource usage and last line of output. In dashboard mode (see
+ * setDashboardMode ()) that table replaces the tabs: no tab, label or
+ * progress bar is created for a process and the row selected in the
+ * table decides what the output view shows.
+ *
+ * Reads, dropped bytes, painting and the lag of the event loop are
+ * counted (see ProcMetrics); metricsText () puts them in the Prometheus
+ * text format, showCounters () shows them and setMetricsFile () has
+ * them exported periodically.
+ *
+ * With setKeepSession () each new process is recorded in a ProcSession
+ * and its output is spilled to a log (see OutputLog) once a second and
+ * when it ends. After a restart - or a crash - restoreSession () shows
+ * the tabs again at once: the logs are mapped in memory rather than
+ * read (see ProcOutput::mapLog ()). Closing a tab forgets the process;
+ * closing the widget does not.
+ *
+ * The output of finished processes may be exported to JSON Lines or CSV
+ * (exportRuns (), exportOutput ()); the file is written by an
+ * OutputExporter in a worker thread, straight from the output store.
+ */
+
+/* ------------------------------------------------------------------------- */
+static QString dataFilePath (const char * name)
+{
+    QString s_input = QStandardPaths::writableLocation (
+                QStandardPaths::AppDataLocation);
+    QDir dr (s_input);
+    dr.mkpath (QLatin1String ("."));
+    if (!dr.exists()) {
+        PROCRUNGUI_DEBUGM("Failed to create application data directory\n");
+        return QString ();
+    }
+
+    s_input = dr.absoluteFilePath (QLatin1String (name));
+
+    return s_input;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static QString defaultDataFile ()
+{
+    return dataFilePath ("proc_run_gui_commands.ini");
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Options of saved commands that ProcRunItem has no place for are kept
+ * in this file, keyed by ProcRunGui::commandKey ().
  */
+static QString optionsFile ()
+{
+    return dataFilePath ("proc_run_gui_options.ini");
+}
+/* ========================================================================= */
+
+//! Group of the options file where pipeline groups are marked.
+#define STG_PIPELINE_GROUP "Pipelines"
+
+//! Most commands whose options are kept parsed.
+#define MAX_CACHED_SETTINGS 1024
 
 /* ------------------------------------------------------------------------- */
 /**
@@ -233,13 +176,58 @@ ProcRunGui::ProcRunGui(QWidget * parent) :
     running_mov_(),
     cmdmodl_(NULL),
     item_in_form_(NULL),
-    b_list_lock_(false)
+    b_list_lock_(false),
+    batches_(),
+    history_(),
+    timer_ticks_(0),
+    kill_timeout_(5000),
+    shutdown_(NULL),
+    shutdown_dlg_(NULL),
+    b_shutdown_done_(false),
+    b_use_pty_(false),
+    b_use_launcher_(false),
+    server_(NULL),
+    windows_(),
+    tiled_(),
+    dashboard_(),
+    b_dashboard_mode_(false),
+    board_(NULL),
+    counters_view_(),
+    s_metrics_file_(),
+    tick_clock_(),
+    wheel_(NULL),
+    watched_(),
+    retries_(),
+    cache_(),
+    settings_(),
+    b_keep_session_(false),
+    b_restoring_(false),
+    session_(),
+    exports_()
 {
     PROCRUNGUI_TRACE_ENTRY;
     ui->setupUi (this);
+    ui->batchWidget->hide ();
+    ui->dashboardView->hide ();
+    prepareDashboardView (ui->dashboardView);
+
+    QTabBar * tab_bar = ui->tabWidget->tabBar ();
+    tab_bar->setContextMenuPolicy (Qt::CustomContextMenu);
+    connect (tab_bar, &QTabBar::customContextMenuRequested,
+             this, &ProcRunGui::tabContextMenu);
+    connect (tab_bar, &QTabBar::tabMoved,
+             this, &ProcRunGui::tabMoved);
+    connect (ui->tabWidget, &QTabWidget::tabBarDoubleClicked,
+             this, &ProcRunGui::detachTab);
+
+    wheel_ = new TimerWheel (100, this);
+    connect (wheel_, &TimerWheel::expired,
+             this, &ProcRunGui::wheelExpired);
 
     startTimer (100);
+    tick_clock_.start ();
     loadCommands ();
+    history_.open ();
     PROCRUNGUI_TRACE_EXIT;
 }
 /* ========================================================================= */
@@ -268,21 +256,48 @@ PrgProcess *ProcRunGui::runProgram (
 
 /* ------------------------------------------------------------------------- */
 PrgProcess *ProcRunGui::runProgram (
-        const ProcRunData &data, ProcRunGui::Kb kb, void *user_data)
+        const ProcRunData &data, ProcRunGui::Kb kb, void *user_data,
+        int attempt, const QString & s_settings_key)
 {
     PROCRUNGUI_TRACE_ENTRY;
-    PrgProcess * result = new PrgProcess (this, kb, user_data);
-    processes_.append (result);
-    data.setupProcess (result);
-
-    result->widget_ = new QLabel ();
-    result->widget_->setText (tr ("%1> %2")
-                             .arg (data.s_program_)
-                             .arg (data.sl_arguments_.join (QChar (' '))));
+    // processes that start now would not be waited for
+    if ((shutdown_ != NULL) || b_shutdown_done_) {
+        PROCRUNGUI_DEBUGM("Not starting %s while closing\n",
+                          TMP_A(data.s_program_));
+        PROCRUNGUI_TRACE_EXIT;
+        return NULL;
+    }
+    // instances of a template use the settings of the template
+    QString s_key = s_settings_key.isEmpty () ?
+                commandKey (data) : s_settings_key;
+    // retries always run the program
+    QString s_cache_key;
+    if (attempt == 1) {
+        CommandSettings stg = commandSettings (s_key);
+        if (!stg.cache_.isEmpty ()) {
+            // what is stored went through the filter
+            s_cache_key = cache_.key (
+                        data, stg.profile_, stg.filter_, b_use_pty_, stg.cache_);
+        }
+    }
+    ResultCache::Entry cached;
+    if (!s_cache_key.isEmpty () && cache_.lookup (s_cache_key, cached)) {
+        PrgProcess * result = createProcess (
+                    data, kb, user_data, attempt, s_key);
+        appendNotice (result, tr ("Inputs did not change; replaying the "
+                                  "output of a previous run (%1 s)")
+                      .arg (cached.duration_ms_ / 1000.0, 0, 'f', 1));
+        result->replay (cached);
+        PROCRUNGUI_TRACE_EXIT;
+        return result;
+    }
 
-    QFileInfo fl (data.s_program_);
-    ui->tabWidget->addTab (result->widget_, QIcon(), fl.baseName ());
-    result->perform (data.sl_input_);
+    PrgProcess * result = createProcess (data, kb, user_data, attempt, s_key);
+    result->s_cache_key_ = s_cache_key;
+    // a program that can't be started is finished from the event
+    // loop, so the result is valid when we return
+    armPolicy (result);
+    result->perform (data.sl_input_, b_use_pty_, b_use_launcher_);
 
     PROCRUNGUI_TRACE_EXIT;
     return result;
@@ -290,489 +305,2241 @@ PrgProcess *ProcRunGui::runProgram (
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-int ProcRunGui::programIndex (PrgProcess *prg)
+/**
+ * The standard output of each stage is connected to the standard input
+ * of the next one by QProcess::setStandardOutputProcess (), so the data
+ * goes from one program to the other through a pipe without reaching
+ * us. The tab of a stage shows its standard error; the last one also
+ * shows its standard output. Only the first stage is given the saved
+ * input.
+ *
+ * Stages use plain pipes (neither the pseudo-terminal nor the launcher)
+ * and are not retried on their own. A stage that fails to start is only
+ * reported from the event loop, so none of them goes away while the
+ * others are being started.
+ */
+QList<PrgProcess*> ProcRunGui::runPipeline (
+        const QList<ProcRunData> & stages, Kb kb, void * user_data)
 {
-    return processes_.indexOf (prg);
+    PROCRUNGUI_TRACE_ENTRY;
+    QList<PrgProcess*> result;
+    if ((shutdown_ != NULL) || b_shutdown_done_) {
+        PROCRUNGUI_TRACE_EXIT;
+        return result;
+    }
+    for (int i = 0; i < stages.count (); ++i) {
+        PrgProcess * proc = createProcess (stages.at (i), kb, user_data, 1);
+        proc->pipe_stage_ = i;
+        result.append (proc);
+    }
+    for (int i = 1; i < result.count (); ++i) {
+        result.at (i - 1)->setStandardOutputProcess (result.at (i));
+    }
+
+    for (int i = 0; i < result.count (); ++i) {
+        PrgProcess * proc = result.at (i);
+        armPolicy (proc);
+        proc->perform (i == 0 ? stages.first ().sl_input_ : QStringList ());
+    }
+
+    PROCRUNGUI_TRACE_EXIT;
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-PrgProcess * ProcRunGui::program (int idx)
+/**
+ * The process must be the last one in processes_ and the tabs must
+ * already mirror the ones before it.
+ */
+void ProcRunGui::addTab (PrgProcess * proc)
 {
-    return processes_.at (idx);
+    proc->widget_ = new QLabel ();
+    proc->widget_->setText (commandTitle (proc->data_));
+
+    QFileInfo fl (proc->data_.s_program_);
+    int tab = ui->tabWidget->addTab (proc->widget_, QIcon(), fl.baseName ());
+    assert(tab == programIndex (proc));
+
+    if ((proc->filter_ != NULL) && proc->filter_->hasProgress ()) {
+        proc->progress_bar_ = new QProgressBar ();
+        proc->progress_bar_->setRange (0, 100);
+        proc->progress_bar_->setValue (proc->filter_->progress ());
+        proc->progress_bar_->setTextVisible (false);
+        proc->progress_bar_->setFixedSize (40, 8);
+        ui->tabWidget->tabBar ()->setTabButton (
+                    tab, QTabBar::LeftSide, proc->progress_bar_);
+    }
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-static QString defaultDataFile ()
+QString ProcRunGui::commandTitle (const ProcRunData & data)
 {
-    QString s_input = QStandardPaths::writableLocation (
-                QStandardPaths::AppDataLocation);
-    QDir dr (s_input);
-    dr.mkpath (QLatin1String ("."));
-    if (!dr.exists()) {
-        PROCRUNGUI_DEBUGM("Failed to create application data directory\n");
-        return QString ();
-    }
-
-    s_input = dr.absoluteFilePath (QLatin1String ("proc_run_gui_commands.ini"));
-
-    return s_input;
+    return tr ("%1> %2")
+            .arg (data.s_program_)
+            .arg (data.sl_arguments_.join (QChar (' ')));
 }
 /* ========================================================================= */
 
-#define STG_TOP_CONTAINER "ProcRunGui"
-#define STG_CONTAINER "Container"
-#define STG_VAL_TYPE "EntryType"
-
 /* ------------------------------------------------------------------------- */
-bool ProcRunGui::loadCommands(const QString &s_file)
+PrgProcess * ProcRunGui::createProcess (
+        const ProcRunData & data, Kb kb, void * user_data, int attempt,
+        const QString & s_settings_key)
 {
-    PROCRUNGUI_TRACE_ENTRY;
-    bool b_ret = false;
-    for (;;) {
-        // Default to a file in application data directory.
-        QString s_input = s_file;
-        if (s_file.isEmpty()) {
-            s_input = defaultDataFile ();
-            if (s_file.isEmpty()) {
-                break;
-            }
-        }
+    PrgProcess * result = new PrgProcess (this, data, kb, user_data);
+    result->attempt_ = attempt;
+    result->s_settings_key_ = s_settings_key.isEmpty () ?
+                commandKey (data) : s_settings_key;
+    processes_.append (result);
+    data.setupProcess (result);
 
-        // Make sure the file exists.
-        if (!QFile (s_input).exists ()) {
-            PROCRUNGUI_DEBUGM("Input file %s does not exists\n", TMP_A(s_input));
-            break;
+    CommandSettings stg = commandSettings (result->s_settings_key_);
+    result->setFilter (stg.filter_);
+    if (board_ == NULL) {
+        addTab (result);
+    } else {
+        // the row shows up now rather than at the next sample
+        board_->refresh ();
+        if (!ui->dashboardView->currentIndex ().isValid ()) {
+            ui->dashboardView->setCurrentIndex (
+                        board_->index (board_->rowCount () - 1, 0));
         }
-        PROCRUNGUI_DEBUGM("ProcRunGui loads commands from file %s\n",
-                          TMP_A(s_input));
-
-        // Load the file using settings
-        QSettings stg (s_input, QSettings::IniFormat);
-
-        b_ret = loadCommands (stg);
-        break;
     }
 
-    PROCRUNGUI_TRACE_EXIT;
-    return b_ret;
+    result->setLaunchProfile (stg.profile_);
+    if (b_keep_session_ && !b_restoring_) {
+        startSessionLog (result);
+    }
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-bool ProcRunGui::loadCommands (QSettings & stg)
+ProcRunBatch * ProcRunGui::runBatch (
+        const QList<ProcRunData> & jobs, ProcRunBatch::Mode mode,
+        int max_parallel, const QString & s_title,
+        const QString & s_settings_key)
 {
     PROCRUNGUI_TRACE_ENTRY;
-    bool b_ret = false;
-    for (;;) {
-
-        ProcRunModel * mdl = new ProcRunModel (this);
-        b_ret = mdl->load (stg);
-        setCmdModel (mdl);
-
-        break;
+    if ((shutdown_ != NULL) || b_shutdown_done_) {
+        PROCRUNGUI_TRACE_EXIT;
+        return NULL;
     }
+    ProcRunBatch * result = new ProcRunBatch (this, jobs, mode);
+    result->setMaxParallel (max_parallel);
+    result->setTitle (s_title);
+    result->setSettingsKey (s_settings_key);
+    batches_.append (result);
+    connect (result, &ProcRunBatch::progress,
+             this, &ProcRunGui::batchProgress);
+    connect (result, &ProcRunBatch::done,
+             this, &ProcRunGui::batchDone);
+    result->start ();
+    updateBatchProgress ();
     PROCRUNGUI_TRACE_EXIT;
-    return b_ret;
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::setCmdModel (ProcRunModel * mdl)
+/**
+ * Returns NULL if the command is not a template or has no values.
+ */
+ProcRunBatch * ProcRunGui::fanOut (const ProcRunData & data)
 {
-    if (cmdmodl_ != NULL) {
-        delete cmdmodl_;
+    CommandTemplate tpl = commandTemplate (data);
+    QList<ProcRunData> jobs = tpl.instances (data);
+    if (jobs.isEmpty ()) {
+        PROCRUNGUI_DEBUGM("No instances for template %s\n",
+                          TMP_A(data.s_program_));
+        return NULL;
     }
-    cmdmodl_ = mdl;
-    ui->treeView->setModel (cmdmodl_);
-    connect (ui->treeView->selectionModel(), &QItemSelectionModel::currentRowChanged,
-             this, &ProcRunGui::treeviewSelectionChanged);
+    QFileInfo fl (data.s_program_);
+    // the instances share the settings and history of the template
+    return runBatch (jobs, ProcRunBatch::Parallel, tpl.max_parallel_,
+                     tr ("%1 over %2 {%3}")
+                     .arg (fl.fileName ())
+                     .arg (jobs.count ())
+                     .arg (tpl.s_placeholder_.trimmed ()),
+                     commandKey (data));
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-ProcRunItemBase *ProcRunGui::selectedCmdEntry ()
+QString ProcRunGui::commandKey (const ProcRunData & data)
 {
-    ProcRunItemBase * result = NULL;
-    QItemSelectionModel * slc = ui->treeView->selectionModel ();
-    if (slc != NULL) {
-        QModelIndex mi = slc->currentIndex();
-        if (mi.isValid()) {
-            result = cmdmodl_->itemFromIndex (mi);
-        }
+    QCryptographicHash hsh (QCryptographicHash::Sha1);
+    hsh.addData (data.s_program_.toUtf8 ());
+    foreach(const QString & s_arg, data.sl_arguments_) {
+        hsh.addData ("\0", 1);
+        hsh.addData (s_arg.toUtf8 ());
     }
-    return result;
+    hsh.addData ("\0\0", 2);
+    hsh.addData (data.s_wrk_dir_.toUtf8 ());
+    return QString::fromLatin1 (hsh.result ().toHex ());
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-bool ProcRunGui::saveCommands(const QString &s_file)
+/**
+ * Starting a program needs most of these, so they are read together and
+ * kept until one of them is saved; the options file is only written by
+ * saveSettings (). The copy is cheap, the strings are shared.
+ */
+ProcRunGui::CommandSettings ProcRunGui::commandSettings (
+        const QString & s_key) const
 {
-    PROCRUNGUI_TRACE_ENTRY;
-    bool b_ret = false;
-    for (;;) {
-        // Default to a file in application data directory.
-        QString s_input = s_file;
-        if (s_file.isEmpty()) {
-            s_input = defaultDataFile ();
-            if (s_file.isEmpty()) {
-                break;
-            }
-        }
-
-        PROCRUNGUI_DEBUGM("ProcRunGui saves commands to file %s\n",
-                          TMP_A(s_input));
-
-        // Load the file using settings
-        QSettings stg (s_input, QSettings::IniFormat);
-
-        b_ret = saveCommands (stg);
-
-        break;
+    QHash<QString, CommandSettings>::const_iterator iter =
+            settings_.constFind (s_key);
+    if (iter != settings_.constEnd ())
+        return iter.value ();
+
+    CommandSettings result;
+    QString s_file = optionsFile ();
+    if (!s_file.isEmpty ()) {
+        QSettings stg (s_file, QSettings::IniFormat);
+        result.filter_.load (stg, s_key);
+        result.profile_.load (stg, s_key);
+        result.policy_.load (stg, s_key);
+        result.template_.load (stg, s_key);
+        result.cache_.load (stg, s_key);
     }
-    PROCRUNGUI_TRACE_EXIT;
-    return b_ret;
+    // one-off commands (from the server, say) should not pile up
+    if (settings_.count () >= MAX_CACHED_SETTINGS) {
+        settings_.clear ();
+    }
+    settings_.insert (s_key, result);
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-bool ProcRunGui::saveCommands(QSettings &s_data)
+template <typename T>
+void ProcRunGui::saveSettings (const QString & s_key, const T & value)
 {
-    PROCRUNGUI_TRACE_ENTRY;
-    bool b_ret = false;
-    if (cmdmodl_ != NULL) {
-        b_ret = cmdmodl_->save (s_data);
-    }
-    PROCRUNGUI_TRACE_EXIT;
-    return b_ret;
+    settings_.remove (s_key);
+    QString s_file = optionsFile ();
+    if (s_file.isEmpty ())
+        return;
+    QSettings stg (s_file, QSettings::IniFormat);
+    value.save (stg, s_key);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::closeEvent (QCloseEvent * ev)
+qint64 ProcRunGui::estimatedDuration (const ProcRunData & data) const
 {
-    saveCommands ();
-    int cnt = ui->tabWidget->count() - 1;
-    for (int i = cnt; i >= 0; --i) {
-        if (!on_tabWidget_tabCloseRequested (i)) {
-            ev->ignore ();
-            return;
-        }
-    }
-
-    emit aboutToClose ();
-
-    if (ui->tabWidget->count() > 0) {
-        QThread::msleep (500);
-    }
-
-    qDeleteAll (processes_);
-
-    ev->accept ();
+    return history_.stats (commandKey (data)).p50_;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::timerEvent (QTimerEvent *)
+OutputFilterConfig ProcRunGui::outputFilter (const ProcRunData & data) const
 {
-    int cnt = ui->tabWidget->count() - 1;
-    QIcon ic (running_mov_.currentPixmap());
-    for (int i = cnt; i >= 0; --i) {
-        PrgProcess * proc = processes_.at (i);
-        assert(ui->tabWidget->widget(i) == proc->widget_);
-        if (proc->isRunning ()) {
-            ui->tabWidget->setTabIcon (i, ic);
-        }
-    }
+    return commandSettings (commandKey (data)).filter_;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-QString ProcRunGui::processGeneratedText (
-        PrgProcess * proc, const QString &s_input, bool is_error)
+void ProcRunGui::setOutputFilter (
+        const ProcRunData & data, const OutputFilterConfig & config)
 {
-    QString s_prefix;
-    QString s_suffix;
-    if (is_error) {
-        s_prefix = QLatin1String ("<red>");
-        s_suffix = QLatin1String ("</red>");
-    } else {
-        // ..
-    }
+    saveSettings (commandKey (data), config);
+}
+/* ========================================================================= */
 
-    QString s_result = s_prefix;
-    QLatin1String nl ("<br />\n");
-    foreach(const QString s_line, s_input.toHtmlEscaped ().split (QChar('\n'))) {
-        s_result.append (s_line);
-        s_result.append (nl);
+/* ------------------------------------------------------------------------- */
+/* ------------------------------------------------------------------------- */
+LaunchProfile ProcRunGui::launchProfile (const ProcRunData & data) const
+{
+    return commandSettings (commandKey (data)).profile_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setLaunchProfile (
+        const ProcRunData & data, const LaunchProfile & profile)
+{
+    saveSettings (commandKey (data), profile);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+RunPolicy ProcRunGui::runPolicy (const ProcRunData & data) const
+{
+    return commandSettings (commandKey (data)).policy_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setRunPolicy (
+        const ProcRunData & data, const RunPolicy & policy)
+{
+    saveSettings (commandKey (data), policy);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+CommandTemplate ProcRunGui::commandTemplate (const ProcRunData & data) const
+{
+    return commandSettings (commandKey (data)).template_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setCommandTemplate (
+        const ProcRunData & data, const CommandTemplate & tpl)
+{
+    saveSettings (commandKey (data), tpl);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+CacheConfig ProcRunGui::cacheConfig (const ProcRunData & data) const
+{
+    return commandSettings (commandKey (data)).cache_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setCacheConfig (
+        const ProcRunData & data, const CacheConfig & config)
+{
+    saveSettings (commandKey (data), config);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::armPolicy (PrgProcess * proc)
+{
+    proc->policy_ = commandSettings (proc->s_settings_key_).policy_;
+    if (proc->attempt_ > 1) {
+        appendNotice (proc, tr ("Attempt %1 of %2")
+                      .arg (proc->attempt_)
+                      .arg (proc->policy_.retries_ + 1));
+    }
+
+    if (proc->policy_.timeout_s_ > 0) {
+        proc->deadline_id_ = wheel_->schedule (
+                    proc->policy_.timeout_s_ * Q_INT64_C(1000));
+        watched_.insert (proc->deadline_id_, proc);
+    }
+    if (proc->policy_.idle_s_ > 0) {
+        proc->last_output_ms_ = wheel_->now ();
+        proc->idle_id_ = wheel_->schedule (
+                    proc->policy_.idle_s_ * Q_INT64_C(1000));
+        watched_.insert (proc->idle_id_, proc);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::disarmPolicy (PrgProcess * proc)
+{
+    if (proc->deadline_id_ != 0) {
+        wheel_->cancel (proc->deadline_id_);
+        watched_.remove (proc->deadline_id_);
+        proc->deadline_id_ = 0;
+    }
+    if (proc->idle_id_ != 0) {
+        wheel_->cancel (proc->idle_id_);
+        watched_.remove (proc->idle_id_);
+        proc->idle_id_ = 0;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs the user ended are not retried, nor are pipeline stages, nor
+ * anything while the window closes.
+ *
+ * Called by the process before its callback. The callback moves to the
+ * retry, so it is only called when the last attempt ends.
+ */
+bool ProcRunGui::scheduleRetry (PrgProcess * proc)
+{
+    if ((shutdown_ != NULL) || b_shutdown_done_)
+        return false;
+    if (proc->b_signaled_ && !proc->b_timed_out_)
+        return false;
+    if (proc->pipe_stage_ != -1)
+        return false;
+    if (!proc->policy_.shouldRetry (
+                proc->attempt_, proc->exit_code_,
+                proc->b_crashed_, proc->b_timed_out_))
+        return false;
+
+    qint64 delay = proc->policy_.retryDelayMs (proc->attempt_);
+    PendingRetry retry;
+    retry.data_ = proc->data_;
+    retry.kb_ = proc->kb_;
+    retry.user_data_ = proc->user_data_;
+    retry.attempt_ = proc->attempt_ + 1;
+    retry.s_settings_key_ = proc->s_settings_key_;
+    proc->kb_ = NULL;
+    proc->user_data_ = NULL;
+    quint64 id = wheel_->schedule (delay);
+    retries_.insert (id, retry);
+    emit retryScheduled (proc, id);
+
+    appendNotice (
+                proc,
+                tr ("Retrying in %n second(s) (attempt %1 of %2)", "",
+                    static_cast<int>((delay + 999) / 1000))
+                .arg (retry.attempt_)
+                .arg (proc->policy_.retries_ + 1));
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The silence check is rescheduled for the rest of the allowed time
+ * when output came since it was armed.
+ */
+void ProcRunGui::wheelExpired (quint64 id)
+{
+    if (retries_.contains (id)) {
+        PendingRetry retry = retries_.take (id);
+        PrgProcess * proc = runProgram (
+                    retry.data_, retry.kb_, retry.user_data_, retry.attempt_,
+                    retry.s_settings_key_);
+        if (proc != NULL) {
+            emit retryStarted (id, proc);
+        }
+        return;
+    }
+
+    PrgProcess * proc = watched_.take (id);
+    if ((proc == NULL) || !proc->isRunning ())
+        return;
+
+    if (id == proc->deadline_id_) {
+        proc->deadline_id_ = 0;
+        proc->b_timed_out_ = true;
+        appendNotice (proc, tr ("Still running after %n second(s); terminating",
+                                "", proc->policy_.timeout_s_));
+        proc->terminateTree (kill_timeout_);
+    } else if (id == proc->idle_id_) {
+        qint64 allowed = proc->policy_.idle_s_ * Q_INT64_C(1000);
+        qint64 quiet = wheel_->now () - proc->last_output_ms_;
+        if (quiet < allowed) {
+            proc->idle_id_ = wheel_->schedule (allowed - quiet);
+            watched_.insert (proc->idle_id_, proc);
+        } else {
+            proc->idle_id_ = 0;
+            proc->b_timed_out_ = true;
+            appendNotice (proc, tr ("No output for %n second(s); terminating",
+                                    "", proc->policy_.idle_s_));
+            proc->terminateTree (kill_timeout_);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The default name is "procrungui"; the socket is then placed in the
+ * temporary directory.
+ */
+bool ProcRunGui::listen (const QString & s_name)
+{
+    if (server_ == NULL) {
+        server_ = new ProcRunServer (this);
+        connect (this, &ProcRunGui::processOutput,
+                 server_, &ProcRunServer::processOutput);
+        connect (this, &ProcRunGui::processFinished,
+                 server_, &ProcRunServer::processFinished);
+        connect (this, &ProcRunGui::processRemoved,
+                 server_, &ProcRunServer::processRemoved);
+    }
+    return server_->listen (
+                s_name.isEmpty () ? QString (QLatin1String ("procrungui")) : s_name);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::stopListening ()
+{
+    if (server_ != NULL) {
+        server_->close ();
+    }
+}
+/* ========================================================================= */
+
+int ProcRunGui::programIndex (PrgProcess *prg)
+{
+    return processes_.indexOf (prg);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+PrgProcess * ProcRunGui::program (int idx)
+{
+    return processes_.at (idx);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcRunGui::pendingTimers () const
+{
+    return wheel_->count ();
+}
+/* ========================================================================= */
+
+#define STG_TOP_CONTAINER "ProcRunGui"
+#define STG_CONTAINER "Container"
+#define STG_VAL_TYPE "EntryType"
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::loadCommands(const QString &s_file)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+        // Default to a file in application data directory.
+        QString s_input = s_file;
+        if (s_file.isEmpty()) {
+            s_input = defaultDataFile ();
+            if (s_file.isEmpty()) {
+                break;
+            }
+        }
+
+        // Make sure the file exists.
+        if (!QFile (s_input).exists ()) {
+            PROCRUNGUI_DEBUGM("Input file %s does not exists\n", TMP_A(s_input));
+            break;
+        }
+        PROCRUNGUI_DEBUGM("ProcRunGui loads commands from file %s\n",
+                          TMP_A(s_input));
+
+        // Load the file using settings
+        QSettings stg (s_input, QSettings::IniFormat);
+
+        b_ret = loadCommands (stg);
+        break;
+    }
+
+    PROCRUNGUI_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::loadCommands (QSettings & stg)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+
+        ProcRunModel * mdl = new ProcRunModel (this);
+        b_ret = mdl->load (stg);
+        setCmdModel (mdl);
+
+        break;
+    }
+    PROCRUNGUI_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setCmdModel (ProcRunModel * mdl)
+{
+    if (cmdmodl_ != NULL) {
+        delete cmdmodl_;
+    }
+    cmdmodl_ = mdl;
+    ui->treeView->setModel (cmdmodl_);
+    connect (ui->treeView->selectionModel(), &QItemSelectionModel::currentRowChanged,
+             this, &ProcRunGui::treeviewSelectionChanged);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunItemBase *ProcRunGui::selectedCmdEntry ()
+{
+    ProcRunItemBase * result = NULL;
+    QItemSelectionModel * slc = ui->treeView->selectionModel ();
+    if (slc != NULL) {
+        QModelIndex mi = slc->currentIndex();
+        if (mi.isValid()) {
+            result = cmdmodl_->itemFromIndex (mi);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::saveCommands(const QString &s_file)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+        // Default to a file in application data directory.
+        QString s_input = s_file;
+        if (s_file.isEmpty()) {
+            s_input = defaultDataFile ();
+            if (s_file.isEmpty()) {
+                break;
+            }
+        }
+
+        PROCRUNGUI_DEBUGM("ProcRunGui saves commands to file %s\n",
+                          TMP_A(s_input));
+
+        // Load the file using settings
+        QSettings stg (s_input, QSettings::IniFormat);
+
+        b_ret = saveCommands (stg);
+
+        break;
+    }
+    PROCRUNGUI_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::saveCommands(QSettings &s_data)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    bool b_ret = false;
+    if (cmdmodl_ != NULL) {
+        b_ret = cmdmodl_->save (s_data);
+    }
+    PROCRUNGUI_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If processes are still running the user is asked once; all of them
+ * are then signaled together and the close event is ignored until
+ * ProcShutdown reports that they were reaped (or that the deadline
+ * passed). Only then aboutToClose () is emitted and the widget closes.
+ */
+void ProcRunGui::closeEvent (QCloseEvent * ev)
+{
+    // already waiting for processes to end
+    if (shutdown_ != NULL) {
+        ev->ignore ();
+        return;
+    }
+
+    if (!b_shutdown_done_) {
+        saveCommands ();
+
+        QList<PrgProcess*> running;
+        foreach(PrgProcess * proc, processes_) {
+            if (proc->isRunning ()) {
+                running.append (proc);
+            }
+        }
+
+        if (!running.isEmpty ()) {
+            int res = QMessageBox::question (
+                        this,
+                        tr("Terminate processes?"),
+                        tr("%n process(es) still running.\n"
+                           "Are you sure you want to terminate them "
+                           "and close?", "", running.count ()),
+                        QMessageBox::Yes, QMessageBox::Cancel);
+            if (res != QMessageBox::Yes) {
+                ev->ignore ();
+                return;
+            }
+
+            // nothing new may start while we wait; the question ran an
+            // event loop, so look at what runs again
+            foreach(quint64 id, retries_.keys ()) {
+                wheel_->cancel (id);
+            }
+            retries_.clear ();
+            foreach(ProcRunBatch * batch, batches_) {
+                batch->stop ();
+            }
+            stopListening ();
+            running.clear ();
+            foreach(PrgProcess * proc, processes_) {
+                if (proc->isRunning ()) {
+                    running.append (proc);
+                }
+            }
+
+            // give each tree the chance to exit gracefully, then some
+            int deadline = (kill_timeout_ >= 0 ? kill_timeout_ : 10000) + 2000;
+            shutdown_ = new ProcShutdown (running, kill_timeout_, deadline, this);
+
+            shutdown_dlg_ = new QProgressDialog (
+                        tr ("Waiting for processes to end..."),
+                        tr ("Close now"), 0, running.count (), this);
+            shutdown_dlg_->setWindowModality (Qt::WindowModal);
+            shutdown_dlg_->setMinimumDuration (500);
+            connect (shutdown_dlg_, &QProgressDialog::canceled,
+                     shutdown_, &ProcShutdown::forceNow);
+
+            connect (shutdown_, &ProcShutdown::progress,
+                     this, &ProcRunGui::shutdownProgress);
+            connect (shutdown_, &ProcShutdown::finished,
+                     this, &ProcRunGui::shutdownFinished,
+                     Qt::QueuedConnection);
+            shutdown_->start ();
+
+            ev->ignore ();
+            return;
+        }
+    }
+
+    emit aboutToClose ();
+
+    // tabs go away with the processes; don't look at them in between
+    ui->outputView->setOutput (NULL);
+    ui->tabWidget->blockSignals (true);
+    if (board_ != NULL) {
+        ui->dashboardView->selectionModel ()->blockSignals (true);
+    }
+    QList<OutputWindow*> windows = outputWindows ();
+    foreach(quint64 id, retries_.keys ()) {
+        wheel_->cancel (id);
+    }
+    retries_.clear ();
+    foreach(PrgProcess * proc, processes_) {
+        disarmPolicy (proc);
+        emit processRemoved (proc);
+        foreach(OutputWindow * wnd, windows) {
+            wnd->removeOutput (&proc->output_);
+        }
+    }
+    qDeleteAll (processes_);
+    processes_.clear ();
+    ui->tabWidget->blockSignals (false);
+    if (board_ != NULL) {
+        ui->dashboardView->selectionModel ()->blockSignals (false);
+    }
+
+    ev->accept ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::shutdownProgress (int done, int total)
+{
+    if (shutdown_dlg_ == NULL)
+        return;
+    shutdown_dlg_->setMaximum (total);
+    shutdown_dlg_->setValue (done);
+    shutdown_dlg_->setLabelText (
+                tr ("Waiting for %n process(es) to end...", "", total - done));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::shutdownFinished (bool b_all_reaped)
+{
+    if (!b_all_reaped) {
+        PROCRUNGUI_DEBUGM("Closing with %d processes not reaped\n",
+                          shutdown_->remaining ());
+    }
+
+    shutdown_->deleteLater ();
+    shutdown_ = NULL;
+    if (shutdown_dlg_ != NULL) {
+        shutdown_dlg_->deleteLater ();
+        shutdown_dlg_ = NULL;
+    }
+
+    b_shutdown_done_ = true;
+    close ();
+}
+/* ========================================================================= */
+
+//! Counters are exported to the metrics file every ten seconds.
+#define METRICS_EXPORT_TICKS 100
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The timer asks for a tick every 100 ms; anything beyond that is time
+ * the event loop spent on something else and is recorded as its lag.
+ */
+void ProcRunGui::timerEvent (QTimerEvent *)
+{
+    int cnt = processes_.count () - 1;
+    QIcon ic (running_mov_.currentPixmap());
+    ProcMetrics::global ().setLoopLag (tick_clock_.restart () - 100);
+    // memory usage is sampled once a second
+    bool b_sample = (++timer_ticks_ % 10) == 0;
+    for (int i = cnt; i >= 0; --i) {
+        PrgProcess * proc = processes_.at (i);
+        if (proc->isRunning ()) {
+            if (proc->widget_ != NULL) {
+                assert(ui->tabWidget->widget(i) == proc->widget_);
+                ui->tabWidget->setTabIcon (i, ic);
+            }
+            if (b_sample) {
+                proc->sampleResources ();
+                if (proc->log_ != NULL) {
+                    proc->log_->write (proc->output_, false);
+                }
+            }
+        }
+    }
+    if (!batches_.isEmpty ()) {
+        updateBatchProgress ();
+    }
+    if (b_sample && !dashboard_.isNull ()) {
+        dashboard_->refresh ();
+    }
+    if (b_sample && (board_ != NULL)) {
+        board_->refresh ();
+    }
+    if (b_sample && !counters_view_.isNull ()) {
+        int pos = counters_view_->verticalScrollBar ()->value ();
+        counters_view_->setPlainText (metricsText ());
+        counters_view_->verticalScrollBar ()->setValue (pos);
+    }
+    if (((timer_ticks_ % METRICS_EXPORT_TICKS) == 0) &&
+            !s_metrics_file_.isEmpty ()) {
+        writeMetrics (s_metrics_file_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The process already placed the data in its output.
+ */
+void ProcRunGui::processGeneratedText (
+        PrgProcess * proc, ProcOutput::Channel channel)
+{
+    Q_UNUSED(channel);
+    proc->last_output_ms_ = wheel_->now ();
+    if ((proc->progress_bar_ != NULL) && proc->filter_->takeProgressChanged ()) {
+        proc->progress_bar_->setValue (proc->filter_->progress ());
+    }
+    outputChanged (proc);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::appendNotice (PrgProcess * proc, const QString & s_text)
+{
+    proc->output_.appendNotice (s_text);
+    outputChanged (proc);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::outputChanged (PrgProcess * proc)
+{
+    if (ui->outputView->output () == &proc->output_) {
+        ui->outputView->outputChanged ();
+    }
+    foreach(OutputWindow * wnd, outputWindows ()) {
+        wnd->outputChanged (&proc->output_);
+    }
+    emit processOutput (proc);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::finishProcess (PrgProcess *proc)
+{
+    ProcMetrics::global ().processes_ended_.fetchAndAddRelaxed (1);
+    disarmPolicy (proc);
+    if (proc->b_started_ && !proc->b_from_cache_) {
+        ProcRunRecord rec;
+        rec.s_key_ = proc->s_settings_key_;
+        rec.s_program_ = proc->data_.s_program_;
+        rec.start_ms_ = proc->start_time_.toMSecsSinceEpoch ();
+        rec.end_ms_ = proc->end_time_.toMSecsSinceEpoch ();
+        rec.exit_code_ = proc->exit_code_;
+        rec.b_crashed_ = proc->b_crashed_;
+        rec.peak_rss_ = proc->peak_rss_;
+        rec.output_size_ = proc->output_size_;
+        history_.append (rec);
+    }
+    if (!proc->s_cache_key_.isEmpty ()) {
+        storeResult (proc);
+    }
+    if (proc->log_ != NULL) {
+        proc->log_->write (proc->output_, true);
+        proc->log_->close ();
+        session_.finish (proc->session_id_, proc->exit_code_, proc->b_crashed_,
+                         proc->end_time_.toMSecsSinceEpoch ());
+    }
+
+    if (!proc->survivors_.isEmpty ()) {
+        QStringList sl_pids;
+        foreach(qint64 pid, proc->survivors_) {
+            sl_pids.append (QString::number (pid));
+        }
+        PROCRUNGUI_DEBUGM("%d processes survived %s and were killed: %s\n",
+                          proc->survivors_.count (),
+                          TMP_A(proc->data_.s_program_),
+                          TMP_A(sl_pids.join (QLatin1String (", "))));
+        appendNotice (
+                    proc,
+                    tr ("%n process(es) outlived the program and "
+                        "were killed: %1", "",
+                        proc->survivors_.count ())
+                    .arg (sl_pids.join (QLatin1String (", "))));
+    }
+
+    // lines without a final new line were completed
+    outputChanged (proc);
+    emit processFinished (proc);
+
+    // tabs are kept while shutting down; all go away at once
+    if (shutdown_ != NULL) {
+        return;
+    }
+
+    if (autoclose_finished_ || proc->close_on_exit_) {
+        processDone (proc);
+    } else {
+        proc->packOutput ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only runs that ended on their own are kept; ones that crashed, were
+ * terminated or timed out say nothing about the inputs.
+ */
+void ProcRunGui::storeResult (PrgProcess * proc)
+{
+    if (!proc->b_started_ || proc->b_crashed_ || proc->b_signaled_ ||
+            proc->b_timed_out_ || (proc->output_size_ > ResultCache::MAX_OUTPUT))
+        return;
+
+    ResultCache::Entry entry;
+    entry.exit_code_ = proc->exit_code_;
+    entry.duration_ms_ = proc->start_time_.msecsTo (proc->end_time_);
+    const ProcOutput & output = proc->output_;
+    for (int i = 0; i < output.lineCount (); ++i) {
+        const ProcOutput::Line & ln = output.line (i);
+        if (ln.channel_ == ProcOutput::Notice)
+            continue;
+        // consecutive lines of a channel go in a single record
+        if (entry.records_.isEmpty () ||
+                (entry.records_.last ().channel_ != ln.channel_)) {
+            ResultCache::Record rec;
+            rec.channel_ = ln.channel_;
+            entry.records_.append (rec);
+        }
+        QByteArray & data = entry.records_.last ().data_;
+        for (int r = output.repeats (i); r >= 0; --r) {
+            data.append (output.lineData (ln), ln.size_);
+            data.append ('\n');
+        }
+    }
+    cache_.store (proc->s_cache_key_, entry);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A process that can't be recorded simply runs without a log.
+ */
+void ProcRunGui::startSessionLog (PrgProcess * proc)
+{
+    int id = session_.add (proc->data_, QDateTime::currentMSecsSinceEpoch ());
+    if (id == -1)
+        return;
+    proc->session_id_ = id;
+    proc->log_ = new OutputLog ();
+    if (!proc->log_->open (session_.logBase (id))) {
+        delete proc->log_;
+        proc->log_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Processes that are already running are not recorded.
+ */
+void ProcRunGui::setKeepSession (bool value)
+{
+    if (value && !session_.isOpen () && !session_.open ()) {
+        value = false;
+    }
+    b_keep_session_ = value;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The restored processes are not started again; they look like they
+ * just ended, with the exit code and times they had. Processes that were
+ * still running when the session ended are shown as crashed. Processes
+ * that already have a tab are skipped, so calling this twice is harmless.
+ */
+int ProcRunGui::restoreSession ()
+{
+    if (!session_.isOpen () && !session_.open ())
+        return 0;
+
+    int result = 0;
+    b_restoring_ = true;
+    foreach(const ProcSession::Item & item, session_.items ()) {
+        bool b_shown = false;
+        foreach(PrgProcess * proc, processes_) {
+            if (proc->session_id_ == item.id_) {
+                b_shown = true;
+                break;
+            }
+        }
+        if (b_shown)
+            continue;
+
+        PrgProcess * proc = createProcess (item.data_, NULL, NULL, 1);
+        proc->session_id_ = item.id_;
+        proc->restore (item, session_.logBase (item.id_));
+        if (item.b_running_) {
+            proc->output_.appendNotice (
+                        tr ("The program was still running when the "
+                            "session ended; the output may be incomplete"));
+        }
+        outputChanged (proc);
+        ++result;
+    }
+    b_restoring_ = false;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::processDone (PrgProcess *proc, int idx)
+{
+    if (idx == -1) {
+        idx = programIndex (proc);
+        if (idx == -1)
+            return;
+    } else if (proc == NULL) {
+        proc = processes_.at (idx);
+    }
+
+    if (proc->widget_ != NULL) {
+        assert(ui->tabWidget->widget(idx) == proc->widget_);
+        ui->tabWidget->removeTab (idx);
+    }
+    disarmPolicy (proc);
+    if (proc->session_id_ != -1) {
+        delete proc->log_;
+        proc->log_ = NULL;
+        session_.remove (proc->session_id_);
+    }
+    emit processRemoved (proc);
+    foreach(OutputWindow * wnd, outputWindows ()) {
+        wnd->removeOutput (&proc->output_);
+    }
+    // the caller (maybe a slot of the process itself) may still use it
+    proc->deleteLater ();
+    processes_.removeAt (idx);
+
+    if (processes_.isEmpty() && close_on_last_) {
+        close ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_tabWidget_currentChanged (int index)
+{
+    if (index == -1) {
+        ui->outputView->setOutput (NULL);
+    } else {
+        PrgProcess * prc = program (index);
+        assert(ui->tabWidget->widget (index) == prc->widget_);
+        ui->outputView->setOutput (&prc->output_);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::on_tabWidget_tabCloseRequested (int index)
+{
+    PrgProcess * prc = program (index);
+    assert((prc->widget_ == NULL) ||
+           (ui->tabWidget->widget (index) == prc->widget_));
+
+    if (prc->isRunning ()) {
+        int res = QMessageBox::question (
+                    this,
+                    tr("Terminate process?"),
+                    tr("Are you sure you want to kill the process?\n"
+                       "The process is given no chance to exit gracefully "
+                       "and unsaved data may be lost."),
+                    QMessageBox::Yes, QMessageBox::Cancel);
+        if (res == QMessageBox::Yes) {
+            prc->close_on_exit_ = true;
+            prc->killTree ();
+        } else {
+            return false;
+        }
+    } else {
+        processDone (prc, index);
+    }
+
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_buttonBox_clicked (QAbstractButton *button)
+{
+    if (ui->buttonBox->button (QDialogButtonBox::Reset) == button) {
+        item_in_form_ = NULL;
+        ui->procDataWidget->clearProgForm ();
+    } else if (ui->buttonBox->button (QDialogButtonBox::Save) == button) {
+        saveProgramForm ();
+    } else if (ui->buttonBox->button (QDialogButtonBox::Ok) == button) {
+        ui->stackedWidget->setCurrentIndex (0);
+    } else if (ui->buttonBox->button (QDialogButtonBox::Cancel) == button) {
+        ui->stackedWidget->setCurrentIndex (0);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_runButton_clicked()
+{
+    ui->stackedWidget->setCurrentIndex (1);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::saveProgramForm ()
+{
+    if (cmdmodl_ == NULL) {
+        setCmdModel (new ProcRunModel (this));
+    }
+
+    if (item_in_form_ == NULL) {
+        item_in_form_ = new ProcRunItem ();
+        ProcRunGroup * gr = NULL;
+        int index = -1;
+        QItemSelectionModel * slc = ui->treeView->selectionModel ();
+        if (slc != NULL) {
+            QModelIndex mi = slc->currentIndex();
+            if (mi.isValid()) {
+                ProcRunItemBase * crtit = cmdmodl_->itemFromIndex (mi);
+                if (crtit->type () == ProcRunItemBase::CommandType) {
+                    gr = crtit->parent ();
+                    index = gr->indexOf (crtit) + 1;
+                } else if (crtit->type () == ProcRunItemBase::GroupType) {
+                    gr = static_cast<ProcRunGroup*> (crtit);
+                }
+            }
+        }
+        cmdmodl_->insertItem (item_in_form_, index, gr);
+    }
+    ProcRunData old_data = *item_in_form_;
+    ui->procDataWidget->getData (*item_in_form_);
+    cmdmodl_->itemChanged (item_in_form_);
+
+    // the options follow the command when it changes
+    setOutputFilter (old_data, OutputFilterConfig ());
+    setLaunchProfile (old_data, LaunchProfile ());
+    setRunPolicy (old_data, RunPolicy ());
+    setCommandTemplate (old_data, CommandTemplate ());
+    setCacheConfig (old_data, CacheConfig ());
+    setOutputFilter (*item_in_form_, ui->procDataWidget->outputFilter ());
+    setLaunchProfile (*item_in_form_, ui->procDataWidget->launchProfile ());
+    setRunPolicy (*item_in_form_, ui->procDataWidget->runPolicy ());
+    setCommandTemplate (*item_in_form_, ui->procDataWidget->commandTemplate ());
+    setCacheConfig (*item_in_form_, ui->procDataWidget->cacheConfig ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::loadProgramForm (ProcRunItem * item)
+{
+    if (item == NULL)
+        return;
+    if (item_in_form_ == item)
+        return;
+    ui->procDataWidget->clearProgForm ();
+    ui->procDataWidget->setCachedData (*item, true);
+    ui->procDataWidget->setOutputFilter (outputFilter (*item));
+    ui->procDataWidget->setLaunchProfile (launchProfile (*item));
+    ui->procDataWidget->setRunPolicy (runPolicy (*item));
+    ui->procDataWidget->setCommandTemplate (commandTemplate (*item));
+    ui->procDataWidget->setCacheConfig (cacheConfig (*item));
+
+    item_in_form_ = item;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_terminateButton_clicked()
+{
+    int index = currentProgramIndex ();
+    if (index == -1)
+        return;
+    PrgProcess * prc = program (index);
+
+    if (prc->isRunning ()) {
+        prc->close_on_exit_ = true;
+        prc->terminateTree (kill_timeout_);
+    } else {
+        processDone (prc, index);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_killButton_clicked()
+{
+    int index = currentProgramIndex ();
+    if (index != -1) {
+        on_tabWidget_tabCloseRequested (index);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::addNewGroup ()
+{
+    if (cmdmodl_ == NULL) {
+        setCmdModel (new ProcRunModel (this));
+    }
+
+    ProcRunGroup * item = new ProcRunGroup (
+                tr ("New group"));
+    ProcRunGroup * gr = NULL;
+    int index = -1;
+    QItemSelectionModel * slc = ui->treeView->selectionModel ();
+    if (slc != NULL) {
+        QModelIndex mi = slc->currentIndex();
+        if (mi.isValid()) {
+            ProcRunItemBase * crtit = cmdmodl_->itemFromIndex (mi);
+            if (crtit->type () == ProcRunItemBase::CommandType) {
+                gr = crtit->parent ();
+                index = gr->indexOf (crtit) + 1;
+            } else if (crtit->type () == ProcRunItemBase::GroupType) {
+                gr = static_cast<ProcRunGroup*> (crtit);
+            }
+        }
+    }
+    cmdmodl_->insertItem (item, index, gr);
+
+    ui->treeView->edit (cmdmodl_->indexFromItem (item));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_treeView_customContextMenuRequested (const QPoint &pos)
+{
+    QMenu mnu;
+    QAction act_new_folder (
+                qApp->style()->standardIcon (QStyle::SP_DirIcon),
+                tr("Add new group"), this);
+    mnu.addAction (&act_new_folder);
+    QAction act_remove (
+                qApp->style()->standardIcon (QStyle::SP_BrowserStop),
+                tr("Delete"), this);
+    mnu.addAction (&act_remove);
+    mnu.addSeparator ();
+
+    ProcRunItemBase * crtit = selectedCmdEntry ();
+    bool b_has_sel = (crtit != NULL);
+    bool b_is_group = b_has_sel &&
+            (crtit->type () == ProcRunItemBase::GroupType);
+    bool b_is_pipeline = b_is_group &&
+            isPipelineGroup (ui->treeView->selectionModel ()->currentIndex ());
+
+    // a command is run by itself, a group as a batch
+    QAction act_run (
+                qApp->style()->standardIcon (QStyle::SP_MediaPlay),
+                tr("Run"), this);
+    act_run.setEnabled (b_has_sel && !b_is_group);
+    mnu.addAction (&act_run);
+    QAction act_run_group (
+                qApp->style()->standardIcon (QStyle::SP_MediaSeekForward),
+                b_is_pipeline ?
+                    tr("Run group as pipeline") :
+                    tr("Run group in parallel"), this);
+    act_run_group.setEnabled (b_is_group);
+    mnu.addAction (&act_run_group);
+    QAction act_run_seq (
+                qApp->style()->standardIcon (QStyle::SP_MediaSkipForward),
+                tr("Run sequentially"), this);
+    act_run_seq.setEnabled (b_has_sel);
+    mnu.addAction (&act_run_seq);
+    QAction act_run_pipe (tr("Run as pipeline"), this);
+    act_run_pipe.setEnabled (b_has_sel);
+    mnu.addAction (&act_run_pipe);
+    QAction act_pipeline (tr("Group is a pipeline"), this);
+    act_pipeline.setCheckable (true);
+    act_pipeline.setEnabled (b_is_group);
+    act_pipeline.setChecked (b_is_pipeline);
+    mnu.addAction (&act_pipeline);
+    QAction act_fan_out (tr("Fan out"), this);
+    act_fan_out.setEnabled (
+                b_has_sel && (crtit->type () == ProcRunItemBase::CommandType) &&
+                !commandTemplate (*static_cast<ProcRunItem*>(crtit)).isEmpty ());
+    mnu.addAction (&act_fan_out);
+    mnu.addSeparator ();
+    QAction act_stats (
+                qApp->style()->standardIcon (QStyle::SP_FileDialogInfoView),
+                tr("Statistics..."), this);
+    mnu.addAction (&act_stats);
+
+    QAction * result = mnu.exec (ui->treeView->viewport()->mapToGlobal (pos));
+    if (result == &act_new_folder) {
+        addNewGroup ();
+    } else if (result == &act_remove) {
+        removeItem (selectedCmdEntry ());
+    } else if (result == &act_run) {
+        runSelected ();
+    } else if (result == &act_run_group) {
+        runSelectedGroup ();
+    } else if (result == &act_run_seq) {
+        runSelectedSequentially ();
+    } else if (result == &act_run_pipe) {
+        runSelectedAsPipeline ();
+    } else if (result == &act_pipeline) {
+        setPipelineGroup (ui->treeView->selectionModel ()->currentIndex (),
+                          act_pipeline.isChecked ());
+    } else if (result == &act_fan_out) {
+        fanOutSelected ();
+    } else if (result == &act_stats) {
+        showStatistics ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::removeItem (ProcRunItemBase * item)
+{
+    if (item == NULL)
+        return;
+    if (cmdmodl_ == NULL) {
+        return;
+    }
+
+    int res = QMessageBox::question (
+                this,
+                tr("Delete saved command?"),
+                tr("Are you sure you want to delete this entry?\n"
+                   "Once deleted you will have no way to undo\n"
+                   "this operation."),
+                QMessageBox::Yes, QMessageBox::Cancel);
+    if (res == QMessageBox::Yes) {
+        cmdmodl_->removeItem (item);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::treeviewSelectionChanged (
+        const QModelIndex &current, const QModelIndex &)
+{
+    if (!current.isValid()) {
+        return;
+    }
+    if (cmdmodl_ == NULL) {
+        setCmdModel (new ProcRunModel (this));
+    }
+    ProcRunItemBase * it = cmdmodl_->itemFromIndex (current);
+    if (it == NULL) {
+        return;
+    }
+
+    if (it->type () == ProcRunItemBase::CommandType) {
+        loadProgramForm (static_cast<ProcRunItem*>(it));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::collectCommands (
+        const QModelIndex & mi, QList<ProcRunData> & result,
+        QList<ProcRunItemBase*> & seen)
+{
+    ProcRunItemBase * it = cmdmodl_->itemFromIndex (mi);
+    if ((it == NULL) || seen.contains (it)) {
+        return;
+    }
+    seen.append (it);
+
+    if (it->type () == ProcRunItemBase::CommandType) {
+        result.append (*static_cast<ProcRunItem*>(it));
+    } else if (it->type () == ProcRunItemBase::GroupType) {
+        int i_max = cmdmodl_->rowCount (mi);
+        for (int i = 0; i < i_max; ++i) {
+            collectCommands (cmdmodl_->index (i, 0, mi), result, seen);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<ProcRunData> ProcRunGui::selectedCommands ()
+{
+    QList<ProcRunData> result;
+    QItemSelectionModel * slc = ui->treeView->selectionModel ();
+    if ((slc == NULL) || (cmdmodl_ == NULL)) {
+        return result;
+    }
+
+    QModelIndexList sel = slc->selectedRows ();
+    if (sel.isEmpty () && slc->currentIndex ().isValid ()) {
+        sel.append (slc->currentIndex ());
+    }
+
+    QList<ProcRunItemBase*> seen;
+    foreach(const QModelIndex & mi, sel) {
+        collectCommands (mi, result, seen);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Groups are known by the names on the path from the root, so renaming
+ * a group or one of its parents drops the mark.
+ */
+QString ProcRunGui::groupKey (const QModelIndex & mi) const
+{
+    QStringList sl_path;
+    for (QModelIndex iter = mi; iter.isValid (); iter = iter.parent ()) {
+        sl_path.prepend (iter.data (Qt::DisplayRole).toString ());
+    }
+    QCryptographicHash hsh (QCryptographicHash::Sha1);
+    hsh.addData (sl_path.join (QChar ('/')).toUtf8 ());
+    return QString::fromLatin1 (hsh.result ().toHex ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunGui::isPipelineGroup (const QModelIndex & mi) const
+{
+    QString s_file = optionsFile ();
+    if (!mi.isValid () || s_file.isEmpty ())
+        return false;
+    QSettings stg (s_file, QSettings::IniFormat);
+    stg.beginGroup (QLatin1String (STG_PIPELINE_GROUP));
+    return stg.value (groupKey (mi), false).toBool ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::setPipelineGroup (const QModelIndex & mi, bool b_pipeline)
+{
+    QString s_file = optionsFile ();
+    if (!mi.isValid () || s_file.isEmpty ())
+        return;
+    QSettings stg (s_file, QSettings::IniFormat);
+    stg.beginGroup (QLatin1String (STG_PIPELINE_GROUP));
+    if (b_pipeline) {
+        stg.setValue (groupKey (mi), true);
+    } else {
+        stg.remove (groupKey (mi));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A template command is fanned out; any other command gets a tab of
+ * its own, without a batch.
+ */
+void ProcRunGui::runSelected ()
+{
+    ProcRunItemBase * crtit = selectedCmdEntry ();
+    if ((crtit == NULL) || (crtit->type () != ProcRunItemBase::CommandType))
+        return;
+    ProcRunItem * item = static_cast<ProcRunItem*>(crtit);
+    if (!commandTemplate (*item).isEmpty ()) {
+        fanOutSelected ();
+        return;
+    }
+    ui->stackedWidget->setCurrentIndex (0);
+    runProgram (*item);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A group marked as a pipeline is run as one.
+ */
+void ProcRunGui::runSelectedGroup ()
+{
+    QItemSelectionModel * slc = ui->treeView->selectionModel ();
+    if ((slc != NULL) && isPipelineGroup (slc->currentIndex ())) {
+        runSelectedAsPipeline ();
+        return;
+    }
+
+    QList<ProcRunData> jobs = selectedCommands ();
+    if (jobs.isEmpty ())
+        return;
+    ui->stackedWidget->setCurrentIndex (0);
+    runBatch (jobs, ProcRunBatch::Parallel);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::runSelectedSequentially ()
+{
+    QList<ProcRunData> jobs = selectedCommands ();
+    if (jobs.isEmpty ())
+        return;
+    ui->stackedWidget->setCurrentIndex (0);
+    runBatch (jobs, ProcRunBatch::Sequential);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::runSelectedAsPipeline ()
+{
+    QList<ProcRunData> jobs = selectedCommands ();
+    if (jobs.isEmpty ())
+        return;
+    ui->stackedWidget->setCurrentIndex (0);
+    runBatch (jobs, ProcRunBatch::Pipeline);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::fanOutSelected ()
+{
+    ProcRunItemBase * crtit = selectedCmdEntry ();
+    if ((crtit == NULL) || (crtit->type () != ProcRunItemBase::CommandType))
+        return;
+    ui->stackedWidget->setCurrentIndex (0);
+    if (fanOut (*static_cast<ProcRunItem*>(crtit)) == NULL) {
+        QMessageBox::warning (
+                    this, tr ("Fan out"),
+                    tr ("The values of the template matched nothing."));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::batchProgress ()
+{
+    updateBatchProgress ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::batchDone ()
+{
+    ProcRunBatch * batch = qobject_cast<ProcRunBatch*>(sender ());
+    if (batch == NULL)
+        return;
+    if (!batch->title ().isEmpty ()) {
+        showBatchSummary (batch);
+    }
+
+    // keep it around until no other batch is running so that
+    // the progress view keeps showing the totals
+    bool b_all_done = true;
+    foreach(ProcRunBatch * iter, batches_) {
+        if (!iter->isDone ()) {
+            b_all_done = false;
+            break;
+        }
+    }
+    updateBatchProgress ();
+    if (b_all_done) {
+        foreach(ProcRunBatch * iter, batches_) {
+            iter->deleteLater ();
+        }
+        batches_.clear ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The box is not modal, so batches that end while nobody looks
+ * do not stop the others.
+ */
+void ProcRunGui::showBatchSummary (ProcRunBatch * batch)
+{
+    int failed = batch->failedCount ();
+    QMessageBox * box = new QMessageBox (
+                failed == 0 ? QMessageBox::Information : QMessageBox::Warning,
+                batch->title (),
+                tr ("%1 succeeded, %2 failed, %3 in total.")
+                .arg (batch->count () - failed)
+                .arg (failed)
+                .arg (QTime (0, 0).addMSecs (
+                          static_cast<int>(batch->elapsed ())).toString (
+                          QLatin1String ("hh:mm:ss"))),
+                QMessageBox::Ok, this);
+    if (failed > 0) {
+        QStringList sl_failed;
+        foreach(const ProcRunData & data, batch->failedJobs ()) {
+            sl_failed.append (data.s_program_ + QChar (' ') +
+                              data.sl_arguments_.join (QChar (' ')));
+        }
+        box->setDetailedText (sl_failed.join (QChar ('\n')));
+    }
+    box->setAttribute (Qt::WA_DeleteOnClose);
+    box->setModal (false);
+    box->show ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::updateBatchProgress ()
+{
+    if (batches_.isEmpty ()) {
+        ui->batchWidget->hide ();
+        return;
+    }
+
+    int total = 0;
+    int finished = 0;
+    int failed = 0;
+    qint64 remaining = 0;
+    qint64 elapsed = 0;
+    foreach(ProcRunBatch * batch, batches_) {
+        total += batch->count ();
+        finished += batch->finishedCount ();
+        failed += batch->failedCount ();
+        elapsed = qMax (elapsed, batch->elapsed ());
+        if (remaining >= 0) {
+            qint64 batch_rem = batch->remainingEstimate ();
+            if (batch_rem < 0) {
+                remaining = -1;
+            } else {
+                // batches run side by side
+                remaining = qMax (remaining, batch_rem);
+            }
+        }
     }
-    s_result.append (s_suffix);
 
-    if (proc->widget_ == ui->tabWidget->currentWidget()) {
-        ui->plainTextEdit->appendHtml (s_result);
+    ui->batchProgressBar->setMaximum (total);
+    ui->batchProgressBar->setValue (finished);
+
+    QString s_eta;
+    if (finished == total) {
+        s_eta = tr ("done");
+    } else if (remaining < 0) {
+        s_eta = tr ("ETA unknown");
+    } else {
+        s_eta = tr ("ETA %1").arg (
+                    QTime (0, 0).addMSecs (
+                        static_cast<int>(remaining)).toString (
+                            QLatin1String ("hh:mm:ss")));
     }
 
-    return s_result;
+    qreal rate = elapsed > 0 ? (finished * 1000.0) / elapsed : 0.0;
+    ui->batchLabel->setText (
+                tr ("%1 of %2 done, %3 failed, %4 jobs/min, %5")
+                .arg (finished)
+                .arg (total)
+                .arg (failed)
+                .arg (rate * 60.0, 0, 'f', 1)
+                .arg (s_eta));
+    ui->batchWidget->show ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::finishProcess (PrgProcess *proc)
+void ProcRunGui::showStatistics ()
 {
-    if (autoclose_finished_ || proc->close_on_exit_) {
-        processDone (proc);
-    }
+    ProcRunStatsDlg dlg (cmdmodl_, history_, this);
+    dlg.exec ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::processDone (PrgProcess *proc, int idx)
+QList<OutputWindow*> ProcRunGui::outputWindows ()
 {
-    if (idx == -1) {
-        idx = programIndex (proc);
-        if (idx == -1)
-            return;
-    } else if (proc == NULL) {
-        proc = processes_.at (idx);
+    QList<OutputWindow*> result;
+    for (int i = windows_.count () - 1; i >= 0; --i) {
+        if (windows_.at (i).isNull ()) {
+            windows_.removeAt (i);
+        } else {
+            result.prepend (windows_.at (i).data ());
+        }
     }
+    return result;
+}
+/* ========================================================================= */
 
-    assert(ui->tabWidget->widget(idx) == proc->widget_);
-    ui->tabWidget->removeTab (idx);
-    delete proc;
-    processes_.removeAt (idx);
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::detachTab (int index)
+{
+    if ((index < 0) || (index >= processes_.count ()))
+        return;
 
-    if (processes_.isEmpty() && close_on_last_) {
-        close ();
-    }
+    PrgProcess * proc = processes_.at (index);
+    OutputWindow * wnd = new OutputWindow (this);
+    wnd->addOutput (&proc->output_, commandTitle (proc->data_));
+    windows_.append (wnd);
+    wnd->show ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_tabWidget_currentChanged (int index)
+void ProcRunGui::tileTab (int index)
 {
-    if (index == -1) {
-        ui->plainTextEdit->clear ();
-    } else {
-        PrgProcess * prc = program (index);
-        assert(ui->tabWidget->widget (index) == prc->widget_);
-        ui->plainTextEdit->clear ();
-        ui->plainTextEdit->appendHtml (prc->all_output_);
+    if ((index < 0) || (index >= processes_.count ()))
+        return;
+
+    if (tiled_.isNull ()) {
+        tiled_ = new OutputWindow (this);
+        windows_.append (tiled_);
     }
+
+    PrgProcess * proc = processes_.at (index);
+    tiled_->addOutput (&proc->output_, commandTitle (proc->data_));
+    tiled_->show ();
+    tiled_->raise ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-bool ProcRunGui::on_tabWidget_tabCloseRequested (int index)
+/**
+ * The index of a process in processes_ is the index of its tab, so the
+ * list follows the tabs the user drags around.
+ */
+void ProcRunGui::tabMoved (int from, int to)
 {
-    PrgProcess * prc = program (index);
-    assert(ui->tabWidget->widget (index) == prc->widget_);
+    processes_.move (from, to);
+    assert(ui->tabWidget->widget (to) == processes_.at (to)->widget_);
+}
+/* ========================================================================= */
 
-    if (prc->isRunning ()) {
-        int res = QMessageBox::question (
-                    this,
-                    tr("Terminate process?"),
-                    tr("Are you sure you want to kill the process?\n"
-                       "The process is given no chance to exit gracefully "
-                       "and unsaved data may be lost."),
-                    QMessageBox::Yes, QMessageBox::Cancel);
-        if (res == QMessageBox::Yes) {
-            prc->close_on_exit_ = true;
-            prc->kill ();
-        } else {
-            return false;
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::tabContextMenu (const QPoint & pos)
+{
+    QTabBar * tab_bar = ui->tabWidget->tabBar ();
+    int index = tab_bar->tabAt (pos);
+    if (index == -1)
+        return;
+    processMenu (index, tab_bar->mapToGlobal (pos));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::processMenu (int index, const QPoint & global_pos)
+{
+    QMenu mnu;
+    QAction act_detach (tr("Open in new window"), this);
+    mnu.addAction (&act_detach);
+    QAction act_tile (tr("Add to tiled window"), this);
+    mnu.addAction (&act_tile);
+    QAction act_tile_all (tr("Tile all"), this);
+    mnu.addAction (&act_tile_all);
+    mnu.addSeparator ();
+    QAction act_dashboard (tr("Dashboard"), this);
+    mnu.addAction (&act_dashboard);
+    QAction act_counters (tr("Counters"), this);
+    mnu.addAction (&act_counters);
+    mnu.addSeparator ();
+    QAction act_export (tr("Export output..."), this);
+    act_export.setEnabled (!processes_.at (index)->isRunning ());
+    mnu.addAction (&act_export);
+    QAction act_export_all (tr("Export all finished..."), this);
+    mnu.addAction (&act_export_all);
+
+    QAction * result = mnu.exec (global_pos);
+    if (result == &act_detach) {
+        detachTab (index);
+    } else if (result == &act_tile) {
+        tileTab (index);
+    } else if (result == &act_tile_all) {
+        for (int i = 0; i < processes_.count (); ++i) {
+            tileTab (i);
         }
-    } else {
-        processDone (prc, index);
+    } else if (result == &act_dashboard) {
+        showDashboard ();
+    } else if (result == &act_counters) {
+        showCounters ();
+    } else if (result == &act_export) {
+        exportOutput (index);
+    } else if (result == &act_export_all) {
+        exportOutput (-1);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The window owns the model; rows are refreshed from timerEvent ()
+ * right after the resources were sampled, as long as the window is open.
+ */
+void ProcRunGui::showDashboard ()
+{
+    if (!dashboard_.isNull ()) {
+        QWidget * wnd = qobject_cast<QWidget*> (dashboard_->parent ());
+        wnd->raise ();
+        wnd->activateWindow ();
+        return;
     }
 
-    return true;
+    QTableView * view = new QTableView (this);
+    view->setWindowFlags (Qt::Window);
+    view->setAttribute (Qt::WA_DeleteOnClose);
+    view->setWindowTitle (tr ("Processes"));
+    dashboard_ = new ProcDashboardModel (this, view);
+    view->setModel (dashboard_);
+    prepareDashboardView (view);
+    connect (view, &QTableView::doubleClicked,
+             this, &ProcRunGui::dashboardActivated);
+    view->resize (900, 480);
+    view->show ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_buttonBox_clicked (QAbstractButton *button)
+void ProcRunGui::dashboardActivated (const QModelIndex & index)
 {
-    if (ui->buttonBox->button (QDialogButtonBox::Reset) == button) {
-        item_in_form_ = NULL;
-        ui->procDataWidget->clearProgForm ();
-    } else if (ui->buttonBox->button (QDialogButtonBox::Save) == button) {
-        saveProgramForm ();
-    } else if (ui->buttonBox->button (QDialogButtonBox::Ok) == button) {
-        ui->stackedWidget->setCurrentIndex (0);
-    } else if (ui->buttonBox->button (QDialogButtonBox::Cancel) == button) {
-        ui->stackedWidget->setCurrentIndex (0);
+    if (dashboard_.isNull ())
+        return;
+    PrgProcess * proc = dashboard_->process (index.row ());
+    int tab = programIndex (proc);
+    if (tab == -1)
+        return;
+    if (board_ != NULL) {
+        ui->dashboardView->setCurrentIndex (
+                    board_->index (board_->row (proc), 0));
+    } else {
+        ui->tabWidget->setCurrentIndex (tab);
     }
+    raise ();
+    activateWindow ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_runButton_clicked()
+void ProcRunGui::prepareDashboardView (QTableView * view)
 {
-    ui->stackedWidget->setCurrentIndex (1);
+    view->setSelectionBehavior (QAbstractItemView::SelectRows);
+    view->setEditTriggers (QAbstractItemView::NoEditTriggers);
+    view->setWordWrap (false);
+    view->verticalHeader ()->setSectionResizeMode (QHeaderView::Fixed);
+    view->verticalHeader ()->setDefaultSectionSize (
+                view->fontMetrics ().height () + 6);
+    view->horizontalHeader ()->setStretchLastSection (true);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::saveProgramForm ()
+/**
+ * Switching drops the tabs (with their labels and progress bars) or
+ * creates them again for all processes; the process shown in the
+ * output view stays the same.
+ */
+void ProcRunGui::setDashboardMode (bool value)
 {
-    if (cmdmodl_ == NULL) {
-        setCmdModel (new ProcRunModel (this));
-    }
+    if (value == b_dashboard_mode_)
+        return;
 
-    if (item_in_form_ == NULL) {
-        item_in_form_ = new ProcRunItem ();
-        ProcRunGroup * gr = NULL;
-        int index = -1;
-        QItemSelectionModel * slc = ui->treeView->selectionModel ();
-        if (slc != NULL) {
-            QModelIndex mi = slc->currentIndex();
-            if (mi.isValid()) {
-                ProcRunItemBase * crtit = cmdmodl_->itemFromIndex (mi);
-                if (crtit->type () == ProcRunItemBase::CommandType) {
-                    gr = crtit->parent ();
-                    index = gr->indexOf (crtit) + 1;
-                } else if (crtit->type () == ProcRunItemBase::GroupType) {
-                    gr = static_cast<ProcRunGroup*> (crtit);
-                }
-            }
+    int current = currentProgramIndex ();
+    b_dashboard_mode_ = value;
+    ui->tabWidget->blockSignals (true);
+    if (value) {
+        foreach(PrgProcess * proc, processes_) {
+            // the tab bar owns the progress bar and drops it with the tab
+            proc->progress_bar_ = NULL;
+            delete proc->widget_;
+            proc->widget_ = NULL;
         }
-        cmdmodl_->insertItem (item_in_form_, index, gr);
+        ui->tabWidget->hide ();
+
+        board_ = new ProcDashboardModel (this, this);
+        ui->dashboardView->setModel (board_);
+        ui->dashboardView->setColumnWidth (ProcDashboardModel::ColProgram, 240);
+        connect (ui->dashboardView->selectionModel (),
+                 &QItemSelectionModel::currentRowChanged,
+                 this, &ProcRunGui::boardCurrentChanged);
+        if (current != -1) {
+            int row = board_->row (processes_.at (current));
+            ui->dashboardView->setCurrentIndex (board_->index (row, 0));
+        }
+        ui->dashboardView->show ();
+    } else {
+        ui->dashboardView->hide ();
+        ui->dashboardView->setModel (NULL);
+        delete board_;
+        board_ = NULL;
+
+        foreach(PrgProcess * proc, processes_) {
+            addTab (proc);
+        }
+        ui->tabWidget->setCurrentIndex (current);
+        ui->tabWidget->show ();
     }
-    ui->procDataWidget->getData (*item_in_form_);
-    cmdmodl_->itemChanged (item_in_form_);
+    ui->tabWidget->blockSignals (false);
+
+    ui->outputView->setOutput (
+                current == -1 ? NULL : &processes_.at (current)->output_);
+    ui->dashboardButton->setChecked (value);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::loadProgramForm (ProcRunItem * item)
+int ProcRunGui::currentProgramIndex ()
 {
-    if (item == NULL)
+    if (board_ == NULL)
+        return ui->tabWidget->currentIndex ();
+    QModelIndex mi = ui->dashboardView->currentIndex ();
+    if (!mi.isValid ())
+        return -1;
+    return programIndex (board_->process (mi.row ()));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_dashboardButton_toggled (bool b_checked)
+{
+    setDashboardMode (b_checked);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::on_dashboardView_customContextMenuRequested (
+        const QPoint & pos)
+{
+    if (board_ == NULL)
         return;
-    if (item_in_form_ == item)
+    QModelIndex mi = ui->dashboardView->indexAt (pos);
+    if (!mi.isValid ())
         return;
-    ui->procDataWidget->clearProgForm ();
-    ui->procDataWidget->setCachedData (*item, true);
-
-    item_in_form_ = item;
+    int index = programIndex (board_->process (mi.row ()));
+    if (index == -1)
+        return;
+    processMenu (index, ui->dashboardView->viewport ()->mapToGlobal (pos));
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_terminateButton_clicked()
+void ProcRunGui::on_dashboardView_doubleClicked (const QModelIndex & index)
 {
-    int index = ui->tabWidget->currentIndex();
-    PrgProcess * prc = program (index);
-    DBG_ASSERT(ui->tabWidget->widget (index) == prc->widget_);
+    if (board_ == NULL)
+        return;
+    detachTab (programIndex (board_->process (index.row ())));
+}
+/* ========================================================================= */
 
-    if (prc->isRunning ()) {
-        prc->close_on_exit_ = true;
-        prc->terminate ();
-    } else {
-        processDone (prc, index);
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::boardCurrentChanged (
+        const QModelIndex & current, const QModelIndex & previous)
+{
+    Q_UNUSED(previous);
+    PrgProcess * proc = NULL;
+    if (board_ != NULL) {
+        proc = board_->process (current.row ());
     }
+    ui->outputView->setOutput (proc == NULL ? NULL : &proc->output_);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_killButton_clicked()
+void ProcRunGui::showCounters ()
 {
-    on_tabWidget_tabCloseRequested (ui->tabWidget->currentIndex());
+    if (!counters_view_.isNull ()) {
+        counters_view_->raise ();
+        counters_view_->activateWindow ();
+        return;
+    }
+
+    counters_view_ = new QPlainTextEdit (this);
+    counters_view_->setWindowFlags (Qt::Window);
+    counters_view_->setAttribute (Qt::WA_DeleteOnClose);
+    counters_view_->setWindowTitle (tr ("Counters"));
+    counters_view_->setReadOnly (true);
+    counters_view_->setLineWrapMode (QPlainTextEdit::NoWrap);
+    counters_view_->setPlainText (metricsText ());
+    counters_view_->resize (700, 480);
+    counters_view_->show ();
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::addNewGroup ()
+/**
+ * Totals cover all processes that ever ran; the families named
+ * procrun_process_* have a sample for each process that is still
+ * around, labelled with its tab and program.
+ */
+QString ProcRunGui::metricsText ()
 {
-    if (cmdmodl_ == NULL) {
-        setCmdModel (new ProcRunModel (this));
+    ProcMetrics & m = ProcMetrics::global ();
+    const ProcCounters & t = m.totals_;
+    QString result;
+    QLatin1String s_out ("channel=\"stdout\"");
+    QLatin1String s_err ("channel=\"stderr\"");
+
+    ProcMetrics::appendFamily (
+                result, "procrun_read_bytes_total", "counter",
+                "Bytes read from the programs.");
+    ProcMetrics::appendSample (
+                result, "procrun_read_bytes_total", s_out,
+                t.read_bytes_[ProcOutput::StdOut].loadRelaxed ());
+    ProcMetrics::appendSample (
+                result, "procrun_read_bytes_total", s_err,
+                t.read_bytes_[ProcOutput::StdErr].loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_read_calls_total", "counter",
+                "Reads that returned data.");
+    ProcMetrics::appendSample (
+                result, "procrun_read_calls_total", QString (),
+                t.read_calls_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_dropped_bytes_total", "counter",
+                "Bytes filtered out, redrawn or erased.");
+    ProcMetrics::appendSample (
+                result, "procrun_dropped_bytes_total", QString (),
+                t.dropped_bytes_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_backlog_bytes", "gauge",
+                "Bytes that were waiting at the last read of each program.");
+    ProcMetrics::appendSample (
+                result, "procrun_backlog_bytes", QString (),
+                t.backlog_bytes_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_rendered_bytes_total", "counter",
+                "Bytes of output decoded for painting.");
+    ProcMetrics::appendSample (
+                result, "procrun_rendered_bytes_total", QString (),
+                m.rendered_bytes_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_event_loop_lag_milliseconds", "gauge",
+                "How late the last periodic timer fired.");
+    ProcMetrics::appendSample (
+                result, "procrun_event_loop_lag_milliseconds", QString (),
+                m.loop_lag_ms_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_event_loop_lag_max_milliseconds", "gauge",
+                "Largest event loop lag seen.");
+    ProcMetrics::appendSample (
+                result, "procrun_event_loop_lag_max_milliseconds", QString (),
+                m.max_loop_lag_ms_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_processes_started_total", "counter",
+                "Processes created.");
+    ProcMetrics::appendSample (
+                result, "procrun_processes_started_total", QString (),
+                m.processes_started_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_processes_ended_total", "counter",
+                "Processes that ended.");
+    ProcMetrics::appendSample (
+                result, "procrun_processes_ended_total", QString (),
+                m.processes_ended_.loadRelaxed ());
+    ProcMetrics::appendFamily (
+                result, "procrun_processes_destroyed_total", "counter",
+                "Processes that were deleted.");
+    ProcMetrics::appendSample (
+                result, "procrun_processes_destroyed_total", QString (),
+                m.processes_destroyed_.loadRelaxed ());
+
+    int running = 0;
+    QStringList sl_labels;
+    foreach(PrgProcess * proc, processes_) {
+        if (proc->isRunning ())
+            ++running;
+        sl_labels.append (QString (QLatin1String ("tab=\"%1\",program=%2"))
+                          .arg (sl_labels.count ())
+                          .arg (ProcMetrics::labelValue (
+                                    proc->data_.s_program_)));
     }
-
-    ProcRunGroup * item = new ProcRunGroup (
-                tr ("New group"));
-    ProcRunGroup * gr = NULL;
-    int index = -1;
-    QItemSelectionModel * slc = ui->treeView->selectionModel ();
-    if (slc != NULL) {
-        QModelIndex mi = slc->currentIndex();
-        if (mi.isValid()) {
-            ProcRunItemBase * crtit = cmdmodl_->itemFromIndex (mi);
-            if (crtit->type () == ProcRunItemBase::CommandType) {
-                gr = crtit->parent ();
-                index = gr->indexOf (crtit) + 1;
-            } else if (crtit->type () == ProcRunItemBase::GroupType) {
-                gr = static_cast<ProcRunGroup*> (crtit);
-            }
+    ProcMetrics::appendFamily (
+                result, "procrun_processes", "gauge",
+                "Processes that have a tab.");
+    ProcMetrics::appendSample (
+                result, "procrun_processes", QString (), processes_.count ());
+    ProcMetrics::appendFamily (
+                result, "procrun_processes_running", "gauge",
+                "Processes that are running.");
+    ProcMetrics::appendSample (
+                result, "procrun_processes_running", QString (), running);
+
+    if (processes_.isEmpty ())
+        return result;
+
+    ProcMetrics::appendFamily (
+                result, "procrun_process_read_bytes_total", "counter",
+                "Bytes read from a program.");
+    for (int i = 0; i < processes_.count (); ++i) {
+        const ProcCounters & c = processes_.at (i)->counters_;
+        ProcMetrics::appendSample (
+                    result, "procrun_process_read_bytes_total",
+                    sl_labels.at (i) + QChar (',') + s_out,
+                    c.read_bytes_[ProcOutput::StdOut].loadRelaxed ());
+        ProcMetrics::appendSample (
+                    result, "procrun_process_read_bytes_total",
+                    sl_labels.at (i) + QChar (',') + s_err,
+                    c.read_bytes_[ProcOutput::StdErr].loadRelaxed ());
+    }
+    ProcMetrics::appendFamily (
+                result, "procrun_process_read_calls_total", "counter",
+                "Reads from a program that returned data.");
+    for (int i = 0; i < processes_.count (); ++i) {
+        ProcMetrics::appendSample (
+                    result, "procrun_process_read_calls_total", sl_labels.at (i),
+                    processes_.at (i)->counters_.read_calls_.loadRelaxed ());
+    }
+    ProcMetrics::appendFamily (
+                result, "procrun_process_dropped_bytes_total", "counter",
+                "Bytes from a program that were not kept.");
+    for (int i = 0; i < processes_.count (); ++i) {
+        ProcMetrics::appendSample (
+                    result, "procrun_process_dropped_bytes_total", sl_labels.at (i),
+                    processes_.at (i)->counters_.dropped_bytes_.loadRelaxed ());
+    }
+    ProcMetrics::appendFamily (
+                result, "procrun_process_backlog_bytes", "gauge",
+                "Bytes that were waiting at the last read of a program.");
+    for (int i = 0; i < processes_.count (); ++i) {
+        ProcMetrics::appendSample (
+                    result, "procrun_process_backlog_bytes", sl_labels.at (i),
+                    processes_.at (i)->counters_.backlog_bytes_.loadRelaxed ());
+    }
+    ProcMetrics::appendFamily (
+                result, "procrun_process_resident_bytes", "gauge",
+                "Resident memory of a running program.");
+    for (int i = 0; i < processes_.count (); ++i) {
+        PrgProcess * proc = processes_.at (i);
+        if (proc->isRunning () && (proc->rss_ >= 0)) {
+            ProcMetrics::appendSample (
+                        result, "procrun_process_resident_bytes",
+                        sl_labels.at (i), proc->rss_ * 1024);
         }
     }
-    cmdmodl_->insertItem (item, index, gr);
-
-    ui->treeView->edit (cmdmodl_->indexFromItem (item));
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::on_treeView_customContextMenuRequested (const QPoint &pos)
+/**
+ * The file is replaced in a single step, so a collector never reads
+ * a partial export.
+ */
+bool ProcRunGui::writeMetrics (const QString & s_file)
 {
-    QMenu mnu;
-    QAction act_new_folder (
-                qApp->style()->standardIcon (QStyle::SP_DirIcon),
-                tr("Add new group"), this);
-    mnu.addAction (&act_new_folder);
-    QAction act_remove (
-                qApp->style()->standardIcon (QStyle::SP_BrowserStop),
-                tr("Delete"), this);
-    mnu.addAction (&act_remove);
-
+    QSaveFile f (s_file);
+    if (!f.open (QIODevice::WriteOnly | QIODevice::Text)) {
+        PROCRUNGUI_DEBUGM("Cannot write metrics to %s\n", TMP_A(s_file));
+        return false;
+    }
+    f.write (metricsText ().toUtf8 ());
+    if (!f.commit ()) {
+        PROCRUNGUI_DEBUGM("Cannot write metrics to %s\n", TMP_A(s_file));
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
 
-    QAction * result = mnu.exec (ui->treeView->viewport()->mapToGlobal (pos));
-    if (result == &act_new_folder) {
-        addNewGroup ();
-    } else if (result == &act_remove) {
-        removeItem (selectedCmdEntry ());
+/* ------------------------------------------------------------------------- */
+/**
+ * Processes that are still running are skipped; returns NULL if none is
+ * left. The exporter deletes itself once it is done.
+ */
+OutputExporter * ProcRunGui::exportRuns (
+        const QList<PrgProcess*> & procs, const QString & s_file)
+{
+    OutputExporter * result = new OutputExporter (
+                s_file, OutputExporter::formatForFile (s_file));
+    foreach(PrgProcess * proc, procs) {
+        if (proc->isRunning ())
+            continue;
+        OutputExporter::RunInfo info;
+        info.s_program_ = proc->data_.s_program_;
+        info.sl_arguments_ = proc->data_.sl_arguments_;
+        info.s_wrk_dir_ = proc->data_.s_wrk_dir_;
+        info.start_ms_ = proc->start_time_.toMSecsSinceEpoch ();
+        info.end_ms_ = proc->end_time_.toMSecsSinceEpoch ();
+        info.exit_code_ = proc->exit_code_;
+        info.b_crashed_ = proc->b_crashed_;
+        result->addRun (proc->output_, info);
     }
+    if (result->runCount () == 0) {
+        delete result;
+        return NULL;
+    }
+    connect (result, &OutputExporter::progress,
+             this, &ProcRunGui::exportProgress, Qt::QueuedConnection);
+    connect (result, &OutputExporter::done,
+             this, &ProcRunGui::exportDone, Qt::QueuedConnection);
+    result->start ();
+    return result;
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::removeItem (ProcRunItemBase * item)
+/**
+ * The progress is shown in a dialog that does not block the rest of the
+ * application; cancelling it stops the export.
+ */
+void ProcRunGui::exportOutput (int index)
 {
-    if (item == NULL)
+    QList<PrgProcess*> procs;
+    if (index == -1) {
+        procs = processes_;
+    } else {
+        procs.append (processes_.at (index));
+    }
+
+    QString s_file = QFileDialog::getSaveFileName (
+                this, tr ("Export output"), QString (),
+                tr ("JSON Lines (*.jsonl);;CSV (*.csv)"));
+    if (s_file.isEmpty ())
         return;
-    if (cmdmodl_ == NULL) {
+
+    OutputExporter * exporter = exportRuns (procs, s_file);
+    if (exporter == NULL) {
+        QMessageBox::information (this, tr ("Export output"),
+                                  tr ("There is no finished process to export."));
         return;
     }
 
-    int res = QMessageBox::question (
-                this,
-                tr("Delete saved command?"),
-                tr("Are you sure you want to delete this entry?\n"
-                   "Once deleted you will have no way to undo\n"
-                   "this operation."),
-                QMessageBox::Yes, QMessageBox::Cancel);
-    if (res == QMessageBox::Yes) {
-        cmdmodl_->removeItem (item);
-    }
+    QProgressDialog * dlg = new QProgressDialog (
+                tr ("Exporting %n run(s) to %1...", "", exporter->runCount ())
+                .arg (QFileInfo (s_file).fileName ()),
+                tr ("Cancel"), 0, 1000, this);
+    dlg->setWindowModality (Qt::NonModal);
+    dlg->setMinimumDuration (500);
+    dlg->setValue (0);
+    connect (dlg, SIGNAL(canceled()),
+             exporter, SLOT(cancel()));
+    exports_.insert (exporter, dlg);
 }
 /* ========================================================================= */
 
 /* ------------------------------------------------------------------------- */
-void ProcRunGui::treeviewSelectionChanged (
-        const QModelIndex &current, const QModelIndex &)
+void ProcRunGui::exportProgress (qint64 done, qint64 total)
 {
-    if (!current.isValid()) {
-        return;
-    }
-    if (cmdmodl_ == NULL) {
-        setCmdModel (new ProcRunModel (this));
-    }
-    ProcRunItemBase * it = cmdmodl_->itemFromIndex (current);
-    if (it == NULL) {
+    QPointer<QProgressDialog> dlg = exports_.value (sender ());
+    if (dlg.isNull () || (total <= 0))
         return;
-    }
+    dlg->setValue (static_cast<int>(qMin (done * 1000 / total, Q_INT64_C(999))));
+}
+/* ========================================================================= */
 
-    if (it->type () == ProcRunItemBase::CommandType) {
-        loadProgramForm (static_cast<ProcRunItem*>(it));
+/* ------------------------------------------------------------------------- */
+void ProcRunGui::exportDone (bool b_ok, const QString & s_error)
+{
+    QPointer<QProgressDialog> dlg = exports_.take (sender ());
+    bool b_cancelled = !dlg.isNull () && dlg->wasCanceled ();
+    if (!dlg.isNull ()) {
+        dlg->deleteLater ();
+    }
+    if (!b_ok && !b_cancelled) {
+        PROCRUNGUI_DEBUGM("Export failed: %s\n", TMP_A(s_error));
+        QMessageBox::warning (this, tr ("Export output"),
+                              tr ("The output could not be exported:\n%1")
+                              .arg (s_error));
     }
 }
 /* ========================================================================= */
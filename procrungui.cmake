@@ -18,17 +18,75 @@ macro    (procrunguiInit
 
     # compose the list of headers and sources
     set(PROCRUNGUI_HEADERS
+        "ansiparser.h"
+        "commandtemplate.h"
+        "launchprofile.h"
+        "outputchunk.h"
+        "outputexporter.h"
+        "outputfilter.h"
+        "outputlog.h"
+        "outputpacker.h"
+        "outputview.h"
+        "outputwindow.h"
+        "procdashboardmodel.h"
+        "procdatalistmodel.h"
         "procdatawdg.h"
+        "prgprocess.h"
+        "proclauncher.h"
+        "procmetrics.h"
+        "procoutput.h"
+        "procpty.h"
+        "procrunbatch.h"
+        "procrunhistory.h"
+        "procrunserver.h"
+        "procrunstatsdlg.h"
+        "procsession.h"
+        "procshutdown.h"
+        "proctree.h"
+        "resultcache.h"
+        "runpolicy.h"
+        "textscan.h"
+        "timerwheel.h"
         "procrungui.h")
     set(PROCRUNGUI_SOURCES
+        "ansiparser.cc"
+        "commandtemplate.cc"
+        "launchprofile.cc"
+        "outputchunk.cc"
+        "outputexporter.cc"
+        "outputfilter.cc"
+        "outputlog.cc"
+        "outputpacker.cc"
+        "outputview.cc"
+        "outputwindow.cc"
+        "procdashboardmodel.cc"
+        "procdatalistmodel.cc"
         "procdatawdg.cc"
+        "prgprocess.cc"
+        "proclauncher.cc"
+        "procmetrics.cc"
+        "procoutput.cc"
+        "procpty.cc"
+        "procrunbatch.cc"
+        "procrunhistory.cc"
+        "procrunserver.cc"
+        "procrunstatsdlg.cc"
+        "procsession.cc"
+        "procshutdown.cc"
+        "proctree.cc"
+        "resultcache.cc"
+        "runpolicy.cc"
+        "textscan.cc"
+        "timerwheel.cc"
         "procrungui.cc")
     set(PROCRUNGUI_UIS
         "procdatawdg.ui"
+        "procrunstatsdlg.ui"
         "procrungui.ui")
 
     set(PROCRUNGUI_QT_MODS
         "Core"
+        "Network"
         "Widgets")
 
     pileSetSources(
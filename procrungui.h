@@ -11,16 +11,32 @@
 #define GUARD_PROCRUNGUI_INCLUDE
 
 #include <procrungui/procrungui-config.h>
+#include <procrungui/procrunbatch.h>
+#include <procrungui/procrunhistory.h>
+#include <procrungui/procoutput.h>
+#include <procrungui/launchprofile.h>
+#include <procrungui/runpolicy.h>
+#include <procrungui/commandtemplate.h>
+#include <procrungui/resultcache.h>
+#include <procrungui/procsession.h>
+#include <procrun/procrundata.h>
 
 #include <QStringList>
 #include <QWidget>
 #include <QList>
 #include <QMovie>
+#include <QPointer>
+#include <QHash>
+#include <QElapsedTimer>
 
 QT_BEGIN_NAMESPACE
 class QSettings;
+class QProgressDialog;
 class QAbstractButton;
 class QListWidgetItem;
+class QModelIndex;
+class QPlainTextEdit;
+class QTableView;
 QT_END_NAMESPACE
 
 namespace Ui {
@@ -28,6 +44,12 @@ class ProcRunGui;
 }
 
 class PrgProcess;
+class ProcShutdown;
+class ProcRunServer;
+class OutputWindow;
+class TimerWheel;
+class ProcDashboardModel;
+class OutputExporter;
 class ProcRunModel;
 class ProcRunItem;
 class ProcRunItemBase;
@@ -65,13 +87,249 @@ public:
             Kb kb = NULL,
             void * user_data = NULL);
 
-    //! We should run a program.
+    //! We should run a program (@a attempt is 2 and up for retries).
+    //!
+    //! Nothing is started while the window closes and NULL is returned.
+    //! The settings and history are the ones stored under @a s_settings_key
+    //! (the commandKey () of @a data if empty).
     PrgProcess *
     runProgram (
             const ProcRunData & data,
             Kb kb = NULL,
+            void * user_data = NULL,
+            int attempt = 1,
+            const QString & s_settings_key = QString ());
+
+    //! Run programs with the output of each one feeding the next one (none while closing).
+    QList<PrgProcess*>
+    runPipeline (
+            const QList<ProcRunData> & stages,
+            Kb kb = NULL,
             void * user_data = NULL);
 
+    //! Run a set of programs as a single batch (a titled one is summarized).
+    //!
+    //! Nothing is started while the window closes and NULL is returned.
+    //! A non-empty @a s_settings_key is used for all the programs.
+    ProcRunBatch *
+    runBatch (
+            const QList<ProcRunData> & jobs,
+            ProcRunBatch::Mode mode,
+            int max_parallel = 0,
+            const QString & s_title = QString (),
+            const QString & s_settings_key = QString ());
+
+    //! Run an instance of a template command for each of its values.
+    ProcRunBatch *
+    fanOut (
+            const ProcRunData & data);
+
+    //! A string that identifies a command (program, arguments, directory).
+    static QString
+    commandKey (
+            const ProcRunData & data);
+
+    //! Expected duration of a command in milliseconds (-1 if unknown).
+    qint64
+    estimatedDuration (
+            const ProcRunData & data) const;
+
+    //! Milliseconds between terminate and kill (negative to never kill).
+    int
+    killTimeout () const {
+        return kill_timeout_;
+    }
+
+    //! Set milliseconds between terminate and kill (negative to never kill).
+    void
+    setKillTimeout (
+            int value) {
+        kill_timeout_ = value;
+    }
+
+    //! Are new processes given a pseudo-terminal for their output?
+    bool
+    usePty () const {
+        return b_use_pty_;
+    }
+
+    //! Give new processes a pseudo-terminal for their output (Linux only).
+    void
+    setUsePty (
+            bool value) {
+        b_use_pty_ = value;
+    }
+
+    //! Are new processes started by the launcher helper?
+    bool
+    useLauncher () const {
+        return b_use_launcher_;
+    }
+
+    //! Start new processes with the launcher helper (see ProcLauncher::start).
+    void
+    setUseLauncher (
+            bool value) {
+        b_use_launcher_ = value;
+    }
+
+    //! Are new processes recorded in the session?
+    bool
+    keepSession () const {
+        return b_keep_session_;
+    }
+
+    //! Record new processes and spill their output, so restoreSession () can show them.
+    void
+    setKeepSession (
+            bool value);
+
+    //! Are the processes shown in a table instead of tabs?
+    bool
+    dashboardMode () const {
+        return b_dashboard_mode_;
+    }
+
+    //! Show the processes in a table under the output instead of tabs.
+    void
+    setDashboardMode (
+            bool value);
+
+    //! Index of the process shown in the output view (-1 for none).
+    int
+    currentProgramIndex ();
+
+    //! The text that names a command in tabs, tables and windows.
+    static QString
+    commandTitle (
+            const ProcRunData & data);
+
+    //! Add a tab for each process recorded in the session; returns their number.
+    int
+    restoreSession ();
+
+    //! Counters of all processes in the Prometheus text format.
+    QString
+    metricsText ();
+
+    //! Write metricsText () to a file, replacing it at once; false on error.
+    bool
+    writeMetrics (
+            const QString & s_file);
+
+    //! The file where counters are exported periodically (empty for none).
+    const QString &
+    metricsFile () const {
+        return s_metrics_file_;
+    }
+
+    //! Export counters to a file every few seconds (empty to stop).
+    void
+    setMetricsFile (
+            const QString & s_file) {
+        s_metrics_file_ = s_file;
+    }
+
+    //! Write the output of finished processes to a file in the background.
+    OutputExporter *
+    exportRuns (
+            const QList<PrgProcess*> & procs,
+            const QString & s_file);
+
+    //! Output filter stored for a command.
+    OutputFilterConfig
+    outputFilter (
+            const ProcRunData & data) const;
+
+    //! Store the output filter for a command.
+    void
+    setOutputFilter (
+            const ProcRunData & data,
+            const OutputFilterConfig & config);
+
+    //! Environment and limits stored for a command.
+    LaunchProfile
+    launchProfile (
+            const ProcRunData & data) const;
+
+    //! Store the environment and limits for a command.
+    void
+    setLaunchProfile (
+            const ProcRunData & data,
+            const LaunchProfile & profile);
+
+    //! Timeouts and retries stored for a command.
+    RunPolicy
+    runPolicy (
+            const ProcRunData & data) const;
+
+    //! Store the timeouts and retries for a command.
+    void
+    setRunPolicy (
+            const ProcRunData & data,
+            const RunPolicy & policy);
+
+    //! Placeholder and values stored for a command.
+    CommandTemplate
+    commandTemplate (
+            const ProcRunData & data) const;
+
+    //! Store the placeholder and values for a command.
+    void
+    setCommandTemplate (
+            const ProcRunData & data,
+            const CommandTemplate & tpl);
+
+    //! Tells if the result of a command is reused and what it reads.
+    CacheConfig
+    cacheConfig (
+            const ProcRunData & data) const;
+
+    //! Store if the result of a command is reused and what it reads.
+    void
+    setCacheConfig (
+            const ProcRunData & data,
+            const CacheConfig & config);
+
+    //! Stored results of commands that have a CacheConfig.
+    ResultCache &
+    resultCache () {
+        return cache_;
+    }
+
+    //! Number of runs waiting to be retried.
+    int
+    pendingRetries () const {
+        return retries_.count ();
+    }
+
+    //! The log of completed runs.
+    const ProcRunHistory &
+    history () const {
+        return history_;
+    }
+
+    //! Accept control requests on a local socket; false if that failed.
+    bool
+    listen (
+            const QString & s_name = QString ());
+
+    //! Stop accepting control requests.
+    void
+    stopListening ();
+
+    //! The control server (NULL if listen () was never called).
+    ProcRunServer *
+    server () const {
+        return server_;
+    }
+
+    //! Number of processes (one for each tab).
+    int
+    programCount () const {
+        return processes_.count ();
+    }
+
     //! Find the index of the program given its process.
     int
     programIndex (
@@ -82,6 +340,10 @@ public:
     program (
             int idx);
 
+    //! Number of timeouts and retry delays that did not expire yet.
+    int
+    pendingTimers () const;
+
     //! Reads saved commands from a file.
     bool
     loadCommands (
@@ -125,20 +387,92 @@ public:
     removeItem (
             ProcRunItemBase *item);
 
+    //! The commands in the selected entries of the tree (groups are expanded).
+    QList<ProcRunData>
+    selectedCommands ();
+
+    //! Tell if a group of the tree runs as a pipeline.
+    bool
+    isPipelineGroup (
+            const QModelIndex & mi) const;
+
+    //! Mark a group of the tree to run as a pipeline (or not).
+    void
+    setPipelineGroup (
+            const QModelIndex & mi,
+            bool b_pipeline);
+
 public slots:
 
     //! Creates a new group around selected item.
     void
     addNewGroup ();
 
+    //! Run the selected command on its own.
+    void
+    runSelected ();
+
+    //! Run the commands of the selected group at the same time.
+    void
+    runSelectedGroup ();
+
+    //! Run selected commands one after another.
+    void
+    runSelectedSequentially ();
+
+    //! Run selected commands with the output of each one feeding the next one.
+    void
+    runSelectedAsPipeline ();
+
+    //! Run the selected template command for each of its values.
+    void
+    fanOutSelected ();
+
+    //! Show duration statistics for saved commands.
+    void
+    showStatistics ();
+
+    //! Show the output of a tab in a window of its own.
+    void
+    detachTab (
+            int index);
+
+    //! Show the output of a tab in the shared tiled window.
+    void
+    tileTab (
+            int index);
+
+    //! Show all processes in a table, one row each.
+    void
+    showDashboard ();
+
+    //! Show the counters in a window, refreshed every second.
+    void
+    showCounters ();
+
+    //! Ask for a file and export a finished tab (all finished ones for -1).
+    void
+    exportOutput (
+            int index = -1);
+
 protected:
 
     //! Used by running processes to inform the instance about activity.
-    QString
+    void
     processGeneratedText (
             PrgProcess *proc,
-            const QString & s_input,
-            bool is_error);
+            ProcOutput::Channel channel);
+
+    //! Add a message of our own to the output of a process.
+    void
+    appendNotice (
+            PrgProcess *proc,
+            const QString & s_text);
+
+    //! Refresh the view if it shows this process.
+    void
+    outputChanged (
+            PrgProcess *proc);
 
     //! A process has finished its execution.
     void
@@ -186,12 +520,98 @@ private slots:
     on_treeView_customContextMenuRequested (
             const QPoint &pos);
 
+    void
+    tabContextMenu (
+            const QPoint & pos);
+
+    void
+    tabMoved (
+            int from,
+            int to);
+
+    void
+    dashboardActivated (
+            const QModelIndex & index);
+
+    void
+    on_dashboardButton_toggled (
+            bool b_checked);
+
+    void
+    on_dashboardView_customContextMenuRequested (
+            const QPoint & pos);
+
+    void
+    on_dashboardView_doubleClicked (
+            const QModelIndex & index);
+
+    void
+    boardCurrentChanged (
+            const QModelIndex & current,
+            const QModelIndex & previous);
+
+    void
+    batchProgress ();
+
+    void
+    batchDone ();
+
+    void
+    shutdownProgress (
+            int done,
+            int total);
+
+    void
+    shutdownFinished (
+            bool b_all_reaped);
+
+    void
+    wheelExpired (
+            quint64 id);
+
+    void
+    exportProgress (
+            qint64 done,
+            qint64 total);
+
+    void
+    exportDone (
+            bool b_ok,
+            const QString & s_error);
+
 signals:
 
     //! The window is about to be closed.
     void
     aboutToClose ();
 
+    //! A process has new output.
+    void
+    processOutput (
+            PrgProcess * proc);
+
+    //! A process has ended.
+    void
+    processFinished (
+            PrgProcess * proc);
+
+    //! A process is about to be deleted.
+    void
+    processRemoved (
+            PrgProcess * proc);
+
+    //! A process ended and will be run again; @a retry identifies the attempt.
+    void
+    retryScheduled (
+            PrgProcess * proc,
+            quint64 retry);
+
+    //! The attempt scheduled as @a retry was started.
+    void
+    retryStarted (
+            quint64 retry,
+            PrgProcess * proc);
+
 protected slots:
 
     void
@@ -200,6 +620,112 @@ protected slots:
             const QModelIndex &previous);
 
 private:
+
+    //! Append the commands inside an entry of the tree.
+    void
+    collectCommands (
+            const QModelIndex & mi,
+            QList<ProcRunData> & result,
+            QList<ProcRunItemBase*> & seen);
+
+    //! Identifies a group of the tree in the options file.
+    QString
+    groupKey (
+            const QModelIndex & mi) const;
+
+    //! Show aggregated progress of the batches.
+    void
+    updateBatchProgress ();
+
+    //! Tell how a titled batch went.
+    void
+    showBatchSummary (
+            ProcRunBatch * batch);
+
+    //! Create the tab of a process (not used in dashboard mode).
+    void
+    addTab (
+            PrgProcess * proc);
+
+    //! The menu of a process in the tab bar or in the dashboard.
+    void
+    processMenu (
+            int index,
+            const QPoint & global_pos);
+
+    //! Common look of the tables that list the processes.
+    static void
+    prepareDashboardView (
+            QTableView * view);
+
+    //! Create a process and its tab; the caller starts it.
+    PrgProcess *
+    createProcess (
+            const ProcRunData & data,
+            Kb kb,
+            void * user_data,
+            int attempt,
+            const QString & s_settings_key = QString ());
+
+    //! Everything stored for a command in the options file.
+    struct CommandSettings {
+        OutputFilterConfig filter_; /**< which lines are kept */
+        LaunchProfile profile_; /**< environment and limits */
+        RunPolicy policy_; /**< time limits and retries */
+        CommandTemplate template_; /**< values to fan out over */
+        CacheConfig cache_; /**< when results are reused */
+    };
+
+    //! The settings stored under @a s_key (read once, then remembered).
+    CommandSettings
+    commandSettings (
+            const QString & s_key) const;
+
+    //! Store the settings of type T under @a s_key.
+    template <typename T>
+    void
+    saveSettings (
+            const QString & s_key,
+            const T & value);
+
+    //! Start the timeouts of the policy of a process about to be started.
+    void
+    armPolicy (
+            PrgProcess * proc);
+
+    //! Remove the timeouts of a process.
+    void
+    disarmPolicy (
+            PrgProcess * proc);
+
+    //! Keep the output of a process for its next run with the same inputs.
+    void
+    storeResult (
+            PrgProcess * proc);
+
+    //! Record a new process in the session and spill its output.
+    void
+    startSessionLog (
+            PrgProcess * proc);
+
+    //! Schedule another attempt if the policy asks for one (true if it did).
+    bool
+    scheduleRetry (
+            PrgProcess * proc);
+
+    //! A run waiting for its retry delay.
+    struct PendingRetry {
+        ProcRunData data_; /**< what to run */
+        Kb kb_; /**< callback of the first run */
+        void * user_data_; /**< user data of the first run */
+        int attempt_; /**< number of the attempt to start */
+        QString s_settings_key_; /**< settings of the first run */
+    };
+
+    //! Open windows, dropping the ones that were closed.
+    QList<OutputWindow*>
+    outputWindows ();
+
     Ui::ProcRunGui *ui; /**< ui components */
     QList<PrgProcess*> processes_; /**< the list of processes */
     bool close_on_last_; /**< should we also close when last process is closed? */
@@ -208,6 +734,33 @@ private:
     ProcRunModel * cmdmodl_; /**< the model for saved commands */
     ProcRunItem * item_in_form_; /**< the item that is presented in the form */
     bool b_list_lock_; /**< prevent multiple events in list widgets */
+    QList<ProcRunBatch*> batches_; /**< batches that are running */
+    ProcRunHistory history_; /**< completed runs */
+    int timer_ticks_; /**< number of timer events so far */
+    int kill_timeout_; /**< milliseconds between terminate and kill */
+    ProcShutdown * shutdown_; /**< waits for processes while closing */
+    QProgressDialog * shutdown_dlg_; /**< shows shutdown progress */
+    bool b_shutdown_done_; /**< all processes were reaped, we may close */
+    bool b_use_pty_; /**< start new processes with a pseudo-terminal */
+    bool b_use_launcher_; /**< start new processes with the launcher helper */
+    ProcRunServer * server_; /**< control requests from other programs */
+    QList<QPointer<OutputWindow> > windows_; /**< detached output windows */
+    QPointer<OutputWindow> tiled_; /**< the window where tabs are tiled */
+    QPointer<ProcDashboardModel> dashboard_; /**< model of the dashboard window */
+    bool b_dashboard_mode_; /**< processes are listed in board_, not in tabs */
+    ProcDashboardModel * board_; /**< model of the table in dashboard mode or NULL */
+    QPointer<QPlainTextEdit> counters_view_; /**< the counters window */
+    QString s_metrics_file_; /**< counters are exported here (empty for none) */
+    QElapsedTimer tick_clock_; /**< measures the lag of timerEvent () */
+    TimerWheel * wheel_; /**< timeouts and retry delays of all processes */
+    QHash<quint64, PrgProcess*> watched_; /**< processes by timer wheel id */
+    QHash<quint64, PendingRetry> retries_; /**< retries by timer wheel id */
+    ResultCache cache_; /**< stored results of cached commands */
+    mutable QHash<QString, CommandSettings> settings_; /**< parsed options by settings key */
+    bool b_keep_session_; /**< new processes are recorded in session_ */
+    bool b_restoring_; /**< restoreSession () is creating the tabs */
+    ProcSession session_; /**< processes that may be shown again */
+    QHash<QObject*, QPointer<QProgressDialog> > exports_; /**< progress of running exports */
 };
 
 #endif // GUARD_PROCRUNGUI_H_INCLUDE
@@ -0,0 +1,299 @@
+/**
+ * @file procrunhistory.cc
+ * @brief Definitions for ProcRunHistory class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procrunhistory.h"
+
+#include "procrungui-private.h"
+
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QDir>
+
+#include <algorithm>
+
+/**
+ * @class ProcRunHistory
+ *
+ * Each record is written as a small frame (magic, payload size,
+ * payload, checksum) at the end of the file. A frame that was only
+ * partially written (the application crashed) is dropped when the
+ * file is opened again.
+ *
+ * Only a bounded number of durations is kept in memory for each
+ * command; that is enough for the percentiles to follow recent
+ * behavior.
+ */
+
+//! Marks the start of each record in the file.
+#define HISTORY_MAGIC 0x50524831
+
+//! Version of the payload format.
+#define HISTORY_VERSION 1
+
+//! Largest payload of a record; a bigger size means the file is damaged.
+#define HISTORY_MAX_RECORD (1024 * 1024)
+
+/* ------------------------------------------------------------------------- */
+static QByteArray encodeRecord (const ProcRunRecord & rec)
+{
+    QByteArray result;
+    QDataStream ds (&result, QIODevice::WriteOnly);
+    ds.setVersion (QDataStream::Qt_5_0);
+    ds << static_cast<quint8>(HISTORY_VERSION)
+       << rec.s_key_
+       << rec.s_program_
+       << rec.start_ms_
+       << rec.end_ms_
+       << static_cast<qint32>(rec.exit_code_)
+       << rec.b_crashed_
+       << rec.peak_rss_
+       << rec.output_size_;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static bool decodeRecord (const QByteArray & payload, ProcRunRecord & rec)
+{
+    QDataStream ds (payload);
+    ds.setVersion (QDataStream::Qt_5_0);
+    quint8 version;
+    qint32 exit_code;
+    ds >> version;
+    if (version != HISTORY_VERSION)
+        return false;
+    ds >> rec.s_key_
+       >> rec.s_program_
+       >> rec.start_ms_
+       >> rec.end_ms_
+       >> exit_code
+       >> rec.b_crashed_
+       >> rec.peak_rss_
+       >> rec.output_size_;
+    rec.exit_code_ = exit_code;
+    return ds.status () == QDataStream::Ok;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Reads frames until the end of the device or until a damaged frame
+ * is found. @a good_end receives the offset just past the last good frame.
+ */
+static bool readFrames (
+        QIODevice & dev, QList<ProcRunRecord> & result, qint64 & good_end)
+{
+    QDataStream ds (&dev);
+    ds.setVersion (QDataStream::Qt_5_0);
+    good_end = dev.pos ();
+    for (;;) {
+        if (dev.atEnd ())
+            return true;
+
+        quint32 magic;
+        quint32 size;
+        ds >> magic >> size;
+        if ((ds.status () != QDataStream::Ok) || (magic != HISTORY_MAGIC))
+            return false;
+        // a damaged size must not make us allocate gigabytes
+        if ((size > HISTORY_MAX_RECORD) || (size > dev.bytesAvailable ()))
+            return false;
+
+        QByteArray payload (static_cast<int>(size), Qt::Uninitialized);
+        if (ds.readRawData (payload.data (), payload.size ()) != payload.size ())
+            return false;
+
+        quint16 checksum;
+        ds >> checksum;
+        if ((ds.status () != QDataStream::Ok) ||
+                (checksum != qChecksum (payload.constData (), payload.size ())))
+            return false;
+
+        ProcRunRecord rec;
+        if (decodeRecord (payload, rec)) {
+            result.append (rec);
+        }
+        good_end = dev.pos ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunHistory::ProcRunHistory () :
+    file_ (),
+    entries_ ()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunHistory::~ProcRunHistory()
+{
+    close ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcRunHistory::defaultFile ()
+{
+    QString s_path = QStandardPaths::writableLocation (
+                QStandardPaths::AppDataLocation);
+    QDir dr (s_path);
+    dr.mkpath (QLatin1String ("."));
+    if (!dr.exists()) {
+        PROCRUNGUI_DEBUGM("Failed to create application data directory\n");
+        return QString ();
+    }
+    return dr.absoluteFilePath (QLatin1String ("proc_run_gui_history.bin"));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunHistory::open (const QString & s_file)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    bool b_ret = false;
+    for (;;) {
+        close ();
+        entries_.clear ();
+
+        QString s_path = s_file;
+        if (s_path.isEmpty ()) {
+            s_path = defaultFile ();
+            if (s_path.isEmpty ()) {
+                break;
+            }
+        }
+
+        file_.setFileName (s_path);
+        if (!file_.open (QIODevice::ReadWrite)) {
+            PROCRUNGUI_DEBUGM("Can't open history file %s\n", TMP_A(s_path));
+            break;
+        }
+
+        QList<ProcRunRecord> records;
+        qint64 good_end = 0;
+        if (!readFrames (file_, records, good_end)) {
+            PROCRUNGUI_DEBUGM("History file %s is damaged past %lld\n",
+                              TMP_A(s_path), good_end);
+            file_.resize (good_end);
+        }
+        file_.seek (good_end);
+
+        foreach(const ProcRunRecord & rec, records) {
+            account (rec);
+        }
+
+        b_ret = true;
+        break;
+    }
+    PROCRUNGUI_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunHistory::close ()
+{
+    if (file_.isOpen ()) {
+        file_.close ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunHistory::append (const ProcRunRecord & rec)
+{
+    account (rec);
+    if (!file_.isOpen ())
+        return false;
+
+    QByteArray payload = encodeRecord (rec);
+    // it would be taken for damage when read back
+    if (payload.size () > HISTORY_MAX_RECORD)
+        return false;
+    QDataStream ds (&file_);
+    ds.setVersion (QDataStream::Qt_5_0);
+    ds << static_cast<quint32>(HISTORY_MAGIC)
+       << static_cast<quint32>(payload.size ());
+    ds.writeRawData (payload.constData (), payload.size ());
+    ds << qChecksum (payload.constData (), payload.size ());
+    file_.flush ();
+    return ds.status () == QDataStream::Ok;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunHistory::account (const ProcRunRecord & rec)
+{
+    Entry & entry = entries_[rec.s_key_];
+    if (entry.durations_.isEmpty ()) {
+        entry.runs_ = 0;
+        entry.failures_ = 0;
+        entry.peak_rss_ = -1;
+        entry.next_ = 0;
+        entry.durations_.reserve (SAMPLES_PER_COMMAND);
+    }
+
+    ++entry.runs_;
+    if (!rec.isSuccess ()) {
+        ++entry.failures_;
+    }
+    entry.peak_rss_ = qMax (entry.peak_rss_, rec.peak_rss_);
+
+    if (entry.durations_.count () < SAMPLES_PER_COMMAND) {
+        entry.durations_.append (rec.duration ());
+    } else {
+        entry.durations_[entry.next_] = rec.duration ();
+    }
+    entry.next_ = (entry.next_ + 1) % SAMPLES_PER_COMMAND;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunStats ProcRunHistory::stats (const QString & s_key) const
+{
+    ProcRunStats result;
+    QHash<QString, Entry>::const_iterator iter = entries_.constFind (s_key);
+    if ((iter == entries_.constEnd ()) || iter->durations_.isEmpty ())
+        return result;
+
+    const Entry & entry = iter.value ();
+    result.runs_ = entry.runs_;
+    result.failures_ = entry.failures_;
+    result.peak_rss_ = entry.peak_rss_;
+
+    int last = entry.next_ - 1;
+    if (last < 0)
+        last = entry.durations_.count () - 1;
+    result.last_ = entry.durations_.at (last);
+
+    QVector<qint64> sorted = entry.durations_;
+    int cnt = sorted.count ();
+    int i50 = (cnt - 1) * 50 / 100;
+    int i95 = (cnt - 1) * 95 / 100;
+    std::nth_element (sorted.begin (), sorted.begin () + i95, sorted.end ());
+    result.p95_ = sorted.at (i95);
+    std::nth_element (sorted.begin (), sorted.begin () + i50, sorted.begin () + i95);
+    result.p50_ = sorted.at (i50);
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunHistory::readAll (
+        const QString & s_file, QList<ProcRunRecord> & result)
+{
+    QFile f (s_file);
+    if (!f.open (QIODevice::ReadOnly))
+        return false;
+    qint64 good_end;
+    return readFrames (f, result, good_end);
+}
+/* ========================================================================= */
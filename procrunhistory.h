@@ -0,0 +1,145 @@
+/**
+ * @file procrunhistory.h
+ * @brief Declarations for ProcRunHistory class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCRUNHISTORY_H_INCLUDE
+#define GUARD_PROCRUNHISTORY_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QFile>
+
+//! A completed run, as stored in the history.
+struct PROCRUNGUI_EXPORT ProcRunRecord {
+    QString s_key_; /**< identifies the command (ProcRunGui::commandKey ()) */
+    QString s_program_; /**< the program that was run */
+    qint64 start_ms_; /**< start time in milliseconds since epoch */
+    qint64 end_ms_; /**< end time in milliseconds since epoch */
+    int exit_code_; /**< the exit code of the process */
+    bool b_crashed_; /**< did the process crash (or was killed)? */
+    qint64 peak_rss_; /**< maximum resident set size in kilobytes or -1 */
+    qint64 output_size_; /**< number of bytes produced by the process */
+
+    //! Default constructor.
+    ProcRunRecord () :
+        s_key_(),
+        s_program_(),
+        start_ms_(0),
+        end_ms_(0),
+        exit_code_(0),
+        b_crashed_(false),
+        peak_rss_(-1),
+        output_size_(0)
+    {}
+
+    //! The duration of the run in milliseconds.
+    qint64
+    duration () const {
+        return end_ms_ - start_ms_;
+    }
+
+    //! Did the run end successfully?
+    bool
+    isSuccess () const {
+        return !b_crashed_ && (exit_code_ == 0);
+    }
+};
+
+//! Statistics for a command, computed from its history.
+struct PROCRUNGUI_EXPORT ProcRunStats {
+    int runs_; /**< number of runs */
+    int failures_; /**< number of runs that did not succeed */
+    qint64 p50_; /**< median duration in milliseconds or -1 */
+    qint64 p95_; /**< 95th percentile of the duration or -1 */
+    qint64 last_; /**< duration of the last run or -1 */
+    qint64 peak_rss_; /**< largest peak resident set size seen or -1 */
+
+    //! Default constructor.
+    ProcRunStats () :
+        runs_(0),
+        failures_(0),
+        p50_(-1),
+        p95_(-1),
+        last_(-1),
+        peak_rss_(-1)
+    {}
+};
+
+//! Append-only log of completed runs with per-command statistics.
+class PROCRUNGUI_EXPORT ProcRunHistory {
+
+public:
+
+    //! Number of durations kept in memory for each command.
+    enum { SAMPLES_PER_COMMAND = 256 };
+
+    //! Default constructor.
+    ProcRunHistory ();
+
+    //! Destructor.
+    virtual ~ProcRunHistory();
+
+    //! Read existing records and prepare the file for appending.
+    bool
+    open (
+            const QString & s_file = QString ());
+
+    //! Close the file.
+    void
+    close ();
+
+    //! The path of the log file.
+    QString
+    fileName () const {
+        return file_.fileName ();
+    }
+
+    //! Append a record to the log and update the statistics.
+    bool
+    append (
+            const ProcRunRecord & rec);
+
+    //! Statistics for a command.
+    ProcRunStats
+    stats (
+            const QString & s_key) const;
+
+    //! Read all records from a log file.
+    static bool
+    readAll (
+            const QString & s_file,
+            QList<ProcRunRecord> & result);
+
+    //! The default location of the history file.
+    static QString
+    defaultFile ();
+
+private:
+
+    //! Per-command accumulated data.
+    struct Entry {
+        int runs_; /**< number of runs */
+        int failures_; /**< number of failed runs */
+        qint64 peak_rss_; /**< largest peak resident set size seen */
+        QVector<qint64> durations_; /**< recent durations (circular) */
+        int next_; /**< where the next duration goes in durations_ */
+    };
+
+    //! Update in-memory statistics.
+    void
+    account (
+            const ProcRunRecord & rec);
+
+    QFile file_; /**< the log */
+    QHash<QString, Entry> entries_; /**< statistics for each command */
+};
+
+#endif // GUARD_PROCRUNHISTORY_H_INCLUDE
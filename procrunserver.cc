@@ -0,0 +1,608 @@
+/**
+ * @file procrunserver.cc
+ * @brief Definitions for ProcRunServer class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procrunserver.h"
+#include "procrungui.h"
+#include "prgprocess.h"
+
+#include "procrungui-private.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QtEndian>
+
+/**
+ * @class ProcRunServer
+ *
+ * Clients connect to a local socket (a Unix-domain socket, or a named
+ * pipe on Windows) that only the current user may open. Each frame is:
+ *
+ *     quint16 magic (0x5052), quint8 type, quint32 payload size, payload
+ *
+ * with all integers big-endian and the payload written by QDataStream
+ * (Qt_5_0 format). Every request starts with a quint32 tag that is
+ * echoed in the reply, so a client may have several requests in flight:
+ *
+ * - Submit: tag, QString program, QStringList arguments,
+ *   QString working directory, QStringList standard input.
+ *   Answered by Submitted: tag, qint32 job, or by Error if the program
+ *   was not started (the window is closing).
+ * - Subscribe: tag, qint32 job, qint64 first sequence number (0 for all
+ *   the output so far, -1 for new output only). Answered by Ok: tag;
+ *   the lines are then pushed in Output frames and a Finished frame
+ *   ends the stream.
+ * - Unsubscribe: tag, qint32 job. Answered by Ok: tag.
+ * - Status: tag, qint32 job (-1 for all jobs). Answered by StatusReply:
+ *   tag, quint32 count, then for each job: qint32 job, QString program,
+ *   quint8 JobState, qint64 pid, qint32 exit code, bool crashed,
+ *   qint64 lines, qint64 bytes, qint32 progress (-1 if unknown).
+ * - Kill: tag, qint32 job, bool force. Without force the tree is asked
+ *   to terminate first, as the Terminate button does. Answered by Ok:
+ *   tag once the signal was sent.
+ *
+ * Output frames carry qint32 job, quint32 count and then, for each
+ * line: qint64 sequence number, quint8 ProcOutput::Channel, qint64 time
+ * in milliseconds since the epoch and the bytes of the line
+ * (quint32 size followed by the raw UTF-8, no escape sequences). Lines
+ * are taken straight from the chunks of ProcOutput; output that
+ * arrives within FLUSH_MS is sent as one batch. A client that reads
+ * slower than the process writes is paused at MAX_PENDING unsent bytes
+ * and catches up from the store later, so no lines are lost while the
+ * tab is open. Lines redrawn in place get new sequence numbers; a
+ * client may see earlier states of such lines.
+ *
+ * Finished carries qint32 job, qint32 exit code and bool crashed.
+ * Error carries the tag of the request and a QString message.
+ *
+ * Jobs started from the interface are known by the same identifiers;
+ * they are assigned when a process is first seen by a client. A job is
+ * forgotten when its tab is closed; requests about it then get Error.
+ */
+
+/* ------------------------------------------------------------------------- */
+static int jobState (const PrgProcess * proc)
+{
+    if (proc == NULL)
+        return ProcRunServer::JobGone;
+    if (proc->end_time_.isValid ())
+        return ProcRunServer::JobFinished;
+    if (proc->isRunning () && proc->b_started_)
+        return ProcRunServer::JobRunning;
+    return ProcRunServer::JobStarting;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunServer::ProcRunServer (ProcRunGui * gui) :
+    QObject (gui),
+    gui_ (gui),
+    server_ (NULL),
+    clients_ (),
+    jobs_ (),
+    ids_ (),
+    dirty_ (),
+    flush_timer_ (),
+    next_job_ (1)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    flush_timer_.setSingleShot (true);
+    flush_timer_.setInterval (FLUSH_MS);
+    connect (&flush_timer_, &QTimer::timeout,
+             this, &ProcRunServer::flush);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunServer::~ProcRunServer()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    close ();
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A socket left behind by an instance that crashed is removed; one that
+ * still answers belongs to another instance and is left alone.
+ */
+bool ProcRunServer::listen (const QString & s_name)
+{
+    close ();
+    server_ = new QLocalServer (this);
+    server_->setSocketOptions (QLocalServer::UserAccessOption);
+
+    bool b_ok = server_->listen (s_name);
+    if (!b_ok && (server_->serverError () ==
+                  QAbstractSocket::AddressInUseError)) {
+        QLocalSocket probe;
+        probe.connectToServer (s_name);
+        if (!probe.waitForConnected (200)) {
+            QLocalServer::removeServer (s_name);
+            b_ok = server_->listen (s_name);
+        }
+    }
+
+    if (!b_ok) {
+        PROCRUNGUI_DEBUGM("Failed to listen on %s: %s\n",
+                          TMP_A(s_name), TMP_A(server_->errorString ()));
+        delete server_;
+        server_ = NULL;
+        return false;
+    }
+
+    connect (server_, &QLocalServer::newConnection,
+             this, &ProcRunServer::newConnection);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::close ()
+{
+    while (!clients_.isEmpty ()) {
+        removeClient (clients_.last ());
+    }
+    dirty_.clear ();
+    flush_timer_.stop ();
+    if (server_ != NULL) {
+        server_->close ();
+        delete server_;
+        server_ = NULL;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProcRunServer::isListening () const
+{
+    return (server_ != NULL) && server_->isListening ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcRunServer::serverPath () const
+{
+    return server_ == NULL ? QString () : server_->fullServerName ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcRunServer::jobId (PrgProcess * proc)
+{
+    QHash<PrgProcess*, int>::const_iterator it = ids_.constFind (proc);
+    if (it != ids_.constEnd ())
+        return it.value ();
+
+    int job = next_job_++;
+    ids_.insert (proc, job);
+    jobs_.insert (job, QPointer<PrgProcess> (proc));
+    return job;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+PrgProcess * ProcRunServer::jobProcess (int job) const
+{
+    return jobs_.value (job).data ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Called for every read, so processes nobody asked about return early.
+ */
+void ProcRunServer::processOutput (PrgProcess * proc)
+{
+    QHash<PrgProcess*, int>::const_iterator it = ids_.constFind (proc);
+    if (it == ids_.constEnd ())
+        return;
+
+    if (!dirty_.contains (it.value ())) {
+        dirty_.append (it.value ());
+    }
+    if (!flush_timer_.isActive ()) {
+        flush_timer_.start ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::processFinished (PrgProcess * proc)
+{
+    QHash<PrgProcess*, int>::const_iterator it = ids_.constFind (proc);
+    if (it == ids_.constEnd ())
+        return;
+    sendFinished (it.value (), proc);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The lines go away with the process, so subscribers get the rest of
+ * them now, regardless of how much they have to read.
+ */
+void ProcRunServer::processRemoved (PrgProcess * proc)
+{
+    QHash<PrgProcess*, int>::iterator it = ids_.find (proc);
+    if (it == ids_.end ())
+        return;
+
+    int job = it.value ();
+    sendFinished (job, proc);
+    dirty_.removeAll (job);
+    // the address may be reused by the next process
+    ids_.erase (it);
+    jobs_.remove (job);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::newConnection ()
+{
+    while (server_->hasPendingConnections ()) {
+        QLocalSocket * socket = server_->nextPendingConnection ();
+        Client * client = new Client ();
+        client->socket_ = socket;
+        clients_.append (client);
+
+        connect (socket, &QLocalSocket::readyRead,
+                 this, &ProcRunServer::clientReadyRead);
+        connect (socket, &QLocalSocket::bytesWritten,
+                 this, &ProcRunServer::clientBytesWritten);
+        connect (socket, &QLocalSocket::disconnected,
+                 this, &ProcRunServer::clientDisconnected);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunServer::Client * ProcRunServer::findClient (QLocalSocket * socket)
+{
+    foreach(Client * client, clients_) {
+        if (client->socket_ == socket)
+            return client;
+    }
+    return NULL;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::clientReadyRead ()
+{
+    Client * client = findClient (qobject_cast<QLocalSocket*> (sender ()));
+    if (client == NULL)
+        return;
+
+    client->input_ += client->socket_->readAll ();
+    for (;;) {
+        if (client->input_.size () < HEADER_SIZE)
+            break;
+
+        const uchar * hdr = reinterpret_cast<const uchar*> (
+                    client->input_.constData ());
+        quint16 magic = qFromBigEndian<quint16> (hdr);
+        int type = hdr[2];
+        quint32 size = qFromBigEndian<quint32> (hdr + 3);
+        if ((magic != MAGIC) || (size > MAX_REQUEST)) {
+            PROCRUNGUI_DEBUGM("Dropping client after a malformed frame\n");
+            removeClient (client);
+            return;
+        }
+        if (static_cast<quint32> (client->input_.size ()) <
+                HEADER_SIZE + size)
+            break;
+
+        QByteArray payload = client->input_.mid (
+                    HEADER_SIZE, static_cast<int> (size));
+        client->input_.remove (0, HEADER_SIZE + static_cast<int> (size));
+        handleFrame (client, type, payload);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Subscriptions that were paused resume once the client has read half
+ * of what was waiting.
+ */
+void ProcRunServer::clientBytesWritten ()
+{
+    QLocalSocket * socket = qobject_cast<QLocalSocket*> (sender ());
+    if ((socket == NULL) || dirty_.isEmpty () || flush_timer_.isActive ())
+        return;
+    if (socket->bytesToWrite () < MAX_PENDING / 2) {
+        flush_timer_.start ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::clientDisconnected ()
+{
+    Client * client = findClient (qobject_cast<QLocalSocket*> (sender ()));
+    if (client != NULL) {
+        removeClient (client);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::removeClient (Client * client)
+{
+    clients_.removeOne (client);
+    client->socket_->disconnect (this);
+    client->socket_->abort ();
+    client->socket_->deleteLater ();
+    delete client;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::handleFrame (
+        Client * client, int type, const QByteArray & payload)
+{
+    QDataStream in (payload);
+    in.setVersion (QDataStream::Qt_5_0);
+    quint32 tag = 0;
+    in >> tag;
+
+    switch (type) {
+    case Submit: {
+        ProcRunData data;
+        in >> data.s_program_ >> data.sl_arguments_
+           >> data.s_wrk_dir_ >> data.sl_input_;
+        if ((in.status () != QDataStream::Ok) || data.s_program_.isEmpty ()) {
+            sendError (client, tag, QLatin1String ("malformed submit request"));
+            break;
+        }
+        PrgProcess * proc = gui_->runProgram (data);
+        // nothing starts while the window closes; only a process that
+        // is still owned by the window may become a job
+        if ((proc == NULL) || (gui_->programIndex (proc) == -1)) {
+            sendError (client, tag, QLatin1String ("program was not started"));
+            break;
+        }
+        int job = jobId (proc);
+
+        QByteArray frame;
+        QDataStream out (&frame, QIODevice::WriteOnly);
+        beginFrame (out, Submitted);
+        out << tag << qint32 (job);
+        endFrame (client->socket_, frame);
+        break; }
+    case Subscribe: {
+        qint32 job = -1;
+        qint64 first = 0;
+        in >> job >> first;
+        PrgProcess * proc = jobProcess (job);
+        if ((in.status () != QDataStream::Ok) || (proc == NULL)) {
+            sendError (client, tag, QLatin1String ("no such job"));
+            break;
+        }
+        if (first < 0) {
+            const ProcOutput & output = proc->output_;
+            int count = output.lineCount ();
+            first = count == 0 ? 0 : output.line (count - 1).seq_ + 1;
+        }
+        client->subs_.insert (job, first);
+        sendOk (client, tag);
+        sendOutput (client, job, false);
+        if (jobState (proc) == JobFinished) {
+            sendFinished (job, proc);
+        }
+        break; }
+    case Unsubscribe: {
+        qint32 job = -1;
+        in >> job;
+        client->subs_.remove (job);
+        sendOk (client, tag);
+        break; }
+    case Status: {
+        qint32 job = -1;
+        in >> job;
+        QList<int> jobs;
+        if (job == -1) {
+            int count = gui_->programCount ();
+            for (int i = 0; i < count; ++i) {
+                jobs.append (jobId (gui_->program (i)));
+            }
+        } else if (jobs_.contains (job)) {
+            jobs.append (job);
+        } else {
+            sendError (client, tag, QLatin1String ("no such job"));
+            break;
+        }
+
+        QByteArray frame;
+        QDataStream out (&frame, QIODevice::WriteOnly);
+        beginFrame (out, StatusReply);
+        out << tag << quint32 (jobs.count ());
+        foreach(int j, jobs) {
+            writeStatus (out, j);
+        }
+        endFrame (client->socket_, frame);
+        break; }
+    case Kill: {
+        qint32 job = -1;
+        bool b_force = false;
+        in >> job >> b_force;
+        PrgProcess * proc = jobProcess (job);
+        if ((proc == NULL) || !proc->isRunning ()) {
+            sendError (client, tag, QLatin1String ("job is not running"));
+            break;
+        }
+        if (b_force) {
+            proc->killTree ();
+        } else {
+            proc->terminateTree (gui_->killTimeout ());
+        }
+        sendOk (client, tag);
+        break; }
+    default:
+        sendError (client, tag, QLatin1String ("unknown request"));
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::writeStatus (QDataStream & out, int job)
+{
+    PrgProcess * proc = jobProcess (job);
+    int state = jobState (proc);
+    out << qint32 (job);
+    if (proc == NULL) {
+        out << QString () << quint8 (state) << qint64 (-1) << qint32 (-1)
+            << false << qint64 (0) << qint64 (0) << qint32 (-1);
+        return;
+    }
+
+    bool b_done = state == JobFinished;
+    out << proc->data_.s_program_
+        << quint8 (state)
+        << qint64 (proc->pid_)
+        << qint32 (b_done ? proc->exit_code_ : -1)
+        << (b_done && proc->b_crashed_)
+        << qint64 (proc->output_.lineCount ())
+        << qint64 (proc->output_.byteSize ())
+        << qint32 (proc->filter_ == NULL ? -1 : proc->filter_->progress ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::flush ()
+{
+    QList<int> jobs = dirty_;
+    dirty_.clear ();
+    foreach(int job, jobs) {
+        bool b_throttled = false;
+        foreach(Client * client, clients_) {
+            if (client->subs_.contains (job) &&
+                    !sendOutput (client, job, false)) {
+                b_throttled = true;
+            }
+        }
+        // picked up again when the slow client reads
+        if (b_throttled) {
+            dirty_.append (job);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The text of the lines is copied from the chunks into a frame of up to
+ * MAX_BATCH bytes, which is then handed to the socket.
+ */
+bool ProcRunServer::sendOutput (Client * client, int job, bool b_force)
+{
+    PrgProcess * proc = jobProcess (job);
+    QHash<int, qint64>::iterator it = client->subs_.find (job);
+    if ((proc == NULL) || (it == client->subs_.end ()))
+        return true;
+
+    const ProcOutput & output = proc->output_;
+    int count = output.lineCount ();
+    int idx = output.findSeq (it.value ());
+    while (idx < count) {
+        if (!b_force && (client->socket_->bytesToWrite () > MAX_PENDING))
+            return false;
+
+        QByteArray frame;
+        QDataStream out (&frame, QIODevice::WriteOnly);
+        beginFrame (out, Output);
+        out << qint32 (job);
+        int count_pos = frame.size ();
+        out << quint32 (0);
+
+        quint32 lines = 0;
+        int bytes = 0;
+        do {
+            const ProcOutput::Line & ln = output.line (idx);
+            out << ln.seq_ << quint8 (ln.channel_) << ln.time_ms_;
+            out.writeBytes (output.lineData (ln),
+                            static_cast<uint> (ln.size_));
+            bytes += ln.size_;
+            ++lines;
+            ++idx;
+        } while ((idx < count) && (bytes < MAX_BATCH));
+
+        qToBigEndian<quint32> (lines, frame.data () + count_pos);
+        it.value () = output.line (idx - 1).seq_ + 1;
+        endFrame (client->socket_, frame);
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::sendFinished (int job, PrgProcess * proc)
+{
+    bool b_done = jobState (proc) == JobFinished;
+    foreach(Client * client, clients_) {
+        if (!client->subs_.contains (job))
+            continue;
+
+        sendOutput (client, job, true);
+        client->subs_.remove (job);
+
+        QByteArray frame;
+        QDataStream out (&frame, QIODevice::WriteOnly);
+        beginFrame (out, Finished);
+        out << qint32 (job)
+            << qint32 (b_done ? proc->exit_code_ : -1)
+            << (!b_done || proc->b_crashed_);
+        endFrame (client->socket_, frame);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::sendOk (Client * client, quint32 tag)
+{
+    QByteArray frame;
+    QDataStream out (&frame, QIODevice::WriteOnly);
+    beginFrame (out, Ok);
+    out << tag;
+    endFrame (client->socket_, frame);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::sendError (
+        Client * client, quint32 tag, const QString & s_message)
+{
+    QByteArray frame;
+    QDataStream out (&frame, QIODevice::WriteOnly);
+    beginFrame (out, Error);
+    out << tag << s_message;
+    endFrame (client->socket_, frame);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::beginFrame (QDataStream & out, int type)
+{
+    out.setVersion (QDataStream::Qt_5_0);
+    out << quint16 (MAGIC) << quint8 (type) << quint32 (0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunServer::endFrame (QLocalSocket * socket, QByteArray & frame)
+{
+    qToBigEndian<quint32> (
+                static_cast<quint32> (frame.size () - HEADER_SIZE),
+                frame.data () + 3);
+    socket->write (frame);
+}
+/* ========================================================================= */
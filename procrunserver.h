@@ -0,0 +1,227 @@
+/**
+ * @file procrunserver.h
+ * @brief Declarations for ProcRunServer class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCRUNSERVER_H_INCLUDE
+#define GUARD_PROCRUNSERVER_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QByteArray>
+#include <QString>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QLocalServer;
+class QLocalSocket;
+class QDataStream;
+QT_END_NAMESPACE
+
+class ProcRunGui;
+class PrgProcess;
+
+//! Lets other programs drive a ProcRunGui through a local socket.
+class PROCRUNGUI_EXPORT ProcRunServer : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! Kinds of frames.
+    enum FrameType {
+        Submit = 0x01, /**< client: start a command */
+        Subscribe = 0x02, /**< client: stream the output of a job */
+        Unsubscribe = 0x03, /**< client: stop streaming a job */
+        Status = 0x04, /**< client: ask about one or all jobs */
+        Kill = 0x05, /**< client: end a job */
+
+        Submitted = 0x81, /**< server: the job for a Submit */
+        Output = 0x82, /**< server: a batch of lines */
+        StatusReply = 0x83, /**< server: the answer to Status */
+        Finished = 0x84, /**< server: a subscribed job has ended */
+        Ok = 0x85, /**< server: a request with no other answer was done */
+        Error = 0x8f /**< server: a request could not be honored */
+    };
+
+    //! State of a job as reported by Status.
+    enum JobState {
+        JobStarting = 0, /**< not running yet */
+        JobRunning = 1, /**< running */
+        JobFinished = 2, /**< ended; exit code is valid */
+        JobGone = 3 /**< the tab was closed */
+    };
+
+    //! Protocol limits.
+    enum {
+        MAGIC = 0x5052, /**< first two bytes of each frame ("PR") */
+        HEADER_SIZE = 7, /**< magic, type and payload size */
+        MAX_REQUEST = 1024 * 1024, /**< larger client frames drop the client */
+        MAX_BATCH = 256 * 1024, /**< bytes of text in one Output frame */
+        MAX_PENDING = 4 * 1024 * 1024, /**< unsent bytes that pause streaming */
+        FLUSH_MS = 20 /**< output is gathered this long before sending */
+    };
+
+    //! Default constructor.
+    ProcRunServer (
+            ProcRunGui * gui);
+
+    //! Destructor.
+    virtual ~ProcRunServer();
+
+    //! Start accepting clients on @a s_name; false if that failed.
+    bool
+    listen (
+            const QString & s_name);
+
+    //! Stop accepting clients and drop the ones that are connected.
+    void
+    close ();
+
+    //! Tell if we are accepting clients.
+    bool
+    isListening () const;
+
+    //! Full path of the socket (empty if not listening).
+    QString
+    serverPath () const;
+
+    //! Number of connected clients.
+    int
+    clientCount () const {
+        return clients_.count ();
+    }
+
+    //! Identifier of a process, assigned on first use.
+    int
+    jobId (
+            PrgProcess * proc);
+
+public slots:
+
+    //! A process has new output.
+    void
+    processOutput (
+            PrgProcess * proc);
+
+    //! A process has ended.
+    void
+    processFinished (
+            PrgProcess * proc);
+
+    //! A process is about to be deleted.
+    void
+    processRemoved (
+            PrgProcess * proc);
+
+private slots:
+
+    void
+    newConnection ();
+
+    void
+    clientReadyRead ();
+
+    void
+    clientBytesWritten ();
+
+    void
+    clientDisconnected ();
+
+    //! Send pending output to subscribers.
+    void
+    flush ();
+
+private:
+
+    //! A connected client.
+    struct Client {
+        QLocalSocket * socket_; /**< the connection */
+        QByteArray input_; /**< received bytes not yet parsed */
+        QHash<int, qint64> subs_; /**< next sequence number for each job */
+    };
+
+    //! Find the client for a socket (NULL if none).
+    Client *
+    findClient (
+            QLocalSocket * socket);
+
+    //! The process for a job (NULL if gone).
+    PrgProcess *
+    jobProcess (
+            int job) const;
+
+    //! Act on a complete frame from a client.
+    void
+    handleFrame (
+            Client * client,
+            int type,
+            const QByteArray & payload);
+
+    //! Send new lines of a job to a client; false if it was throttled.
+    bool
+    sendOutput (
+            Client * client,
+            int job,
+            bool b_force);
+
+    //! Send Finished for a job to its subscribers and drop them.
+    void
+    sendFinished (
+            int job,
+            PrgProcess * proc);
+
+    //! Append the Status record of a job.
+    void
+    writeStatus (
+            QDataStream & out,
+            int job);
+
+    //! Tell a client that a request was done.
+    void
+    sendOk (
+            Client * client,
+            quint32 tag);
+
+    //! Tell a client that a request failed.
+    void
+    sendError (
+            Client * client,
+            quint32 tag,
+            const QString & s_message);
+
+    //! Write the header of a frame; the payload follows.
+    static void
+    beginFrame (
+            QDataStream & out,
+            int type);
+
+    //! Fill in the payload size and send the frame.
+    static void
+    endFrame (
+            QLocalSocket * socket,
+            QByteArray & frame);
+
+    //! Drop a client.
+    void
+    removeClient (
+            Client * client);
+
+    ProcRunGui * gui_; /**< the widget that runs the processes */
+    QLocalServer * server_; /**< accepts connections */
+    QList<Client*> clients_; /**< connected clients */
+    QHash<int, QPointer<PrgProcess> > jobs_; /**< processes by job id */
+    QHash<PrgProcess*, int> ids_; /**< job ids by process */
+    QList<int> dirty_; /**< jobs with output not yet sent */
+    QTimer flush_timer_; /**< gathers output before it is sent */
+    int next_job_; /**< id of the next job */
+};
+
+#endif // GUARD_PROCRUNSERVER_H_INCLUDE
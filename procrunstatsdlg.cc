@@ -0,0 +1,154 @@
+/**
+ * @file procrunstatsdlg.cc
+ * @brief Definitions for ProcRunStatsDlg class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procrunstatsdlg.h"
+#include "ui_procrunstatsdlg.h"
+#include "procrunhistory.h"
+#include "procrungui.h"
+
+#include "procrungui-private.h"
+
+#include <procrun/procrunmodel.h>
+
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+
+/**
+ * @class ProcRunStatsDlg
+ *
+ * The tree of saved commands is mirrored in the dialog; each command
+ * shows the number of runs, failures and duration percentiles
+ * recorded in the run history.
+ */
+
+enum StatColumns {
+    COL_NAME = 0,
+    COL_RUNS,
+    COL_FAILURES,
+    COL_P50,
+    COL_P95,
+    COL_LAST,
+    COL_RSS
+};
+
+//! A row that sorts durations and sizes by value rather than by text.
+class StatItem : public QTreeWidgetItem {
+public:
+
+    //! Constructor.
+    StatItem (QTreeWidgetItem * parent) :
+        QTreeWidgetItem (parent)
+    {}
+
+    //! Show @a value (-1 if unknown) as @a s_text and sort by @a value.
+    void
+    setValue (
+            int column,
+            qint64 value,
+            const QString & s_text) {
+        setText (column, s_text);
+        setData (column, Qt::UserRole, value);
+    }
+
+    //! Columns with a raw value compare that; unknown ones go first.
+    bool
+    operator< (
+            const QTreeWidgetItem & other) const {
+        int column = treeWidget () == NULL ? 0 : treeWidget ()->sortColumn ();
+        QVariant mine = data (column, Qt::UserRole);
+        QVariant theirs = other.data (column, Qt::UserRole);
+        if (!mine.isValid () && !theirs.isValid ())
+            return QTreeWidgetItem::operator< (other);
+        qint64 a = mine.isValid () ? mine.toLongLong () : -1;
+        qint64 b = theirs.isValid () ? theirs.toLongLong () : -1;
+        return a < b;
+    }
+};
+
+/* ------------------------------------------------------------------------- */
+ProcRunStatsDlg::ProcRunStatsDlg (
+        ProcRunModel * model, const ProcRunHistory & history,
+        QWidget *parent) :
+    QDialog (parent),
+    ui (new Ui::ProcRunStatsDlg ()),
+    model_ (model),
+    history_ (history)
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    ui->setupUi (this);
+
+    ui->treeWidget->setSortingEnabled (false);
+    if (model_ != NULL) {
+        addChildren (QModelIndex (), ui->treeWidget->invisibleRootItem ());
+    }
+    ui->treeWidget->expandAll ();
+    ui->treeWidget->setSortingEnabled (true);
+    ui->treeWidget->resizeColumnToContents (COL_NAME);
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcRunStatsDlg::~ProcRunStatsDlg()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    delete ui;
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcRunStatsDlg::formatDuration (qint64 ms)
+{
+    if (ms < 0)
+        return QString ();
+    if (ms < 1000)
+        return tr ("%1 ms").arg (ms);
+    if (ms < 60000)
+        return tr ("%1 s").arg (ms / 1000.0, 0, 'f', 2);
+    return tr ("%1:%2 min")
+            .arg (ms / 60000)
+            .arg ((ms / 1000) % 60, 2, 10, QChar ('0'));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcRunStatsDlg::addChildren (
+        const QModelIndex & parent, QTreeWidgetItem * parent_item)
+{
+    int i_max = model_->rowCount (parent);
+    for (int i = 0; i < i_max; ++i) {
+        QModelIndex mi = model_->index (i, 0, parent);
+        ProcRunItemBase * it = model_->itemFromIndex (mi);
+        if (it == NULL)
+            continue;
+
+        StatItem * twi = new StatItem (parent_item);
+        twi->setText (COL_NAME, mi.data (Qt::DisplayRole).toString ());
+        twi->setIcon (COL_NAME, mi.data (Qt::DecorationRole).value<QIcon> ());
+
+        if (it->type () == ProcRunItemBase::GroupType) {
+            addChildren (mi, twi);
+        } else if (it->type () == ProcRunItemBase::CommandType) {
+            ProcRunStats st = history_.stats (
+                        ProcRunGui::commandKey (
+                            *static_cast<ProcRunItem*>(it)));
+            twi->setData (COL_RUNS, Qt::DisplayRole, st.runs_);
+            twi->setData (COL_FAILURES, Qt::DisplayRole, st.failures_);
+            twi->setValue (COL_P50, st.p50_, formatDuration (st.p50_));
+            twi->setValue (COL_P95, st.p95_, formatDuration (st.p95_));
+            twi->setValue (COL_LAST, st.last_, formatDuration (st.last_));
+            twi->setValue (COL_RSS, st.peak_rss_, st.peak_rss_ < 0 ?
+                               QString () :
+                               tr ("%1 MiB").arg (
+                                   st.peak_rss_ / 1024.0, 0, 'f', 1));
+        }
+    }
+}
+/* ========================================================================= */
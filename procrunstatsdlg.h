@@ -0,0 +1,62 @@
+/**
+ * @file procrunstatsdlg.h
+ * @brief Declarations for ProcRunStatsDlg class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCRUNSTATSDLG_H_INCLUDE
+#define GUARD_PROCRUNSTATSDLG_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QDialog>
+
+QT_BEGIN_NAMESPACE
+class QModelIndex;
+class QTreeWidgetItem;
+QT_END_NAMESPACE
+
+namespace Ui {
+class ProcRunStatsDlg;
+}
+
+class ProcRunModel;
+class ProcRunHistory;
+
+//! Shows duration statistics for saved commands.
+class PROCRUNGUI_EXPORT ProcRunStatsDlg : public QDialog {
+    Q_OBJECT
+
+public:
+
+    //! Default constructor.
+    ProcRunStatsDlg (
+            ProcRunModel * model,
+            const ProcRunHistory & history,
+            QWidget *parent = NULL);
+
+    //! Destructor.
+    virtual ~ProcRunStatsDlg();
+
+    //! Format a duration given in milliseconds.
+    static QString
+    formatDuration (
+            qint64 ms);
+
+private:
+
+    //! Add the children of an entry in the model.
+    void
+    addChildren (
+            const QModelIndex & parent,
+            QTreeWidgetItem * parent_item);
+
+    Ui::ProcRunStatsDlg *ui; /**< ui components */
+    ProcRunModel * model_; /**< saved commands */
+    const ProcRunHistory & history_; /**< source of statistics */
+};
+
+#endif // GUARD_PROCRUNSTATSDLG_H_INCLUDE
@@ -0,0 +1,188 @@
+/**
+ * @file procsession.cc
+ * @brief Definitions for ProcSession class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procsession.h"
+#include "outputlog.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+#include <QStandardPaths>
+#include <QDir>
+#include <QStringList>
+
+#include <algorithm>
+
+/**
+ * @class ProcSession
+ *
+ * The session file is an ini with a group for each process (named after
+ * its id) and the output of each process is spilled next to it by an
+ * OutputLog. Every change is synced right away, so what is on disk
+ * after a crash is as good as what a clean exit leaves behind; a
+ * process that was still running then is recognized by the missing end.
+ */
+
+#define STG_SESSION_FILE "session.ini"
+#define STG_SESSION_NEXT "NextId"
+#define STG_SESSION_PROGRAM "Program"
+#define STG_SESSION_ARGS "Arguments"
+#define STG_SESSION_WRKDIR "WorkingDirectory"
+#define STG_SESSION_INPUT "Input"
+#define STG_SESSION_RUNNING "Running"
+#define STG_SESSION_EXIT "ExitCode"
+#define STG_SESSION_CRASHED "Crashed"
+#define STG_SESSION_START "Start"
+#define STG_SESSION_END "End"
+
+/* ------------------------------------------------------------------------- */
+ProcSession::ProcSession () :
+    stg_ (NULL),
+    s_dir_ ()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcSession::~ProcSession()
+{
+    delete stg_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The default session lives in the application data directory.
+ */
+bool ProcSession::open (const QString & s_dir)
+{
+    delete stg_;
+    stg_ = NULL;
+
+    s_dir_ = s_dir;
+    if (s_dir_.isEmpty ()) {
+        s_dir_ = QStandardPaths::writableLocation (
+                    QStandardPaths::AppDataLocation) +
+                QLatin1String ("/session");
+    }
+    QDir dr (s_dir_);
+    if (!dr.mkpath (QLatin1String ("."))) {
+        PROCRUNGUI_DEBUGM("Cannot create session directory %s\n",
+                          TMP_A(s_dir_));
+        return false;
+    }
+    stg_ = new QSettings (dr.absoluteFilePath (
+                              QLatin1String (STG_SESSION_FILE)),
+                          QSettings::IniFormat);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcSession::add (const ProcRunData & data, qint64 start_ms)
+{
+    if (stg_ == NULL)
+        return -1;
+
+    int id = stg_->value (QLatin1String (STG_SESSION_NEXT), 1).toInt ();
+    stg_->setValue (QLatin1String (STG_SESSION_NEXT), id + 1);
+    stg_->beginGroup (QString::number (id));
+    stg_->setValue (QLatin1String (STG_SESSION_PROGRAM), data.s_program_);
+    stg_->setValue (QLatin1String (STG_SESSION_ARGS), data.sl_arguments_);
+    stg_->setValue (QLatin1String (STG_SESSION_WRKDIR), data.s_wrk_dir_);
+    stg_->setValue (QLatin1String (STG_SESSION_INPUT), data.sl_input_);
+    stg_->setValue (QLatin1String (STG_SESSION_RUNNING), true);
+    stg_->setValue (QLatin1String (STG_SESSION_START), start_ms);
+    stg_->endGroup ();
+    stg_->sync ();
+    return id;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcSession::finish (
+        int id, int exit_code, bool b_crashed, qint64 end_ms)
+{
+    if ((stg_ == NULL) || (id <= 0))
+        return;
+    stg_->beginGroup (QString::number (id));
+    stg_->setValue (QLatin1String (STG_SESSION_RUNNING), false);
+    stg_->setValue (QLatin1String (STG_SESSION_EXIT), exit_code);
+    stg_->setValue (QLatin1String (STG_SESSION_CRASHED), b_crashed);
+    stg_->setValue (QLatin1String (STG_SESSION_END), end_ms);
+    stg_->endGroup ();
+    stg_->sync ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcSession::remove (int id)
+{
+    if ((stg_ == NULL) || (id <= 0))
+        return;
+    stg_->remove (QString::number (id));
+    stg_->sync ();
+    OutputLog::remove (logBase (id));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<ProcSession::Item> ProcSession::items () const
+{
+    QList<Item> result;
+    if (stg_ == NULL)
+        return result;
+
+    QList<int> ids;
+    foreach(const QString & s_group, stg_->childGroups ()) {
+        bool b_ok;
+        int id = s_group.toInt (&b_ok);
+        if (b_ok && (id > 0)) {
+            ids.append (id);
+        }
+    }
+    std::sort (ids.begin (), ids.end ());
+
+    foreach(int id, ids) {
+        Item item;
+        item.id_ = id;
+        stg_->beginGroup (QString::number (id));
+        item.data_.s_program_ =
+                stg_->value (QLatin1String (STG_SESSION_PROGRAM)).toString ();
+        item.data_.sl_arguments_ =
+                stg_->value (QLatin1String (STG_SESSION_ARGS)).toStringList ();
+        item.data_.s_wrk_dir_ =
+                stg_->value (QLatin1String (STG_SESSION_WRKDIR)).toString ();
+        item.data_.sl_input_ =
+                stg_->value (QLatin1String (STG_SESSION_INPUT)).toStringList ();
+        item.b_running_ =
+                stg_->value (QLatin1String (STG_SESSION_RUNNING), true).toBool ();
+        item.exit_code_ =
+                stg_->value (QLatin1String (STG_SESSION_EXIT), -1).toInt ();
+        item.b_crashed_ =
+                stg_->value (QLatin1String (STG_SESSION_CRASHED), false).toBool ();
+        item.start_ms_ =
+                stg_->value (QLatin1String (STG_SESSION_START), 0).toLongLong ();
+        item.end_ms_ =
+                stg_->value (QLatin1String (STG_SESSION_END), 0).toLongLong ();
+        stg_->endGroup ();
+        if (!item.data_.s_program_.isEmpty ()) {
+            result.append (item);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ProcSession::logBase (int id) const
+{
+    return QDir (s_dir_).absoluteFilePath (QString::number (id));
+}
+/* ========================================================================= */
@@ -0,0 +1,98 @@
+/**
+ * @file procsession.h
+ * @brief Declarations for ProcSession class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCSESSION_H_INCLUDE
+#define GUARD_PROCSESSION_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrun/procrundata.h>
+
+#include <QString>
+#include <QList>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+//! The processes in the tabs, kept on disk so they can be shown again.
+class PROCRUNGUI_EXPORT ProcSession {
+
+public:
+
+    //! What is known about a process.
+    struct Item {
+        int id_; /**< identifies the process in the session */
+        ProcRunData data_; /**< what was run */
+        bool b_running_; /**< the end was not recorded */
+        int exit_code_; /**< exit code (or signal) */
+        bool b_crashed_; /**< ended abnormally or could not start */
+        qint64 start_ms_; /**< when it started (ms since epoch) */
+        qint64 end_ms_; /**< when it ended (ms since epoch, 0 if running) */
+    };
+
+    //! Default constructor.
+    ProcSession ();
+
+    //! Destructor.
+    virtual ~ProcSession();
+
+    //! Use the session in @a s_dir (the default one if empty).
+    bool
+    open (
+            const QString & s_dir = QString ());
+
+    //! Tell if a session is open.
+    bool
+    isOpen () const {
+        return stg_ != NULL;
+    }
+
+    //! The directory holding the session.
+    const QString &
+    directory () const {
+        return s_dir_;
+    }
+
+    //! Record a process that started; returns its id (-1 if not open).
+    int
+    add (
+            const ProcRunData & data,
+            qint64 start_ms);
+
+    //! Record the end of a process.
+    void
+    finish (
+            int id,
+            int exit_code,
+            bool b_crashed,
+            qint64 end_ms);
+
+    //! Forget a process and delete its log.
+    void
+    remove (
+            int id);
+
+    //! The processes in the session, oldest first.
+    QList<Item>
+    items () const;
+
+    //! Base name of the log of a process (see OutputLog).
+    QString
+    logBase (
+            int id) const;
+
+private:
+
+    Q_DISABLE_COPY(ProcSession)
+
+    QSettings * stg_; /**< the session file or NULL */
+    QString s_dir_; /**< where the session and the logs are */
+};
+
+#endif // GUARD_PROCSESSION_H_INCLUDE
@@ -0,0 +1,152 @@
+/**
+ * @file procshutdown.cc
+ * @brief Definitions for ProcShutdown class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "procshutdown.h"
+#include "prgprocess.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class ProcShutdown
+ *
+ * All processes are asked to terminate in the same pass (each one
+ * escalates to a kill on its own after the kill timeout). The instance
+ * then waits for state changes from the event loop; nothing here
+ * sleeps or calls waitForFinished ().
+ *
+ * When the deadline is reached the remaining process trees are killed
+ * and, after a short grace period, finished (false) is emitted
+ * regardless of what is still around.
+ */
+
+//! Time given to killed processes to be reaped after the deadline.
+#define SHUTDOWN_GRACE_MS 1000
+
+/* ------------------------------------------------------------------------- */
+ProcShutdown::ProcShutdown (
+        const QList<PrgProcess*> & processes, int kill_timeout_ms,
+        int deadline_ms, QObject *parent) :
+    QObject (parent),
+    processes_ (),
+    total_ (processes.count ()),
+    kill_timeout_ (kill_timeout_ms),
+    deadline_ (deadline_ms),
+    deadline_timer_ (),
+    b_forced_ (false),
+    b_finished_ (false)
+{
+    foreach(PrgProcess * proc, processes) {
+        processes_.append (QPointer<PrgProcess> (proc));
+    }
+    deadline_timer_.setSingleShot (true);
+    connect (&deadline_timer_, SIGNAL(timeout()),
+             this, SLOT(deadlineReached()));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProcShutdown::~ProcShutdown()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::start ()
+{
+    PROCRUNGUI_TRACE_ENTRY;
+    foreach(const QPointer<PrgProcess> & proc, processes_) {
+        if (proc.isNull ())
+            continue;
+        connect (proc.data (), SIGNAL(ended()),
+                 this, SLOT(processEnded()));
+        connect (proc.data (), SIGNAL(destroyed()),
+                 this, SLOT(processDestroyed()), Qt::QueuedConnection);
+        proc->terminateTree (kill_timeout_);
+    }
+    deadline_timer_.start (deadline_);
+    check ();
+    PROCRUNGUI_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProcShutdown::remaining () const
+{
+    int result = 0;
+    foreach(const QPointer<PrgProcess> & proc, processes_) {
+        if (!proc.isNull () && proc->isRunning ()) {
+            ++result;
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::processEnded ()
+{
+    check ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::processDestroyed ()
+{
+    check ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::forceNow ()
+{
+    if (b_forced_)
+        return;
+    b_forced_ = true;
+
+    foreach(const QPointer<PrgProcess> & proc, processes_) {
+        if (!proc.isNull () && proc->isRunning ()) {
+            proc->killTree ();
+        }
+    }
+    deadline_timer_.start (SHUTDOWN_GRACE_MS);
+    check ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::deadlineReached ()
+{
+    if (!b_forced_) {
+        PROCRUNGUI_DEBUGM("Shutdown deadline reached with %d processes left\n",
+                          remaining ());
+        forceNow ();
+    } else if (!b_finished_) {
+        PROCRUNGUI_DEBUGM("%d processes could not be reaped in time\n",
+                          remaining ());
+        b_finished_ = true;
+        emit finished (false);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcShutdown::check ()
+{
+    if (b_finished_)
+        return;
+
+    int left = remaining ();
+    emit progress (total_ - left, total_);
+    if (left == 0) {
+        deadline_timer_.stop ();
+        b_finished_ = true;
+        emit finished (true);
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,98 @@
+/**
+ * @file procshutdown.h
+ * @brief Declarations for ProcShutdown class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCSHUTDOWN_H_INCLUDE
+#define GUARD_PROCSHUTDOWN_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <QProcess>
+
+class PrgProcess;
+
+//! Ends a set of processes at once and waits for them without blocking.
+class PROCRUNGUI_EXPORT ProcShutdown : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! Default constructor.
+    ProcShutdown (
+            const QList<PrgProcess*> & processes,
+            int kill_timeout_ms,
+            int deadline_ms,
+            QObject *parent = NULL);
+
+    //! Destructor.
+    virtual ~ProcShutdown();
+
+    //! Signal all processes.
+    void
+    start ();
+
+    //! Number of processes we are waiting for.
+    int
+    total () const {
+        return total_;
+    }
+
+    //! Number of processes that are still running.
+    int
+    remaining () const;
+
+public slots:
+
+    //! Kill whatever is left and stop waiting soon.
+    void
+    forceNow ();
+
+signals:
+
+    //! The number of processes that are still running has changed.
+    void
+    progress (
+            int done,
+            int total);
+
+    //! Waiting ended; @a b_all_reaped is false if the deadline was reached.
+    void
+    finished (
+            bool b_all_reaped);
+
+private slots:
+
+    void
+    processEnded ();
+
+    void
+    processDestroyed ();
+
+    void
+    deadlineReached ();
+
+private:
+
+    //! Check if we are done and emit the signals.
+    void
+    check ();
+
+    QList<QPointer<PrgProcess> > processes_; /**< what we wait for */
+    int total_; /**< initial number of processes */
+    int kill_timeout_; /**< milliseconds between terminate and kill */
+    int deadline_; /**< milliseconds until we stop waiting */
+    QTimer deadline_timer_; /**< fires when the deadline is reached */
+    bool b_forced_; /**< remaining processes were killed */
+    bool b_finished_; /**< the finished signal was emitted */
+};
+
+#endif // GUARD_PROCSHUTDOWN_H_INCLUDE
@@ -0,0 +1,232 @@
+/**
+ * @file proctree.cc
+ * @brief Definitions for ProcTree class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "proctree.h"
+
+#include "procrungui-private.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+
+#ifdef Q_OS_UNIX
+#   include <sys/types.h>
+#   include <signal.h>
+#   include <unistd.h>
+#   include <errno.h>
+#endif
+
+/**
+ * @class ProcTree
+ *
+ * On Linux the children started by ProcRunGui become leaders of their
+ * own session, so everything they start (unless it detaches itself)
+ * shares their process group and can be signaled at once.
+ * Descendants are also discovered by walking /proc so that the ones
+ * that created their own group can still be reached and reported.
+ *
+ * Process ids are reused, so a process seen earlier is remembered
+ * together with its start time; collect () only keeps it while an
+ * entry with the same id and start time exists. A walk reads each
+ * /proc/[pid]/stat once, whatever the size of the tree.
+ *
+ * On other platforms the functions do nothing and the caller should
+ * fall back to QProcess::terminate () and QProcess::kill ().
+ */
+
+#ifdef Q_OS_LINUX
+/* ------------------------------------------------------------------------- */
+//! Parsed content of /proc/[pid]/stat that we care about.
+struct ProcStat {
+    qint64 pid_;
+    qint64 ppid_;
+    qint64 pgrp_;
+    qint64 start_;
+    char state_;
+};
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static bool readProcStat (qint64 pid, ProcStat & result)
+{
+    QFile f (QString (QLatin1String ("/proc/%1/stat")).arg (pid));
+    if (!f.open (QIODevice::ReadOnly))
+        return false;
+    QByteArray content = f.readAll ();
+
+    // the name is in parentheses and may contain spaces
+    int name_end = content.lastIndexOf (')');
+    if (name_end == -1)
+        return false;
+    // fields are numbered from the state, which is the third one
+    QList<QByteArray> fields = content.mid (name_end + 2).split (' ');
+    if (fields.count () < 20)
+        return false;
+
+    result.pid_ = pid;
+    result.state_ = fields.at (0).isEmpty () ? '?' : fields.at (0).at (0);
+    result.ppid_ = fields.at (1).toLongLong ();
+    result.pgrp_ = fields.at (2).toLongLong ();
+    result.start_ = fields.at (19).toLongLong ();
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static QList<ProcStat> allProcesses ()
+{
+    QList<ProcStat> result;
+    QDir dr (QLatin1String ("/proc"));
+    foreach(const QString & s_name, dr.entryList (QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool b_ok;
+        qint64 pid = s_name.toLongLong (&b_ok);
+        if (!b_ok)
+            continue;
+        ProcStat st;
+        if (readProcStat (pid, st)) {
+            result.append (st);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+#endif // Q_OS_LINUX
+
+/* ------------------------------------------------------------------------- */
+bool ProcTree::hasProcessGroups ()
+{
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Only async-signal-safe calls are allowed here as this runs in
+ * the child between fork () and exec ().
+ */
+void ProcTree::becomeGroupLeader ()
+{
+#ifdef Q_OS_UNIX
+    ::setsid ();
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A @a pid or @a pgid that is not positive is not looked for. Zombies
+ * are left out; they are dead and only wait to be reaped.
+ */
+QList<ProcTree::Member> ProcTree::collect (
+        qint64 pid, qint64 pgid, const QList<Member> & known)
+{
+    QList<Member> result;
+#ifdef Q_OS_LINUX
+    QHash<qint64, ProcStat> table;
+    QMultiHash<qint64, qint64> children;
+    foreach(const ProcStat & st, allProcesses ()) {
+        table.insert (st.pid_, st);
+        children.insert (st.ppid_, st.pid_);
+    }
+
+    QSet<qint64> seen;
+    QList<qint64> candidates;
+
+    // the id of a process we knew may now belong to another one
+    foreach(const Member & member, known) {
+        QHash<qint64, ProcStat>::const_iterator it =
+                table.constFind (member.pid_);
+        if ((it != table.constEnd ()) &&
+                (it.value ().start_ == member.start_)) {
+            candidates.append (member.pid_);
+        }
+    }
+    if (pgid > 0) {
+        foreach(const ProcStat & st, table) {
+            if (st.pgrp_ == pgid) {
+                candidates.append (st.pid_);
+            }
+        }
+    }
+    if (pid > 0) {
+        QSet<qint64> visited;
+        QList<qint64> pending;
+        pending.append (pid);
+        while (!pending.isEmpty ()) {
+            qint64 crt = pending.takeLast ();
+            foreach(qint64 child, children.values (crt)) {
+                if (!visited.contains (child)) {
+                    visited.insert (child);
+                    candidates.append (child);
+                    pending.append (child);
+                }
+            }
+        }
+    }
+
+    foreach(qint64 crt, candidates) {
+        if (seen.contains (crt))
+            continue;
+        seen.insert (crt);
+        const ProcStat & st = table[crt];
+        if (st.state_ == 'Z')
+            continue;
+        Member member;
+        member.pid_ = crt;
+        member.start_ = st.start_;
+        result.append (member);
+    }
+#else
+    Q_UNUSED(pid);
+    Q_UNUSED(pgid);
+    Q_UNUSED(known);
+#endif
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<qint64> ProcTree::pids (const QList<Member> & members)
+{
+    QList<qint64> result;
+    foreach(const Member & member, members) {
+        result.append (member.pid_);
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProcTree::sendSignal (qint64 pgid, const QList<qint64> & pids, Signal sig)
+{
+#ifdef Q_OS_UNIX
+    int signo = (sig == Kill) ? SIGKILL : SIGTERM;
+    if (pgid > 0) {
+        if (::killpg (static_cast<pid_t>(pgid), signo) != 0) {
+            PROCRUNGUI_DEBUGM("killpg (%lld) failed with %d\n", pgid, errno);
+        }
+    }
+    foreach(qint64 pid, pids) {
+        if (pid > 0) {
+            ::kill (static_cast<pid_t>(pid), signo);
+        }
+    }
+#else
+    Q_UNUSED(pgid);
+    Q_UNUSED(pids);
+    Q_UNUSED(sig);
+#endif
+}
+/* ========================================================================= */
+
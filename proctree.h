@@ -0,0 +1,63 @@
+/**
+ * @file proctree.h
+ * @brief Declarations for ProcTree class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROCTREE_H_INCLUDE
+#define GUARD_PROCTREE_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QList>
+
+//! Helpers for dealing with a process and all its descendants.
+class PROCRUNGUI_EXPORT ProcTree {
+
+public:
+
+    //! The signal to send.
+    enum Signal {
+        Terminate, /**< ask politely (SIGTERM) */
+        Kill /**< no way to refuse (SIGKILL) */
+    };
+
+    //! A process that can be told apart from a later one with the same id.
+    struct Member {
+        qint64 pid_; /**< process id */
+        qint64 start_; /**< start time in clock ticks after boot */
+    };
+
+    //! Tell if process groups are supported on this platform.
+    static bool
+    hasProcessGroups ();
+
+    //! Make the calling process the leader of a new session and group.
+    static void
+    becomeGroupLeader ();
+
+    //! Live descendants of @a pid, members of group @a pgid and @a known
+    //! processes that still exist, from a single walk of /proc.
+    static QList<Member>
+    collect (
+            qint64 pid,
+            qint64 pgid,
+            const QList<Member> & known = QList<Member> ());
+
+    //! The ids of a list of processes.
+    static QList<qint64>
+    pids (
+            const QList<Member> & members);
+
+    //! Send a signal to a process group and to a list of processes.
+    static void
+    sendSignal (
+            qint64 pgid,
+            const QList<qint64> & pids,
+            Signal sig);
+};
+
+#endif // GUARD_PROCTREE_H_INCLUDE
@@ -0,0 +1,381 @@
+/**
+ * @file resultcache.cc
+ * @brief Definitions for ResultCache class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "resultcache.h"
+#include "launchprofile.h"
+#include "outputfilter.h"
+#include "commandtemplate.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+/**
+ * @class ResultCache
+ *
+ * The key of a run is a hash over the content of the program binary,
+ * the arguments, the working directory, the environment overrides of
+ * its LaunchProfile, the saved input and the content of the files the
+ * command declares that it reads. What is stored is the output as we
+ * kept it, so the OutputFilterConfig and the use of a pseudo-terminal
+ * (which merges the channels) also go in. Only what is declared is
+ * looked at; a command that reads other files or depends on the time,
+ * the network or inherited environment variables should not be cached.
+ *
+ * Hashing the content of a file is what costs, so the hash is kept
+ * with the size and the modification time of the file and is reused
+ * as long as those do not change; the hashes survive restarts in an
+ * index next to the results.
+ *
+ * Each result is a file named after its key with the exit code and the
+ * lines of output (as they were stored, without colors).
+ */
+
+#define STG_CACHE_GROUP "ResultCache"
+#define STG_CACHE_ENABLED "Enabled"
+#define STG_CACHE_INPUTS "Inputs"
+
+//! First bytes of a stored run.
+#define RESULT_MAGIC 0x50524331
+//! First bytes of the index of file hashes.
+#define INDEX_MAGIC 0x50524349
+//! Layout of the files written by this version.
+#define RESULT_VERSION 1
+
+/* ------------------------------------------------------------------------- */
+void CacheConfig::load (QSettings & stg, const QString & s_key)
+{
+    stg.beginGroup (QLatin1String (STG_CACHE_GROUP));
+    stg.beginGroup (s_key);
+    b_enabled_ = stg.value (QLatin1String (STG_CACHE_ENABLED), false).toBool ();
+    s_inputs_ = stg.value (QLatin1String (STG_CACHE_INPUTS)).toString ();
+    stg.endGroup ();
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void CacheConfig::save (QSettings & stg, const QString & s_key) const
+{
+    stg.beginGroup (QLatin1String (STG_CACHE_GROUP));
+    if (isEmpty ()) {
+        stg.remove (s_key);
+    } else {
+        stg.beginGroup (s_key);
+        stg.setValue (QLatin1String (STG_CACHE_ENABLED), b_enabled_);
+        stg.setValue (QLatin1String (STG_CACHE_INPUTS), s_inputs_);
+        stg.endGroup ();
+    }
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ResultCache::ResultCache () :
+    s_dir_ (QStandardPaths::writableLocation (
+                QStandardPaths::CacheLocation) +
+            QLatin1String ("/results")),
+    files_ (),
+    b_index_loaded_ (false),
+    b_index_dirty_ (false)
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ResultCache::~ResultCache()
+{
+    saveIndex ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ResultCache::setDirectory (const QString & s_dir)
+{
+    saveIndex ();
+    s_dir_ = s_dir;
+    files_.clear ();
+    b_index_loaded_ = false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A program given by name is looked up in the PATH, a relative one in
+ * the working directory.
+ */
+QString ResultCache::key (
+        const ProcRunData & data, const LaunchProfile & profile,
+        const OutputFilterConfig & filter, bool b_use_pty,
+        const CacheConfig & config)
+{
+    QString s_program = data.s_program_;
+    if (!s_program.contains (QChar ('/')) && !s_program.contains (QChar ('\\'))) {
+        QString s_found = QStandardPaths::findExecutable (s_program);
+        if (!s_found.isEmpty ()) {
+            s_program = s_found;
+        }
+    } else if (QDir::isRelativePath (s_program) && !data.s_wrk_dir_.isEmpty ()) {
+        s_program = QDir (data.s_wrk_dir_).filePath (s_program);
+    }
+    QByteArray program_hash = fileHash (s_program);
+    if (program_hash.isEmpty ()) {
+        PROCRUNGUI_DEBUGM("Not caching %s: the program can't be read\n",
+                          TMP_A(data.s_program_));
+        return QString ();
+    }
+
+    QCryptographicHash hsh (QCryptographicHash::Sha1);
+    hsh.addData (program_hash);
+    foreach(const QString & s_arg, data.sl_arguments_) {
+        hsh.addData ("\0a", 2);
+        hsh.addData (s_arg.toUtf8 ());
+    }
+    hsh.addData ("\0w", 2);
+    hsh.addData (data.s_wrk_dir_.toUtf8 ());
+    foreach(const QString & s_env, profile.sl_env_) {
+        hsh.addData ("\0e", 2);
+        hsh.addData (s_env.toUtf8 ());
+    }
+    foreach(const QString & s_input, data.sl_input_) {
+        hsh.addData ("\0i", 2);
+        hsh.addData (s_input.toUtf8 ());
+    }
+    hsh.addData ("\0+", 2);
+    hsh.addData (filter.s_include_.toUtf8 ());
+    hsh.addData ("\0-", 2);
+    hsh.addData (filter.s_exclude_.toUtf8 ());
+    hsh.addData ("\0%", 2);
+    hsh.addData (filter.s_progress_.toUtf8 ());
+    hsh.addData (filter.b_collapse_ ? "\0c" : "\0n", 2);
+    hsh.addData (b_use_pty ? "\0t" : "\0p", 2);
+    foreach(const QString & s_file, expandInputs (config.s_inputs_, data.s_wrk_dir_)) {
+        QString s_path = s_file;
+        if (QDir::isRelativePath (s_path) && !data.s_wrk_dir_.isEmpty ()) {
+            s_path = QDir (data.s_wrk_dir_).filePath (s_path);
+        }
+        hsh.addData ("\0f", 2);
+        hsh.addData (s_file.toUtf8 ());
+        hsh.addData (fileHash (s_path));
+    }
+    saveIndex ();
+    return QString::fromLatin1 (hsh.result ().toHex ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ResultCache::lookup (const QString & s_key, Entry & entry) const
+{
+    QFile f (entryPath (s_key));
+    if (!f.open (QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in (&f);
+    quint32 magic;
+    qint32 version;
+    in >> magic >> version;
+    if ((magic != RESULT_MAGIC) || (version != RESULT_VERSION))
+        return false;
+
+    qint32 exit_code;
+    quint32 count;
+    in >> exit_code >> entry.duration_ms_ >> count;
+    entry.exit_code_ = exit_code;
+    entry.records_.clear ();
+    for (quint32 i = 0; (i < count) && (in.status () == QDataStream::Ok); ++i) {
+        Record rec;
+        quint8 channel;
+        in >> channel >> rec.data_;
+        rec.channel_ = channel;
+        entry.records_.append (rec);
+    }
+    if (in.status () != QDataStream::Ok) {
+        PROCRUNGUI_DEBUGM("Damaged cached result %s\n", TMP_A(s_key));
+        return false;
+    }
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ResultCache::store (const QString & s_key, const Entry & entry)
+{
+    if (s_key.isEmpty () || !QDir ().mkpath (s_dir_))
+        return false;
+
+    QSaveFile f (entryPath (s_key));
+    if (!f.open (QIODevice::WriteOnly))
+        return false;
+    QDataStream out (&f);
+    out << static_cast<quint32>(RESULT_MAGIC)
+        << static_cast<qint32>(RESULT_VERSION)
+        << static_cast<qint32>(entry.exit_code_)
+        << entry.duration_ms_
+        << static_cast<quint32>(entry.records_.count ());
+    foreach(const Record & rec, entry.records_) {
+        out << static_cast<quint8>(rec.channel_) << rec.data_;
+    }
+    if (!f.commit ()) {
+        PROCRUNGUI_DEBUGM("Cannot store result %s\n", TMP_A(s_key));
+        return false;
+    }
+    prune ();
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ResultCache::clear ()
+{
+    QDir dir (s_dir_);
+    foreach(const QString & s_name, dir.entryList (
+                QStringList (QLatin1String ("*.run")), QDir::Files)) {
+        dir.remove (s_name);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QByteArray ResultCache::fileHash (const QString & s_path)
+{
+    loadIndex ();
+
+    QFileInfo fi (s_path);
+    if (!fi.isFile ())
+        return QByteArray ();
+    QString s_abs = fi.absoluteFilePath ();
+    qint64 mtime_ms = fi.lastModified ().toMSecsSinceEpoch ();
+
+    QHash<QString, FileSig>::const_iterator iter = files_.constFind (s_abs);
+    if ((iter != files_.constEnd ()) &&
+            (iter.value ().size_ == fi.size ()) &&
+            (iter.value ().mtime_ms_ == mtime_ms)) {
+        return iter.value ().hash_;
+    }
+
+    QFile f (s_abs);
+    if (!f.open (QIODevice::ReadOnly))
+        return QByteArray ();
+    QCryptographicHash hsh (QCryptographicHash::Sha1);
+    if (!hsh.addData (&f))
+        return QByteArray ();
+
+    FileSig sig;
+    sig.size_ = fi.size ();
+    sig.mtime_ms_ = mtime_ms;
+    sig.hash_ = hsh.result ();
+    files_.insert (s_abs, sig);
+    b_index_dirty_ = true;
+    return sig.hash_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Files that do not exist are kept in the list, so that creating one
+ * of them changes the key.
+ */
+QStringList ResultCache::expandInputs (
+        const QString & s_inputs, const QString & s_wrk_dir)
+{
+    QStringList result;
+    foreach(const QString & s_part, s_inputs.split (QChar (','))) {
+        QString s_input = s_part.trimmed ();
+        if (s_input.isEmpty ())
+            continue;
+        if (CommandTemplate::isGlob (s_input)) {
+            result.append (CommandTemplate::glob (s_input, s_wrk_dir));
+        } else {
+            result.append (s_input);
+        }
+    }
+    result.sort ();
+    result.removeDuplicates ();
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QString ResultCache::entryPath (const QString & s_key) const
+{
+    return QDir (s_dir_).filePath (s_key + QLatin1String (".run"));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ResultCache::loadIndex ()
+{
+    if (b_index_loaded_)
+        return;
+    b_index_loaded_ = true;
+
+    QFile f (QDir (s_dir_).filePath (QLatin1String ("files.idx")));
+    if (!f.open (QIODevice::ReadOnly))
+        return;
+    QDataStream in (&f);
+    quint32 magic;
+    qint32 version;
+    quint32 count;
+    in >> magic >> version >> count;
+    if ((magic != INDEX_MAGIC) || (version != RESULT_VERSION))
+        return;
+    for (quint32 i = 0; (i < count) && (in.status () == QDataStream::Ok); ++i) {
+        QString s_path;
+        FileSig sig;
+        in >> s_path >> sig.size_ >> sig.mtime_ms_ >> sig.hash_;
+        if (in.status () == QDataStream::Ok) {
+            files_.insert (s_path, sig);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ResultCache::saveIndex ()
+{
+    if (!b_index_dirty_ || !QDir ().mkpath (s_dir_))
+        return;
+
+    QSaveFile f (QDir (s_dir_).filePath (QLatin1String ("files.idx")));
+    if (!f.open (QIODevice::WriteOnly))
+        return;
+    QDataStream out (&f);
+    out << static_cast<quint32>(INDEX_MAGIC)
+        << static_cast<qint32>(RESULT_VERSION)
+        << static_cast<quint32>(files_.count ());
+    QHash<QString, FileSig>::const_iterator iter;
+    for (iter = files_.constBegin (); iter != files_.constEnd (); ++iter) {
+        out << iter.key () << iter.value ().size_
+            << iter.value ().mtime_ms_ << iter.value ().hash_;
+    }
+    if (f.commit ()) {
+        b_index_dirty_ = false;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ResultCache::prune ()
+{
+    QDir dir (s_dir_);
+    QFileInfoList entries = dir.entryInfoList (
+                QStringList (QLatin1String ("*.run")), QDir::Files, QDir::Time);
+    for (int i = MAX_ENTRIES; i < entries.count (); ++i) {
+        dir.remove (entries.at (i).fileName ());
+    }
+}
+/* ========================================================================= */
@@ -0,0 +1,172 @@
+/**
+ * @file resultcache.h
+ * @brief Declarations for ResultCache class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_RESULTCACHE_H_INCLUDE
+#define GUARD_RESULTCACHE_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+#include <procrun/procrundata.h>
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+struct LaunchProfile;
+struct OutputFilterConfig;
+
+//! Tells if the result of a command may be reused and what it reads.
+struct PROCRUNGUI_EXPORT CacheConfig {
+
+    //! Default constructor.
+    CacheConfig () :
+        b_enabled_ (false),
+        s_inputs_ ()
+    {}
+
+    //! Tell if results are not reused.
+    bool
+    isEmpty () const {
+        return !b_enabled_;
+    }
+
+    //! Read the configuration stored for a command.
+    void
+    load (
+            QSettings & stg,
+            const QString & s_key);
+
+    //! Store the configuration for a command.
+    void
+    save (
+            QSettings & stg,
+            const QString & s_key) const;
+
+    bool b_enabled_; /**< reuse the result when nothing changed */
+    QString s_inputs_; /**< files the command reads, comma separated (globs allowed) */
+};
+
+//! Results of deterministic commands, keyed by what they depend on.
+class PROCRUNGUI_EXPORT ResultCache {
+
+public:
+
+    //! Limits.
+    enum {
+        MAX_OUTPUT = 16 * 1024 * 1024, /**< larger outputs are not stored */
+        MAX_ENTRIES = 256 /**< oldest results are removed past this */
+    };
+
+    //! Output of a channel (one or more lines, each ended by a new line).
+    struct Record {
+        int channel_; /**< ProcOutput::Channel */
+        QByteArray data_; /**< raw bytes */
+    };
+
+    //! A stored run.
+    struct Entry {
+        int exit_code_; /**< how the program ended */
+        qint64 duration_ms_; /**< how long the original run took */
+        QList<Record> records_; /**< the output, in order */
+    };
+
+    //! Constructor.
+    ResultCache ();
+
+    //! Destructor; saves what was learned about files.
+    virtual ~ResultCache();
+
+    //! Where results are kept (created when needed).
+    const QString &
+    directory () const {
+        return s_dir_;
+    }
+
+    //! Change the place where results are kept.
+    void
+    setDirectory (
+            const QString & s_dir);
+
+    //! Hash of everything a run depends on (empty if it can't be computed).
+    //!
+    //! The output is stored filtered, so the filter and the terminal
+    //! mode (@a b_use_pty) are part of the key.
+    QString
+    key (
+            const ProcRunData & data,
+            const LaunchProfile & profile,
+            const OutputFilterConfig & filter,
+            bool b_use_pty,
+            const CacheConfig & config);
+
+    //! Read a stored run; false if there is none.
+    bool
+    lookup (
+            const QString & s_key,
+            Entry & entry) const;
+
+    //! Store a run; false if it could not be written.
+    bool
+    store (
+            const QString & s_key,
+            const Entry & entry);
+
+    //! Remove all stored runs.
+    void
+    clear ();
+
+    //! Hash of the content of a file (empty if it can't be read).
+    QByteArray
+    fileHash (
+            const QString & s_path);
+
+    //! The files named by a list of paths and globs, sorted.
+    static QStringList
+    expandInputs (
+            const QString & s_inputs,
+            const QString & s_wrk_dir);
+
+private:
+
+    //! What we know about a file.
+    struct FileSig {
+        qint64 size_; /**< size when hashed */
+        qint64 mtime_ms_; /**< modification time when hashed */
+        QByteArray hash_; /**< hash of the content */
+    };
+
+    //! Path of the file holding a run.
+    QString
+    entryPath (
+            const QString & s_key) const;
+
+    //! Read the hashes of files from a previous session.
+    void
+    loadIndex ();
+
+    //! Save the hashes of files for next session.
+    void
+    saveIndex ();
+
+    //! Remove the oldest runs past MAX_ENTRIES.
+    void
+    prune ();
+
+    QString s_dir_; /**< where results are kept */
+    QHash<QString, FileSig> files_; /**< known file hashes by path */
+    bool b_index_loaded_; /**< files_ was read from disk */
+    bool b_index_dirty_; /**< files_ has changes not on disk */
+};
+
+#endif // GUARD_RESULTCACHE_H_INCLUDE
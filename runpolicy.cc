@@ -0,0 +1,122 @@
+/**
+ * @file runpolicy.cc
+ * @brief Definitions for RunPolicy class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "runpolicy.h"
+
+#include "procrungui-private.h"
+
+#include <QSettings>
+#include <QStringList>
+
+/**
+ * @class RunPolicy
+ *
+ * A run that is terminated because of the wall-clock limit or because
+ * it stayed silent for too long is retried only when no exit codes are
+ * listed; a list names the codes (of runs that exited on their own)
+ * that are worth another attempt. The delay doubles with each attempt,
+ * up to an hour.
+ */
+
+#define STG_POLICY_GROUP "RunPolicy"
+#define STG_POLICY_TIMEOUT "TimeoutSeconds"
+#define STG_POLICY_IDLE "IdleSeconds"
+#define STG_POLICY_RETRIES "Retries"
+#define STG_POLICY_CODES "RetryCodes"
+#define STG_POLICY_DELAY "RetryDelaySeconds"
+
+//! Longest delay between attempts.
+#define MAX_RETRY_DELAY_MS (3600 * 1000)
+
+/* ------------------------------------------------------------------------- */
+void RunPolicy::load (QSettings & stg, const QString & s_key)
+{
+    stg.beginGroup (QLatin1String (STG_POLICY_GROUP));
+    stg.beginGroup (s_key);
+    timeout_s_ = stg.value (QLatin1String (STG_POLICY_TIMEOUT), 0).toInt ();
+    idle_s_ = stg.value (QLatin1String (STG_POLICY_IDLE), 0).toInt ();
+    retries_ = stg.value (QLatin1String (STG_POLICY_RETRIES), 0).toInt ();
+    s_retry_codes_ = stg.value (QLatin1String (STG_POLICY_CODES)).toString ();
+    retry_delay_s_ = stg.value (QLatin1String (STG_POLICY_DELAY), 5).toInt ();
+    stg.endGroup ();
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void RunPolicy::save (QSettings & stg, const QString & s_key) const
+{
+    stg.beginGroup (QLatin1String (STG_POLICY_GROUP));
+    if (isEmpty ()) {
+        stg.remove (s_key);
+    } else {
+        stg.beginGroup (s_key);
+        stg.setValue (QLatin1String (STG_POLICY_TIMEOUT), timeout_s_);
+        stg.setValue (QLatin1String (STG_POLICY_IDLE), idle_s_);
+        stg.setValue (QLatin1String (STG_POLICY_RETRIES), retries_);
+        stg.setValue (QLatin1String (STG_POLICY_CODES), s_retry_codes_);
+        stg.setValue (QLatin1String (STG_POLICY_DELAY), retry_delay_s_);
+        stg.endGroup ();
+    }
+    stg.endGroup ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @a attempt starts at 1 for the first run.
+ */
+bool RunPolicy::shouldRetry (
+        int attempt, int exit_code, bool b_crashed, bool b_timed_out) const
+{
+    if (attempt > retries_)
+        return false;
+
+    QList<int> codes;
+    if (!parseCodes (s_retry_codes_, codes)) {
+        PROCRUNGUI_DEBUGM("Ignoring malformed exit code list %s\n",
+                          TMP_A(s_retry_codes_));
+        codes.clear ();
+    }
+    if (codes.isEmpty ())
+        return b_timed_out || b_crashed || (exit_code != 0);
+    if (b_timed_out || b_crashed)
+        return false;
+    return codes.contains (exit_code);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+qint64 RunPolicy::retryDelayMs (int attempt) const
+{
+    qint64 result = qMax (0, retry_delay_s_) * Q_INT64_C(1000);
+    for (int i = 1; (i < attempt) && (result < MAX_RETRY_DELAY_MS); ++i) {
+        result *= 2;
+    }
+    return qMin (result, static_cast<qint64> (MAX_RETRY_DELAY_MS));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool RunPolicy::parseCodes (const QString & s_codes, QList<int> & codes)
+{
+    codes.clear ();
+    foreach(const QString & s_part, s_codes.split (QChar (','))) {
+        QString s_code = s_part.trimmed ();
+        if (s_code.isEmpty ())
+            continue;
+        bool b_ok;
+        int code = s_code.toInt (&b_ok);
+        if (!b_ok)
+            return false;
+        codes.append (code);
+    }
+    return true;
+}
+/* ========================================================================= */
@@ -0,0 +1,78 @@
+/**
+ * @file runpolicy.h
+ * @brief Declarations for RunPolicy class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_RUNPOLICY_H_INCLUDE
+#define GUARD_RUNPOLICY_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QString>
+#include <QList>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+//! Timeouts and retries for a command.
+struct PROCRUNGUI_EXPORT RunPolicy {
+
+    //! Default constructor.
+    RunPolicy () :
+        timeout_s_ (0),
+        idle_s_ (0),
+        retries_ (0),
+        s_retry_codes_ (),
+        retry_delay_s_ (5)
+    {}
+
+    //! Tell if the policy changes nothing.
+    bool
+    isEmpty () const {
+        return (timeout_s_ <= 0) && (idle_s_ <= 0) && (retries_ <= 0);
+    }
+
+    //! Read the policy stored for a command.
+    void
+    load (
+            QSettings & stg,
+            const QString & s_key);
+
+    //! Store the policy for a command.
+    void
+    save (
+            QSettings & stg,
+            const QString & s_key) const;
+
+    //! Tell if a run that ended this way deserves another attempt.
+    bool
+    shouldRetry (
+            int attempt,
+            int exit_code,
+            bool b_crashed,
+            bool b_timed_out) const;
+
+    //! Milliseconds to wait before attempt @a attempt + 1.
+    qint64
+    retryDelayMs (
+            int attempt) const;
+
+    //! Parse a list of exit codes like "1, 75"; false if malformed.
+    static bool
+    parseCodes (
+            const QString & s_codes,
+            QList<int> & codes);
+
+    int timeout_s_; /**< wall-clock limit in seconds (0 for none) */
+    int idle_s_; /**< limit on the time without output (0 for none) */
+    int retries_; /**< attempts after the first one */
+    QString s_retry_codes_; /**< exit codes that are retried (empty for any failure) */
+    int retry_delay_s_; /**< delay before the first retry; doubles after */
+};
+
+#endif // GUARD_RUNPOLICY_H_INCLUDE
@@ -0,0 +1,144 @@
+/**
+ * @file fakechild.cc
+ * @brief A program that misbehaves on purpose, for the tests.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * Usage:
+ *
+ *     fakechild <seed>                  random output, then a random way to end
+ *     fakechild exit <code> [<delay>]   one line of output, then exit with code
+ *                                       (after delay milliseconds)
+ *
+ * With a seed the program writes a random number of lines to its
+ * standard output and error, in bursts and with random pauses, then
+ * either exits with a random code, dies from a signal, hangs (some
+ * times ignoring SIGTERM), leaves a partial line or leaves a grandchild
+ * behind that lingers for a couple of seconds. The same seed always does
+ * the same thing.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+//! The ways a run may end.
+enum Ending {
+    EndExit = 0, /**< exit with a random code */
+    EndSignal, /**< die from SIGSEGV or SIGABRT */
+    EndHang, /**< wait forever */
+    EndHangNoTerm, /**< wait forever, ignoring SIGTERM */
+    EndPartial, /**< exit after a line without its new line */
+    EndOrphan, /**< exit, leaving a grandchild that lingers */
+    ENDING_COUNT
+};
+
+/* ------------------------------------------------------------------------- */
+static void pauseMs (int ms)
+{
+    if (ms > 0) {
+        usleep (static_cast<useconds_t>(ms) * 1000);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static void hang ()
+{
+    for (;;) {
+        pause ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static void writeLines (unsigned int seed)
+{
+    int lines = rand () % 400;
+    int burst = 1 + rand () % 50;
+    for (int i = 0; i < lines; ++i) {
+        FILE * out = (rand () % 5) == 0 ? stderr : stdout;
+        int width = rand () % 200;
+        fprintf (out, "%u:%d ", seed, i);
+        for (int c = 0; c < width; ++c) {
+            fputc ('a' + (c % 26), out);
+        }
+        // some colored lines and some that are redrawn
+        if ((rand () % 10) == 0) {
+            fputs (" \x1b[1;31merror\x1b[0m", out);
+        } else if ((rand () % 10) == 0) {
+            fputs (" 50%\r 100%", out);
+        }
+        fputc ('\n', out);
+        if ((i % burst) == 0) {
+            fflush (stdout);
+            fflush (stderr);
+            pauseMs (rand () % 20);
+        }
+    }
+    fflush (stdout);
+    fflush (stderr);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int main (int argc, char * argv[])
+{
+    if (((argc == 3) || (argc == 4)) && (strcmp (argv[1], "exit") == 0)) {
+        printf ("exiting with %s\n", argv[2]);
+        fflush (stdout);
+        if (argc == 4) {
+            pauseMs (atoi (argv[3]));
+        }
+        return atoi (argv[2]);
+    }
+    if (argc != 2) {
+        fprintf (stderr, "usage: fakechild <seed> | "
+                 "fakechild exit <code> [<delay>]\n");
+        return 2;
+    }
+
+    // crashes are part of the plan; don't litter the disk
+    struct rlimit no_core;
+    no_core.rlim_cur = 0;
+    no_core.rlim_max = 0;
+    setrlimit (RLIMIT_CORE, &no_core);
+
+    unsigned int seed = static_cast<unsigned int>(strtoul (argv[1], NULL, 10));
+    srand (seed);
+    pauseMs (rand () % 100);
+    writeLines (seed);
+
+    switch (rand () % ENDING_COUNT) {
+    case EndSignal:
+        raise ((rand () % 2) == 0 ? SIGSEGV : SIGABRT);
+        break;
+    case EndHang:
+        hang ();
+        break;
+    case EndHangNoTerm:
+        signal (SIGTERM, SIG_IGN);
+        hang ();
+        break;
+    case EndPartial:
+        fputs ("no new line at the end", stdout);
+        fflush (stdout);
+        break;
+    case EndOrphan:
+        // nobody waits for it, so it must go away by itself
+        if (fork () == 0) {
+            sleep (2);
+            _exit (0);
+        }
+        break;
+    default:
+        break;
+    }
+    return rand () % 3;
+}
+/* ========================================================================= */
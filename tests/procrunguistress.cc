@@ -0,0 +1,474 @@
+/**
+ * @file procrunguistress.cc
+ * @brief Randomized run, kill, close and move sequences against ProcRunGui.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * The children are instances of fakechild (FAKECHILD_PATH). The seed
+ * of the random sequence is printed and is part of every failure
+ * message; set PROCRUNGUI_STRESS_SEED to run the same sequence again and
+ * PROCRUNGUI_STRESS_STEPS to change its length.
+ *
+ * Besides keeping processes and tabs in step, each test checks that
+ * every process ends exactly once, that nothing (processes, output
+ * chunks, timers) is left once the tabs are closed, and that starting
+ * and killing programs does not stall the event loop.
+ */
+
+#include <procrungui/procrungui.h>
+#include <procrungui/prgprocess.h>
+#include <procrungui/procmetrics.h>
+#include <procrungui/outputchunk.h>
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTabBar>
+#include <QTabWidget>
+#include <QtTest>
+
+//! Most children that run at once.
+#define MAX_RUNNING 16
+
+//! Longest a runProgram () or killTree () call may take, in milliseconds.
+#define MAX_CALL_MS 500
+
+//! Largest event loop lag allowed, in milliseconds.
+#define MAX_LAG_MS 1500
+
+//! Watches the processes of a window end and go away.
+class EndRecorder : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! Constructor.
+    EndRecorder (
+            ProcRunGui * gui) :
+        QObject (gui),
+        started_ (0),
+        ended_ (0),
+        live_ (),
+        order_ (),
+        sl_problems_ ()
+    {
+        connect (gui, SIGNAL(processFinished(PrgProcess*)),
+                 this, SLOT(processFinished(PrgProcess*)));
+        connect (gui, SIGNAL(processRemoved(PrgProcess*)),
+                 this, SLOT(processRemoved(PrgProcess*)));
+    }
+
+    //! A process was started by the test.
+    void
+    started (
+            PrgProcess * proc) {
+        live_.insert (proc, 0);
+        ++started_;
+    }
+
+    int started_; /**< processes the test started */
+    int ended_; /**< processes that ended, each counted once */
+    QHash<PrgProcess*, int> live_; /**< times each process still around ended */
+    QList<PrgProcess*> order_; /**< processes in the order they ended */
+    QStringList sl_problems_; /**< what went wrong, if anything */
+
+public slots:
+
+    //! finishProcess () is done with a process.
+    void
+    processFinished (
+            PrgProcess * proc) {
+        QHash<PrgProcess*, int>::iterator iter = live_.find (proc);
+        if (iter == live_.end ()) {
+            sl_problems_.append (QLatin1String ("an unknown process ended"));
+            return;
+        }
+        if (++iter.value () != 1) {
+            sl_problems_.append (
+                        QString (QLatin1String ("a process ended %1 times"))
+                        .arg (iter.value ()));
+            return;
+        }
+        ++ended_;
+        order_.append (proc);
+    }
+
+    //! A process is about to be deleted.
+    void
+    processRemoved (
+            PrgProcess * proc) {
+        QHash<PrgProcess*, int>::iterator iter = live_.find (proc);
+        if (iter == live_.end ()) {
+            sl_problems_.append (QLatin1String ("an unknown process was removed"));
+            return;
+        }
+        if (iter.value () != 1) {
+            sl_problems_.append (QLatin1String (
+                                     "a process was removed before it ended"));
+        }
+        // the address may be handed to a new process
+        live_.erase (iter);
+    }
+};
+
+//! What the counters said before a test.
+struct Baseline {
+
+    //! Take the current values and start measuring the lag anew.
+    Baseline () :
+        started_ (ProcMetrics::global ().processes_started_.loadRelaxed ()),
+        ended_ (ProcMetrics::global ().processes_ended_.loadRelaxed ()),
+        destroyed_ (ProcMetrics::global ().processes_destroyed_.loadRelaxed ()),
+        chunks_ (OutputChunkPool::usedCount ())
+    {
+        ProcMetrics::global ().max_loop_lag_ms_.storeRelaxed (0);
+    }
+
+    qint64 started_; /**< ProcMetrics::processes_started_ */
+    qint64 ended_; /**< ProcMetrics::processes_ended_ */
+    qint64 destroyed_; /**< ProcMetrics::processes_destroyed_ */
+    int chunks_; /**< OutputChunkPool::usedCount () */
+};
+
+//! Randomized sequences of user actions.
+class ProcRunGuiStress : public QObject {
+    Q_OBJECT
+
+private:
+
+    //! The tab strip of the window.
+    static QTabWidget *
+    tabs (
+            ProcRunGui * gui) {
+        return gui->findChild<QTabWidget*> (QLatin1String ("tabWidget"));
+    }
+
+    //! Run the fake child with these arguments (NULL if it was refused).
+    static PrgProcess *
+    runChild (
+            ProcRunGui * gui,
+            EndRecorder * rec,
+            const QStringList & sl_args,
+            qint64 & max_call_ms) {
+        ProcRunData data (QLatin1String (FAKECHILD_PATH), sl_args,
+                          QString (), QStringList ());
+        QElapsedTimer clock;
+        clock.start ();
+        PrgProcess * result = gui->runProgram (data);
+        max_call_ms = qMax (max_call_ms, clock.elapsed ());
+        if (result != NULL) {
+            rec->started (result);
+        }
+        return result;
+    }
+
+    //! Kill a process and its children, timing the call.
+    static void
+    killChild (
+            PrgProcess * proc,
+            qint64 & max_call_ms) {
+        QElapsedTimer clock;
+        clock.start ();
+        proc->killTree ();
+        max_call_ms = qMax (max_call_ms, clock.elapsed ());
+    }
+
+    //! Number of processes that are still running.
+    static int
+    runningCount (
+            ProcRunGui * gui) {
+        int result = 0;
+        for (int i = 0; i < gui->programCount (); ++i) {
+            if (gui->program (i)->isRunning ()) {
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    //! Close a tab the way the close button of the tab does it.
+    static void
+    closeTab (
+            ProcRunGui * gui,
+            int index) {
+        QMetaObject::invokeMethod (
+                    gui, "on_tabWidget_tabCloseRequested",
+                    Q_ARG(int, index));
+    }
+
+    //! The processes match the tabs (or the lack of them) one to one.
+    static bool
+    consistent (
+            ProcRunGui * gui,
+            QString & s_why) {
+        QTabWidget * tab_widget = tabs (gui);
+        if (gui->dashboardMode ()) {
+            if (tab_widget->count () != 0) {
+                s_why = QString (QLatin1String ("%1 tabs in dashboard mode"))
+                        .arg (tab_widget->count ());
+                return false;
+            }
+        } else if (tab_widget->count () != gui->programCount ()) {
+            s_why = QString (QLatin1String ("%1 tabs for %2 processes"))
+                    .arg (tab_widget->count ()).arg (gui->programCount ());
+            return false;
+        }
+        for (int i = 0; i < gui->programCount (); ++i) {
+            PrgProcess * proc = gui->program (i);
+            if (gui->programIndex (proc) != i) {
+                s_why = QString (QLatin1String ("process %1 found at %2"))
+                        .arg (i).arg (gui->programIndex (proc));
+                return false;
+            }
+            QWidget * expected = gui->dashboardMode () ?
+                        NULL : tab_widget->widget (i);
+            if (proc->widget_ != expected) {
+                s_why = QString (QLatin1String ("tab %1 shows another process"))
+                        .arg (i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! End all children and drop their tabs.
+    static void
+    cleanup (
+            ProcRunGui * gui,
+            qint64 & max_call_ms) {
+        for (int i = 0; i < gui->programCount (); ++i) {
+            if (gui->program (i)->isRunning ()) {
+                killChild (gui->program (i), max_call_ms);
+            }
+        }
+        QTRY_VERIFY_WITH_TIMEOUT(runningCount (gui) == 0, 20000);
+        while (gui->programCount () > 0) {
+            closeTab (gui, gui->programCount () - 1);
+        }
+    }
+
+    //! Each process ended once and nothing of them is left.
+    static void
+    verifyNothingLeft (
+            ProcRunGui * gui,
+            EndRecorder * rec,
+            const Baseline & before,
+            const QString & s_context) {
+        ProcMetrics & m = ProcMetrics::global ();
+        QVERIFY2(rec->sl_problems_.isEmpty (),
+                 qPrintable(s_context + rec->sl_problems_.join (
+                                QLatin1String ("; "))));
+        QVERIFY2(rec->ended_ == rec->started_,
+                 qPrintable(s_context + QString (QLatin1String (
+                     "%1 of %2 processes ended"))
+                     .arg (rec->ended_).arg (rec->started_)));
+        QVERIFY2(rec->live_.isEmpty (),
+                 qPrintable(s_context + QString (QLatin1String (
+                     "%1 processes were not removed"))
+                     .arg (rec->live_.count ())));
+
+        qint64 started = m.processes_started_.loadRelaxed () - before.started_;
+        QCOMPARE(started, static_cast<qint64>(rec->started_));
+        QCOMPARE(m.processes_ended_.loadRelaxed () - before.ended_, started);
+
+        // deleteLater () and background packing finish from the event loop
+        QTRY_COMPARE_WITH_TIMEOUT(
+                    m.processes_destroyed_.loadRelaxed () - before.destroyed_,
+                    started, 5000);
+        QTRY_COMPARE_WITH_TIMEOUT(
+                    OutputChunkPool::usedCount (), before.chunks_, 5000);
+        QCOMPARE(gui->pendingTimers (), 0);
+    }
+
+    //! Calls and the event loop were quick enough.
+    static void
+    verifyLatency (
+            qint64 max_call_ms,
+            const QString & s_context) {
+        QVERIFY2(max_call_ms <= MAX_CALL_MS,
+                 qPrintable(s_context + QString (QLatin1String (
+                     "a call took %1 ms")).arg (max_call_ms)));
+        qint64 lag = ProcMetrics::global ().max_loop_lag_ms_.loadRelaxed ();
+        QVERIFY2(lag <= MAX_LAG_MS,
+                 qPrintable(s_context + QString (QLatin1String (
+                     "the event loop lagged %1 ms")).arg (lag)));
+    }
+
+private slots:
+
+    void
+    initTestCase () {
+        // history, sessions and saved commands go to a test location
+        QStandardPaths::setTestModeEnabled (true);
+    }
+
+    //! Processes end once each, in the order their programs exit.
+    void
+    endsInOrder () {
+        Baseline before;
+        qint64 max_call_ms = 0;
+        ProcRunGui gui;
+        EndRecorder * rec = new EndRecorder (&gui);
+
+        // the last one started is the first one to exit
+        QList<PrgProcess*> expected;
+        for (int i = 0; i < 4; ++i) {
+            PrgProcess * proc = runChild (
+                        &gui, rec, QStringList ()
+                        << QLatin1String ("exit") << QString::number (i)
+                        << QString::number ((3 - i) * 300),
+                        max_call_ms);
+            QVERIFY(proc != NULL);
+            expected.prepend (proc);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(rec->ended_, 4, 10000);
+        QCOMPARE(rec->order_, expected);
+        for (int i = 0; i < expected.count (); ++i) {
+            QCOMPARE(expected.at (i)->exit_code_, 3 - i);
+        }
+
+        cleanup (&gui, max_call_ms);
+        if (QTest::currentTestFailed ())
+            return;
+        verifyNothingLeft (&gui, rec, before, QString ());
+        if (QTest::currentTestFailed ())
+            return;
+        verifyLatency (max_call_ms, QString ());
+    }
+
+    //! Dragging a tab moves its process too (the tabMoved () fix).
+    void
+    tabMovedKeepsProcesses () {
+        Baseline before;
+        qint64 max_call_ms = 0;
+        ProcRunGui gui;
+        EndRecorder * rec = new EndRecorder (&gui);
+        QTabWidget * tab_widget = tabs (&gui);
+        QVERIFY(tab_widget != NULL);
+
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(runChild (&gui, rec, QStringList ()
+                              << QLatin1String ("exit")
+                              << QString::number (i),
+                              max_call_ms) != NULL);
+        }
+        QTRY_VERIFY_WITH_TIMEOUT(runningCount (&gui) == 0, 10000);
+
+        // codes 0 1 2 become 1 2 0
+        tab_widget->tabBar ()->moveTab (0, 2);
+        QString s_why;
+        QVERIFY2(consistent (&gui, s_why), qPrintable(s_why));
+        QCOMPARE(gui.program (0)->exit_code_, 1);
+        QCOMPARE(gui.program (1)->exit_code_, 2);
+        QCOMPARE(gui.program (2)->exit_code_, 0);
+
+        // the process behind the moved tab is the one that goes away
+        PrgProcess * moved = gui.program (2);
+        closeTab (&gui, 2);
+        QCOMPARE(gui.programCount (), 2);
+        QCOMPARE(gui.programIndex (moved), -1);
+        QVERIFY2(consistent (&gui, s_why), qPrintable(s_why));
+        QCOMPARE(gui.program (0)->exit_code_, 1);
+        QCOMPARE(gui.program (1)->exit_code_, 2);
+
+        cleanup (&gui, max_call_ms);
+        if (QTest::currentTestFailed ())
+            return;
+        verifyNothingLeft (&gui, rec, before, QString ());
+    }
+
+    //! Random runs, kills, closes, moves and mode switches.
+    void
+    randomSequence () {
+        quint32 seed = static_cast<quint32>(
+                    QDateTime::currentMSecsSinceEpoch ());
+        QByteArray env_seed = qgetenv ("PROCRUNGUI_STRESS_SEED");
+        if (!env_seed.isEmpty ()) {
+            seed = env_seed.toUInt ();
+        }
+        int steps = 300;
+        QByteArray env_steps = qgetenv ("PROCRUNGUI_STRESS_STEPS");
+        if (!env_steps.isEmpty ()) {
+            steps = env_steps.toInt ();
+        }
+        qInfo ("PROCRUNGUI_STRESS_SEED=%u", seed);
+        QRandomGenerator gen (seed);
+        const QString s_seed =
+                QString (QLatin1String ("seed %1: ")).arg (seed);
+
+        Baseline before;
+        qint64 max_call_ms = 0;
+        ProcRunGui gui;
+        EndRecorder * rec = new EndRecorder (&gui);
+        QTabWidget * tab_widget = tabs (&gui);
+        QString s_why;
+        for (int step = 0; step < steps; ++step) {
+            int count = gui.programCount ();
+            int index = count == 0 ? -1 : gen.bounded (count);
+            PrgProcess * proc = index == -1 ? NULL : gui.program (index);
+
+            switch (gen.bounded (8)) {
+            case 0:
+            case 1:
+                if (runningCount (&gui) < MAX_RUNNING) {
+                    runChild (&gui, rec, QStringList ()
+                              << QString::number (gen.generate ()),
+                              max_call_ms);
+                }
+                break;
+            case 2:
+                if ((proc != NULL) && proc->isRunning ()) {
+                    proc->terminateTree (200);
+                }
+                break;
+            case 3:
+                if ((proc != NULL) && proc->isRunning ()) {
+                    killChild (proc, max_call_ms);
+                }
+                break;
+            case 4:
+            case 5:
+                // a running one would ask first
+                if ((proc != NULL) && !proc->isRunning ()) {
+                    closeTab (&gui, index);
+                }
+                break;
+            case 6:
+                if ((count > 1) && !gui.dashboardMode ()) {
+                    tab_widget->tabBar ()->moveTab (index, gen.bounded (count));
+                }
+                break;
+            default:
+                if (gen.bounded (10) == 0) {
+                    gui.setDashboardMode (!gui.dashboardMode ());
+                }
+                break;
+            }
+
+            QTest::qWait (gen.bounded (20));
+            QVERIFY2(consistent (&gui, s_why),
+                     qPrintable(QString (QLatin1String ("%1step %2: %3"))
+                                .arg (s_seed).arg (step).arg (s_why)));
+            QVERIFY2(rec->sl_problems_.isEmpty (),
+                     qPrintable(QString (QLatin1String ("%1step %2: %3"))
+                                .arg (s_seed).arg (step)
+                                .arg (rec->sl_problems_.join (
+                                          QLatin1String ("; ")))));
+        }
+
+        cleanup (&gui, max_call_ms);
+        if (QTest::currentTestFailed ())
+            return;
+        verifyNothingLeft (&gui, rec, before, s_seed);
+        if (QTest::currentTestFailed ())
+            return;
+        verifyLatency (max_call_ms, s_seed);
+    }
+};
+
+QTEST_MAIN(ProcRunGuiStress)
+#include "procrunguistress.moc"
@@ -0,0 +1,87 @@
+/**
+ * @file textscanbench.cc
+ * @brief Benchmark for the TextScan implementations.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include <procrungui/textscan.h>
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QtTest>
+
+//! Measures an implementation in a pool thread.
+class MeasureJob : public QRunnable {
+public:
+    MeasureJob (TextScan::Isa isa) :
+        isa_ (isa),
+        rate_ (0.0),
+        b_done_ (0)
+    {
+        setAutoDelete (false);
+    }
+
+    void
+    run () {
+        rate_ = TextScan::measure (isa_, 16);
+        b_done_.storeRelease (1);
+    }
+
+    TextScan::Isa isa_; /**< what is measured */
+    double rate_; /**< bytes per second */
+    QAtomicInt b_done_; /**< set once rate_ is valid */
+};
+
+//! Runs TextScan::measure () for each implementation.
+class TextScanBench : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void
+    measure_data () {
+        QTest::addColumn<int>("isa");
+        QTest::newRow ("scalar") << static_cast<int>(TextScan::Scalar);
+        QTest::newRow ("sse2") << static_cast<int>(TextScan::Sse2);
+        QTest::newRow ("avx2") << static_cast<int>(TextScan::Avx2);
+    }
+
+    //! Bytes per second of each implementation; the one in use stays.
+    void
+    measure () {
+        QFETCH(int, isa);
+        TextScan::Isa value = static_cast<TextScan::Isa>(isa);
+        if (!TextScan::isSupported (value))
+            QSKIP("not supported by this processor");
+
+        TextScan::Isa in_use = TextScan::isa ();
+        double rate = TextScan::measure (value, 64);
+        QVERIFY(rate > 0.0);
+        QCOMPARE(TextScan::isa (), in_use);
+        qDebug ("%s: %.1f MB/s", QTest::currentDataTag (), rate / 1e6);
+    }
+
+    //! Output is scanned with the implementation in use while measuring.
+    void
+    measureConcurrently () {
+        TextScan::Isa in_use = TextScan::isa ();
+        QByteArray line ("[ 42%] Building CXX object module.cc.o\n");
+
+        MeasureJob job (TextScan::Scalar);
+        QThreadPool::globalInstance ()->start (&job);
+        while (job.b_done_.loadAcquire () == 0) {
+            QCOMPARE(TextScan::isa (), in_use);
+            QCOMPARE(TextScan::printableRun (line.constData (), line.size ()),
+                     line.size () - 1);
+        }
+        QThreadPool::globalInstance ()->waitForDone ();
+        QVERIFY(job.rate_ > 0.0);
+    }
+};
+
+QTEST_APPLESS_MAIN(TextScanBench)
+#include "textscanbench.moc"
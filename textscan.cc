@@ -0,0 +1,450 @@
+/**
+ * @file textscan.cc
+ * @brief Definitions for TextScan class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "textscan.h"
+
+#include "procrungui-private.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#   define TEXTSCAN_HAVE_SSE2 1
+#   include <emmintrin.h>
+#endif
+
+#if defined(TEXTSCAN_HAVE_SSE2) && defined(__GNUC__)
+#   define TEXTSCAN_HAVE_AVX2 1
+#   include <immintrin.h>
+#   define TEXTSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+/**
+ * @class TextScan
+ *
+ * Splitting output in lines and finding escape sequences means looking
+ * for a few byte values in a lot of text; deciding how to decode a line
+ * means checking its bytes once more. These loops are vectorized with
+ * SSE2 or AVX2 when the processor has them. The implementation is
+ * picked at run time; the plain one is always there as a fallback.
+ *
+ * Validation looks at 16 or 32 bytes at a time while the text is 7-bit
+ * and falls back to a byte by byte check for multi-byte sequences,
+ * resuming the fast path at the next 7-bit character. Overlong forms,
+ * surrogates and values past U+10FFFF are rejected.
+ */
+
+//! Functions of an implementation.
+struct ScanImpl {
+    TextScan::Isa isa_;
+    int (*printable_run_) (const char *, int);
+    int (*ascii_run_) (const char *, int);
+};
+
+/* ------------------------------------------------------------------------- */
+static inline int lowestBit (unsigned int mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz (mask);
+#elif defined(_MSC_VER)
+    unsigned long result;
+    _BitScanForward (&result, mask);
+    return static_cast<int>(result);
+#else
+    int result = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        ++result;
+    }
+    return result;
+#endif
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static inline bool isControl (unsigned char c)
+{
+    return (c < 0x20) || (c == 0x7f);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static int printableRunScalar (const char * data, int size)
+{
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+    int i = 0;
+    while ((i < size) && !isControl (p[i])) {
+        ++i;
+    }
+    return i;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static int asciiRunScalar (const char * data, int size)
+{
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+    int i = 0;
+    // eight at a time
+    while (i + 8 <= size) {
+        quint64 word;
+        memcpy (&word, p + i, sizeof(word));
+        if ((word & Q_UINT64_C(0x8080808080808080)) != 0)
+            break;
+        i += 8;
+    }
+    while ((i < size) && (p[i] < 0x80)) {
+        ++i;
+    }
+    return i;
+}
+/* ========================================================================= */
+
+#ifdef TEXTSCAN_HAVE_SSE2
+
+/* ------------------------------------------------------------------------- */
+static int printableRunSse2 (const char * data, int size)
+{
+    const __m128i last_ctl = _mm_set1_epi8 (0x1f);
+    const __m128i del = _mm_set1_epi8 (0x7f);
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128 (
+                    reinterpret_cast<const __m128i *>(data + i));
+        // unsigned v <= 0x1f is the same as min (v, 0x1f) == v
+        __m128i ctl = _mm_or_si128 (
+                    _mm_cmpeq_epi8 (_mm_min_epu8 (v, last_ctl), v),
+                    _mm_cmpeq_epi8 (v, del));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8 (ctl));
+        if (mask != 0)
+            return i + lowestBit (mask);
+    }
+    return i + printableRunScalar (data + i, size - i);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static int asciiRunSse2 (const char * data, int size)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128 (
+                    reinterpret_cast<const __m128i *>(data + i));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8 (v));
+        if (mask != 0)
+            return i + lowestBit (mask);
+    }
+    return i + asciiRunScalar (data + i, size - i);
+}
+/* ========================================================================= */
+
+#endif // TEXTSCAN_HAVE_SSE2
+
+#ifdef TEXTSCAN_HAVE_AVX2
+
+/* ------------------------------------------------------------------------- */
+TEXTSCAN_TARGET_AVX2
+static int printableRunAvx2 (const char * data, int size)
+{
+    const __m256i last_ctl = _mm256_set1_epi8 (0x1f);
+    const __m256i del = _mm256_set1_epi8 (0x7f);
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256 (
+                    reinterpret_cast<const __m256i *>(data + i));
+        __m256i ctl = _mm256_or_si256 (
+                    _mm256_cmpeq_epi8 (_mm256_min_epu8 (v, last_ctl), v),
+                    _mm256_cmpeq_epi8 (v, del));
+        unsigned int mask =
+                static_cast<unsigned int>(_mm256_movemask_epi8 (ctl));
+        if (mask != 0)
+            return i + lowestBit (mask);
+    }
+    // the tail stays in this function so that it is VEX encoded too;
+    // calling SSE code with dirty upper halves is slow
+    if (i + 16 <= size) {
+        __m128i v = _mm_loadu_si128 (
+                    reinterpret_cast<const __m128i *>(data + i));
+        __m128i ctl = _mm_or_si128 (
+                    _mm_cmpeq_epi8 (
+                        _mm_min_epu8 (v, _mm256_castsi256_si128 (last_ctl)), v),
+                    _mm_cmpeq_epi8 (v, _mm256_castsi256_si128 (del)));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8 (ctl));
+        if (mask != 0)
+            return i + lowestBit (mask);
+        i += 16;
+    }
+    return i + printableRunScalar (data + i, size - i);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+TEXTSCAN_TARGET_AVX2
+static int asciiRunAvx2 (const char * data, int size)
+{
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256 (
+                    reinterpret_cast<const __m256i *>(data + i));
+        unsigned int mask =
+                static_cast<unsigned int>(_mm256_movemask_epi8 (v));
+        if (mask != 0)
+            return i + lowestBit (mask);
+    }
+    if (i + 16 <= size) {
+        __m128i v = _mm_loadu_si128 (
+                    reinterpret_cast<const __m128i *>(data + i));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8 (v));
+        if (mask != 0)
+            return i + lowestBit (mask);
+        i += 16;
+    }
+    return i + asciiRunScalar (data + i, size - i);
+}
+/* ========================================================================= */
+
+#endif // TEXTSCAN_HAVE_AVX2
+
+/* ------------------------------------------------------------------------- */
+static ScanImpl implFor (TextScan::Isa value)
+{
+    ScanImpl result;
+    result.isa_ = TextScan::Scalar;
+    result.printable_run_ = printableRunScalar;
+    result.ascii_run_ = asciiRunScalar;
+    switch (value) {
+    case TextScan::Avx2:
+#ifdef TEXTSCAN_HAVE_AVX2
+        result.isa_ = TextScan::Avx2;
+        result.printable_run_ = printableRunAvx2;
+        result.ascii_run_ = asciiRunAvx2;
+#endif
+        break;
+    case TextScan::Sse2:
+#ifdef TEXTSCAN_HAVE_SSE2
+        result.isa_ = TextScan::Sse2;
+        result.printable_run_ = printableRunSse2;
+        result.ascii_run_ = asciiRunSse2;
+#endif
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static ScanImpl & currentImpl ()
+{
+    static ScanImpl impl = implFor (
+                TextScan::isSupported (TextScan::Avx2) ? TextScan::Avx2 :
+                TextScan::isSupported (TextScan::Sse2) ? TextScan::Sse2 :
+                                                         TextScan::Scalar);
+    return impl;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return the length of the sequence starting at @a p or 0 if it is not
+ * a valid one.
+ */
+static inline int utf8Sequence (const unsigned char * p, int size)
+{
+    unsigned char c = p[0];
+    if (c < 0x80)
+        return 1;
+
+    int length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if (c < 0xc2) {
+        // continuation byte or overlong two byte form
+        return 0;
+    } else if (c < 0xe0) {
+        length = 2;
+    } else if (c < 0xf0) {
+        length = 3;
+        if (c == 0xe0)
+            low = 0xa0; // overlong
+        else if (c == 0xed)
+            high = 0x9f; // surrogates
+    } else if (c < 0xf5) {
+        length = 4;
+        if (c == 0xf0)
+            low = 0x90; // overlong
+        else if (c == 0xf4)
+            high = 0x8f; // past U+10FFFF
+    } else {
+        return 0;
+    }
+    if (size < length)
+        return 0;
+
+    if ((p[1] < low) || (p[1] > high))
+        return 0;
+    for (int i = 2; i < length; ++i) {
+        if ((p[i] & 0xc0) != 0x80)
+            return 0;
+    }
+    return length;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+static TextScan::Encoding classifyWith (
+        const ScanImpl & impl, const char * data, int size)
+{
+    int i = impl.ascii_run_ (data, size);
+    if (i == size)
+        return TextScan::Ascii;
+
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+    while (i < size) {
+        int n = utf8Sequence (p + i, size - i);
+        if (n == 0)
+            return TextScan::Invalid;
+        i += n;
+        if ((i < size) && (p[i] < 0x80)) {
+            i += impl.ascii_run_ (data + i, size - i);
+        }
+    }
+    return TextScan::Utf8;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+TextScan::Isa TextScan::isa ()
+{
+    return currentImpl ().isa_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool TextScan::setIsa (Isa value)
+{
+    if (!isSupported (value))
+        return false;
+    currentImpl () = implFor (value);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool TextScan::isSupported (Isa value)
+{
+    switch (value) {
+    case Scalar:
+        return true;
+    case Sse2:
+#ifdef TEXTSCAN_HAVE_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case Avx2:
+#ifdef TEXTSCAN_HAVE_AVX2
+        return __builtin_cpu_supports ("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int TextScan::printableRun (const char * data, int size)
+{
+    return currentImpl ().printable_run_ (data, size);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int TextScan::asciiRun (const char * data, int size)
+{
+    return currentImpl ().ascii_run_ (data, size);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * A sequence cut by the end of the text makes it invalid.
+ */
+TextScan::Encoding TextScan::classify (const char * data, int size)
+{
+    return classifyWith (currentImpl (), data, size);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The input looks like build output: lines of about 80 characters,
+ * some of them colored, a few with multi-byte characters. Each line is
+ * split the way the capture stage does it and then classified.
+ *
+ * The measured implementation is called directly; the one in use is
+ * neither changed nor looked at, so this may run in any thread while
+ * output is captured.
+ */
+double TextScan::measure (Isa value, int megabytes)
+{
+    if (!isSupported (value))
+        return 0.0;
+
+    static const char * const samples[] = {
+        "[ 42%] Building CXX object src/CMakeFiles/app.dir/module.cc.o\n",
+        "\x1b[1;32mok\x1b[0m   test_parser ........................ 0.12s\n",
+        "warning: unused variable 'x' [-Wunused-variable] in \xc3\xa9t\xc3\xa9.c\n",
+        "Downloading https://example.com/pkg-1.2.3.tar.gz \xe2\x86\x92 cache\n",
+        "\tat org.example.Main.run(Main.java:42)\n"
+    };
+    QByteArray input;
+    int chunk = 1024 * 1024;
+    input.reserve (chunk + 128);
+    for (int i = 0; input.size () < chunk; ++i) {
+        input.append (samples[i % (sizeof(samples) / sizeof(samples[0]))]);
+    }
+
+    const ScanImpl impl = implFor (value);
+    const char * data = input.constData ();
+    int size = input.size ();
+    int lines = 0;
+    QElapsedTimer timer;
+    timer.start ();
+    for (int round = 0; round < megabytes; ++round) {
+        int pos = 0;
+        int line_start = 0;
+        while (pos < size) {
+            pos += impl.printable_run_ (data + pos, size - pos);
+            if (pos >= size)
+                break;
+            if (data[pos] == '\n') {
+                if (classifyWith (impl, data + line_start,
+                                  pos - line_start) != Invalid)
+                    ++lines;
+                line_start = pos + 1;
+            }
+            ++pos;
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed ();
+    if ((elapsed <= 0) || (lines == 0))
+        return 0.0;
+    return static_cast<double>(size) * megabytes * 1e9 / elapsed;
+}
+/* ========================================================================= */
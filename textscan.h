@@ -0,0 +1,79 @@
+/**
+ * @file textscan.h
+ * @brief Declarations for TextScan class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_TEXTSCAN_H_INCLUDE
+#define GUARD_TEXTSCAN_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QtGlobal>
+
+//! Byte scanning primitives used on captured output.
+class PROCRUNGUI_EXPORT TextScan {
+
+public:
+
+    //! Instruction sets that an implementation may use.
+    enum Isa {
+        Scalar, /**< plain C++ */
+        Sse2, /**< 16 bytes at a time */
+        Avx2 /**< 32 bytes at a time */
+    };
+
+    //! What a piece of text turned out to be.
+    enum Encoding {
+        Ascii, /**< only 7-bit characters */
+        Utf8, /**< valid UTF-8 with some multi-byte characters */
+        Invalid /**< not valid UTF-8 */
+    };
+
+    //! The implementation in use (best one the processor supports).
+    static Isa
+    isa ();
+
+    //! Use another implementation; false if the processor lacks it.
+    //!
+    //! Not synchronized; call it before any output is captured.
+    static bool
+    setIsa (
+            Isa value);
+
+    //! Tell if the processor supports an instruction set.
+    static bool
+    isSupported (
+            Isa value);
+
+    //! Length of the leading run without control bytes (< 0x20 and 0x7f).
+    static int
+    printableRun (
+            const char * data,
+            int size);
+
+    //! Length of the leading run of 7-bit characters.
+    static int
+    asciiRun (
+            const char * data,
+            int size);
+
+    //! Find out if the text is 7-bit, valid UTF-8 or neither.
+    static Encoding
+    classify (
+            const char * data,
+            int size);
+
+    //! Bytes per second that an implementation goes through (benchmark).
+    //!
+    //! The implementation in use is neither changed nor needed.
+    static double
+    measure (
+            Isa value,
+            int megabytes = 64);
+};
+
+#endif // GUARD_TEXTSCAN_H_INCLUDE
@@ -0,0 +1,126 @@
+/**
+ * @file timerwheel.cc
+ * @brief Definitions for TimerWheel class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "timerwheel.h"
+
+#include "procrungui-private.h"
+
+/**
+ * @class TimerWheel
+ *
+ * Deadlines are rounded up to the next tick and placed in the bucket
+ * of that tick modulo SLOTS; those further away than a full turn share
+ * the bucket and are skipped until their tick comes. Scheduling and
+ * cancelling cost the same however many deadlines are pending, and a
+ * single QTimer runs, only while there is something to wait for.
+ *
+ * Cancelled entries stay in their bucket until it is next visited.
+ * Ticks missed while the event loop was busy are caught up at once.
+ */
+
+/* ------------------------------------------------------------------------- */
+TimerWheel::TimerWheel (int tick_ms, QObject *parent) :
+    QObject (parent),
+    slots_ (SLOTS),
+    live_ (),
+    clock_ (),
+    timer_ (),
+    tick_ms_ (qMax (1, tick_ms)),
+    current_ (0),
+    next_id_ (1)
+{
+    clock_.start ();
+    timer_.setInterval (tick_ms_);
+    connect (&timer_, SIGNAL(timeout()),
+             this, SLOT(tick()));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+TimerWheel::~TimerWheel()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+quint64 TimerWheel::schedule (qint64 delay_ms)
+{
+    if (live_.isEmpty ()) {
+        // nothing was looked at while stopped
+        current_ = now () / tick_ms_;
+        timer_.start ();
+    }
+
+    qint64 due = (now () + qMax (Q_INT64_C(0), delay_ms) + tick_ms_ - 1) /
+            tick_ms_;
+    if (due <= current_) {
+        due = current_ + 1;
+    }
+
+    Entry entry;
+    entry.id_ = next_id_++;
+    entry.due_ = due;
+    slots_[static_cast<int>(due % SLOTS)].append (entry);
+    live_.insert (entry.id_);
+    return entry.id_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void TimerWheel::cancel (quint64 id)
+{
+    if (id == 0)
+        return;
+    live_.remove (id);
+    if (live_.isEmpty ()) {
+        timer_.stop ();
+        for (int i = 0; i < SLOTS; ++i) {
+            slots_[i].clear ();
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The ids are collected first, as handlers of expired () are free to
+ * schedule and cancel.
+ */
+void TimerWheel::tick ()
+{
+    qint64 target = now () / tick_ms_;
+    qint64 steps = qMin (target - current_, static_cast<qint64> (SLOTS));
+
+    QList<quint64> fired;
+    for (qint64 i = 1; i <= steps; ++i) {
+        QList<Entry> & bucket = slots_[static_cast<int>((current_ + i) % SLOTS)];
+        int j = 0;
+        while (j < bucket.count ()) {
+            const Entry & entry = bucket.at (j);
+            if (!live_.contains (entry.id_)) {
+                bucket.removeAt (j);
+            } else if (entry.due_ <= target) {
+                fired.append (entry.id_);
+                live_.remove (entry.id_);
+                bucket.removeAt (j);
+            } else {
+                ++j;
+            }
+        }
+    }
+    current_ = qMax (current_, target);
+
+    if (live_.isEmpty ()) {
+        timer_.stop ();
+    }
+    foreach(quint64 id, fired) {
+        emit expired (id);
+    }
+}
+/* ========================================================================= */
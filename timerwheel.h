@@ -0,0 +1,99 @@
+/**
+ * @file timerwheel.h
+ * @brief Declarations for TimerWheel class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_TIMERWHEEL_H_INCLUDE
+#define GUARD_TIMERWHEEL_H_INCLUDE
+
+#include <procrungui/procrungui-config.h>
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+//! Many one-shot deadlines served by a single timer.
+class PROCRUNGUI_EXPORT TimerWheel : public QObject {
+    Q_OBJECT
+
+public:
+
+    //! Limits.
+    enum {
+        SLOTS = 512 /**< buckets in the wheel */
+    };
+
+    //! Constructor.
+    TimerWheel (
+            int tick_ms = 100,
+            QObject *parent = NULL);
+
+    //! Destructor.
+    virtual ~TimerWheel();
+
+    //! Expire in @a delay_ms milliseconds; the id is never 0.
+    quint64
+    schedule (
+            qint64 delay_ms);
+
+    //! Forget about a deadline (0 is ignored).
+    void
+    cancel (
+            quint64 id);
+
+    //! Number of pending deadlines.
+    int
+    count () const {
+        return live_.count ();
+    }
+
+    //! Milliseconds since the wheel was created (monotonic).
+    qint64
+    now () const {
+        return clock_.elapsed ();
+    }
+
+    //! Granularity in milliseconds.
+    int
+    tickMs () const {
+        return tick_ms_;
+    }
+
+signals:
+
+    //! A deadline was reached.
+    void
+    expired (
+            quint64 id);
+
+private slots:
+
+    //! Advance the wheel to the current time.
+    void
+    tick ();
+
+private:
+
+    //! A deadline in a bucket.
+    struct Entry {
+        quint64 id_; /**< as returned by schedule () */
+        qint64 due_; /**< tick at which it expires */
+    };
+
+    QVector<QList<Entry> > slots_; /**< buckets indexed by tick modulo SLOTS */
+    QSet<quint64> live_; /**< deadlines that were not cancelled */
+    QElapsedTimer clock_; /**< time base */
+    QTimer timer_; /**< runs while something is pending */
+    int tick_ms_; /**< milliseconds per tick */
+    qint64 current_; /**< last tick that was processed */
+    quint64 next_id_; /**< next id to hand out */
+};
+
+#endif // GUARD_TIMERWHEEL_H_INCLUDE